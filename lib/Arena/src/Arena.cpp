@@ -0,0 +1,123 @@
+#include "Arena.h"
+#include <string.h>
+
+Arena::Arena() :
+    _name(""), _base(nullptr), _size(0), _used(0), _highWater(0), _allocations(0), _failures(0), _overruns(0)
+{
+#if ARENA_CHECKS
+    _numRecords = 0;
+#endif
+}
+
+void Arena::begin(const char* name, void* base, size_t size)
+{
+    _name = name ? name : "";
+    _base = static_cast<uint8_t*>(base);
+    _size = base ? size : 0;
+    _used = 0;
+    _highWater = 0;
+    _allocations = 0;
+    _failures = 0;
+    _overruns = 0;
+#if ARENA_CHECKS
+    _numRecords = 0;
+    if (_base) memset(_base, POISON_BYTE, _size);
+#endif
+}
+
+void* Arena::allocate(size_t bytes, size_t align, const char* tag)
+{
+    if (align == 0 || (align & (align - 1)) != 0) {
+        _failures++;
+        return nullptr;
+    }
+    if (bytes == 0) bytes = 1;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(_base);
+    const uintptr_t at = (start + _used + align - 1) & ~uintptr_t(align - 1);
+    size_t need = bytes;
+#if ARENA_CHECKS
+    need += GUARD;
+#endif
+    if (_base == nullptr || at - start > _size || need > _size - (at - start)) {
+        _failures++;
+        return nullptr;
+    }
+    const size_t offset = at - start;
+    _used = offset + need;
+    if (_used > _highWater) _highWater = _used;
+    _allocations++;
+#if ARENA_CHECKS
+    memset(_base + offset + bytes, GUARD_BYTE, GUARD);
+    if (_numRecords < MAX_RECORDS) {
+        _records[_numRecords++] = Record{offset, bytes, tag ? tag : "?"};
+    }
+#else
+    (void)tag;
+#endif
+    return _base + offset;
+}
+
+bool Arena::carve(Arena& child, const char* name, size_t size)
+{
+    void* region = allocate(size, DEFAULT_ALIGN, name);
+    if (region == nullptr) {
+        return false;
+    }
+    child.begin(name, region, size);
+    return true;
+}
+
+void Arena::rewind(const ArenaMark& mark)
+{
+    if (mark.used > _used || mark.allocations > _allocations) {
+        return; // not a mark of the current contents
+    }
+#if ARENA_CHECKS
+    while (_numRecords > 0 && _records[_numRecords - 1].offset >= mark.used) {
+        if (!guardIntact(_records[_numRecords - 1])) _overruns++;
+        _numRecords--;
+    }
+    memset(_base + mark.used, POISON_BYTE, _used - mark.used);
+#endif
+    _used = mark.used;
+    _allocations = mark.allocations;
+}
+
+#if ARENA_CHECKS
+bool Arena::guardIntact(const Record& r) const
+{
+    const uint8_t* guard = _base + r.offset + r.bytes;
+    for (size_t i = 0; i < GUARD; i++) {
+        if (guard[i] != GUARD_BYTE) return false;
+    }
+    return true;
+}
+#endif
+
+bool Arena::check() const
+{
+#if ARENA_CHECKS
+    bool intact = true;
+    for (size_t i = 0; i < _numRecords; i++) {
+        if (!guardIntact(_records[i])) {
+            _overruns++;
+            intact = false;
+        }
+    }
+    return intact;
+#else
+    return true;
+#endif
+}
+
+void Arena::forEachLive(void (*fn)(const char* tag, size_t bytes, void* ctx), void* ctx) const
+{
+#if ARENA_CHECKS
+    for (size_t i = 0; i < _numRecords; i++) {
+        fn(_records[i].tag, _records[i].bytes, ctx);
+    }
+#else
+    (void)fn;
+    (void)ctx;
+#endif
+}
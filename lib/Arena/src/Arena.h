@@ -0,0 +1,126 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Bump allocator over one region reserved up front (PSRAM for large
+// datasets, such as the VNA correction table). Allocation
+// is a pointer bump to the next aligned address; nothing is freed singly.
+// Everything after a mark goes at once with rewind(), everything with
+// reset(). When the region is used up allocate() returns nullptr and counts
+// a failure; it never falls back to the heap.
+//
+// A user with its own lifetime takes a fixed budget with carve(), so that
+// resetting it cannot touch anyone else's data.
+//
+// Not thread safe: one owner allocates, under its own lock if it has one.
+// The statistics may be read from anywhere.
+//
+// With ARENA_CHECKS (the default off the ESP32) every allocation is
+// followed by a guard pattern and recorded with its tag. Guards are checked
+// when their allocation is released and by check(), released memory is
+// poisoned, and forEachLive() lists what is still allocated (leaks).
+#ifndef ARENA_CHECKS
+#if defined(ESP_PLATFORM)
+#define ARENA_CHECKS 0
+#else
+#define ARENA_CHECKS 1
+#endif
+#endif
+
+struct ArenaMark {
+    size_t used;
+    size_t allocations;
+};
+
+class Arena {
+public:
+    static constexpr size_t DEFAULT_ALIGN = 32; // ESP32-S3 cache line, PSRAM included
+#if ARENA_CHECKS
+    static constexpr size_t  GUARD        = 16;  // bytes after each allocation
+    static constexpr size_t  MAX_RECORDS  = 256; // later allocations go unchecked
+    static constexpr uint8_t GUARD_BYTE   = 0xA5;
+    static constexpr uint8_t POISON_BYTE  = 0xDD;
+#endif
+
+    Arena();
+
+    // The region must outlive the arena's use; it need not be aligned
+    void begin(const char* name, void* base, size_t size);
+
+    // nullptr if bytes do not fit; align is a power of two. bytes == 0
+    // gives a valid, unique pointer.
+    void* allocate(size_t bytes, size_t align = DEFAULT_ALIGN, const char* tag = nullptr);
+    // Uninitialised array of a trivial type
+    template <typename T>
+    T* allocateArray(size_t n, const char* tag = nullptr, size_t align = DEFAULT_ALIGN)
+    {
+        static_assert(std::is_trivially_default_constructible<T>::value, "arena arrays are not constructed");
+        if (n > SIZE_MAX / sizeof(T)) {
+            _failures++;
+            return nullptr;
+        }
+        return static_cast<T*>(allocate(n * sizeof(T), align < alignof(T) ? alignof(T) : align, tag));
+    }
+    // A child arena over size bytes of this one (false if they do not fit)
+    bool carve(Arena& child, const char* name, size_t size);
+
+    ArenaMark mark() const { return ArenaMark{_used, _allocations}; }
+    // Releases everything allocated after the mark
+    void rewind(const ArenaMark& mark);
+    void reset() { rewind(ArenaMark{0, 0}); }
+
+    const char* name() const { return _name; }
+    const void* base() const { return _base; }
+    size_t capacity() const { return _size; }
+    size_t used() const { return _used; }
+    size_t available() const { return _size - _used; }
+    size_t highWater() const { return _highWater; }
+    size_t allocations() const { return _allocations; } // live
+    uint32_t failures() const { return _failures; }
+    uint32_t overruns() const { return _overruns; }     // guards found damaged
+
+    // false if a live allocation has written past its end (always true
+    // without ARENA_CHECKS)
+    bool check() const;
+    // Live allocations, oldest first (nothing without ARENA_CHECKS)
+    void forEachLive(void (*fn)(const char* tag, size_t bytes, void* ctx), void* ctx) const;
+
+private:
+    const char* _name;
+    uint8_t*    _base;
+    size_t      _size;
+    size_t      _used;
+    size_t      _highWater;
+    size_t      _allocations;
+    uint32_t    _failures;
+    mutable uint32_t _overruns;
+#if ARENA_CHECKS
+    struct Record {
+        size_t      offset;
+        size_t      bytes;
+        const char* tag;
+    };
+    bool guardIntact(const Record& r) const;
+
+    Record _records[MAX_RECORDS];
+    size_t _numRecords;
+#endif
+};
+
+// Rewinds its arena to where it was on construction, for scratch space
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : _arena(arena), _mark(arena.mark()) {}
+    ~ArenaScope() { _arena.rewind(_mark); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena&    _arena;
+    ArenaMark _mark;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,109 @@
+#include "BlockUpload.h"
+#include <string.h>
+#include "Crc32.h"
+
+const char* uploadStatusName(UploadStatus status)
+{
+    switch (status) {
+        case UploadStatus::Idle: return "idle";
+        case UploadStatus::Receiving: return "receiving";
+        case UploadStatus::Complete: return "complete";
+        case UploadStatus::BadFrame: return "bad-frame";
+        case UploadStatus::BadCrc: return "bad-crc";
+        case UploadStatus::OutOfOrder: return "out-of-order";
+        case UploadStatus::SinkError: return "sink-error";
+        case UploadStatus::TooLarge: return "too-large";
+        default: return "unknown";
+    }
+}
+
+bool BlockReceiver::begin(UploadSink* sink, uint32_t totalSize)
+{
+    _sink = sink;
+    _total = totalSize;
+    _committed = 0;
+    _fill = 0;
+    if (sink == nullptr || totalSize == 0 || totalSize > sink->capacity()) {
+        _status = UploadStatus::TooLarge;
+        return false;
+    }
+    if (!sink->begin(totalSize)) {
+        _status = UploadStatus::SinkError;
+        return false;
+    }
+    _status = UploadStatus::Receiving;
+    return true;
+}
+
+bool BlockReceiver::resume(uint32_t resumeOffset)
+{
+    if (_sink == nullptr || _status == UploadStatus::Idle || _status == UploadStatus::SinkError ||
+        resumeOffset > _committed || resumeOffset % BLOCK_UPLOAD_SIZE != 0) {
+        return false;
+    }
+    _fill = 0;
+    if (_status != UploadStatus::Complete) {
+        _status = UploadStatus::Receiving;
+    }
+    return true;
+}
+
+bool BlockReceiver::feed(const uint8_t* data, size_t len)
+{
+    while (len > 0 && _status == UploadStatus::Receiving) {
+        if (_fill < sizeof(BlockFrameHeader)) {
+            const size_t n = len < sizeof(BlockFrameHeader) - _fill ? len : sizeof(BlockFrameHeader) - _fill;
+            memcpy(reinterpret_cast<uint8_t*>(&_header) + _fill, data, n);
+            _fill += n; data += n; len -= n;
+            if (_fill == sizeof(BlockFrameHeader) &&
+                (_header.magic != BLOCK_UPLOAD_MAGIC || _header.length == 0 || _header.length > BLOCK_UPLOAD_SIZE ||
+                 _header.offset % BLOCK_UPLOAD_SIZE != 0 || uint64_t(_header.offset) + _header.length > _total)) {
+                _status = UploadStatus::BadFrame;
+            }
+            continue;
+        }
+        const size_t have = _fill - sizeof(BlockFrameHeader);
+        const size_t n = len < _header.length - have ? len : _header.length - have;
+        memcpy(_block + have, data, n);
+        _fill += n; data += n; len -= n;
+        if (_fill == sizeof(BlockFrameHeader) + _header.length) {
+            commitFrame();
+            _fill = 0;
+        }
+    }
+    return !failed();
+}
+
+bool BlockReceiver::commitFrame()
+{
+    if (crc32(_block, _header.length) != _header.crc32) {
+        _status = UploadStatus::BadCrc;
+        return false;
+    }
+    if (_header.offset < _committed) {
+        return true; // resent block, already in flash
+    }
+    if (_header.offset > _committed) {
+        _status = UploadStatus::OutOfOrder;
+        return false;
+    }
+    // Only the final block may be short
+    if (_header.length != BLOCK_UPLOAD_SIZE && _header.offset + _header.length != _total) {
+        _status = UploadStatus::BadFrame;
+        return false;
+    }
+    if (!_sink->write(_header.offset, _block, _header.length)) {
+        _status = UploadStatus::SinkError;
+        return false;
+    }
+    _committed += _header.length;
+    if (_committed == _total) {
+        _status = _sink->finish() ? UploadStatus::Complete : UploadStatus::SinkError;
+    }
+    return true;
+}
+
+BlockFrameHeader BlockReceiver::frameHeader(uint32_t offset, const uint8_t* payload, uint32_t len)
+{
+    return BlockFrameHeader{BLOCK_UPLOAD_MAGIC, offset, len, crc32(payload, len)};
+}
@@ -0,0 +1,85 @@
+#ifndef BLOCK_UPLOAD_H
+#define BLOCK_UPLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Framed, resumable upload of a large image into flash. The HTTP body is a
+// sequence of frames, each a BlockFrameHeader followed by `length` payload
+// bytes. Frames may be split arbitrarily across TCP segments; BlockReceiver
+// reassembles one frame at a time in a fixed buffer, checks its CRC-32 and
+// position, and hands it to an UploadSink. Memory use is one block no matter
+// how large the image is.
+//
+// Every frame except the last carries exactly BLOCK_UPLOAD_SIZE bytes at a
+// multiple of BLOCK_UPLOAD_SIZE, i.e. one flash sector. A frame for an
+// offset that was already committed is skipped, so a client resuming after a
+// dropped connection may safely resend from any earlier block boundary.
+
+static constexpr uint32_t BLOCK_UPLOAD_MAGIC = 0x42555447; // "GTUB"
+static constexpr size_t   BLOCK_UPLOAD_SIZE  = 4096;
+
+struct BlockFrameHeader {
+    uint32_t magic;
+    uint32_t offset;  // position of the payload in the image
+    uint32_t length;  // payload bytes, at most BLOCK_UPLOAD_SIZE
+    uint32_t crc32;   // CRC-32 of the payload
+};
+
+// Destination of an upload, e.g. a flash partition
+class UploadSink {
+public:
+    virtual ~UploadSink() {}
+    virtual size_t capacity() const = 0;
+    virtual bool begin(uint32_t totalSize) = 0;
+    // Called with block-aligned offsets in increasing order
+    virtual bool write(uint32_t offset, const uint8_t* data, size_t len) = 0;
+    virtual bool finish() = 0;
+};
+
+enum class UploadStatus : uint8_t {
+    Idle,
+    Receiving,
+    Complete,
+    BadFrame,     // magic, length or alignment error
+    BadCrc,
+    OutOfOrder,   // a gap: the frame starts after the committed offset
+    SinkError,
+    TooLarge
+};
+
+const char* uploadStatusName(UploadStatus status);
+
+class BlockReceiver {
+public:
+    BlockReceiver() : _sink(nullptr), _total(0), _committed(0), _fill(0), _status(UploadStatus::Idle) {}
+
+    // Starts a new upload of totalSize bytes into sink
+    bool begin(UploadSink* sink, uint32_t totalSize);
+    // Continues the current upload; resumeOffset must be a block boundary not
+    // beyond the committed offset. Clears a previous frame error.
+    bool resume(uint32_t resumeOffset);
+    // Feeds body bytes; returns false once the upload has failed
+    bool feed(const uint8_t* data, size_t len);
+
+    UploadStatus status() const { return _status; }
+    bool failed() const { return _status > UploadStatus::Complete; }
+    uint32_t committed() const { return _committed; }
+    uint32_t total() const { return _total; }
+
+    // Builds the header for the payload at `offset` (used by clients and tools)
+    static BlockFrameHeader frameHeader(uint32_t offset, const uint8_t* payload, uint32_t len);
+
+private:
+    bool commitFrame();
+
+    UploadSink*      _sink;
+    uint32_t         _total;
+    uint32_t         _committed;
+    size_t           _fill; // bytes of the current frame received, header included
+    UploadStatus     _status;
+    BlockFrameHeader _header;
+    uint8_t          _block[BLOCK_UPLOAD_SIZE];
+};
+
+#endif // BLOCK_UPLOAD_H
@@ -0,0 +1,27 @@
+#include "FlashImageSink.h"
+#include <string.h>
+
+bool FlashImageSink::begin(uint32_t totalSize)
+{
+    _firstLen = 0;
+    return _flash != nullptr && totalSize <= _size;
+}
+
+bool FlashImageSink::write(uint32_t offset, const uint8_t* data, size_t len)
+{
+    // Sectors are erased as their block arrives, keeping each call short
+    if (!_flash->flashErase(offset, BLOCK_UPLOAD_SIZE)) {
+        return false;
+    }
+    if (offset == 0) {
+        memcpy(_first, data, len);
+        _firstLen = len;
+        return true;
+    }
+    return _flash->flashWrite(offset, data, uint32_t(len));
+}
+
+bool FlashImageSink::finish()
+{
+    return _firstLen > 0 && _flash->flashWrite(0, _first, uint32_t(_firstLen));
+}
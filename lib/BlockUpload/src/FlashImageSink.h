@@ -0,0 +1,31 @@
+#ifndef FLASH_IMAGE_SINK_H
+#define FLASH_IMAGE_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "BlockUpload.h"
+#include "SweepStore.h" // For SweepFlash
+
+// Copies an uploaded image into a flash area, one sector per block. The first
+// block holds the image's header (magic, sizes, CRC), so its sector is erased
+// as soon as the upload starts writing and the block itself is kept back and
+// written last: an upload cut off part way leaves an area whose header reads
+// as erased, never a valid header over half-written data.
+class FlashImageSink : public UploadSink {
+public:
+    FlashImageSink() : _flash(nullptr), _size(0), _firstLen(0) {}
+    void attach(SweepFlash* flash, size_t size) { _flash = flash; _size = size; }
+
+    size_t capacity() const override { return _flash ? _size : 0; }
+    bool begin(uint32_t totalSize) override;
+    bool write(uint32_t offset, const uint8_t* data, size_t len) override;
+    bool finish() override;
+
+private:
+    SweepFlash* _flash;
+    size_t      _size;
+    size_t      _firstLen; // bytes kept back in _first, 0 before block 0 arrives
+    uint8_t     _first[BLOCK_UPLOAD_SIZE];
+};
+
+#endif // FLASH_IMAGE_SINK_H
@@ -0,0 +1,13 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Standard CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320), same value as zlib's crc32().
+// Pass the previous return value as `crc` to checksum data in pieces; start with 0.
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len);
+
+inline uint32_t crc32(const void* data, size_t len) { return crc32Update(0, data, len); }
+
+#endif // CRC32_H
@@ -0,0 +1,86 @@
+#include "CplxKernels.h"
+#include "CplxKernelsPaths.h"
+
+static void scalarMul(CplxIn x, CplxIn y, CplxOut out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        const float xr = x.re[i], xi = x.im[i], yr = y.re[i], yi = y.im[i];
+        out.re[i] = xr * yr - xi * yi;
+        out.im[i] = xr * yi + xi * yr;
+    }
+}
+
+static void scalarDiv(CplxIn x, CplxIn y, CplxOut out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        const float xr = x.re[i], xi = x.im[i], yr = y.re[i], yi = y.im[i];
+        const float k = 1.0f / (yr * yr + yi * yi);
+        out.re[i] = (xr * yr + xi * yi) * k;
+        out.im[i] = (xi * yr - xr * yi) * k;
+    }
+}
+
+static void scalarAbs2(CplxIn x, float* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = x.re[i] * x.re[i] + x.im[i] * x.im[i];
+    }
+}
+
+static void scalarGamma2(CplxIn z, float z0, float* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        const float rm = z.re[i] - z0, rp = z.re[i] + z0, x2 = z.im[i] * z.im[i];
+        out[i] = (rm * rm + x2) / (rp * rp + x2);
+    }
+}
+
+// p*q + r*s for one element
+static inline void mulAdd2(CplxIn p, CplxIn q, CplxIn r, CplxIn s, CplxOut out, size_t i)
+{
+    out.re[i] = (p.re[i] * q.re[i] - p.im[i] * q.im[i]) + (r.re[i] * s.re[i] - r.im[i] * s.im[i]);
+    out.im[i] = (p.re[i] * q.im[i] + p.im[i] * q.re[i]) + (r.re[i] * s.im[i] + r.im[i] * s.re[i]);
+}
+
+static void scalarCascade(const AbcdIn& m1, const AbcdIn& m2, const AbcdOut& out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        mulAdd2(m1.a, m2.a, m1.b, m2.c, out.a, i);
+        mulAdd2(m1.a, m2.b, m1.b, m2.d, out.b, i);
+        mulAdd2(m1.c, m2.a, m1.d, m2.c, out.c, i);
+        mulAdd2(m1.c, m2.b, m1.d, m2.d, out.d, i);
+    }
+}
+
+static const CplxKernels s_scalar = {
+    "scalar", scalarMul, scalarDiv, scalarAbs2, scalarGamma2, scalarCascade
+};
+
+const CplxKernels* scalarCplxKernels()
+{
+    return &s_scalar;
+}
+
+const CplxKernels* cplxKernels(KernelPath path)
+{
+    switch (path) {
+    case KernelPath::Scalar: return scalarCplxKernels();
+    case KernelPath::Sse2:   return sse2CplxKernels();
+    case KernelPath::Avx2:
+#if defined(__x86_64__) || defined(__i386__)
+        if (!__builtin_cpu_supports("avx2")) return nullptr;
+#endif
+        return avx2CplxKernels();
+    case KernelPath::EspDsp: return espDspCplxKernels();
+    }
+    return nullptr;
+}
+
+const CplxKernels& cplxKernelsBest()
+{
+    static const KernelPath order[] = {KernelPath::Avx2, KernelPath::Sse2, KernelPath::EspDsp};
+    for (KernelPath path : order) {
+        if (const CplxKernels* k = cplxKernels(path)) return *k;
+    }
+    return s_scalar;
+}
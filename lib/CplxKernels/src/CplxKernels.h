@@ -0,0 +1,74 @@
+#ifndef CPLX_KERNELS_H
+#define CPLX_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Batched complex arithmetic over structure-of-arrays float data, the inner
+// loops of network evaluation: products and quotients for ABCD cascades and
+// |Gamma|^2 for reflection coefficients, repeated across many states or
+// frequencies.
+//
+// Each instruction-set path fills the same table of kernels:
+//   Scalar  plain C++, the reference for the others
+//   Sse2    x86 hosts, 4 lanes
+//   Avx2    x86 hosts with AVX2 (checked at run time), 8 lanes
+//   EspDsp  ESP32 builds with esp-dsp available; its vector primitives select
+//           the ae32/aes3 (PIE) implementations for the chip
+// cplxKernels(path) returns nullptr for a path not built or not supported by
+// the CPU; cplxKernelsBest() picks the fastest available one.
+//
+// Outputs may alias an input of the same element (out = x is fine), except
+// for cascade(), whose output must not overlap its inputs.
+
+struct CplxIn {
+    const float* re;
+    const float* im;
+};
+
+struct CplxOut {
+    float* re;
+    float* im;
+};
+
+// One 2x2 complex [A B; C D] matrix per element
+struct AbcdIn {
+    CplxIn a, b, c, d;
+};
+
+struct AbcdOut {
+    CplxOut a, b, c, d;
+};
+
+struct CplxKernels {
+    const char* name;
+    void (*mul)(CplxIn x, CplxIn y, CplxOut out, size_t n);
+    void (*div)(CplxIn x, CplxIn y, CplxOut out, size_t n);
+    void (*abs2)(CplxIn x, float* out, size_t n);
+    // |Gamma|^2 = |z - z0|^2 / |z + z0|^2 for impedances z and real z0
+    void (*gamma2)(CplxIn z, float z0, float* out, size_t n);
+    // out = m1 * m2, i.e. m1 followed by m2 in a cascade
+    void (*cascade)(const AbcdIn& m1, const AbcdIn& m2, const AbcdOut& out, size_t n);
+};
+
+enum class KernelPath : uint8_t {
+    Scalar,
+    Sse2,
+    Avx2,
+    EspDsp
+};
+
+static constexpr size_t NUM_KERNEL_PATHS = 4;
+
+// Accuracy contract against a double-precision reference, checked for every
+// path by `program bench-kernels`:
+//   each result within CPLX_KERNEL_REL_TOL of the magnitude of the terms that
+//   form it (|x||y| for mul, |x|/|y| for div, sum of |products| for cascade)
+static constexpr float CPLX_KERNEL_REL_TOL = 1e-6f;
+//   SWR derived from gamma2 within CPLX_KERNEL_SWR_TOL up to SWR 20
+static constexpr float CPLX_KERNEL_SWR_TOL = 1e-4f;
+
+const CplxKernels* cplxKernels(KernelPath path);
+const CplxKernels& cplxKernelsBest();
+
+#endif // CPLX_KERNELS_H
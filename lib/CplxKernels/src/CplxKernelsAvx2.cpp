@@ -0,0 +1,39 @@
+#include "CplxKernelsPaths.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC target("avx2")
+#include <immintrin.h>
+#include "CplxKernelsSimd.h"
+
+namespace {
+struct Avx2 {
+    typedef __m256 T;
+    static constexpr size_t W = 8;
+    static T load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, T v) { _mm256_storeu_ps(p, v); }
+    static T set1(float v) { return _mm256_set1_ps(v); }
+    static T add(T a, T b) { return _mm256_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_ps(a, b); }
+    static T mul(T a, T b) { return _mm256_mul_ps(a, b); }
+    static T div(T a, T b) { return _mm256_div_ps(a, b); }
+};
+} // namespace
+
+static const CplxKernels s_avx2 = {
+    "avx2", simdMul<Avx2>, simdDiv<Avx2>, simdAbs2<Avx2>, simdGamma2<Avx2>, simdCascade<Avx2>
+};
+
+const CplxKernels* avx2CplxKernels()
+{
+    return &s_avx2;
+}
+
+#else
+
+const CplxKernels* avx2CplxKernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include "CplxKernelsPaths.h"
+
+#if defined(ESP_PLATFORM) && __has_include(<esp_dsp.h>)
+
+#include <esp_dsp.h>
+
+// esp-dsp has real vector primitives only, so each complex kernel is built
+// from them over chunks small enough for stack scratch. Every chunk reads its
+// inputs completely before writing, which keeps aliased outputs safe.
+static constexpr int CHUNK = 64;
+
+static inline const float* at(const float* p, size_t i) { return p + i; }
+
+static void espMul(CplxIn x, CplxIn y, CplxOut out, size_t n)
+{
+    float rr[CHUNK], ii[CHUNK], ri[CHUNK], ir[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const int len = int(n - i < size_t(CHUNK) ? n - i : CHUNK);
+        dsps_mul_f32(at(x.re, i), at(y.re, i), rr, len, 1, 1, 1);
+        dsps_mul_f32(at(x.im, i), at(y.im, i), ii, len, 1, 1, 1);
+        dsps_mul_f32(at(x.re, i), at(y.im, i), ri, len, 1, 1, 1);
+        dsps_mul_f32(at(x.im, i), at(y.re, i), ir, len, 1, 1, 1);
+        dsps_sub_f32(rr, ii, out.re + i, len, 1, 1, 1);
+        dsps_add_f32(ri, ir, out.im + i, len, 1, 1, 1);
+    }
+}
+
+static void espDiv(CplxIn x, CplxIn y, CplxOut out, size_t n)
+{
+    float k[CHUNK], t0[CHUNK], t1[CHUNK], re[CHUNK], im[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const int len = int(n - i < size_t(CHUNK) ? n - i : CHUNK);
+        dsps_mul_f32(at(y.re, i), at(y.re, i), t0, len, 1, 1, 1);
+        dsps_mul_f32(at(y.im, i), at(y.im, i), t1, len, 1, 1, 1);
+        dsps_add_f32(t0, t1, k, len, 1, 1, 1);
+        for (int j = 0; j < len; j++) k[j] = 1.0f / k[j];
+        dsps_mul_f32(at(x.re, i), at(y.re, i), t0, len, 1, 1, 1);
+        dsps_mul_f32(at(x.im, i), at(y.im, i), t1, len, 1, 1, 1);
+        dsps_add_f32(t0, t1, re, len, 1, 1, 1);
+        dsps_mul_f32(at(x.im, i), at(y.re, i), t0, len, 1, 1, 1);
+        dsps_mul_f32(at(x.re, i), at(y.im, i), t1, len, 1, 1, 1);
+        dsps_sub_f32(t0, t1, im, len, 1, 1, 1);
+        dsps_mul_f32(re, k, out.re + i, len, 1, 1, 1);
+        dsps_mul_f32(im, k, out.im + i, len, 1, 1, 1);
+    }
+}
+
+static void espAbs2(CplxIn x, float* out, size_t n)
+{
+    float rr[CHUNK], ii[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const int len = int(n - i < size_t(CHUNK) ? n - i : CHUNK);
+        dsps_mul_f32(at(x.re, i), at(x.re, i), rr, len, 1, 1, 1);
+        dsps_mul_f32(at(x.im, i), at(x.im, i), ii, len, 1, 1, 1);
+        dsps_add_f32(rr, ii, out + i, len, 1, 1, 1);
+    }
+}
+
+static void espGamma2(CplxIn z, float z0, float* out, size_t n)
+{
+    float rm[CHUNK], rp[CHUNK], x2[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const int len = int(n - i < size_t(CHUNK) ? n - i : CHUNK);
+        dsps_addc_f32(at(z.re, i), rm, len, -z0, 1, 1);
+        dsps_addc_f32(at(z.re, i), rp, len, z0, 1, 1);
+        dsps_mul_f32(at(z.im, i), at(z.im, i), x2, len, 1, 1, 1);
+        dsps_mul_f32(rm, rm, rm, len, 1, 1, 1);
+        dsps_mul_f32(rp, rp, rp, len, 1, 1, 1);
+        dsps_add_f32(rm, x2, rm, len, 1, 1, 1);
+        dsps_add_f32(rp, x2, rp, len, 1, 1, 1);
+        for (int j = 0; j < len; j++) out[i + j] = rm[j] / rp[j];
+    }
+}
+
+// out = p*q + r*s over one chunk
+static void espMulAdd2(CplxIn p, CplxIn q, CplxIn r, CplxIn s, CplxOut out, size_t i, int len)
+{
+    float pqRe[CHUNK], pqIm[CHUNK], rsRe[CHUNK], rsIm[CHUNK];
+    espMul(CplxIn{p.re + i, p.im + i}, CplxIn{q.re + i, q.im + i}, CplxOut{pqRe, pqIm}, size_t(len));
+    espMul(CplxIn{r.re + i, r.im + i}, CplxIn{s.re + i, s.im + i}, CplxOut{rsRe, rsIm}, size_t(len));
+    dsps_add_f32(pqRe, rsRe, out.re + i, len, 1, 1, 1);
+    dsps_add_f32(pqIm, rsIm, out.im + i, len, 1, 1, 1);
+}
+
+static void espCascade(const AbcdIn& m1, const AbcdIn& m2, const AbcdOut& out, size_t n)
+{
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const int len = int(n - i < size_t(CHUNK) ? n - i : CHUNK);
+        espMulAdd2(m1.a, m2.a, m1.b, m2.c, out.a, i, len);
+        espMulAdd2(m1.a, m2.b, m1.b, m2.d, out.b, i, len);
+        espMulAdd2(m1.c, m2.a, m1.d, m2.c, out.c, i, len);
+        espMulAdd2(m1.c, m2.b, m1.d, m2.d, out.d, i, len);
+    }
+}
+
+static const CplxKernels s_espDsp = {
+    "esp-dsp", espMul, espDiv, espAbs2, espGamma2, espCascade
+};
+
+const CplxKernels* espDspCplxKernels()
+{
+    return &s_espDsp;
+}
+
+#else
+
+const CplxKernels* espDspCplxKernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef CPLX_KERNELS_PATHS_H
+#define CPLX_KERNELS_PATHS_H
+
+#include "CplxKernels.h"
+
+// Per-path kernel tables, internal to the library. Each returns nullptr when
+// its path is not compiled into this build.
+const CplxKernels* scalarCplxKernels();
+const CplxKernels* sse2CplxKernels();
+const CplxKernels* avx2CplxKernels();
+const CplxKernels* espDspCplxKernels();
+
+#endif // CPLX_KERNELS_PATHS_H
@@ -0,0 +1,100 @@
+#ifndef CPLX_KERNELS_SIMD_H
+#define CPLX_KERNELS_SIMD_H
+
+// Kernel bodies shared by the x86 paths, written once against a vector
+// traits type V (load, store, set1, add, sub, mul, div over V::W lanes).
+// Included only by the per-ISA translation units after their target pragma;
+// everything here has internal linkage so no ISA-specific code can be merged
+// into callers built for another ISA. Tails fall back to the scalar table.
+
+#include "CplxKernels.h"
+#include "CplxKernelsPaths.h"
+
+namespace {
+
+template <class V>
+void simdMul(CplxIn x, CplxIn y, CplxOut out, size_t n)
+{
+    size_t i = 0;
+    for (; i + V::W <= n; i += V::W) {
+        const typename V::T xr = V::load(x.re + i), xi = V::load(x.im + i);
+        const typename V::T yr = V::load(y.re + i), yi = V::load(y.im + i);
+        V::store(out.re + i, V::sub(V::mul(xr, yr), V::mul(xi, yi)));
+        V::store(out.im + i, V::add(V::mul(xr, yi), V::mul(xi, yr)));
+    }
+    scalarCplxKernels()->mul(CplxIn{x.re + i, x.im + i}, CplxIn{y.re + i, y.im + i}, CplxOut{out.re + i, out.im + i}, n - i);
+}
+
+template <class V>
+void simdDiv(CplxIn x, CplxIn y, CplxOut out, size_t n)
+{
+    size_t i = 0;
+    const typename V::T one = V::set1(1.0f);
+    for (; i + V::W <= n; i += V::W) {
+        const typename V::T xr = V::load(x.re + i), xi = V::load(x.im + i);
+        const typename V::T yr = V::load(y.re + i), yi = V::load(y.im + i);
+        const typename V::T k = V::div(one, V::add(V::mul(yr, yr), V::mul(yi, yi)));
+        V::store(out.re + i, V::mul(V::add(V::mul(xr, yr), V::mul(xi, yi)), k));
+        V::store(out.im + i, V::mul(V::sub(V::mul(xi, yr), V::mul(xr, yi)), k));
+    }
+    scalarCplxKernels()->div(CplxIn{x.re + i, x.im + i}, CplxIn{y.re + i, y.im + i}, CplxOut{out.re + i, out.im + i}, n - i);
+}
+
+template <class V>
+void simdAbs2(CplxIn x, float* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + V::W <= n; i += V::W) {
+        const typename V::T xr = V::load(x.re + i), xi = V::load(x.im + i);
+        V::store(out + i, V::add(V::mul(xr, xr), V::mul(xi, xi)));
+    }
+    scalarCplxKernels()->abs2(CplxIn{x.re + i, x.im + i}, out + i, n - i);
+}
+
+template <class V>
+void simdGamma2(CplxIn z, float z0, float* out, size_t n)
+{
+    size_t i = 0;
+    const typename V::T r0 = V::set1(z0);
+    for (; i + V::W <= n; i += V::W) {
+        const typename V::T r = V::load(z.re + i), x = V::load(z.im + i);
+        const typename V::T rm = V::sub(r, r0), rp = V::add(r, r0), x2 = V::mul(x, x);
+        V::store(out + i, V::div(V::add(V::mul(rm, rm), x2), V::add(V::mul(rp, rp), x2)));
+    }
+    scalarCplxKernels()->gamma2(CplxIn{z.re + i, z.im + i}, z0, out + i, n - i);
+}
+
+// p*q + r*s over lanes [i, i + W)
+template <class V>
+inline void simdMulAdd2(CplxIn p, CplxIn q, CplxIn r, CplxIn s, CplxOut out, size_t i)
+{
+    const typename V::T pr = V::load(p.re + i), pi = V::load(p.im + i);
+    const typename V::T qr = V::load(q.re + i), qi = V::load(q.im + i);
+    const typename V::T rr = V::load(r.re + i), ri = V::load(r.im + i);
+    const typename V::T sr = V::load(s.re + i), si = V::load(s.im + i);
+    V::store(out.re + i, V::add(V::sub(V::mul(pr, qr), V::mul(pi, qi)), V::sub(V::mul(rr, sr), V::mul(ri, si))));
+    V::store(out.im + i, V::add(V::add(V::mul(pr, qi), V::mul(pi, qr)), V::add(V::mul(rr, si), V::mul(ri, sr))));
+}
+
+inline CplxIn offsetIn(CplxIn x, size_t i) { return CplxIn{x.re + i, x.im + i}; }
+inline CplxOut offsetOut(CplxOut x, size_t i) { return CplxOut{x.re + i, x.im + i}; }
+
+template <class V>
+void simdCascade(const AbcdIn& m1, const AbcdIn& m2, const AbcdOut& out, size_t n)
+{
+    size_t i = 0;
+    for (; i + V::W <= n; i += V::W) {
+        simdMulAdd2<V>(m1.a, m2.a, m1.b, m2.c, out.a, i);
+        simdMulAdd2<V>(m1.a, m2.b, m1.b, m2.d, out.b, i);
+        simdMulAdd2<V>(m1.c, m2.a, m1.d, m2.c, out.c, i);
+        simdMulAdd2<V>(m1.c, m2.b, m1.d, m2.d, out.d, i);
+    }
+    const AbcdIn t1 = {offsetIn(m1.a, i), offsetIn(m1.b, i), offsetIn(m1.c, i), offsetIn(m1.d, i)};
+    const AbcdIn t2 = {offsetIn(m2.a, i), offsetIn(m2.b, i), offsetIn(m2.c, i), offsetIn(m2.d, i)};
+    const AbcdOut to = {offsetOut(out.a, i), offsetOut(out.b, i), offsetOut(out.c, i), offsetOut(out.d, i)};
+    scalarCplxKernels()->cascade(t1, t2, to, n - i);
+}
+
+} // namespace
+
+#endif // CPLX_KERNELS_SIMD_H
@@ -0,0 +1,39 @@
+#include "CplxKernelsPaths.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC target("sse2")
+#include <emmintrin.h>
+#include "CplxKernelsSimd.h"
+
+namespace {
+struct Sse2 {
+    typedef __m128 T;
+    static constexpr size_t W = 4;
+    static T load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, T v) { _mm_storeu_ps(p, v); }
+    static T set1(float v) { return _mm_set1_ps(v); }
+    static T add(T a, T b) { return _mm_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm_sub_ps(a, b); }
+    static T mul(T a, T b) { return _mm_mul_ps(a, b); }
+    static T div(T a, T b) { return _mm_div_ps(a, b); }
+};
+} // namespace
+
+static const CplxKernels s_sse2 = {
+    "sse2", simdMul<Sse2>, simdDiv<Sse2>, simdAbs2<Sse2>, simdGamma2<Sse2>, simdCascade<Sse2>
+};
+
+const CplxKernels* sse2CplxKernels()
+{
+    return &s_sse2;
+}
+
+#else
+
+const CplxKernels* sse2CplxKernels()
+{
+    return nullptr;
+}
+
+#endif
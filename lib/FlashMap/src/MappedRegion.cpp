@@ -0,0 +1,87 @@
+#include "MappedRegion.h"
+
+#if !defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedRegion::MappedRegion() : _data(nullptr), _size(0)
+#if defined(ESP_PLATFORM)
+    , _handle(0)
+#endif
+{
+}
+
+MappedRegion::~MappedRegion()
+{
+    unmap();
+}
+
+#if defined(ESP_PLATFORM)
+
+bool MappedRegion::mapPartition(const char* label, uint8_t subtype)
+{
+    unmap();
+    const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)subtype, label);
+    if (part == nullptr) {
+        return false;
+    }
+    const void* ptr = nullptr;
+    if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &_handle) != ESP_OK) {
+        return false;
+    }
+    _data = static_cast<const uint8_t*>(ptr);
+    _size = part->size;
+    return true;
+}
+
+void MappedRegion::unmap()
+{
+    if (_data != nullptr) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+        esp_partition_munmap(_handle);
+#else
+        spi_flash_munmap(_handle);
+#endif
+    }
+    _data = nullptr;
+    _size = 0;
+}
+
+#else
+
+bool MappedRegion::mapFile(const char* path)
+{
+    unmap();
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    _data = static_cast<const uint8_t*>(ptr);
+    _size = size_t(st.st_size);
+    return true;
+}
+
+void MappedRegion::unmap()
+{
+    if (_data != nullptr) {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MAPPED_REGION_H
+#define MAPPED_REGION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#endif
+
+// Read-only memory mapping of a data blob so it can be used in place, with no
+// copy into RAM: a flash partition (esp_partition_mmap) on the ESP32, or a
+// file (mmap) on the host. Mapping cost does not depend on the blob size.
+class MappedRegion {
+public:
+    MappedRegion();
+    ~MappedRegion();
+    MappedRegion(const MappedRegion&) = delete;
+    MappedRegion& operator=(const MappedRegion&) = delete;
+
+#if defined(ESP_PLATFORM)
+    // Maps the whole data partition with the given label and subtype
+    bool mapPartition(const char* label, uint8_t subtype);
+#else
+    bool mapFile(const char* path);
+#endif
+    void unmap();
+
+    bool isMapped() const { return _data != nullptr; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const uint8_t* _data;
+    size_t         _size;
+#if defined(ESP_PLATFORM)
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_partition_mmap_handle_t _handle;
+#else
+    spi_flash_mmap_handle_t     _handle;
+#endif
+#endif
+};
+
+#endif // MAPPED_REGION_H
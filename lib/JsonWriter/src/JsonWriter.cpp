@@ -0,0 +1,173 @@
+#include "JsonWriter.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t jsonEscape(char* out, size_t size, const char* s)
+{
+    if (size == 0) {
+        return 0;
+    }
+    size_t n = 0;
+    for (; *s && n + 7 < size; s++) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = char(c);
+        } else if (c == '\n') {
+            out[n++] = '\\';
+            out[n++] = 'n';
+        } else if (c < 0x20) {
+            n += size_t(snprintf(out + n, size - n, "\\u%04x", c));
+        } else {
+            out[n++] = char(c);
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+JsonWriter::JsonWriter(char* out, size_t size) :
+    _out(out), _size(size), _length(0), _hasMembers(0), _depth(0), _overflow(size == 0)
+{
+    if (size > 0) out[0] = '\0';
+}
+
+bool JsonWriter::raw(const char* s, size_t n)
+{
+    if (_overflow || n >= _size - _length) {
+        _overflow = true;
+        return false;
+    }
+    memcpy(_out + _length, s, n);
+    _length += n;
+    _out[_length] = '\0';
+    return true;
+}
+
+// Escaped in place, character by character, so nothing is staged
+bool JsonWriter::quoted(const char* s)
+{
+    if (!raw("\"", 1)) return false;
+    char esc[8];
+    for (; *s; s++) {
+        const unsigned char c = (unsigned char)*s;
+        bool ok;
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = char(c);
+            ok = raw(esc, 2);
+        } else if (c == '\n') {
+            ok = raw("\\n", 2);
+        } else if (c < 0x20) {
+            ok = raw(esc, size_t(snprintf(esc, sizeof(esc), "\\u%04x", c)));
+        } else {
+            ok = raw(s, 1);
+        }
+        if (!ok) return false;
+    }
+    return raw("\"", 1);
+}
+
+bool JsonWriter::member(const char* key)
+{
+    if (_overflow) return false;
+    const uint32_t bit = uint32_t(1) << _depth;
+    if (_hasMembers & bit) {
+        if (!raw(",", 1)) return false;
+    }
+    _hasMembers |= bit;
+    if (key != nullptr) {
+        return quoted(key) && raw(":", 1);
+    }
+    return true;
+}
+
+bool JsonWriter::open(const char* key, char bracket)
+{
+    if (size_t(_depth) + 1 >= MAX_DEPTH) {
+        _overflow = true;
+        return false;
+    }
+    if (_depth > 0 || _length > 0) {
+        if (!member(key)) return false;
+    }
+    if (!raw(&bracket, 1)) return false;
+    _depth++;
+    _hasMembers &= ~(uint32_t(1) << _depth);
+    return true;
+}
+
+JsonWriter& JsonWriter::close(char bracket)
+{
+    if (_depth == 0) {
+        _overflow = true;
+        return *this;
+    }
+    if (raw(&bracket, 1)) _depth--;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject(const char* key)
+{
+    open(key, '{');
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+    return close('}');
+}
+
+JsonWriter& JsonWriter::beginArray(const char* key)
+{
+    open(key, '[');
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+    return close(']');
+}
+
+JsonWriter& JsonWriter::string(const char* key, const char* value)
+{
+    if (member(key)) quoted(value ? value : "");
+    return *this;
+}
+
+JsonWriter& JsonWriter::number(const char* key, uint32_t value)
+{
+    char text[12];
+    if (member(key)) raw(text, size_t(snprintf(text, sizeof(text), "%u", (unsigned)value)));
+    return *this;
+}
+
+JsonWriter& JsonWriter::number(const char* key, int32_t value)
+{
+    char text[12];
+    if (member(key)) raw(text, size_t(snprintf(text, sizeof(text), "%d", (int)value)));
+    return *this;
+}
+
+JsonWriter& JsonWriter::number(const char* key, double value, int precision)
+{
+    if (!isfinite(value)) {
+        return null(key);
+    }
+    char text[32];
+    if (member(key)) raw(text, size_t(snprintf(text, sizeof(text), "%.*g", precision, value)));
+    return *this;
+}
+
+JsonWriter& JsonWriter::boolean(const char* key, bool value)
+{
+    if (member(key)) raw(value ? "true" : "false", value ? 4 : 5);
+    return *this;
+}
+
+JsonWriter& JsonWriter::null(const char* key)
+{
+    if (member(key)) raw("null", 4);
+    return *this;
+}
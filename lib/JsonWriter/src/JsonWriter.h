@@ -0,0 +1,62 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Copies s into out as a JSON string body (without the quotes), truncated
+// at a whole character to fit; returns the length
+size_t jsonEscape(char* out, size_t size, const char* s);
+
+// JSON written straight into a caller buffer: no heap, no intermediate
+// strings. Members are added in order, nested objects and arrays opened and
+// closed explicitly; commas and escaping are taken care of. key is the
+// member name inside an object and nullptr inside an array.
+//
+// A value that does not fit marks the writer overflowed and everything after
+// it is dropped, so finish() only returns a length for complete documents.
+//
+//   JsonWriter json(buffer, sizeof(buffer));
+//   json.beginObject().number("id", id).string("state", "queued").endObject();
+//   const size_t length = json.finish();
+class JsonWriter {
+public:
+    static constexpr size_t MAX_DEPTH = 16;
+
+    JsonWriter(char* out, size_t size);
+
+    JsonWriter& beginObject(const char* key = nullptr);
+    JsonWriter& endObject();
+    JsonWriter& beginArray(const char* key = nullptr);
+    JsonWriter& endArray();
+
+    JsonWriter& string(const char* key, const char* value);
+    JsonWriter& number(const char* key, uint32_t value);
+    JsonWriter& number(const char* key, int32_t value);
+    // %.*g; NaN and infinities as null
+    JsonWriter& number(const char* key, double value, int precision = 7);
+    JsonWriter& boolean(const char* key, bool value);
+    JsonWriter& null(const char* key);
+
+    // Length of the NUL-terminated document, 0 if it overflowed or is not
+    // closed
+    size_t finish() const { return _overflow || _depth != 0 ? 0 : _length; }
+    bool overflowed() const { return _overflow; }
+    size_t length() const { return _length; }
+
+private:
+    bool member(const char* key); // comma and "key":
+    bool open(const char* key, char bracket);
+    JsonWriter& close(char bracket);
+    bool raw(const char* s, size_t n);
+    bool quoted(const char* s);
+
+    char*    _out;
+    size_t   _size;
+    size_t   _length;
+    uint32_t _hasMembers; // bit per depth
+    uint8_t  _depth;
+    bool     _overflow;
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,282 @@
+#include "BoundedSearch.h"
+#include <math.h>
+#include "MatchMetric.h"
+#include "MatchSolver.h"
+
+// Seed neighbourhood: quantised analytic state +/- this many LSBs per bank
+static constexpr int SEED_RADIUS = 1;
+
+// Bounds come from box arithmetic in single precision while leaves are
+// evaluated exactly as the exhaustive search does, so a subtree is only
+// skipped when its bound exceeds the best state by more than rounding.
+static constexpr float BOUND_SLACK_REL = 1e-4f;
+static constexpr float BOUND_SLACK_ABS = 1e-6f;
+
+static float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Best state so far with the exhaustive search's tie rule: on an exact tie
+// the state the exhaustive search visits first wins. `order` is that visiting
+// order: all "L, C" states l-major, then all "C, L" states c-major.
+struct BoundedSearch::Best {
+    float     n, d, ratio;
+    uint32_t  order;
+    TuneState state;
+    float     target;
+    uint32_t  evaluated;
+    uint32_t  pruned;
+    bool      done;
+
+    void offer(const MatchMetric& m, uint32_t candidateOrder, const TuneState& candidate)
+    {
+        evaluated++;
+        const float lhs = m.n * d, rhs = n * m.d;
+        if (lhs < rhs || (lhs == rhs && candidateOrder < order)) {
+            n = m.n; d = m.d; ratio = n / d;
+            order = candidateOrder;
+            state = candidate;
+            done = target > 0.0f && n <= target * d;
+        }
+    }
+
+    bool prunes(float bound)
+    {
+        if (bound > ratio * (1.0f + BOUND_SLACK_REL) + BOUND_SLACK_ABS) {
+            pruned++;
+            return true;
+        }
+        return false;
+    }
+};
+
+void BoundedSearch::build(const Cplx* zL, size_t numL, const Cplx* yC, size_t numC)
+{
+    _zL = zL; _yC = yC;
+    _numL = numL; _numC = numC;
+    const Cplx* values[2] = {zL, yC};
+    const size_t sizes[2] = {numL, numC};
+    std::vector<Box>* trees[2] = {&_lTree, &_cTree};
+    for (int t = 0; t < 2; t++) {
+        std::vector<Box>& tree = *trees[t];
+        const size_t n = sizes[t];
+        tree.resize(2 * n);
+        for (size_t i = 0; i < n; i++) {
+            const Cplx v = values[t][i];
+            tree[n + i] = Box{v.re, v.re, v.im, v.im};
+        }
+        for (size_t k = n - 1; k >= 1; k--) {
+            const Box& a = tree[2 * k];
+            const Box& b = tree[2 * k + 1];
+            tree[k] = Box{fminf(a.re0, b.re0), fmaxf(a.re1, b.re1), fminf(a.im0, b.im0), fmaxf(a.im1, b.im1)};
+        }
+    }
+}
+
+BoundedSearch::Box BoundedSearch::shifted(const Box& box, Cplx by)
+{
+    return Box{box.re0 + by.re, box.re1 + by.re, box.im0 + by.im, box.im1 + by.im};
+}
+
+BoundedSearch::Box BoundedSearch::sum(const Box& a, const Box& b)
+{
+    return Box{a.re0 + b.re0, a.re1 + b.re1, a.im0 + b.im0, a.im1 + b.im1};
+}
+
+// Range of 1/z over a box with Re z > 0. Neither Re(1/z) = r / (r^2 + x^2)
+// nor Im(1/z) = -x / (r^2 + x^2) has a stationary point there, so both take
+// their extremes on the edges: at the corners, where x = 0 or x = +/-r on
+// the r edges, or where r = |x| on the x edges.
+BoundedSearch::Box BoundedSearch::invert(const Box& z)
+{
+    if (!(z.re0 > 0.0f)) {
+        return Box{-INFINITY, INFINITY, -INFINITY, INFINITY};
+    }
+    const float r[12] = {z.re0, z.re0, z.re1, z.re1,
+                         z.re0, z.re0, z.re0, z.re1, z.re1, z.re1,
+                         clampf(fabsf(z.im0), z.re0, z.re1), clampf(fabsf(z.im1), z.re0, z.re1)};
+    const float x[12] = {z.im0, z.im1, z.im0, z.im1,
+                         clampf(0.0f, z.im0, z.im1), clampf(z.re0, z.im0, z.im1), clampf(-z.re0, z.im0, z.im1),
+                         clampf(0.0f, z.im0, z.im1), clampf(z.re1, z.im0, z.im1), clampf(-z.re1, z.im0, z.im1),
+                         z.im0, z.im1};
+    Box out{INFINITY, -INFINITY, INFINITY, -INFINITY};
+    for (int i = 0; i < 12; i++) {
+        const float k = 1.0f / (r[i] * r[i] + x[i] * x[i]);
+        const float re = r[i] * k, im = -x[i] * k;
+        out.re0 = fminf(out.re0, re); out.re1 = fmaxf(out.re1, re);
+        out.im0 = fminf(out.im0, im); out.im1 = fmaxf(out.im1, im);
+    }
+    return out;
+}
+
+// |Gamma|^2 = n / (n + 4 Re a) grows with n and falls with Re a, so the
+// nearest point of the box to 1 + j0 and its largest real part bound it.
+float BoundedSearch::lowerBound(const Box& a)
+{
+    if (!(a.re1 > 0.0f)) {
+        return 1.0f; // Re a <= 0 reflects everything
+    }
+    const float dr = 1.0f - clampf(1.0f, a.re0, a.re1);
+    const float di = clampf(0.0f, a.im0, a.im1);
+    const float n = dr * dr + di * di;
+    return n / (n + 4.0f * a.re1);
+}
+
+// Closed-form L-network for the normalised antenna impedance, quantised to
+// the LSB of each bank. With R <= 1, "L, C" needs Im(zAntenna + jX) =
+// sqrt(R(1 - R)); with G = Re(1/zAntenna) <= 1, "C, L" needs
+// Im(yAntenna + jB) = sqrt(G(1 - G)). Outside those ranges the seed just
+// resonates the antenna.
+void BoundedSearch::seed(Cplx zAntenna, Best& best) const
+{
+    if (_numL < 2 || _numC < 2 || !(_zL[1].im > 0.0f) || !(_yC[1].im > 0.0f)) {
+        return;
+    }
+    const float lsbX = _zL[1].im, lsbB = _yC[1].im;
+    const Cplx yAntenna = cinv(zAntenna);
+    float x[2], b[2];
+
+    const float r = zAntenna.re;
+    if (r > 0.0f && r <= 1.0f) {
+        const float s = sqrtf(r * (1.0f - r));
+        x[0] = s - zAntenna.im;
+        b[0] = s / r;
+    } else {
+        x[0] = -zAntenna.im;
+        b[0] = 0.0f;
+    }
+    const float g = yAntenna.re;
+    if (g > 0.0f && g <= 1.0f) {
+        const float s = sqrtf(g * (1.0f - g));
+        b[1] = s - yAntenna.im;
+        x[1] = s / g;
+    } else {
+        b[1] = -yAntenna.im;
+        x[1] = 0.0f;
+    }
+
+    for (int t = 0; t < 2; t++) {
+        const long l0 = lroundf(clampf(x[t] / lsbX, 0.0f, float(_numL - 1)));
+        const long c0 = lroundf(clampf(b[t] / lsbB, 0.0f, float(_numC - 1)));
+        for (long l = l0 - SEED_RADIUS; l <= l0 + SEED_RADIUS; l++) {
+            for (long c = c0 - SEED_RADIUS; c <= c0 + SEED_RADIUS; c++) {
+                if (l < 0 || c < 0 || size_t(l) >= _numL || size_t(c) >= _numC) continue;
+                if (t == 0) {
+                    evaluateLC(size_t(l), size_t(c), cinv(zAntenna + _zL[l]), best);
+                } else {
+                    evaluateCL(size_t(l), size_t(c), cinv(yAntenna + _yC[c]), best);
+                }
+            }
+        }
+    }
+}
+
+void BoundedSearch::evaluateLC(size_t l, size_t c, Cplx ys, Best& best) const
+{
+    best.offer(matchMetric(ys.re + _yC[c].re, ys.im + _yC[c].im), uint32_t(l * _numC + c),
+               TuneState{uint16_t(l), uint16_t(c), Topology::LC});
+}
+
+void BoundedSearch::evaluateCL(size_t l, size_t c, Cplx zp, Best& best) const
+{
+    best.offer(matchMetric(zp.re + _zL[l].re, zp.im + _zL[l].im), uint32_t(_numL * _numC + c * _numL + l),
+               TuneState{uint16_t(l), uint16_t(c), Topology::CL});
+}
+
+float BoundedSearch::boundInductorsLC(size_t node, Cplx zAntenna) const
+{
+    return lowerBound(sum(invert(shifted(_lTree[node], zAntenna)), _cTree[1]));
+}
+
+float BoundedSearch::boundCapacitorsCL(size_t node, Cplx yAntenna) const
+{
+    return lowerBound(sum(invert(shifted(_cTree[node], yAntenna)), _lTree[1]));
+}
+
+void BoundedSearch::searchInductorsLC(size_t node, float bound, Cplx zAntenna, Best& best) const
+{
+    if (best.done || best.prunes(bound)) {
+        return;
+    }
+    if (node >= _numL) {
+        const size_t l = node - _numL;
+        const Cplx ys = cinv(zAntenna + _zL[l]);
+        searchCapacitorsLC(1, lowerBound(shifted(_cTree[1], ys)), l, ys, best);
+        return;
+    }
+    const float b0 = boundInductorsLC(2 * node, zAntenna);
+    const float b1 = boundInductorsLC(2 * node + 1, zAntenna);
+    const size_t first = b0 <= b1 ? 2 * node : 2 * node + 1;
+    searchInductorsLC(first, b0 <= b1 ? b0 : b1, zAntenna, best);
+    searchInductorsLC(first ^ 1, b0 <= b1 ? b1 : b0, zAntenna, best);
+}
+
+void BoundedSearch::searchCapacitorsLC(size_t node, float bound, size_t l, Cplx ys, Best& best) const
+{
+    if (best.done || best.prunes(bound)) {
+        return;
+    }
+    if (node >= _numC) {
+        evaluateLC(l, node - _numC, ys, best);
+        return;
+    }
+    const float b0 = lowerBound(shifted(_cTree[2 * node], ys));
+    const float b1 = lowerBound(shifted(_cTree[2 * node + 1], ys));
+    const size_t first = b0 <= b1 ? 2 * node : 2 * node + 1;
+    searchCapacitorsLC(first, b0 <= b1 ? b0 : b1, l, ys, best);
+    searchCapacitorsLC(first ^ 1, b0 <= b1 ? b1 : b0, l, ys, best);
+}
+
+void BoundedSearch::searchCapacitorsCL(size_t node, float bound, Cplx yAntenna, Best& best) const
+{
+    if (best.done || best.prunes(bound)) {
+        return;
+    }
+    if (node >= _numC) {
+        const size_t c = node - _numC;
+        const Cplx zp = cinv(yAntenna + _yC[c]);
+        searchInductorsCL(1, lowerBound(shifted(_lTree[1], zp)), c, zp, best);
+        return;
+    }
+    const float b0 = boundCapacitorsCL(2 * node, yAntenna);
+    const float b1 = boundCapacitorsCL(2 * node + 1, yAntenna);
+    const size_t first = b0 <= b1 ? 2 * node : 2 * node + 1;
+    searchCapacitorsCL(first, b0 <= b1 ? b0 : b1, yAntenna, best);
+    searchCapacitorsCL(first ^ 1, b0 <= b1 ? b1 : b0, yAntenna, best);
+}
+
+void BoundedSearch::searchInductorsCL(size_t node, float bound, size_t c, Cplx zp, Best& best) const
+{
+    if (best.done || best.prunes(bound)) {
+        return;
+    }
+    if (node >= _numL) {
+        evaluateCL(node - _numL, c, zp, best);
+        return;
+    }
+    const float b0 = lowerBound(shifted(_lTree[2 * node], zp));
+    const float b1 = lowerBound(shifted(_lTree[2 * node + 1], zp));
+    const size_t first = b0 <= b1 ? 2 * node : 2 * node + 1;
+    searchInductorsCL(first, b0 <= b1 ? b0 : b1, c, zp, best);
+    searchInductorsCL(first ^ 1, b0 <= b1 ? b1 : b0, c, zp, best);
+}
+
+MatchResult BoundedSearch::search(Cplx zAntenna, float gamma2Target) const
+{
+    // Same starting point as the exhaustive search: gamma^2 = 1 at state 0
+    Best best{1.0f, 1.0f, 1.0f, 0, TuneState{0, 0, Topology::LC}, gamma2Target, 0, 0, false};
+    seed(zAntenna, best);
+
+    const Cplx yAntenna = cinv(zAntenna);
+    searchInductorsLC(1, boundInductorsLC(1, zAntenna), zAntenna, best);
+    searchCapacitorsCL(1, boundCapacitorsCL(1, yAntenna), yAntenna, best);
+
+    MatchResult result;
+    result.state = best.state;
+    result.gamma2 = best.n / best.d;
+    result.swr = MatchSolver::swrFromGamma2(result.gamma2);
+    result.evaluated = best.evaluated;
+    result.pruned = best.pruned;
+    return result;
+}
@@ -0,0 +1,71 @@
+#ifndef BOUNDED_SEARCH_H
+#define BOUNDED_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "Cplx.h"
+#include "TuneState.h"
+
+struct MatchResult;
+
+// Branch-and-bound match search over the same normalised tables as
+// MatchSolver::searchExhaustive, returning the same state.
+//
+// Each bank is covered by an implicit binary tree over its mask range (node
+// k has children 2k and 2k+1, leaf i is node size + i) holding the bounding
+// box of the table values below it. For binary-weighted banks a subtree is a
+// contiguous range of element values, so the boxes are tight. A subtree is
+// skipped when a lower bound on |Gamma|^2 over its box provably cannot beat
+// the best state found so far:
+//   "L, C": the inductor tree is bounded through 1/(zAntenna + zL) against
+//           the whole capacitor range, then each inductor leaf descends the
+//           capacitor tree.
+//   "C, L": the same with the roles of the banks swapped.
+// The search is seeded with the quantised closed-form L-network solution of
+// both topologies, which usually leaves only a handful of leaves to check.
+class BoundedSearch {
+public:
+    BoundedSearch() : _numL(0), _numC(0) {}
+    // Sizes the trees up front, so build() with these bank sizes never
+    // allocates
+    BoundedSearch(size_t numL, size_t numC) :
+        _numL(0), _numC(0), _lTree(2 * numL), _cTree(2 * numC) {}
+
+    // Builds the bounding-box trees; numL and numC must be powers of two
+    void build(const Cplx* zL, size_t numL, const Cplx* yC, size_t numC);
+
+    // gamma2Target > 0 stops at the first state with |Gamma|^2 <= target,
+    // which need not be the optimum; 0 searches to completion.
+    MatchResult search(Cplx zAntenna, float gamma2Target = 0.0f) const;
+
+private:
+    struct Box {
+        float re0, re1, im0, im1;
+    };
+    struct Best;
+
+    static Box invert(const Box& z);
+    static float lowerBound(const Box& a);
+    static Box shifted(const Box& box, Cplx by);
+    static Box sum(const Box& a, const Box& b);
+
+    void seed(Cplx zAntenna, Best& best) const;
+    void evaluateLC(size_t l, size_t c, Cplx ys, Best& best) const;
+    void evaluateCL(size_t l, size_t c, Cplx zp, Best& best) const;
+    float boundInductorsLC(size_t node, Cplx zAntenna) const;
+    float boundCapacitorsCL(size_t node, Cplx yAntenna) const;
+    void searchInductorsLC(size_t node, float bound, Cplx zAntenna, Best& best) const;
+    void searchCapacitorsLC(size_t node, float bound, size_t l, Cplx ys, Best& best) const;
+    void searchCapacitorsCL(size_t node, float bound, Cplx yAntenna, Best& best) const;
+    void searchInductorsCL(size_t node, float bound, size_t c, Cplx zp, Best& best) const;
+
+    const Cplx*      _zL;
+    const Cplx*      _yC;
+    size_t           _numL;
+    size_t           _numC;
+    std::vector<Box> _lTree; // 2 * numL nodes, [0] unused
+    std::vector<Box> _cTree;
+};
+
+#endif // BOUNDED_SEARCH_H
@@ -0,0 +1,41 @@
+#ifndef CPLX_H
+#define CPLX_H
+
+// Minimal single-precision complex type for the match solver.
+// std::complex<float> is avoided on purpose: without -ffast-math GCC routes
+// every multiply through __mulsc3 (inf/nan recovery), which is several times
+// slower on the ESP32-S3 FPU than the plain arithmetic below.
+
+struct Cplx {
+    float re;
+    float im;
+};
+
+inline constexpr Cplx cplx(float re, float im) { return Cplx{re, im}; }
+
+inline constexpr Cplx operator+(Cplx a, Cplx b) { return Cplx{a.re + b.re, a.im + b.im}; }
+inline constexpr Cplx operator-(Cplx a, Cplx b) { return Cplx{a.re - b.re, a.im - b.im}; }
+inline constexpr Cplx operator*(Cplx a, float s) { return Cplx{a.re * s, a.im * s}; }
+
+inline constexpr Cplx cmul(Cplx a, Cplx b)
+{
+    return Cplx{a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+}
+
+// |a|^2
+inline constexpr float cnorm2(Cplx a) { return a.re * a.re + a.im * a.im; }
+
+// 1/a, used for impedance <-> admittance conversion
+inline Cplx cinv(Cplx a)
+{
+    const float k = 1.0f / cnorm2(a);
+    return Cplx{a.re * k, -a.im * k};
+}
+
+inline Cplx cdiv(Cplx a, Cplx b)
+{
+    const float k = 1.0f / cnorm2(b);
+    return Cplx{(a.re * b.re + a.im * b.im) * k, (a.im * b.re - a.re * b.im) * k};
+}
+
+#endif // CPLX_H
@@ -0,0 +1,22 @@
+#include "ImpedanceSweep.h"
+
+bool ImpedanceSweep::impedanceAt(float freqHz, Cplx& out) const
+{
+    if (_count == 0 || freqHz < _freqHz[0] || freqHz > _freqHz[_count - 1]) {
+        return false;
+    }
+    // Binary search for the first point at or above freqHz
+    size_t lo = 0, hi = _count - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (_freqHz[mid] < freqHz) lo = mid + 1; else hi = mid;
+    }
+    if (lo == 0 || _freqHz[lo] == freqHz) {
+        out = zAt(lo);
+        return true;
+    }
+    const float t = (freqHz - _freqHz[lo - 1]) / (_freqHz[lo] - _freqHz[lo - 1]);
+    out.re = _re[lo - 1] + t * (_re[lo] - _re[lo - 1]);
+    out.im = _im[lo - 1] + t * (_im[lo] - _im[lo - 1]);
+    return true;
+}
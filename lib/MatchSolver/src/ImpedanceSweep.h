@@ -0,0 +1,33 @@
+#ifndef IMPEDANCE_SWEEP_H
+#define IMPEDANCE_SWEEP_H
+
+#include <stddef.h>
+#include "Cplx.h"
+
+// Read-only view of an antenna impedance sweep, e.g. docs/Longz or docs/Shortz
+// ("freq in Hz; real of Z imag of Z"). Storage is structure-of-arrays and owned
+// by the caller; frequencies must be strictly increasing.
+class ImpedanceSweep {
+public:
+    ImpedanceSweep() : _freqHz(nullptr), _re(nullptr), _im(nullptr), _count(0) {}
+    ImpedanceSweep(const float* freqHz, const float* re, const float* im, size_t count) :
+        _freqHz(freqHz), _re(re), _im(im), _count(count) {}
+
+    size_t size() const { return _count; }
+    float minFreq() const { return _count ? _freqHz[0] : 0.0f; }
+    float maxFreq() const { return _count ? _freqHz[_count - 1] : 0.0f; }
+    float freqAt(size_t i) const { return _freqHz[i]; }
+    Cplx zAt(size_t i) const { return Cplx{_re[i], _im[i]}; }
+
+    // Linearly interpolated antenna impedance at freqHz.
+    // Returns false if freqHz lies outside the swept range.
+    bool impedanceAt(float freqHz, Cplx& out) const;
+
+private:
+    const float* _freqHz;
+    const float* _re;
+    const float* _im;
+    size_t       _count;
+};
+
+#endif // IMPEDANCE_SWEEP_H
@@ -0,0 +1,21 @@
+#ifndef MATCH_METRIC_H
+#define MATCH_METRIC_H
+
+// Reflection metric shared by the exhaustive and bounded searches, so both
+// compute bit-identical values for the same state.
+//
+// For a normalised load a (the admittance y for "L, C", the impedance z for
+// "C, L") |Gamma|^2 = |1 - a|^2 / |1 + a|^2 = n / d with n = |1 - a|^2 and
+// d = n + 4 Re(a). Candidates are compared by cross multiplication.
+struct MatchMetric {
+    float n;
+    float d;
+};
+
+inline MatchMetric matchMetric(float re, float im)
+{
+    const float n = (1.0f - re) * (1.0f - re) + im * im;
+    return MatchMetric{n, n + 4.0f * re};
+}
+
+#endif // MATCH_METRIC_H
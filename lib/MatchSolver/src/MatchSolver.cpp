@@ -0,0 +1,128 @@
+#include "MatchSolver.h"
+#include <math.h>
+#include "MatchMetric.h"
+
+MatchSolver::MatchSolver(const TunerModel& model) :
+    _model(model), _preparedFreq(-1.0f), _mode(SearchMode::Exhaustive), _gamma2Target(0.0f),
+    _bounded(model.numInductorStates(), model.numCapacitorStates()),
+    _zL(model.numInductorStates()), _yC(model.numCapacitorStates())
+{
+}
+
+void MatchSolver::prepare(float freqHz)
+{
+    if (freqHz == _preparedFreq) {
+        return;
+    }
+    _model.seriesImpedances(freqHz, _zL.data());
+    _model.shuntAdmittances(freqHz, _yC.data());
+    normalise();
+    _preparedFreq = freqHz;
+}
+
+void MatchSolver::prepareTables(const Cplx* zL, const Cplx* yC)
+{
+    for (size_t i = 0; i < _zL.size(); i++) _zL[i] = zL[i];
+    for (size_t i = 0; i < _yC.size(); i++) _yC[i] = yC[i];
+    normalise();
+    _preparedFreq = -1.0f; // the next prepare(freqHz) must reload the model tables
+}
+
+void MatchSolver::normalise()
+{
+    const float z0 = _model.z0();
+    const float invZ0 = 1.0f / z0;
+    for (Cplx& z : _zL) z = z * invZ0;
+    for (Cplx& y : _yC) y = y * z0;
+    _bounded.build(_zL.data(), _zL.size(), _yC.data(), _yC.size());
+}
+
+void MatchSolver::setSwrTarget(float swr)
+{
+    const float g = swr > 1.0f ? (swr - 1.0f) / (swr + 1.0f) : 0.0f;
+    _gamma2Target = g * g;
+}
+
+MatchResult MatchSolver::solve(float freqHz, Cplx zAntenna)
+{
+    prepare(freqHz);
+    return solvePrepared(zAntenna);
+}
+
+MatchResult MatchSolver::solvePrepared(Cplx zAntenna) const
+{
+    const Cplx z = zAntenna * (1.0f / _model.z0());
+    if (_mode == SearchMode::BranchAndBound) {
+        return _bounded.search(z, _gamma2Target);
+    }
+    return searchExhaustive(z, _zL.data(), _zL.size(), _yC.data(), _yC.size());
+}
+
+bool MatchSolver::solve(const ImpedanceSweep& sweep, float freqHz, MatchResult& out)
+{
+    Cplx zAntenna;
+    if (!sweep.impedanceAt(freqHz, zAntenna)) {
+        return false;
+    }
+    out = solve(freqHz, zAntenna);
+    return true;
+}
+
+// Each candidate needs one squared distance (see MatchMetric.h) and the
+// comparison n / d < bestN / bestD is done by cross multiplication.
+MatchResult MatchSolver::searchExhaustive(Cplx zAntenna, const Cplx* zL, size_t numL,
+                                          const Cplx* yC, size_t numC)
+{
+    float bestN = 1.0f, bestD = 1.0f; // gamma^2 = 1: anything passive and lossy beats it
+    TuneState best{0, 0, Topology::LC};
+
+    // L, C: antenna - series L - shunt C - radio. Invert once per inductor state.
+    for (size_t l = 0; l < numL; l++) {
+        const Cplx ys = cinv(zAntenna + zL[l]);
+        for (size_t c = 0; c < numC; c++) {
+            const MatchMetric m = matchMetric(ys.re + yC[c].re, ys.im + yC[c].im);
+            if (m.n * bestD < bestN * m.d) {
+                bestN = m.n; bestD = m.d;
+                best = TuneState{uint16_t(l), uint16_t(c), Topology::LC};
+            }
+        }
+    }
+
+    // C, L: antenna - shunt C - series L - radio. Invert once per capacitor state.
+    const Cplx yA = cinv(zAntenna);
+    for (size_t c = 0; c < numC; c++) {
+        const Cplx zp = cinv(yA + yC[c]);
+        for (size_t l = 0; l < numL; l++) {
+            const MatchMetric m = matchMetric(zp.re + zL[l].re, zp.im + zL[l].im);
+            if (m.n * bestD < bestN * m.d) {
+                bestN = m.n; bestD = m.d;
+                best = TuneState{uint16_t(l), uint16_t(c), Topology::CL};
+            }
+        }
+    }
+
+    MatchResult result;
+    result.state = best;
+    result.gamma2 = bestN / bestD;
+    result.swr = swrFromGamma2(result.gamma2);
+    result.evaluated = uint32_t(2 * numL * numC);
+    result.pruned = 0;
+    return result;
+}
+
+Cplx MatchSolver::inputImpedance(Cplx zAntenna, Cplx zL, Cplx yC, Topology topology)
+{
+    if (topology == Topology::LC) {
+        return cinv(cinv(zAntenna + zL) + yC);
+    }
+    return cinv(cinv(zAntenna) + yC) + zL;
+}
+
+float MatchSolver::swrFromGamma2(float gamma2)
+{
+    const float g = sqrtf(gamma2);
+    if (g >= 1.0f) {
+        return INFINITY;
+    }
+    return (1.0f + g) / (1.0f - g);
+}
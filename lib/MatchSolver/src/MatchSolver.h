@@ -0,0 +1,80 @@
+#ifndef MATCH_SOLVER_H
+#define MATCH_SOLVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "BoundedSearch.h"
+#include "Cplx.h"
+#include "ImpedanceSweep.h"
+#include "TuneState.h"
+#include "TunerModel.h"
+
+struct MatchResult {
+    TuneState state;
+    float     gamma2;    // |reflection coefficient|^2 seen by the radio
+    float     swr;
+    uint32_t  evaluated; // L/C/topology combinations examined
+    uint32_t  pruned;    // subtrees skipped by the bound (branch and bound only)
+};
+
+enum class SearchMode : uint8_t {
+    Exhaustive,     // every combination, fixed cost
+    BranchAndBound  // same answer, cost grows far slower with the bank size
+};
+
+// Computes the best LC network for an antenna impedance ("step 4" of the
+// sequence of operation in docs/circuit_description.md).
+//
+// The exhaustive search evaluates every series-L x shunt-C x KM1 combination.
+// Per-state tables are normalised to z0 before the search, so the inner loop
+// is two complex adds and a cross-multiplied compare with no divisions.
+// BranchAndBound (see BoundedSearch.h) returns the same state while
+// evaluating a small fraction of them; it can also stop at an SWR target.
+class MatchSolver {
+public:
+    explicit MatchSolver(const TunerModel& model);
+
+    // Fills the per-state tables for freqHz. solve() calls this when the
+    // frequency changes, so repeated solves at one frequency reuse them.
+    void prepare(float freqHz);
+    // Loads externally supplied (e.g. measured) unnormalised tables with
+    // numInductorStates() / numCapacitorStates() entries instead
+    void prepareTables(const Cplx* zL, const Cplx* yC);
+    // Searches whichever tables were prepared last
+    MatchResult solvePrepared(Cplx zAntenna) const;
+
+    MatchResult solve(float freqHz, Cplx zAntenna);
+    // Interpolates the antenna impedance from a sweep; false if out of range
+    bool solve(const ImpedanceSweep& sweep, float freqHz, MatchResult& out);
+
+    void setSearchMode(SearchMode mode) { _mode = mode; }
+    SearchMode searchMode() const { return _mode; }
+    // Branch and bound only: accept the first state at or below this SWR
+    // instead of the optimum; 0 (default) disables
+    void setSwrTarget(float swr);
+
+    const TunerModel& model() const { return _model; }
+
+    // Exhaustive search over normalised tables: zAntenna and zL divided by z0,
+    // yC multiplied by z0.
+    static MatchResult searchExhaustive(Cplx zAntenna, const Cplx* zL, size_t numL,
+                                        const Cplx* yC, size_t numC);
+
+    // Input impedance seen by the radio, unnormalised
+    static Cplx inputImpedance(Cplx zAntenna, Cplx zL, Cplx yC, Topology topology);
+    static float swrFromGamma2(float gamma2);
+
+private:
+    void normalise();
+
+    const TunerModel&  _model;
+    float              _preparedFreq;
+    SearchMode         _mode;
+    float              _gamma2Target;
+    BoundedSearch      _bounded;
+    std::vector<Cplx>  _zL; // normalised series impedance per inductor state
+    std::vector<Cplx>  _yC; // normalised shunt admittance per capacitor state
+};
+
+#endif // MATCH_SOLVER_H
@@ -0,0 +1,27 @@
+#ifndef TUNE_STATE_H
+#define TUNE_STATE_H
+
+#include <stdint.h>
+
+// Side of the series inductor the shunt capacitor sits on, selected by KM1.
+// Naming follows the annotations in docs/Longz: "L, C" means
+// antenna - series L - shunt C - radio, "C, L" means antenna - shunt C - series L - radio.
+enum class Topology : uint8_t {
+    LC = 0,
+    CL = 1
+};
+
+// Complete relay state of the LC tuning network
+struct TuneState {
+    uint16_t lMask;      // bit n set: inductor n in circuit
+    uint16_t cMask;      // bit n set: capacitor n in circuit
+    Topology topology;
+};
+
+inline bool operator==(const TuneState& a, const TuneState& b)
+{
+    return a.lMask == b.lMask && a.cMask == b.cMask && a.topology == b.topology;
+}
+inline bool operator!=(const TuneState& a, const TuneState& b) { return !(a == b); }
+
+#endif // TUNE_STATE_H
@@ -0,0 +1,29 @@
+#ifndef TUNER_DESIGN_H
+#define TUNER_DESIGN_H
+
+#include <stdint.h>
+#include "TunerModel.h"
+
+// Bank geometry and nominal element values of the LC_Network board, shared by
+// the firmware (relay mapping in GAPTuner) and the host table generator.
+// NOTE: the LC_Network block is still a placeholder in the schematic. Its
+// coils (two lines per monopolar latching relay) are driven through a pair
+// of 74HC595s, 16 lines: four inductor and four capacitor relays. A wider
+// bank needs a third 595 on the chain (BANK_SR_OUTPUTS, Esp32RelayHal.h,
+// up to 32 lines) rather than GPIOs, which are all taken or reserved on the
+// N16R8 (RelayController.h); the solver supports up to MAX_BANK_BITS.
+namespace TunerDesign {
+    static constexpr uint8_t L_BITS          = 4;
+    static constexpr float   L_LSB_HENRIES   = 1.5e-6f;
+    static constexpr float   L_Q             = 150.0f;
+    static constexpr uint8_t C_BITS          = 4;
+    static constexpr float   C_LSB_FARADS    = 60e-12f;
+    static constexpr float   C_Q             = 500.0f;
+
+    inline TunerModel model()
+    {
+        return TunerModel::binaryWeighted(L_BITS, L_LSB_HENRIES, L_Q, C_BITS, C_LSB_FARADS, C_Q);
+    }
+}
+
+#endif // TUNER_DESIGN_H
@@ -0,0 +1,88 @@
+#include "TunerModel.h"
+
+static constexpr float TWO_PI = 6.28318530718f;
+
+TunerModel::TunerModel(float z0) : _z0(z0), _lBits(0), _cBits(0), _l(), _c()
+{
+}
+
+TunerModel TunerModel::binaryWeighted(uint8_t lBits, float lLsbHenries, float qL,
+                                      uint8_t cBits, float cLsbFarads, float qC, float z0)
+{
+    TunerModel model(z0);
+    for (uint8_t i = 0; i < lBits; i++) {
+        model.addInductor(lLsbHenries * float(1u << i), qL);
+    }
+    for (uint8_t i = 0; i < cBits; i++) {
+        model.addCapacitor(cLsbFarads * float(1u << i), qC);
+    }
+    return model;
+}
+
+bool TunerModel::addInductor(float henries, float q)
+{
+    if (_lBits >= MAX_BANK_BITS || henries <= 0.0f || q <= 0.0f) {
+        return false;
+    }
+    _l[_lBits++] = Element{henries, q};
+    return true;
+}
+
+bool TunerModel::addCapacitor(float farads, float q)
+{
+    if (_cBits >= MAX_BANK_BITS || farads <= 0.0f || q <= 0.0f) {
+        return false;
+    }
+    _c[_cBits++] = Element{farads, q};
+    return true;
+}
+
+float TunerModel::inductanceOf(uint16_t lMask) const
+{
+    float sum = 0.0f;
+    for (uint8_t i = 0; i < _lBits; i++) {
+        if (lMask & (1u << i)) sum += _l[i].value;
+    }
+    return sum;
+}
+
+float TunerModel::capacitanceOf(uint16_t cMask) const
+{
+    float sum = 0.0f;
+    for (uint8_t i = 0; i < _cBits; i++) {
+        if (cMask & (1u << i)) sum += _c[i].value;
+    }
+    return sum;
+}
+
+// Both tables are filled as subset sums: the entry for a mask with top bit n is
+// the entry for the same mask without bit n plus element n, so each state
+// costs a single complex add regardless of how many bits it has set.
+
+void TunerModel::seriesImpedances(float freqHz, Cplx* out) const
+{
+    const float w = TWO_PI * freqHz;
+    out[0] = Cplx{0.0f, 0.0f};
+    for (uint8_t bit = 0; bit < _lBits; bit++) {
+        const float x = w * _l[bit].value;
+        const Cplx z{x / _l[bit].q, x}; // ESR = X/Q
+        const size_t half = size_t(1) << bit;
+        for (size_t i = 0; i < half; i++) {
+            out[half + i] = out[i] + z;
+        }
+    }
+}
+
+void TunerModel::shuntAdmittances(float freqHz, Cplx* out) const
+{
+    const float w = TWO_PI * freqHz;
+    out[0] = Cplx{0.0f, 0.0f};
+    for (uint8_t bit = 0; bit < _cBits; bit++) {
+        const float b = w * _c[bit].value;
+        const Cplx y{b / _c[bit].q, b}; // high-Q approximation, G = B/Q
+        const size_t half = size_t(1) << bit;
+        for (size_t i = 0; i < half; i++) {
+            out[half + i] = out[i] + y;
+        }
+    }
+}
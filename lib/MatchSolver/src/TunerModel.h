@@ -0,0 +1,61 @@
+#ifndef TUNER_MODEL_H
+#define TUNER_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Cplx.h"
+
+// Per-state network data for the LC tuning network: a series inductor chain and
+// a shunt capacitor bank, each made of binary-weighted elements switched by
+// KM latching relays (see docs/circuit_description.md). Bit n of an L or C
+// relay mask selects element n of the corresponding bank.
+//
+// The model produces, for one frequency, the series impedance of every
+// inductor-bank state and the shunt admittance of every capacitor-bank state.
+// Those two tables are all the solver needs, so measured personality data can
+// later be substituted for the lumped-element values without touching it.
+class TunerModel {
+public:
+    static constexpr uint8_t MAX_BANK_BITS = 12;
+
+    struct Element {
+        float value; // henries for inductors, farads for capacitors
+        float q;     // unloaded Q, used to derive the element loss
+    };
+
+    explicit TunerModel(float z0 = 50.0f);
+
+    // Builds banks whose element n has value lsb * 2^n
+    static TunerModel binaryWeighted(uint8_t lBits, float lLsbHenries, float qL,
+                                     uint8_t cBits, float cLsbFarads, float qC,
+                                     float z0 = 50.0f);
+
+    bool addInductor(float henries, float q);
+    bool addCapacitor(float farads, float q);
+
+    uint8_t inductorBits() const { return _lBits; }
+    uint8_t capacitorBits() const { return _cBits; }
+    size_t numInductorStates() const { return size_t(1) << _lBits; }
+    size_t numCapacitorStates() const { return size_t(1) << _cBits; }
+    const Element& inductor(uint8_t bit) const { return _l[bit]; }
+    const Element& capacitor(uint8_t bit) const { return _c[bit]; }
+    float z0() const { return _z0; }
+
+    // Total inductance / capacitance selected by a relay mask
+    float inductanceOf(uint16_t lMask) const;
+    float capacitanceOf(uint16_t cMask) const;
+
+    // out[lMask] = series impedance of the inductor chain, numInductorStates() entries
+    void seriesImpedances(float freqHz, Cplx* out) const;
+    // out[cMask] = shunt admittance of the capacitor bank, numCapacitorStates() entries
+    void shuntAdmittances(float freqHz, Cplx* out) const;
+
+private:
+    float   _z0;
+    uint8_t _lBits;
+    uint8_t _cBits;
+    Element _l[MAX_BANK_BITS];
+    Element _c[MAX_BANK_BITS];
+};
+
+#endif // TUNER_MODEL_H
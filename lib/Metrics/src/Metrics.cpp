@@ -0,0 +1,144 @@
+#include "Metrics.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+
+uint32_t metricsMicros()
+{
+    return uint32_t(esp_timer_get_time());
+}
+#else
+#include <chrono>
+
+uint32_t metricsMicros()
+{
+    static const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count());
+}
+#endif
+
+MetricHistogram::MetricHistogram(const uint32_t* boundsUs, size_t count) :
+    _bounds(boundsUs), _count(count < MAX_BOUNDS ? count : MAX_BOUNDS), _sumUs(0)
+{
+    for (std::atomic<uint32_t>& b : _buckets) {
+        b.store(0);
+    }
+}
+
+bool MetricsRegistry::add(const char* family, const char* help, const char* labels, const MetricCounter& metric, double scale)
+{
+    return add(Series{family, help, labels, MetricType::Counter, &metric, scale});
+}
+
+bool MetricsRegistry::add(const char* family, const char* help, const char* labels, const MetricGauge& metric, double scale)
+{
+    return add(Series{family, help, labels, MetricType::Gauge, &metric, scale});
+}
+
+bool MetricsRegistry::add(const char* family, const char* help, const char* labels, const MetricHistogram& metric)
+{
+    return add(Series{family, help, labels, MetricType::Histogram, &metric, 1.0});
+}
+
+bool MetricsRegistry::add(const Series& series)
+{
+    if (_count >= MAX_SERIES) {
+        return false;
+    }
+    // The text format wants all series of a family together
+    const bool continues = _count > 0 && strcmp(_series[_count - 1].family, series.family) == 0;
+    for (size_t i = 0; i < _count && !continues; i++) {
+        if (strcmp(_series[i].family, series.family) == 0) return false;
+    }
+    if (continues && _series[_count - 1].type != series.type) {
+        return false;
+    }
+    _series[_count++] = series;
+    return true;
+}
+
+static size_t clampLength(int n, size_t size)
+{
+    if (n <= 0) return 0;
+    return size_t(n) < size ? size_t(n) : size - 1;
+}
+
+// Line 0 and 1 are HELP and TYPE (empty unless the series starts its
+// family), then the values; 0 past the last line
+size_t MetricsRegistry::formatLine(size_t index, size_t line, char* out, size_t size) const
+{
+    static const char* const typeNames[] = {"counter", "gauge", "histogram"};
+    const Series& s = _series[index];
+    const bool first = index == 0 || strcmp(_series[index - 1].family, s.family) != 0;
+    out[0] = '\0';
+    if (line == 0) {
+        return first ? clampLength(snprintf(out, size, "# HELP %s %s\n", s.family, s.help), size) : 0;
+    }
+    if (line == 1) {
+        return first ? clampLength(snprintf(out, size, "# TYPE %s %s\n", s.family, typeNames[size_t(s.type)]), size) : 0;
+    }
+    const size_t k = line - 2;
+    const char* open = s.labels != nullptr ? "{" : "";
+    const char* labels = s.labels != nullptr ? s.labels : "";
+    const char* close = s.labels != nullptr ? "}" : "";
+
+    if (s.type == MetricType::Counter || s.type == MetricType::Gauge) {
+        if (k > 0) return 0;
+        const double value = s.type == MetricType::Counter ? double(static_cast<const MetricCounter*>(s.metric)->value())
+                                                          : double(static_cast<const MetricGauge*>(s.metric)->value());
+        if (s.scale == 1.0) {
+            return clampLength(snprintf(out, size, "%s%s%s%s %.0f\n", s.family, open, labels, close, value), size);
+        }
+        return clampLength(snprintf(out, size, "%s%s%s%s %.9g\n", s.family, open, labels, close, value * s.scale), size);
+    }
+
+    const MetricHistogram& h = *static_cast<const MetricHistogram*>(s.metric);
+    const char* sep = s.labels != nullptr ? "," : "";
+    if (k <= h.bounds()) {
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i <= k; i++) cumulative += h.bucket(i);
+        if (k < h.bounds()) {
+            return clampLength(snprintf(out, size, "%s_bucket{%s%sle=\"%g\"} %u\n", s.family, labels, sep,
+                                        h.bound(k) * 1e-6, (unsigned)cumulative), size);
+        }
+        return clampLength(snprintf(out, size, "%s_bucket{%s%sle=\"+Inf\"} %u\n", s.family, labels, sep,
+                                    (unsigned)cumulative), size);
+    }
+    if (k == h.bounds() + 1) {
+        return clampLength(snprintf(out, size, "%s_sum%s%s%s %.6f\n", s.family, open, labels, close, h.sumUs() * 1e-6), size);
+    }
+    if (k == h.bounds() + 2) {
+        uint32_t total = 0;
+        for (size_t i = 0; i <= h.bounds(); i++) total += h.bucket(i);
+        return clampLength(snprintf(out, size, "%s_count%s%s%s %u\n", s.family, open, labels, close, (unsigned)total), size);
+    }
+    return 0;
+}
+
+size_t MetricsRegistry::render(char* out, size_t size, MetricsCursor& cursor) const
+{
+    char line[192];
+    size_t len = 0;
+    while (cursor.series < _count) {
+        const Series& s = _series[cursor.series];
+        const size_t lines = 2 + (s.type == MetricType::Histogram
+                                      ? static_cast<const MetricHistogram*>(s.metric)->bounds() + 3 : 1);
+        if (cursor.line >= lines) {
+            cursor.series++;
+            cursor.line = 0;
+            continue;
+        }
+        const size_t n = formatLine(cursor.series, cursor.line, line, sizeof(line));
+        if (len + n > size) {
+            if (len > 0) break;
+            // A line longer than the whole buffer is dropped rather than split
+        } else {
+            memcpy(out + len, line, n);
+            len += n;
+        }
+        cursor.line++;
+    }
+    return len;
+}
@@ -0,0 +1,113 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Counters, gauges and fixed-bucket histograms for the /metrics endpoint,
+// rendered in the Prometheus text exposition format.
+//
+// Recording is a bucket search over a handful of bounds plus relaxed 32-bit
+// atomic adds: no locks, no allocation, safe from any task. Values are read
+// without a snapshot, so a scrape may see a histogram mid-update; counts stay
+// exact. 32-bit counters wrap like a counter reset.
+//
+// Series are registered once at start-up, grouped by family (all series of
+// a family in a row), and rendered line by line into caller buffers, so a
+// scrape streams in chunks without building the whole text in memory.
+
+// Monotonic microseconds for latency measurements
+uint32_t metricsMicros();
+
+class MetricCounter {
+public:
+    void add(uint32_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+    // For mirroring a count kept elsewhere
+    void set(uint32_t value) { _value.store(value, std::memory_order_relaxed); }
+    uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> _value{0};
+};
+
+class MetricGauge {
+public:
+    void set(int32_t value) { _value.store(value, std::memory_order_relaxed); }
+    int32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> _value{0};
+};
+
+// Observations in microseconds, exported in seconds. boundsUs: ascending
+// upper bounds, at most MAX_BOUNDS; a +Inf bucket is implied.
+class MetricHistogram {
+public:
+    static constexpr size_t MAX_BOUNDS = 14;
+
+    MetricHistogram(const uint32_t* boundsUs, size_t count);
+
+    void observe(uint32_t us) {
+        size_t i = 0;
+        while (i < _count && us > _bounds[i]) i++;
+        _buckets[i].fetch_add(1, std::memory_order_relaxed);
+        _sumUs.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    size_t bounds() const { return _count; }
+    uint32_t bound(size_t i) const { return _bounds[i]; }
+    // Observations in bucket i alone (i == bounds(): above the last bound)
+    uint32_t bucket(size_t i) const { return _buckets[i].load(std::memory_order_relaxed); }
+    uint32_t sumUs() const { return _sumUs.load(std::memory_order_relaxed); }
+
+private:
+    const uint32_t*       _bounds;
+    size_t                _count;
+    std::atomic<uint32_t> _buckets[MAX_BOUNDS + 1];
+    std::atomic<uint32_t> _sumUs;
+};
+
+enum class MetricType : uint8_t { Counter, Gauge, Histogram };
+
+// Where a streamed render stopped
+struct MetricsCursor {
+    uint16_t series = 0;
+    uint16_t line = 0;
+};
+
+class MetricsRegistry {
+public:
+    static constexpr size_t MAX_SERIES = 96;
+
+    // family and help must outlive the registry; labels is the inside of the
+    // braces (e.g. "route=\"/tune\"") or nullptr. scale multiplies counter
+    // and gauge values on output (e.g. 1e-3 for milliseconds as seconds).
+    // false if full, or if the family was registered before but not last.
+    bool add(const char* family, const char* help, const char* labels, const MetricCounter& metric, double scale = 1.0);
+    bool add(const char* family, const char* help, const char* labels, const MetricGauge& metric, double scale = 1.0);
+    bool add(const char* family, const char* help, const char* labels, const MetricHistogram& metric);
+
+    // Fills out with whole lines from cursor on and advances it; returns the
+    // bytes written, 0 once everything has been rendered
+    size_t render(char* out, size_t size, MetricsCursor& cursor) const;
+    size_t count() const { return _count; }
+
+private:
+    struct Series {
+        const char* family;
+        const char* help;
+        const char* labels;
+        MetricType  type;
+        const void* metric;
+        double      scale;
+    };
+
+    bool   add(const Series& series);
+    size_t formatLine(size_t series, size_t line, char* out, size_t size) const;
+
+    Series _series[MAX_SERIES];
+    size_t _count = 0;
+};
+
+#endif // METRICS_H
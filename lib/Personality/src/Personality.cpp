@@ -0,0 +1,270 @@
+#include "Personality.h"
+#include "Crc32.h"
+#include <math.h>
+
+bool PersonalityView::attach(const uint8_t* data, size_t size)
+{
+    _base = nullptr;
+    _size = 0;
+    if (data == nullptr || size < sizeof(PersonalityHeader) || (uintptr_t(data) % PERSONALITY_ALIGN) != 0) {
+        return false;
+    }
+    const PersonalityHeader* h = reinterpret_cast<const PersonalityHeader*>(data);
+    if (h->magic != PERSONALITY_MAGIC || h->version != PERSONALITY_VERSION ||
+        h->headerSize != sizeof(PersonalityHeader) || h->totalSize > size ||
+        h->numParams == 0 || h->numParams > 4 || h->numFreqs == 0 ||
+        h->stride % PERSONALITY_ALIGN != 0 || h->stride < h->numFreqs * sizeof(float)) {
+        return false;
+    }
+    // Index sections must fit; data offsets are checked per block
+    const uint64_t freqEnd = uint64_t(h->freqOffset) + uint64_t(h->numFreqs) * sizeof(float);
+    const uint64_t blockEnd = uint64_t(h->blockOffset) + uint64_t(h->numBlocks) * sizeof(PersonalityBlock);
+    if ((h->freqOffset & 3) != 0 || (h->blockOffset & 3) != 0 ||
+        freqEnd > h->totalSize || blockEnd > h->totalSize) {
+        return false;
+    }
+    _base = data;
+    _size = h->totalSize;
+    return true;
+}
+
+bool PersonalityView::verifyCrc() const
+{
+    if (!_base) {
+        return false;
+    }
+    const PersonalityHeader& h = header();
+    return crc32(_base + h.headerSize, h.totalSize - h.headerSize) == h.crc32;
+}
+
+size_t PersonalityView::nearestFreq(float freqHz) const
+{
+    const float* f = freqs();
+    const size_t n = numFreqs();
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (f[mid] < freqHz) lo = mid + 1; else hi = mid;
+    }
+    if (lo == n) return n - 1;
+    if (lo == 0) return 0;
+    return (freqHz - f[lo - 1] <= f[lo] - freqHz) ? lo - 1 : lo;
+}
+
+const PersonalityBlock* PersonalityView::findBlock(BlockKind kind, uint32_t state) const
+{
+    const PersonalityBlock* b = blocks();
+    const uint64_t key = (uint64_t(kind) << 32) | state;
+    size_t lo = 0, hi = numBlocks();
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        const uint64_t k = (uint64_t(b[mid].kind) << 32) | b[mid].state;
+        if (k < key) lo = mid + 1; else hi = mid;
+    }
+    if (lo == numBlocks() || b[lo].kind != uint16_t(kind) || b[lo].state != state) {
+        return nullptr;
+    }
+    // Validate lazily so attach() stays O(1)
+    const uint64_t end = uint64_t(b[lo].dataOffset) + uint64_t(header().stride) * 2 * header().numParams;
+    if (b[lo].dataOffset % PERSONALITY_ALIGN != 0 || end > _size) {
+        return nullptr;
+    }
+    return &b[lo];
+}
+
+const float* PersonalityView::re(const PersonalityBlock& block, SParam p) const
+{
+    return reinterpret_cast<const float*>(_base + block.dataOffset + header().stride * (2 * size_t(p)));
+}
+
+const float* PersonalityView::im(const PersonalityBlock& block, SParam p) const
+{
+    return reinterpret_cast<const float*>(_base + block.dataOffset + header().stride * (2 * size_t(p) + 1));
+}
+
+Cplx PersonalityView::sample(const PersonalityBlock& block, SParam p, size_t freqIndex) const
+{
+    return Cplx{re(block, p)[freqIndex], im(block, p)[freqIndex]};
+}
+
+// A series element Z between two Z0 ports has S21 = 2 Z0 / (Z + 2 Z0), a shunt
+// element Y has S21 = 2 Y0 / (Y + 2 Y0); both invert to 2 (1/S21 - 1).
+
+bool PersonalityView::seriesImpedances(size_t freqIndex, Cplx* out, size_t numStates) const
+{
+    if (findBlock(BlockKind::InductorBank, 0) == nullptr) {
+        // Same as from S21 of the composed chain: z0 (A + B/z0 + C z0 + D) - 2 z0
+        for (size_t s = 0; s < numStates; s++) {
+            AbcdMatrix m;
+            if (!inductorChain(freqIndex, uint32_t(s), m)) {
+                return false;
+            }
+            out[s] = (m.a + m.d) * z0() + m.b + m.c * (z0() * z0()) - Cplx{2.0f * z0(), 0.0f};
+        }
+        return true;
+    }
+    const float k = 2.0f * z0();
+    for (size_t s = 0; s < numStates; s++) {
+        const PersonalityBlock* b = findBlock(BlockKind::InductorBank, uint32_t(s));
+        if (b == nullptr || header().numParams < 2) {
+            return false;
+        }
+        const Cplx t = cinv(sample(*b, SParam::S21, freqIndex));
+        out[s] = Cplx{(t.re - 1.0f) * k, t.im * k};
+    }
+    return true;
+}
+
+bool PersonalityView::shuntAdmittances(size_t freqIndex, Cplx* out, size_t numStates) const
+{
+    if (findBlock(BlockKind::CapacitorBank, 0) == nullptr) {
+        for (size_t s = 0; s < numStates; s++) {
+            if (!capacitorBank(freqIndex, uint32_t(s), out[s])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const float k = 2.0f / z0();
+    for (size_t s = 0; s < numStates; s++) {
+        const PersonalityBlock* b = findBlock(BlockKind::CapacitorBank, uint32_t(s));
+        if (b == nullptr || header().numParams < 2) {
+            return false;
+        }
+        const Cplx t = cinv(sample(*b, SParam::S21, freqIndex));
+        out[s] = Cplx{(t.re - 1.0f) * k, t.im * k};
+    }
+    return true;
+}
+
+AbcdMatrix cascadeAbcd(const AbcdMatrix& x, const AbcdMatrix& y)
+{
+    return AbcdMatrix{cmul(x.a, y.a) + cmul(x.b, y.c), cmul(x.a, y.b) + cmul(x.b, y.d),
+                      cmul(x.c, y.a) + cmul(x.d, y.c), cmul(x.c, y.b) + cmul(x.d, y.d)};
+}
+
+AbcdMatrix sToAbcd(const Cplx s[4], float z0)
+{
+    const Cplx one{1.0f, 0.0f};
+    const Cplx s11 = s[size_t(SParam::S11)], s21 = s[size_t(SParam::S21)];
+    const Cplx s12 = s[size_t(SParam::S12)], s22 = s[size_t(SParam::S22)];
+    const Cplx s12s21 = cmul(s12, s21);
+    const Cplx k = cinv(s21 * 2.0f);
+    return AbcdMatrix{cmul(cmul(one + s11, one - s22) + s12s21, k),
+                      cmul(cmul(one + s11, one + s22) - s12s21, k) * z0,
+                      cmul(cmul(one - s11, one - s22) - s12s21, k) * (1.0f / z0),
+                      cmul(cmul(one - s11, one + s22) + s12s21, k)};
+}
+
+void abcdToS(const AbcdMatrix& m, float z0, Cplx s[4])
+{
+    const Cplx bz = m.b * (1.0f / z0), cz = m.c * z0;
+    const Cplx k = cinv(m.a + bz + cz + m.d);
+    s[size_t(SParam::S11)] = cmul(m.a + bz - cz - m.d, k);
+    s[size_t(SParam::S21)] = k * 2.0f;
+    s[size_t(SParam::S12)] = cmul(cmul(m.a, m.d) - cmul(m.b, m.c), k) * 2.0f;
+    s[size_t(SParam::S22)] = cmul(bz - m.a - cz + m.d, k);
+}
+
+size_t PersonalityView::countStages(BlockKind kind) const
+{
+    size_t n = 0;
+    while (n < 32 && findBlock(kind, packStageState(uint8_t(n), false)) && findBlock(kind, packStageState(uint8_t(n), true))) {
+        n++;
+    }
+    return n;
+}
+
+bool PersonalityView::stageAbcd(BlockKind kind, uint8_t stage, bool set, size_t freqIndex, AbcdMatrix& out) const
+{
+    const PersonalityBlock* b = findBlock(kind, packStageState(stage, set));
+    if (b == nullptr || header().numParams < 4 || freqIndex >= numFreqs()) {
+        return false;
+    }
+    Cplx s[4];
+    for (size_t p = 0; p < 4; p++) {
+        s[p] = sample(*b, SParam(p), freqIndex);
+    }
+    out = sToAbcd(s, z0());
+    return true;
+}
+
+bool PersonalityView::inductorChain(size_t freqIndex, uint32_t lMask, AbcdMatrix& out) const
+{
+    const size_t stages = numInductorStages();
+    if (stages == 0 || (lMask >> stages) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < stages; i++) {
+        AbcdMatrix m;
+        if (!stageAbcd(BlockKind::InductorStage, uint8_t(i), (lMask >> i) & 1, freqIndex, m)) {
+            return false;
+        }
+        out = i == 0 ? m : cascadeAbcd(out, m);
+    }
+    return true;
+}
+
+bool PersonalityView::capacitorBank(size_t freqIndex, uint32_t cMask, Cplx& y) const
+{
+    const size_t branches = numCapacitorBranches();
+    if (branches == 0 || (cMask >> branches) != 0 || header().numParams < 2 || freqIndex >= numFreqs()) {
+        return false;
+    }
+    // Shunt element from S21 as in shuntAdmittances(); an open branch still
+    // contributes its relay's off capacitance
+    const float k = 2.0f / z0();
+    y = Cplx{0.0f, 0.0f};
+    for (size_t i = 0; i < branches; i++) {
+        const PersonalityBlock* b = findBlock(BlockKind::CapacitorBranch, packStageState(uint8_t(i), (cMask >> i) & 1));
+        const Cplx t = cinv(sample(*b, SParam::S21, freqIndex));
+        y = y + Cplx{(t.re - 1.0f) * k, t.im * k};
+    }
+    return true;
+}
+
+bool PersonalityView::composeNetwork(size_t freqIndex, uint32_t lMask, uint32_t cMask, bool capOnAntennaSide,
+                                     Cplx s[4]) const
+{
+    AbcdMatrix chain;
+    Cplx y;
+    if (!inductorChain(freqIndex, lMask, chain) || !capacitorBank(freqIndex, cMask, y)) {
+        return false;
+    }
+    const AbcdMatrix shunt{Cplx{1.0f, 0.0f}, Cplx{0.0f, 0.0f}, y, Cplx{1.0f, 0.0f}};
+    abcdToS(capOnAntennaSide ? cascadeAbcd(chain, shunt) : cascadeAbcd(shunt, chain), z0(), s);
+    return true;
+}
+
+bool PersonalityView::validateNetworks(NetworkValidation& out) const
+{
+    out = NetworkValidation{0, 0.0f, 0, 0.0f, SParam::S11};
+    if (!_base || header().numParams < 4) {
+        return false;
+    }
+    const PersonalityBlock* b = blocks();
+    for (size_t i = 0; i < numBlocks(); i++) {
+        if (b[i].kind != uint16_t(BlockKind::Network) || !findBlock(BlockKind::Network, b[i].state)) {
+            continue;
+        }
+        const uint32_t lMask = b[i].state & 0xFFF, cMask = (b[i].state >> 12) & 0xFFF;
+        const bool capOnAntennaSide = (b[i].state >> 24) & 1;
+        for (size_t f = 0; f < numFreqs(); f++) {
+            Cplx s[4];
+            if (!composeNetwork(f, lMask, cMask, capOnAntennaSide, s)) {
+                return false;
+            }
+            for (size_t p = 0; p < 4; p++) {
+                const float e = sqrtf(cnorm2(s[p] - sample(b[i], SParam(p), f)));
+                if (e > out.maxError) {
+                    out.maxError = e;
+                    out.worstState = b[i].state;
+                    out.worstFreqHz = freqs()[f];
+                    out.worstParam = SParam(p);
+                }
+            }
+        }
+        out.states++;
+    }
+    return out.states != 0;
+}
@@ -0,0 +1,156 @@
+#ifndef PERSONALITY_H
+#define PERSONALITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Cplx.h"
+
+// Binary "personality" of a tuner: measured S-parameters of its networks
+// (docs/circuit_description.md), either of every relay setting of each bank
+// or, linear in the number of relays, of each inductor stage and capacitor
+// branch in both relay positions, from which any state is composed on
+// demand (see inductorChain()). The file is used in
+// place from a memory mapping (flash partition on the ESP32, mmap on the
+// host); attach() only validates the header and index bounds, so cold-start
+// time and RAM use do not depend on the file size.
+//
+// Layout (little endian):
+//   PersonalityHeader
+//   float freqHz[numFreqs]                      frequency index, ascending
+//   PersonalityBlock[numBlocks]                 sorted by (kind, state)
+//   data: per block, per parameter, float re[numFreqs] then float im[numFreqs]
+//
+// Every re/im array starts on a PERSONALITY_ALIGN boundary and is padded to
+// `stride` bytes, so the complex data is structure-of-arrays and safe for
+// aligned vector loads (ESP32-S3 PIE: 16 bytes, AVX: 32 bytes).
+
+static constexpr uint32_t PERSONALITY_MAGIC   = 0x46505447; // "GTPF"
+static constexpr uint16_t PERSONALITY_VERSION = 1;
+static constexpr uint8_t  PERSONALITY_SUBTYPE = 0x41;       // custom data partition subtype
+static constexpr uint32_t PERSONALITY_ALIGN   = 32;
+
+enum class BlockKind : uint16_t {
+    InductorBank    = 1, // 2-port of the series inductor chain, state = L mask (TP1/TP2)
+    CapacitorBank   = 2, // 2-port of the shunt capacitor bank, state = C mask (TP3)
+    Network         = 3, // complete tuning network, state = packed TuneState
+    InductorStage   = 4, // 2-port of one stage of the inductor chain, state = packStageState
+    CapacitorBranch = 5  // 2-port of one capacitor branch (TP3), state = packStageState
+};
+
+// Parameter order within a block
+enum class SParam : uint8_t { S11 = 0, S21 = 1, S12 = 2, S22 = 3 };
+
+struct PersonalityHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t numFreqs;
+    uint32_t numBlocks;
+    uint16_t numParams;    // 4 for 2-port data, 1 for 1-port
+    uint16_t flags;
+    float    z0;
+    uint32_t freqOffset;   // float freqHz[numFreqs]
+    uint32_t blockOffset;  // PersonalityBlock[numBlocks]
+    uint32_t stride;       // bytes per re or im array, multiple of PERSONALITY_ALIGN
+    uint32_t totalSize;
+    uint32_t serial;       // tuner serial number the data was measured on, 0 if generic
+    uint32_t crc32;        // CRC-32 of bytes [headerSize, totalSize)
+};
+
+struct PersonalityBlock {
+    uint16_t kind;         // BlockKind
+    uint16_t reserved;
+    uint32_t state;
+    uint32_t dataOffset;   // first array of the block, from the start of the file
+};
+
+// Pack a TuneState into PersonalityBlock::state for BlockKind::Network
+inline uint32_t packNetworkState(uint16_t lMask, uint16_t cMask, bool capOnAntennaSide)
+{
+    return uint32_t(lMask) | (uint32_t(cMask) << 12) | (uint32_t(capOnAntennaSide) << 24);
+}
+
+// Stage n of the inductor chain (from the radio side) or capacitor branch n,
+// with its KM relay set (element in circuit) or not
+inline uint32_t packStageState(uint8_t stage, bool set)
+{
+    return (uint32_t(stage) << 1) | uint32_t(set);
+}
+
+// Chain (ABCD) matrix of a 2-port, port 1 towards the radio
+struct AbcdMatrix {
+    Cplx a, b, c, d;
+};
+
+// first followed by second
+AbcdMatrix cascadeAbcd(const AbcdMatrix& first, const AbcdMatrix& second);
+// s in SParam order
+AbcdMatrix sToAbcd(const Cplx s[4], float z0);
+void abcdToS(const AbcdMatrix& m, float z0, Cplx s[4]);
+
+// Composed network states against the directly measured ones
+struct NetworkValidation {
+    size_t   states;      // Network blocks compared
+    float    maxError;    // largest |S composed - S measured|, any parameter and point
+    uint32_t worstState;  // packed TuneState of the largest error
+    float    worstFreqHz;
+    SParam   worstParam;
+};
+
+// Read-only, zero-copy view of a mapped personality
+class PersonalityView {
+public:
+    PersonalityView() : _base(nullptr), _size(0) {}
+
+    bool attach(const uint8_t* data, size_t size);
+    bool isValid() const { return _base != nullptr; }
+    bool verifyCrc() const;
+
+    const PersonalityHeader& header() const { return *reinterpret_cast<const PersonalityHeader*>(_base); }
+    size_t numFreqs() const { return header().numFreqs; }
+    size_t numBlocks() const { return header().numBlocks; }
+    float z0() const { return header().z0; }
+    const float* freqs() const { return reinterpret_cast<const float*>(_base + header().freqOffset); }
+    const PersonalityBlock* blocks() const { return reinterpret_cast<const PersonalityBlock*>(_base + header().blockOffset); }
+
+    // Index of the frequency point nearest freqHz
+    size_t nearestFreq(float freqHz) const;
+    // nullptr if the block is not present
+    const PersonalityBlock* findBlock(BlockKind kind, uint32_t state) const;
+
+    // Aligned SoA arrays of one parameter, numFreqs() entries each
+    const float* re(const PersonalityBlock& block, SParam p) const;
+    const float* im(const PersonalityBlock& block, SParam p) const;
+    Cplx sample(const PersonalityBlock& block, SParam p, size_t freqIndex) const;
+
+    // Solver tables from bank blocks at one frequency point, unnormalised:
+    // series impedance of every inductor state, shunt admittance of every
+    // capacitor state, derived from S21 of the measured 2-ports.
+    bool seriesImpedances(size_t freqIndex, Cplx* out, size_t numStates) const;
+    bool shuntAdmittances(size_t freqIndex, Cplx* out, size_t numStates) const;
+    // Without bank blocks both are composed from the stage and branch blocks.
+
+    // Stages / branches with blocks for both relay positions
+    size_t numInductorStages() const { return countStages(BlockKind::InductorStage); }
+    size_t numCapacitorBranches() const { return countStages(BlockKind::CapacitorBranch); }
+    // The inductor chain in state lMask: its stages cascaded in chain order
+    bool inductorChain(size_t freqIndex, uint32_t lMask, AbcdMatrix& out) const;
+    // The capacitor bank in state cMask: its branches in parallel, each
+    // taken as a shunt admittance
+    bool capacitorBank(size_t freqIndex, uint32_t cMask, Cplx& y) const;
+    // A complete network state composed from stages and branches, with the
+    // bank on the antenna side of the chain ("C, L") or on the radio side
+    bool composeNetwork(size_t freqIndex, uint32_t lMask, uint32_t cMask, bool capOnAntennaSide, Cplx s[4]) const;
+    // Every Network block against its composition; false if there are none
+    // or the stage and branch blocks are missing
+    bool validateNetworks(NetworkValidation& out) const;
+
+private:
+    size_t countStages(BlockKind kind) const;
+    bool stageAbcd(BlockKind kind, uint8_t stage, bool set, size_t freqIndex, AbcdMatrix& out) const;
+
+    const uint8_t* _base;
+    size_t         _size;
+};
+
+#endif // PERSONALITY_H
@@ -0,0 +1,111 @@
+#include "PowerPolicy.h"
+#include <string.h>
+
+static const char* const s_stateNames[] = {"active", "tuned_idle", "dormant"};
+static_assert(sizeof(s_stateNames) / sizeof(s_stateNames[0]) == size_t(PowerState::Count), "names vs PowerState");
+
+PowerPolicy::PowerPolicy(const PowerConfig& config, uint32_t nowMs) :
+    _config(config), _state(PowerState::Active), _sleepMode(config.sleepMode), _activity(false),
+    _lastActivityMs(nowMs), _enteredMs(nowMs), _accountedMs(nowMs)
+{
+    memset(&_totals, 0, sizeof(_totals));
+    _totals.entries[size_t(PowerState::Active)] = 1;
+}
+
+void PowerPolicy::activity(uint32_t nowMs)
+{
+    _activity = true;
+    _lastActivityMs = nowMs;
+}
+
+PowerState PowerPolicy::update(uint32_t nowMs, const PowerHold& hold)
+{
+    account(nowMs);
+    if (hold.busy) {
+        _lastActivityMs = nowMs;
+    }
+    const bool woken = _activity || hold.busy;
+    _activity = false;
+    switch (_state) {
+    case PowerState::Active:
+        if (!woken && nowMs - _lastActivityMs >= _config.idleAfterMs) {
+            enter(PowerState::TunedIdle, nowMs);
+        }
+        break;
+    case PowerState::TunedIdle:
+        if (woken) {
+            enter(PowerState::Active, nowMs);
+        } else if (_config.dormantAfterMs != 0 && !hold.networkNeeded &&
+                   nowMs - _enteredMs >= _config.dormantAfterMs) {
+            _sleepMode = hold.lightSleepOnly ? SleepMode::Light : _config.sleepMode;
+            enter(PowerState::Dormant, nowMs);
+        }
+        break;
+    case PowerState::Dormant:
+        if (woken) {
+            enter(PowerState::Active, nowMs);
+        }
+        break;
+    default:
+        break;
+    }
+    return _state;
+}
+
+uint32_t PowerPolicy::nextChangeMs(uint32_t nowMs) const
+{
+    if (_state == PowerState::Active) {
+        const uint32_t quiet = nowMs - _lastActivityMs;
+        return quiet >= _config.idleAfterMs ? 1 : _config.idleAfterMs - quiet;
+    }
+    if (_state == PowerState::TunedIdle && _config.dormantAfterMs != 0) {
+        const uint32_t idle = nowMs - _enteredMs;
+        return idle >= _config.dormantAfterMs ? 1 : _config.dormantAfterMs - idle;
+    }
+    return 0;
+}
+
+void PowerPolicy::restoreTotals(const PowerTotals& saved, uint32_t sleptMs)
+{
+    const uint32_t entries = _totals.entries[size_t(PowerState::Active)];
+    _totals = saved;
+    _totals.entries[size_t(PowerState::Active)] += entries;
+    _totals.ms[size_t(PowerState::Dormant)] += sleptMs;
+    _totals.mj[size_t(PowerState::Dormant)] += double(sleptMs) * _config.deepSleepMw * 1e-3;
+}
+
+float PowerPolicy::stateMw(PowerState state) const
+{
+    switch (state) {
+    case PowerState::Active:    return _config.activeMw;
+    case PowerState::TunedIdle: return _config.idleMw;
+    case PowerState::Dormant:   return _sleepMode == SleepMode::Deep ? _config.deepSleepMw : _config.lightSleepMw;
+    default:                    return 0.0f;
+    }
+}
+
+// mW x ms = µJ
+void PowerPolicy::account(uint32_t nowMs)
+{
+    const uint32_t elapsed = nowMs - _accountedMs;
+    _accountedMs = nowMs;
+    _totals.ms[size_t(_state)] += elapsed;
+    _totals.mj[size_t(_state)] += double(elapsed) * stateMw(_state) * 1e-3;
+}
+
+void PowerPolicy::enter(PowerState state, uint32_t nowMs)
+{
+    _state = state;
+    _enteredMs = nowMs;
+    _totals.entries[size_t(state)]++;
+}
+
+const char* PowerPolicy::stateName(PowerState state)
+{
+    return size_t(state) < size_t(PowerState::Count) ? s_stateNames[size_t(state)] : "?";
+}
+
+const char* PowerPolicy::sleepModeName(SleepMode mode)
+{
+    return mode == SleepMode::Deep ? "deep" : "light";
+}
@@ -0,0 +1,95 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ACTIVE: full clock, WiFi always listening. TUNED-IDLE: relays latched,
+// CPU clocked down and WiFi in modem sleep, still reachable. DORMANT: WiFi
+// off and the CPU asleep, nothing switching near the antenna.
+enum class PowerState : uint8_t {
+    Active, TunedIdle, Dormant,
+    Count
+};
+
+// How DORMANT sleeps. Light sleep keeps RAM, the GPIO levels and the tasks
+// and carries on where it stopped; deep sleep keeps only the RTC domain and
+// wakes through a reboot.
+enum class SleepMode : uint8_t { Light, Deep };
+
+struct PowerConfig {
+    uint32_t  idleAfterMs    = 60000;  // ACTIVE without a request or relay job this long: TUNED-IDLE
+    uint32_t  dormantAfterMs = 600000; // TUNED-IDLE this long: DORMANT; 0: never
+    uint32_t  wakeEveryMs    = 0;      // DORMANT: timer wake, so the UI can get in; 0: wake pin and CI-V only
+    SleepMode sleepMode      = SleepMode::Light;
+    uint16_t  activeCpuMhz   = 240;
+    uint16_t  idleCpuMhz     = 80;     // lowest clock the WiFi driver runs at
+    // Estimated supply power in each state (3.3 V rail), for the energy figures
+    float     activeMw       = 330.0f;
+    float     idleMw         = 66.0f;
+    float     lightSleepMw   = 2.6f;
+    float     deepSleepMw    = 0.05f;
+};
+
+// What keeps the tuner out of the lower states, sampled for every update()
+struct PowerHold {
+    bool busy           = false; // relay job queued or running: ACTIVE
+    bool networkNeeded  = false; // e.g. rig followed over rigctld: never DORMANT
+    bool lightSleepOnly = false; // monostable relay energised, CI-V wake needed: no deep sleep
+};
+
+// Time and estimated energy per state since the first boot; plain data, so
+// it can be kept in RTC memory through a deep sleep
+struct PowerTotals {
+    uint64_t ms[size_t(PowerState::Count)];
+    double   mj[size_t(PowerState::Count)];
+    uint32_t entries[size_t(PowerState::Count)];
+};
+
+// Decides the power state from activity and timeouts on a millisecond clock
+// it is handed, so the host build can drive it on a simulated one. The
+// caller applies each change (clock, modem sleep, sleep) and reports
+// activity; leaving DORMANT is activity() from the wake path.
+class PowerPolicy {
+public:
+    PowerPolicy(const PowerConfig& config, uint32_t nowMs);
+
+    // Takes effect at the next update()
+    void configure(const PowerConfig& config) { _config = config; }
+    const PowerConfig& config() const { return _config; }
+
+    // A request, relay job or wake-up: ACTIVE at the next update()
+    void activity(uint32_t nowMs);
+    // State to be in now, after accounting the time since the last call
+    PowerState update(uint32_t nowMs, const PowerHold& hold);
+    PowerState state() const { return _state; }
+    // How DORMANT sleeps, as decided when it was entered
+    SleepMode sleepMode() const { return _sleepMode; }
+    // ms until update() changes state if nothing happens; 0: not by timeout
+    uint32_t nextChangeMs(uint32_t nowMs) const;
+
+    // As of the last update()
+    const PowerTotals& totals() const { return _totals; }
+    // Totals saved before a deep sleep, plus the sleep itself
+    void restoreTotals(const PowerTotals& saved, uint32_t sleptMs);
+    // Estimated power in state (DORMANT: in the sleep mode it was entered with)
+    float stateMw(PowerState state) const;
+
+    static const char* stateName(PowerState state);
+    static const char* sleepModeName(SleepMode mode);
+
+private:
+    void account(uint32_t nowMs);
+    void enter(PowerState state, uint32_t nowMs);
+
+    PowerConfig _config;
+    PowerState  _state;
+    SleepMode   _sleepMode;
+    bool        _activity;
+    uint32_t    _lastActivityMs;
+    uint32_t    _enteredMs;
+    uint32_t    _accountedMs;
+    PowerTotals _totals;
+};
+
+#endif // POWER_POLICY_H
@@ -0,0 +1,235 @@
+#include "RelaySchedule.h"
+
+static constexpr uint16_t FOREVER = 0xFFFF;
+static constexpr size_t   MAX_LOADS = RELAY_SCHEDULE_MAX_RELAYS + 4;
+
+// Coil current drawn over [start, end)
+struct Load {
+    uint16_t start;
+    uint16_t end;
+    uint16_t ma;
+};
+
+struct Timeline {
+    Load   loads[MAX_LOADS];
+    size_t count;
+
+    void add(uint16_t start, uint16_t end, uint16_t ma) {
+        if (ma > 0 && count < MAX_LOADS) loads[count++] = Load{start, end, ma};
+    }
+
+    uint32_t at(uint16_t t) const {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (loads[i].start <= t && t < loads[i].end) sum += loads[i].ma;
+        }
+        return sum;
+    }
+
+    // Highest load over [t0, t1); it only rises where a load starts
+    uint32_t peak(uint16_t t0, uint16_t t1) const {
+        uint32_t worst = at(t0);
+        for (size_t i = 0; i < count; i++) {
+            if (loads[i].start > t0 && loads[i].start < t1) {
+                const uint32_t v = at(loads[i].start);
+                if (v > worst) worst = v;
+            }
+        }
+        return worst;
+    }
+
+    // Earliest start >= ready at which `ma` fits for `length`; FOREVER if never
+    uint16_t earliest(uint16_t ready, uint16_t length, uint16_t ma, uint16_t budget) const {
+        uint16_t best = FOREVER;
+        const uint16_t candidates = uint16_t(count + 1);
+        for (uint16_t c = 0; c < candidates; c++) {
+            const uint16_t t = c == 0 ? ready : loads[c - 1].end;
+            if (t < ready || t >= best || t == FOREVER) continue;
+            if (peak(t, uint16_t(t + length)) + ma <= budget) best = t;
+        }
+        return best;
+    }
+};
+
+struct StepList {
+    RelayPlan& plan;
+
+    bool add(uint16_t atMs, uint8_t pin, uint8_t level) {
+        if (plan.count >= RELAY_SCHEDULE_MAX_STEPS) {
+            plan.error = "too many relay steps";
+            return false;
+        }
+        plan.steps[plan.count++] = RelayStep{atMs, pin, level};
+        return true;
+    }
+};
+
+RelayScheduler::RelayScheduler(const RelayProfile* relays, size_t count, const BipolarDrive& drive, uint16_t budgetMa) :
+    _relays(relays), _count(count < RELAY_SCHEDULE_MAX_RELAYS ? count : RELAY_SCHEDULE_MAX_RELAYS),
+    _drive(drive), _budgetMa(budgetMa)
+{
+}
+
+bool RelayScheduler::plan(const RelayTarget& target, const RelayTarget& current, bool rfApplied, RelayPlan& out) const
+{
+    out.count = 0;
+    out.totalMs = 0;
+    out.peakMa = 0;
+    out.skipped = 0;
+    out.error = nullptr;
+    if (rfApplied) {
+        out.error = "RF applied, relays not switched";
+        return false;
+    }
+    StepList steps{out};
+    Timeline load = {};
+    uint16_t total = 0;
+
+    // Bipolar relays: one shared pulse, so one requested state; it is only
+    // given if one of them is not in position yet
+    int8_t bipolar = -1;
+    bool bipolarMoves = false;
+    uint8_t bipolarRequested = 0;
+    uint16_t bipolarPulse = 0, bipolarMa = 0;
+    for (size_t i = 0; i < _count; i++) {
+        if (_relays[i].kind != RelayKind::Bipolar) continue;
+        bipolarPulse = _relays[i].pulseMs > bipolarPulse ? _relays[i].pulseMs : bipolarPulse;
+        bipolarMa = uint16_t(bipolarMa + _relays[i].coilMa);
+        if (target.state[i] < 0) continue;
+        if (bipolar >= 0 && bipolar != target.state[i]) {
+            out.error = "bipolar relays share one pulse and cannot take different states";
+            return false;
+        }
+        bipolar = target.state[i];
+        bipolarMoves = bipolarMoves || current.state[i] != target.state[i];
+        bipolarRequested++;
+    }
+    if (!bipolarMoves) {
+        out.skipped = uint8_t(out.skipped + bipolarRequested);
+        bipolar = -1;
+    }
+
+    // Monostable relays other than the bipolar drive switch at t = 0 and hold;
+    // coils left as they are keep drawing current
+    for (size_t i = 0; i < _count; i++) {
+        const RelayProfile& r = _relays[i];
+        const bool driveRelay = i == _drive.polarity || i == _drive.drive[0] || i == _drive.drive[1];
+        if (r.kind != RelayKind::Monostable || (driveRelay && bipolar >= 0)) continue;
+        if (target.state[i] < 0 || target.state[i] == current.state[i]) {
+            if (target.state[i] >= 0) out.skipped++;
+            if (current.state[i] != 0) load.add(0, FOREVER, r.coilMa);
+            continue;
+        }
+        if (!steps.add(0, r.pin, uint8_t(target.state[i]))) return false;
+        if (target.state[i]) load.add(0, FOREVER, r.coilMa);
+        if (r.settleMs > total) total = r.settleMs;
+    }
+    if (load.at(0) > _budgetMa) {
+        out.error = "held relays alone exceed the coil current budget";
+        return false;
+    }
+
+    if (bipolar >= 0) {
+        const RelayProfile& pol = _relays[_drive.polarity];
+        const RelayProfile& d0 = _relays[_drive.drive[0]];
+        const RelayProfile& d1 = _relays[_drive.drive[1]];
+        const uint16_t driveSettle = d0.settleMs > d1.settleMs ? d0.settleMs : d1.settleMs;
+        const uint16_t driveLength = uint16_t(2 * driveSettle + bipolarPulse); // make, pulse, drop out
+        const uint16_t driveMa = uint16_t(d0.coilMa + d1.coilMa + bipolarMa);
+        // No need to wait for the polarity relay if it is known to be in place
+        const bool polarityMoves = current.state[_drive.polarity] != bipolar;
+        if (polarityMoves && !steps.add(0, pol.pin, uint8_t(bipolar))) return false;
+        const size_t polLoad = load.count;
+        if (bipolar) load.add(0, FOREVER, pol.coilMa);
+        const uint16_t start = load.earliest(polarityMoves ? pol.settleMs : 0, driveLength, driveMa, _budgetMa);
+        if (start == FOREVER) {
+            out.error = "gap relay pulse exceeds the coil current budget";
+            return false;
+        }
+        const uint16_t pulseEnd = uint16_t(start + driveSettle + bipolarPulse);
+        const uint16_t released = uint16_t(start + driveLength);
+        load.add(start, released, driveMa);
+        if (!steps.add(start, d0.pin, 1) || !steps.add(start, d1.pin, 1) ||
+            !steps.add(pulseEnd, d0.pin, 0) || !steps.add(pulseEnd, d1.pin, 0)) return false;
+        uint16_t end = released;
+        if (bipolar) {
+            if (polLoad < load.count) load.loads[polLoad].end = released; // held until the drive dropped out
+            if (!steps.add(released, pol.pin, 0)) return false;
+            end = uint16_t(released + pol.settleMs);
+        }
+        if (end > total) total = end;
+    }
+
+    // Monopolar pulses, longest and heaviest first
+    bool placed[RELAY_SCHEDULE_MAX_RELAYS] = {};
+    for (;;) {
+        size_t next = _count;
+        for (size_t i = 0; i < _count; i++) {
+            const RelayProfile& r = _relays[i];
+            if (r.kind != RelayKind::Monopolar || target.state[i] < 0 || placed[i]) continue;
+            if (target.state[i] == current.state[i]) {
+                placed[i] = true;
+                out.skipped++;
+                continue;
+            }
+            if (next == _count || r.pulseMs > _relays[next].pulseMs ||
+                (r.pulseMs == _relays[next].pulseMs && r.coilMa > _relays[next].coilMa)) {
+                next = i;
+            }
+        }
+        if (next == _count) break;
+        placed[next] = true;
+        const RelayProfile& r = _relays[next];
+        const uint16_t start = load.earliest(0, r.pulseMs, r.coilMa, _budgetMa);
+        if (start == FOREVER) {
+            out.error = "latching pulse exceeds the coil current budget";
+            return false;
+        }
+        const uint8_t pin = target.state[next] ? r.pin : r.resetPin;
+        const uint16_t end = uint16_t(start + r.pulseMs);
+        load.add(start, end, r.coilMa);
+        if (!steps.add(start, pin, 1) || !steps.add(end, pin, 0)) return false;
+        if (end > total) total = end;
+    }
+
+    // Stable sort by time; at equal times releases go first
+    for (size_t i = 1; i < out.count; i++) {
+        const RelayStep s = out.steps[i];
+        size_t j = i;
+        while (j > 0 && (out.steps[j - 1].atMs > s.atMs ||
+                         (out.steps[j - 1].atMs == s.atMs && out.steps[j - 1].level > s.level))) {
+            out.steps[j] = out.steps[j - 1];
+            j--;
+        }
+        out.steps[j] = s;
+    }
+    out.totalMs = total;
+    out.peakMa = peakCurrent(out, current);
+    return true;
+}
+
+uint16_t RelayScheduler::peakCurrent(const RelayPlan& plan, const RelayTarget& current) const
+{
+    bool high[256] = {};
+    for (size_t i = 0; i < _count; i++) {
+        if (_relays[i].kind == RelayKind::Monostable && current.state[i] != 0) high[_relays[i].pin] = true;
+    }
+    uint32_t peak = 0;
+    for (size_t s = 0; s <= plan.count; s++) {
+        if (s < plan.count) {
+            high[plan.steps[s].pin] = plan.steps[s].level != 0;
+            if (s + 1 < plan.count && plan.steps[s + 1].atMs == plan.steps[s].atMs) continue;
+        }
+        uint32_t sum = 0;
+        for (size_t i = 0; i < _count; i++) {
+            const RelayProfile& r = _relays[i];
+            if (r.kind == RelayKind::Bipolar) {
+                if (high[_relays[_drive.drive[0]].pin] && high[_relays[_drive.drive[1]].pin]) sum += r.coilMa;
+            } else if (high[r.pin] || (r.kind == RelayKind::Monopolar && high[r.resetPin])) {
+                sum += r.coilMa;
+            }
+        }
+        if (sum > peak) peak = sum;
+    }
+    return uint16_t(peak);
+}
@@ -0,0 +1,108 @@
+#ifndef RELAY_SCHEDULE_H
+#define RELAY_SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimum-time relay switching plans under a coil current budget.
+//
+// Given per-relay timing profiles and a target state, RelayScheduler
+// produces a list of timed coil writes that reaches the target as early as
+// the coil supply (the bias-tee DC feed, see docs/circuit_description.md)
+// allows:
+//   - monostable relays are written at t = 0 and settle after settleMs
+//   - monopolar latching relays get one pulseMs pulse on the SET or RESET coil
+//   - bipolar latching relays (the gap relays) share one pulse: the polarity
+//     relay is set and settled first, then both drive relays are energised
+//     together for the drive settle time plus pulseMs, and the polarity relay
+//     is released only after the drive contacts have dropped out
+// Pulses run in parallel whenever the summed coil current stays within the
+// budget. They are placed longest first at the earliest instant that fits,
+// so the plan is optimal whenever the budget admits the pulses together and
+// packs them first-fit into successive waves otherwise.
+//
+// Nothing is switched with RF applied: plan() refuses when told RF is present.
+// Given the present relay state, only relays that differ from the target are
+// driven; coils held energised count against the budget for the whole plan.
+
+static constexpr size_t RELAY_SCHEDULE_MAX_RELAYS = 24;
+static constexpr size_t RELAY_SCHEDULE_MAX_STEPS  = 64;
+
+enum class RelayKind : uint8_t {
+    Monostable, // one coil, contact follows it
+    Monopolar,  // latching, separate SET and RESET coils
+    Bipolar     // latching, one coil pulsed through the drive relays
+};
+
+struct RelayProfile {
+    const char* name;
+    RelayKind   kind;
+    uint8_t     pin;      // coil, or SET coil for Monopolar; unused for Bipolar
+    uint8_t     resetPin; // Monopolar only
+    uint16_t    settleMs; // contact settled after a coil change (Monostable)
+    uint16_t    pulseMs;  // minimum coil pulse (latching kinds)
+    uint16_t    coilMa;   // coil current while energised
+};
+
+// How the Bipolar relays are pulsed: `polarity` energised latches them SET;
+// the pulse reaches them only while both `drive` relays are energised.
+// All three are Monostable relay indices.
+struct BipolarDrive {
+    uint8_t polarity;
+    uint8_t drive[2];
+};
+
+// Requested (or present) state per relay index: -1 leave alone (unknown),
+// 0 off / RESET, 1 on / SET
+struct RelayTarget {
+    int8_t state[RELAY_SCHEDULE_MAX_RELAYS];
+
+    RelayTarget() { clear(); }
+    void clear() { for (int8_t& s : state) s = -1; }
+    void set(size_t relay, bool on) { if (relay < RELAY_SCHEDULE_MAX_RELAYS) state[relay] = on ? 1 : 0; }
+};
+
+struct RelayStep {
+    uint16_t atMs;
+    uint8_t  pin;
+    uint8_t  level;
+};
+
+struct RelayPlan {
+    RelayStep   steps[RELAY_SCHEDULE_MAX_STEPS]; // sorted by atMs
+    uint8_t     count;
+    uint16_t    totalMs; // until the last contact has settled
+    uint16_t    peakMa;  // highest summed coil current
+    uint8_t     skipped; // relays of the target already in position
+    const char* error;   // why plan() failed, else nullptr
+};
+
+class RelayScheduler {
+public:
+    RelayScheduler(const RelayProfile* relays, size_t count, const BipolarDrive& drive, uint16_t budgetMa);
+
+    void setBudget(uint16_t budgetMa) { _budgetMa = budgetMa; }
+    uint16_t budget() const { return _budgetMa; }
+    size_t count() const { return _count; }
+    const RelayProfile& profile(size_t relay) const { return _relays[relay]; }
+
+    // Plans the way from `current` to `target`. An unknown (-1) current
+    // state is assumed to differ, and for monostable coils to be energised.
+    // false with out.error set if RF is applied, the target cannot be
+    // reached (e.g. the bipolar relays asked for different states) or a
+    // single pulse alone exceeds the budget
+    bool plan(const RelayTarget& target, const RelayTarget& current, bool rfApplied, RelayPlan& out) const;
+
+    // Highest coil current drawn at the step boundaries of a plan, recomputed
+    // from the steps and the coils held in `current`; for checking a plan
+    // independently of how it was built
+    uint16_t peakCurrent(const RelayPlan& plan, const RelayTarget& current) const;
+
+private:
+    const RelayProfile* _relays;
+    size_t              _count;
+    BipolarDrive        _drive;
+    uint16_t            _budgetMa;
+};
+
+#endif // RELAY_SCHEDULE_H
@@ -0,0 +1,68 @@
+#include "FollowPolicy.h"
+
+FollowPolicy::FollowPolicy(const FollowConfig& config, SegmentFn segment, void* context) :
+    _config(config), _segment(segment), _context(context)
+{
+    reset();
+    _ptt = false;
+    _pttHold = false;
+    _pttReleasedMs = 0;
+    _retuneChangedAtMs = 0;
+}
+
+void FollowPolicy::reset()
+{
+    _tunedHz = 0;
+    _tunedSegment = 0;
+    _candidateSegment = 0;
+    _candidateSinceMs = 0;
+    _changedAtMs = 0;
+}
+
+uint32_t FollowPolicy::update(uint32_t nowMs, uint32_t freqHz, bool ptt)
+{
+    if (ptt) {
+        _ptt = true;
+    } else if (_ptt) {
+        _ptt = false;
+        _pttHold = true;
+        _pttReleasedMs = nowMs;
+    }
+    const uint32_t segment = freqHz != 0 ? _segment(_context, freqHz) : 0;
+    if (segment == 0 || segment == _tunedSegment) {
+        _candidateSegment = 0;
+        return 0;
+    }
+    // Hysteresis: a VFO just across the edge still counts as the tuned segment
+    if (_tunedSegment != 0) {
+        const uint32_t probe = freqHz > _tunedHz ? freqHz - _config.hysteresisHz : freqHz + _config.hysteresisHz;
+        if (_segment(_context, probe) == _tunedSegment) {
+            _candidateSegment = 0;
+            return 0;
+        }
+    }
+    if (_candidateSegment == 0) {
+        _changedAtMs = nowMs; // the VFO just left the tuned segment
+    }
+    if (segment != _candidateSegment) {
+        _candidateSegment = segment;
+        _candidateSinceMs = nowMs;
+    }
+    const uint32_t moved = freqHz > _tunedHz ? freqHz - _tunedHz : _tunedHz - freqHz;
+    const bool jump = _tunedSegment == 0 || moved >= _config.bandJumpHz;
+    if (!jump && nowMs - _candidateSinceMs < _config.debounceMs) {
+        return 0;
+    }
+    if (_ptt) {
+        return 0;
+    }
+    if (_pttHold) {
+        if (nowMs - _pttReleasedMs < _config.pttHoldMs) return 0;
+        _pttHold = false;
+    }
+    _tunedHz = freqHz;
+    _tunedSegment = segment;
+    _candidateSegment = 0;
+    _retuneChangedAtMs = _changedAtMs;
+    return freqHz;
+}
@@ -0,0 +1,52 @@
+#ifndef FOLLOW_POLICY_H
+#define FOLLOW_POLICY_H
+
+#include <stdint.h>
+
+struct FollowConfig {
+    uint32_t debounceMs   = 150;    // VFO must rest in a new segment this long (tuning knob)
+    uint32_t hysteresisHz = 2000;   // and be this far past the segment edge
+    uint32_t bandJumpHz   = 500000; // moves this large (band key, memory) skip the debounce
+    uint32_t pttHoldMs    = 100;    // quiet time after PTT release before switching
+};
+
+// Maps a frequency to its tuning segment: frequencies with the same key need
+// the same relays. 0: not covered, never retuned to.
+typedef uint32_t (*SegmentFn)(void* context, uint32_t freqHz);
+
+// Decides when the rig's VFO has moved far enough for the tuner to follow.
+// Fed every poll with the latest frequency and PTT, it asks for a retune as
+// soon as the VFO has settled in a different segment: at once for a large
+// jump, after debounceMs while the knob is turning. Nothing is asked for
+// while PTT is on or within pttHoldMs of its release; a change made during
+// the over is picked up afterwards.
+class FollowPolicy {
+public:
+    FollowPolicy(const FollowConfig& config, SegmentFn segment, void* context);
+
+    // Frequency to retune to now, or 0
+    uint32_t update(uint32_t nowMs, uint32_t freqHz, bool ptt);
+    // When the VFO first left the tuned segment, for the last retune asked for
+    uint32_t changedAtMs() const { return _retuneChangedAtMs; }
+    // Forgets the tuned segment, so the next update retunes (e.g. after a
+    // failed job or a reconnect)
+    void reset();
+
+    uint32_t tunedHz() const { return _tunedHz; }
+
+private:
+    FollowConfig _config;
+    SegmentFn    _segment;
+    void*        _context;
+    uint32_t     _tunedHz;
+    uint32_t     _tunedSegment;
+    uint32_t     _candidateSegment; // 0: VFO in the tuned segment
+    uint32_t     _candidateSinceMs;
+    uint32_t     _changedAtMs;
+    uint32_t     _retuneChangedAtMs;
+    uint32_t     _pttReleasedMs;
+    bool         _ptt;
+    bool         _pttHold;
+};
+
+#endif // FOLLOW_POLICY_H
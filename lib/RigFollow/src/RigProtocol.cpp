@@ -0,0 +1,142 @@
+#include "RigProtocol.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool rigctldParseFrequency(const char* line, uint32_t& hz)
+{
+    // Some rigs report a fractional frequency ("14074000.000000")
+    char* end = nullptr;
+    const double value = strtod(line, &end);
+    if (end == line || (*end != '\0' && *end != '\r') || value < 1.0 || value > 4.0e9) {
+        return false;
+    }
+    hz = uint32_t(value + 0.5);
+    return true;
+}
+
+bool rigctldParsePtt(const char* line, bool& ptt)
+{
+    if ((line[0] != '0' && line[0] != '1') || (line[1] != '\0' && line[1] != '\r')) {
+        return false;
+    }
+    ptt = line[0] == '1';
+    return true;
+}
+
+static size_t frame(uint8_t to, uint8_t from, const uint8_t* body, size_t len, uint8_t* out, size_t size)
+{
+    if (size < len + 5) {
+        return 0;
+    }
+    out[0] = CIV_PREAMBLE;
+    out[1] = CIV_PREAMBLE;
+    out[2] = to;
+    out[3] = from;
+    memcpy(out + 4, body, len);
+    out[4 + len] = CIV_END;
+    return len + 5;
+}
+
+size_t civReadFrequency(uint8_t rig, uint8_t* out, size_t size)
+{
+    const uint8_t body[] = {CIV_CMD_READ_FREQ};
+    return frame(rig, CIV_CONTROLLER, body, sizeof(body), out, size);
+}
+
+size_t civReadPtt(uint8_t rig, uint8_t* out, size_t size)
+{
+    const uint8_t body[] = {CIV_CMD_PTT, 0x00};
+    return frame(rig, CIV_CONTROLLER, body, sizeof(body), out, size);
+}
+
+size_t civFrequencyFrame(uint8_t to, uint8_t from, uint8_t cmd, uint32_t hz, uint8_t* out, size_t size)
+{
+    uint8_t body[6] = {cmd};
+    for (size_t i = 0; i < 5; i++) {
+        const uint8_t lo = uint8_t(hz % 10);
+        hz /= 10;
+        const uint8_t hi = uint8_t(hz % 10);
+        hz /= 10;
+        body[1 + i] = uint8_t(hi << 4 | lo);
+    }
+    return frame(to, from, body, sizeof(body), out, size);
+}
+
+size_t civPttFrame(uint8_t to, uint8_t from, bool ptt, uint8_t* out, size_t size)
+{
+    const uint8_t body[] = {CIV_CMD_PTT, 0x00, uint8_t(ptt ? 1 : 0)};
+    return frame(to, from, body, sizeof(body), out, size);
+}
+
+bool civDecodeFrequency(const uint8_t* bcd, uint32_t& hz)
+{
+    uint64_t value = 0;
+    for (int i = 4; i >= 0; i--) {
+        const uint8_t hi = bcd[i] >> 4, lo = bcd[i] & 0x0F;
+        if (hi > 9 || lo > 9) return false;
+        value = value * 100 + hi * 10 + lo;
+    }
+    if (value > 0xFFFFFFFFull) {
+        return false;
+    }
+    hz = uint32_t(value);
+    return true;
+}
+
+CivDecoder::CivDecoder(uint8_t rig, uint8_t controller) :
+    _rig(rig), _controller(controller), _len(0)
+{
+}
+
+bool CivDecoder::feed(uint8_t byte, CivEvent& event)
+{
+    if (byte == CIV_PREAMBLE) {
+        // FE FE starts a frame; a preamble inside one restarts it
+        if (_len >= 2 && _frame[_len - 1] != CIV_PREAMBLE) {
+            _len = 0;
+        }
+        if (_len < 2) {
+            _frame[_len++] = byte;
+        }
+        return false;
+    }
+    if (_len < 2) {
+        _len = 0; // noise between frames
+        return false;
+    }
+    if (byte == CIV_END) {
+        const bool ok = decode(event);
+        _len = 0;
+        return ok;
+    }
+    if (_len == CIV_MAX_FRAME) {
+        _len = 0; // too long for anything we read
+        return false;
+    }
+    _frame[_len++] = byte;
+    return false;
+}
+
+// _frame: FE FE to from cmd data...
+bool CivDecoder::decode(CivEvent& event) const
+{
+    if (_len < 5) {
+        return false;
+    }
+    const uint8_t to = _frame[2], from = _frame[3], cmd = _frame[4];
+    if (from == _controller || (to != _controller && to != CIV_BROADCAST) || (_rig != 0 && from != _rig)) {
+        return false; // our own echo, or traffic between other stations
+    }
+    if ((cmd == CIV_CMD_FREQ_TX || cmd == CIV_CMD_READ_FREQ) && _len == 10) {
+        event.kind = CivEvent::Frequency;
+        event.ptt = false;
+        return civDecodeFrequency(_frame + 5, event.freqHz);
+    }
+    if (cmd == CIV_CMD_PTT && _len == 7 && _frame[5] == 0x00) {
+        event.kind = CivEvent::Ptt;
+        event.freqHz = 0;
+        event.ptt = _frame[6] != 0;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,76 @@
+#ifndef RIG_PROTOCOL_H
+#define RIG_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The two ways the tuner learns the transceiver frequency and PTT.
+//
+// hamlib rigctld (TCP, default protocol): the commands "f" and "t" are
+// answered with one line each, the VFO frequency in Hz and 0/1 for PTT;
+// errors come back as "RPRT <negative code>".
+//
+// Icom CI-V (UART): frames FE FE <to> <from> <cmd> [<sub>] [data] FD.
+// Frequencies are 5 BCD bytes, least significant pair first. With CI-V
+// transceive on, the rig broadcasts every VFO change (cmd 00, to 00); PTT
+// is read with cmd 1C 00. On the single-wire bus every frame we send comes
+// back as an echo.
+
+static constexpr uint16_t RIGCTLD_PORT = 4532;
+
+// One reply line (without the newline) to "f" or "t"; false for an error
+// reply or anything else
+bool rigctldParseFrequency(const char* line, uint32_t& hz);
+bool rigctldParsePtt(const char* line, bool& ptt);
+
+static constexpr uint8_t CIV_PREAMBLE     = 0xFE;
+static constexpr uint8_t CIV_END          = 0xFD;
+static constexpr uint8_t CIV_CONTROLLER   = 0xE0; // our address
+static constexpr uint8_t CIV_BROADCAST    = 0x00;
+static constexpr uint8_t CIV_CMD_FREQ_TX  = 0x00; // transceive: frequency changed
+static constexpr uint8_t CIV_CMD_READ_FREQ = 0x03;
+static constexpr uint8_t CIV_CMD_SET_FREQ = 0x05;
+static constexpr uint8_t CIV_CMD_PTT      = 0x1C; // sub 00: PTT
+static constexpr uint8_t CIV_OK           = 0xFB;
+static constexpr uint8_t CIV_NG           = 0xFA;
+static constexpr size_t  CIV_MAX_FRAME    = 16;
+
+// Frame builders; return the frame length, 0 if size is too small
+size_t civReadFrequency(uint8_t rig, uint8_t* out, size_t size);
+size_t civReadPtt(uint8_t rig, uint8_t* out, size_t size);
+// cmd with the frequency as data (transceive, read reply or set)
+size_t civFrequencyFrame(uint8_t to, uint8_t from, uint8_t cmd, uint32_t hz, uint8_t* out, size_t size);
+size_t civPttFrame(uint8_t to, uint8_t from, bool ptt, uint8_t* out, size_t size);
+
+// 5 BCD bytes, least significant first; false if a nibble is not a digit
+bool civDecodeFrequency(const uint8_t* bcd, uint32_t& hz);
+
+struct CivEvent {
+    enum Kind : uint8_t { Frequency, Ptt };
+    Kind     kind;
+    uint32_t freqHz;
+    bool     ptt;
+};
+
+// Reassembles frames from a byte stream and reports the frequency and PTT
+// frames sent to us (or broadcast) by the rig. Echoes of our own frames,
+// OK/NG acknowledgements and other commands are skipped; a frame cut short
+// by a new preamble (bus collision) is dropped.
+class CivDecoder {
+public:
+    // rig 0: accept any sender
+    explicit CivDecoder(uint8_t rig = 0, uint8_t controller = CIV_CONTROLLER);
+
+    // true when byte completed a frame that filled event
+    bool feed(uint8_t byte, CivEvent& event);
+
+private:
+    bool decode(CivEvent& event) const;
+
+    uint8_t _rig;
+    uint8_t _controller;
+    uint8_t _frame[CIV_MAX_FRAME];
+    size_t  _len;
+};
+
+#endif // RIG_PROTOCOL_H
@@ -0,0 +1,269 @@
+#include "SweepCodec.h"
+#include <math.h>
+#include <string.h>
+
+static constexpr double MAX_STEPS = double(1 << 27); // |value| / step, keeps residuals in 31 bits
+static constexpr size_t PADDING   = 8;
+
+static size_t align4(size_t n)
+{
+    return (n + 3) & ~size_t(3);
+}
+
+static uint32_t zigzag(int64_t v)
+{
+    return uint32_t(v < 0 ? (uint64_t(-v) << 1) - 1 : uint64_t(v) << 1);
+}
+
+static int64_t unzigzag(uint32_t v)
+{
+    return (v & 1) ? -int64_t((v >> 1) + 1) : int64_t(v >> 1);
+}
+
+static uint8_t bitWidth(uint32_t v)
+{
+    uint8_t n = 0;
+    while (v) {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+static int64_t quantise(float x, float step)
+{
+    return llround(double(x) / step);
+}
+
+static float reconstruct(int64_t x, float step)
+{
+    return float(double(x) * double(step));
+}
+
+// Zigzag residual of point i of a block from its linear prediction
+static uint32_t residual(const float* x, size_t i, float step)
+{
+    const int64_t prediction = i == 1 ? quantise(x[0], step) : 2 * quantise(x[i - 1], step) - quantise(x[i - 2], step);
+    return zigzag(quantise(x[i], step) - prediction);
+}
+
+// Largest |dGamma| that moves SWR by at most maxSwr at |Gamma| = g:
+// SWR(g + t) - SWR(g) = 2t / ((1 - g)(1 - g - t)) <= maxSwr
+static double gammaToleranceForSwr(double g, double maxSwr)
+{
+    const double m = fmax(1.0 - g, 0.0);
+    return maxSwr * m * m / (2.0 + maxSwr * m);
+}
+
+void impedanceTolerance(const float* re, const float* im, size_t n, float maxOhms, float maxSwr, float z0, float* tol)
+{
+    for (size_t i = 0; i < n; i++) {
+        double t = maxOhms > 0.0f ? double(maxOhms) : INFINITY;
+        if (maxSwr > 0.0f) {
+            // |dGamma| = 2 z0 |dZ| / (|Z + z0| |Z + dZ + z0|), with |Z + dZ + z0| >= |Z + z0| - |dZ|
+            const double ar = re[i] - z0, ai = im[i], br = re[i] + z0, bi = im[i];
+            const double sum = sqrt(br * br + bi * bi);
+            const double g = sqrt(ar * ar + ai * ai) / sum;
+            const double tg = gammaToleranceForSwr(g, maxSwr);
+            t = fmin(t, tg * sum * sum / (2.0 * z0 + tg * sum));
+        }
+        tol[i] = float(t);
+    }
+}
+
+void reflectionTolerance(const float* re, const float* im, size_t n, float maxS, float maxSwr, float* tol)
+{
+    for (size_t i = 0; i < n; i++) {
+        double t = maxS > 0.0f ? double(maxS) : INFINITY;
+        if (maxSwr > 0.0f) {
+            t = fmin(t, gammaToleranceForSwr(sqrt(double(re[i]) * re[i] + double(im[i]) * im[i]), maxSwr));
+        }
+        tol[i] = float(t);
+    }
+}
+
+size_t SweepEncoder::maxEncodedSize(size_t n, uint16_t blockSize)
+{
+    if (blockSize == 0) {
+        return 0;
+    }
+    const size_t blocks = (n + blockSize - 1) / blockSize;
+    const size_t perBlock = sizeof(SweepCodecBlock) + align4((size_t(blockSize) - 1) * 2 * 32 / 8);
+    return sizeof(SweepCodecHeader) + blocks * (sizeof(uint32_t) + perBlock) + PADDING;
+}
+
+size_t SweepEncoder::encode(const float* re, const float* im, const float* tol, size_t n, uint8_t* out,
+                            size_t capacity, uint16_t blockSize)
+{
+    if (n == 0 || blockSize < 2 || capacity < maxEncodedSize(n, blockSize)) {
+        return 0;
+    }
+    memset(out, 0, capacity);
+    const size_t numBlocks = (n + blockSize - 1) / blockSize;
+    uint32_t* offsets = reinterpret_cast<uint32_t*>(out + sizeof(SweepCodecHeader));
+    size_t pos = sizeof(SweepCodecHeader) + numBlocks * sizeof(uint32_t);
+
+    for (size_t b = 0; b < numBlocks; b++) {
+        const size_t first = b * blockSize;
+        const size_t count = n - first < blockSize ? n - first : blockSize;
+        // Each component within step / 2 keeps the complex error within step / sqrt(2)
+        double minTol = INFINITY, maxAbs = 0.0;
+        for (size_t i = first; i < first + count; i++) {
+            minTol = fmin(minTol, double(tol[i]));
+            maxAbs = fmax(maxAbs, fmax(fabs(double(re[i])), fabs(double(im[i]))));
+        }
+        if (!(minTol > 0.0)) {
+            return 0;
+        }
+        float step = float(minTol * 1.41421356 * 0.999);
+        for (int attempt = 0;; attempt++) {
+            if (attempt == 8 || !(step > 0.0f) || maxAbs / step > MAX_STEPS) {
+                return 0;
+            }
+            bool within = true;
+            for (size_t i = first; i < first + count && within; i++) {
+                const double dr = reconstruct(quantise(re[i], step), step) - re[i];
+                const double di = reconstruct(quantise(im[i], step), step) - im[i];
+                within = sqrt(dr * dr + di * di) <= tol[i];
+            }
+            if (within) break;
+            // Float rounding of large values on a fine step
+            step *= 0.5f;
+        }
+
+        uint32_t maxRe = 0, maxIm = 0;
+        for (size_t i = 1; i < count; i++) {
+            maxRe |= residual(re + first, i, step);
+            maxIm |= residual(im + first, i, step);
+        }
+        const SweepCodecBlock header = {step, int32_t(quantise(re[first], step)), int32_t(quantise(im[first], step)),
+                                        bitWidth(maxRe), bitWidth(maxIm), 0};
+        offsets[b] = uint32_t(pos);
+        memcpy(out + pos, &header, sizeof(header));
+        pos += sizeof(header);
+
+        uint8_t* bits = out + pos;
+        size_t bit = 0;
+        for (size_t i = 1; i < count; i++) {
+            const uint32_t fields[2] = {residual(re + first, i, step), residual(im + first, i, step)};
+            const uint8_t widths[2] = {header.bitsRe, header.bitsIm};
+            for (int f = 0; f < 2; f++) {
+                for (uint8_t k = 0; k < widths[f]; k++, bit++) {
+                    if ((fields[f] >> k) & 1) bits[bit >> 3] |= uint8_t(1u << (bit & 7));
+                }
+            }
+        }
+        pos += align4((bit + 7) / 8);
+    }
+
+    SweepCodecHeader h = {SWEEP_CODEC_MAGIC, SWEEP_CODEC_VERSION, blockSize, uint32_t(n), uint32_t(numBlocks),
+                          uint32_t(pos + PADDING)};
+    memcpy(out, &h, sizeof(h));
+    return h.totalSize;
+}
+
+bool SweepCodecView::attach(const uint8_t* data, size_t size)
+{
+    _base = nullptr;
+    if (data == nullptr || size < sizeof(SweepCodecHeader) || (uintptr_t(data) & 3) != 0) {
+        return false;
+    }
+    const SweepCodecHeader* h = reinterpret_cast<const SweepCodecHeader*>(data);
+    if (h->magic != SWEEP_CODEC_MAGIC || h->version != SWEEP_CODEC_VERSION || h->blockSize < 2 ||
+        h->totalSize > size || h->numBlocks != (uint64_t(h->count) + h->blockSize - 1) / h->blockSize ||
+        sizeof(SweepCodecHeader) + uint64_t(h->numBlocks) * sizeof(uint32_t) > h->totalSize) {
+        return false;
+    }
+    // Every block with its residuals must lie inside the stream
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data + sizeof(SweepCodecHeader));
+    for (uint32_t b = 0; b < h->numBlocks; b++) {
+        if ((offsets[b] & 3) != 0 || uint64_t(offsets[b]) + sizeof(SweepCodecBlock) > h->totalSize) {
+            return false;
+        }
+        const SweepCodecBlock* blk = reinterpret_cast<const SweepCodecBlock*>(data + offsets[b]);
+        const uint64_t points = b + 1 < h->numBlocks ? h->blockSize : h->count - uint64_t(b) * h->blockSize;
+        const uint64_t bits = (points - 1) * (blk->bitsRe + blk->bitsIm);
+        if (blk->bitsRe > 31 || blk->bitsIm > 31 ||
+            offsets[b] + sizeof(SweepCodecBlock) + (bits + 7) / 8 + PADDING > h->totalSize) {
+            return false;
+        }
+    }
+    _base = data;
+    return true;
+}
+
+const SweepCodecBlock& SweepCodecView::block(size_t b) const
+{
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(_base + sizeof(SweepCodecHeader));
+    return *reinterpret_cast<const SweepCodecBlock*>(_base + offsets[b]);
+}
+
+// Residual fields of a block, in order
+class ResidualReader {
+public:
+    explicit ResidualReader(const SweepCodecBlock& block) :
+        _bits(reinterpret_cast<const uint8_t*>(&block + 1)), _pos(0) {}
+
+    uint32_t read(uint8_t width)
+    {
+        uint64_t word;
+        memcpy(&word, _bits + (_pos >> 3), sizeof(word));
+        const uint32_t v = uint32_t((word >> (_pos & 7)) & ((uint64_t(1) << width) - 1));
+        _pos += width;
+        return v;
+    }
+
+private:
+    const uint8_t* _bits;
+    size_t         _pos;
+};
+
+Cplx SweepCodecView::at(size_t i) const
+{
+    if (i >= size()) {
+        return Cplx{0.0f, 0.0f};
+    }
+    float re, im;
+    decode(i, 1, &re, &im);
+    return Cplx{re, im};
+}
+
+void SweepCodecView::decode(size_t first, size_t n, float* re, float* im) const
+{
+    if (first >= size()) {
+        return;
+    }
+    if (n > size() - first) {
+        n = size() - first;
+    }
+    const size_t blockSize = header().blockSize;
+    size_t out = 0;
+    while (out < n) {
+        const size_t i = first + out;
+        const SweepCodecBlock& blk = block(i / blockSize);
+        const size_t k = i % blockSize;
+        ResidualReader reader(blk);
+        int64_t re1 = blk.re0, im1 = blk.im0, re2 = blk.re0, im2 = blk.im0;
+        for (size_t j = 1; j <= k; j++) {
+            const int64_t r = unzigzag(reader.read(blk.bitsRe)), s = unzigzag(reader.read(blk.bitsIm));
+            const int64_t nr = (j == 1 ? re1 : 2 * re1 - re2) + r, ni = (j == 1 ? im1 : 2 * im1 - im2) + s;
+            re2 = re1;
+            im2 = im1;
+            re1 = nr;
+            im1 = ni;
+        }
+        // Then the rest of the block in sequence
+        for (size_t j = k;; j++) {
+            re[out] = reconstruct(re1, blk.step);
+            im[out] = reconstruct(im1, blk.step);
+            out++;
+            if (out == n || j + 1 == blockSize || first + out >= size()) break;
+            const int64_t r = unzigzag(reader.read(blk.bitsRe)), s = unzigzag(reader.read(blk.bitsIm));
+            const int64_t nr = (j == 0 ? re1 : 2 * re1 - re2) + r, ni = (j == 0 ? im1 : 2 * im1 - im2) + s;
+            re2 = re1;
+            im2 = im1;
+            re1 = nr;
+            im1 = ni;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef SWEEP_CODEC_H
+#define SWEEP_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Cplx.h"
+
+// Error-bounded compression of one complex quantity over a frequency grid
+// (an impedance sweep, one S-parameter of a personality block), for data
+// that is smooth in frequency.
+//
+// The points are cut into blocks of blockSize. Within a block every value is
+// quantised to a multiple of the block's step, chosen from the tolerance of
+// its points so that no point moves by more than its tolerance (|error| of
+// the complex value). The quantised values are coded as the first value and
+// then the residuals of a linear prediction from the two before
+// (2 x[i-1] - x[i-2]), zigzag coded at a fixed bit width per block and
+// component. Prediction runs on the integers, so nothing drifts.
+//
+// An offset index gives each block directly: one bin decodes by unpacking
+// at most blockSize - 1 residuals of its block, with nothing else expanded.
+//
+// Layout (little endian), 4-byte aligned:
+//   SweepCodecHeader
+//   uint32_t blockOffset[numBlocks]   from the start of the stream
+//   per block: SweepCodecBlock, then 2 (n - 1) residuals interleaved re, im
+//   8 bytes of padding, so the decoder may read whole words
+static constexpr uint32_t SWEEP_CODEC_MAGIC   = 0x43535447; // "GTSC"
+static constexpr uint16_t SWEEP_CODEC_VERSION = 1;
+
+struct SweepCodecHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t blockSize;
+    uint32_t count;
+    uint32_t numBlocks;
+    uint32_t totalSize;
+};
+
+struct SweepCodecBlock {
+    float   step;
+    int32_t re0;        // first value, in steps
+    int32_t im0;
+    uint8_t bitsRe;     // residual width, 0..31
+    uint8_t bitsIm;
+    uint16_t reserved;
+};
+
+// Tolerance per point, |error| of the complex value, for the encoder:
+// impedances within maxOhms and moving SWR (against z0) by at most maxSwr,
+// or reflection coefficients / S-parameters within maxS and moving SWR by at
+// most maxSwr. A limit <= 0 is not applied.
+void impedanceTolerance(const float* re, const float* im, size_t n, float maxOhms, float maxSwr, float z0,
+                        float* tol);
+void reflectionTolerance(const float* re, const float* im, size_t n, float maxS, float maxSwr, float* tol);
+
+class SweepEncoder {
+public:
+    static constexpr uint16_t DEFAULT_BLOCK = 32;
+
+    // Enough for any data
+    static size_t maxEncodedSize(size_t n, uint16_t blockSize = DEFAULT_BLOCK);
+    // Bytes written, 0 if out is too small, a tolerance is not positive or a
+    // value is too large for its step
+    static size_t encode(const float* re, const float* im, const float* tol, size_t n, uint8_t* out,
+                         size_t capacity, uint16_t blockSize = DEFAULT_BLOCK);
+};
+
+// Read-only view of an encoded sweep, used in place
+class SweepCodecView {
+public:
+    SweepCodecView() : _base(nullptr) {}
+
+    bool attach(const uint8_t* data, size_t size);
+    size_t size() const { return _base ? header().count : 0; }
+    size_t encodedSize() const { return _base ? header().totalSize : 0; }
+
+    // One bin
+    Cplx at(size_t i) const;
+    // Points [first, first + n), each block unpacked once
+    void decode(size_t first, size_t n, float* re, float* im) const;
+
+private:
+    const SweepCodecHeader& header() const { return *reinterpret_cast<const SweepCodecHeader*>(_base); }
+    const SweepCodecBlock& block(size_t b) const;
+
+    const uint8_t* _base;
+};
+
+#endif // SWEEP_CODEC_H
@@ -0,0 +1,290 @@
+#include "SweepParser.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr float DEG_TO_RAD_F = 0.01745329252f;
+
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+SweepParser::SweepParser(uint8_t ports) :
+    _params(ports == 2 ? 4 : 1), _toImpedance(false),
+    _freq(nullptr), _re(nullptr), _im(nullptr), _capacity(0),
+    _ann(nullptr), _annCapacity(0)
+{
+    reset();
+}
+
+void SweepParser::setSampleBuffer(float* freqHz, float* re, float* im, size_t capacity)
+{
+    _freq = freqHz; _re = re; _im = im;
+    _capacity = capacity;
+    _count = 0;
+}
+
+void SweepParser::setAnnotationBuffer(Annotation* annotations, size_t capacity)
+{
+    _ann = annotations;
+    _annCapacity = capacity;
+    _annCount = 0;
+}
+
+void SweepParser::reset()
+{
+    _state = State::LineStart;
+    _status = Status::Ok;
+    // Longz defaults; a Touchstone option line replaces them
+    _param = Param::Z;
+    _format = Format::RI;
+    _freqScale = 1.0f;
+    _z0 = 50.0f;
+    _normalised = false;
+    _count = 0;
+    _total = 0;
+    _lines = 0;
+    _annCount = 0;
+    _lineHadRecord = false;
+    _recordFill = 0;
+    _tokenLen = 0;
+    _lineLen = 0;
+}
+
+void SweepParser::clearSamples()
+{
+    _count = 0;
+    if (_status == Status::BufferFull) {
+        _status = Status::Ok;
+        emitRecord(); // the record that did not fit
+    }
+}
+
+size_t SweepParser::feed(const char* data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && _status == Status::Ok) {
+        const char c = data[i];
+        switch (_state) {
+        case State::Token:
+            if (c == '\n' || isBlank(c) || c == '!' || c == '%') {
+                endToken();
+                _state = State::Data;
+                continue; // the separator is handled in the Data state
+            }
+            if (size_t(_tokenLen) + 1 >= sizeof(_token)) {
+                _status = Status::BadToken;
+                return i;
+            }
+            _token[_tokenLen++] = c;
+            break;
+
+        case State::Comment:
+        case State::Annotation:
+        case State::Option:
+            if (c == '\n') {
+                endLine();
+            } else if (_state != State::Comment && size_t(_lineLen) + 1 < sizeof(_line)) {
+                _line[_lineLen++] = c;
+            }
+            break;
+
+        case State::LineStart:
+        case State::Data:
+            if (c == '\n') {
+                endLine();
+            } else if (isBlank(c)) {
+                // separator
+            } else if (c == '!' || (c == '[' && _state == State::LineStart)) {
+                _state = State::Comment; // Touchstone comment or v2 keyword line
+            } else if (c == '%') {
+                _lineLen = 0;
+                _state = _lineHadRecord ? State::Annotation : State::Comment;
+            } else if (c == '#' && _state == State::LineStart) {
+                _lineLen = 0;
+                _state = State::Option;
+            } else if (_lineHadRecord && _recordFill == 0 && !isdigit((unsigned char)c) &&
+                       c != '-' && c != '+' && c != '.') {
+                _state = State::Comment; // trailing text after a record
+            } else {
+                _token[0] = c;
+                _tokenLen = 1;
+                _state = State::Token;
+            }
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
+void SweepParser::finish()
+{
+    if (_status != Status::Ok) {
+        return;
+    }
+    if (_state == State::Token) {
+        endToken();
+    }
+    if (_state != State::LineStart) {
+        endLine();
+    }
+}
+
+void SweepParser::endToken()
+{
+    _token[_tokenLen] = '\0';
+    char* end = nullptr;
+    const float v = strtof(_token, &end);
+    _tokenLen = 0;
+    if (end == _token || *end != '\0') {
+        _status = Status::BadToken;
+        return;
+    }
+    _record[_recordFill++] = v;
+    if (_recordFill == 1 + 2 * _params) {
+        _lineHadRecord = true;
+        emitRecord();
+    }
+}
+
+void SweepParser::endLine()
+{
+    if (_state == State::Option) {
+        parseOption();
+    } else if (_state == State::Annotation) {
+        parseAnnotation();
+    }
+    _state = State::LineStart;
+    _lineHadRecord = false;
+    _lines++;
+}
+
+void SweepParser::emitRecord()
+{
+    if (_recordFill != 1 + 2 * _params) {
+        return;
+    }
+    if (_count >= _capacity) {
+        _status = Status::BufferFull; // keep the record until clearSamples()
+        return;
+    }
+    _freq[_count] = _record[0] * _freqScale;
+    for (uint8_t p = 0; p < _params; p++) {
+        float a = _record[1 + 2 * p], b = _record[2 + 2 * p];
+        if (_format != Format::RI) {
+            const float mag = _format == Format::DB ? powf(10.0f, a / 20.0f) : a;
+            const float ang = b * DEG_TO_RAD_F;
+            a = mag * cosf(ang);
+            b = mag * sinf(ang);
+        }
+        if (_toImpedance && _params == 1 && (_param != Param::Z || _normalised)) {
+            if (_param == Param::S) {
+                // Z = z0 (1 + S) / (1 - S)
+                const float dr = 1.0f - a, k = _z0 / (dr * dr + b * b);
+                const float nr = 1.0f + a;
+                const float zr = (nr * dr - b * b) * k, zi = (b * dr + nr * b) * k;
+                a = zr; b = zi;
+            } else if (_param == Param::Y) {
+                // Touchstone Y is normalised: Z = z0 / y
+                const float k = _z0 / (a * a + b * b);
+                a = a * k; b = -b * k;
+            } else {
+                a *= _z0; b *= _z0;
+            }
+        }
+        _re[_count * _params + p] = a;
+        _im[_count * _params + p] = b;
+    }
+    _count++;
+    _total++;
+    _recordFill = 0;
+}
+
+// Option line tokens are case-insensitive; fields not given keep the
+// Touchstone defaults GHz, S, MA, R 50.
+void SweepParser::parseOption()
+{
+    _line[_lineLen] = '\0';
+    _freqScale = 1e9f; _param = Param::S; _format = Format::MA; _z0 = 50.0f;
+    _normalised = true;
+    char* save = nullptr;
+    bool expectR = false;
+    for (char* tok = strtok_r(_line, " \t\r", &save); tok; tok = strtok_r(nullptr, " \t\r", &save)) {
+        for (char* p = tok; *p; p++) *p = char(tolower(*p));
+        if (expectR) {
+            _z0 = strtof(tok, nullptr);
+            expectR = false;
+        } else if (!strcmp(tok, "hz")) _freqScale = 1.0f;
+        else if (!strcmp(tok, "khz")) _freqScale = 1e3f;
+        else if (!strcmp(tok, "mhz")) _freqScale = 1e6f;
+        else if (!strcmp(tok, "ghz")) _freqScale = 1e9f;
+        else if (!strcmp(tok, "s")) _param = Param::S;
+        else if (!strcmp(tok, "y")) _param = Param::Y;
+        else if (!strcmp(tok, "z")) _param = Param::Z;
+        else if (!strcmp(tok, "ri")) _format = Format::RI;
+        else if (!strcmp(tok, "ma")) _format = Format::MA;
+        else if (!strcmp(tok, "db")) _format = Format::DB;
+        else if (!strcmp(tok, "r")) expectR = true;
+        else {
+            _status = Status::BadOption; // G/H parameters and the like
+            return;
+        }
+    }
+    if (_z0 <= 0.0f) {
+        _status = Status::BadOption;
+    }
+}
+
+// "% 0.57 uH, 181 pF", "% 65 pF, 71 uH", "% 6.24, 937.4 pF": up to two
+// values, each optionally followed by a unit. A value without a unit is the
+// other kind, in uH or pF.
+void SweepParser::parseAnnotation()
+{
+    if (_ann == nullptr || _annCount >= _annCapacity || _count == 0) {
+        return;
+    }
+    _line[_lineLen] = '\0';
+    float value[2];
+    char kind[2] = {0, 0}; // 'L', 'C' or 0
+    int n = 0;
+    const char* p = _line;
+    while (*p && n < 2) {
+        char* end = nullptr;
+        const float v = strtof(p, &end);
+        if (end == p) { p++; continue; }
+        p = end;
+        while (*p == ' ') p++;
+        float scale = 1.0f;
+        char k = 0;
+        if (p[0] && (p[1] == 'H' || p[1] == 'F')) {
+            const char prefix = p[0];
+            scale = prefix == 'p' ? 1e-12f : prefix == 'n' ? 1e-9f : prefix == 'u' ? 1e-6f : prefix == 'm' ? 1e-3f : 0.0f;
+            if (scale != 0.0f) {
+                k = p[1] == 'H' ? 'L' : 'C';
+                p += 2;
+            } else {
+                scale = 1.0f;
+            }
+        }
+        value[n] = v * (k ? scale : 1.0f);
+        kind[n] = k;
+        n++;
+    }
+    if (n == 0 || (n == 1 && kind[0] == 0) || (n == 2 && kind[0] == 0 && kind[1] == 0)) {
+        return; // free text, not a match annotation
+    }
+    if (n == 2 && kind[0] == 0) { kind[0] = kind[1] == 'L' ? 'C' : 'L'; value[0] *= kind[0] == 'L' ? 1e-6f : 1e-12f; }
+    if (n == 2 && kind[1] == 0) { kind[1] = kind[0] == 'L' ? 'C' : 'L'; value[1] *= kind[1] == 'L' ? 1e-6f : 1e-12f; }
+
+    Annotation& a = _ann[_annCount++];
+    a.freqHz = _freq[_count - 1];
+    a.henries = 0.0f;
+    a.farads = 0.0f;
+    for (int i = 0; i < n; i++) {
+        if (kind[i] == 'L') a.henries = value[i]; else a.farads = value[i];
+    }
+    a.capFirst = kind[0] == 'C';
+}
@@ -0,0 +1,103 @@
+#ifndef SWEEP_PARSER_H
+#define SWEEP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Push-style parser for VNA sweep text: Touchstone (.s1p/.s2p) and the
+// "% comment" / "freq re im" format of docs/Longz and docs/Shortz.
+//
+// Bytes are fed in arbitrary chunks; tokens and lines may straddle chunk
+// boundaries. Samples go into caller-supplied structure-of-arrays buffers and
+// nothing is allocated: the parser keeps one token and one short line buffer.
+// When the sample buffer fills, feed() stops and returns the bytes consumed
+// so the caller can drain the buffer (clearSamples()) and feed the rest.
+//
+// Touchstone: "# <Hz|kHz|MHz|GHz> <S|Y|Z> <RI|MA|DB> R <z0>" option line,
+// '!' comments, records of 1 + 2*ports^2 numbers that may wrap across lines.
+// Without an option line the Longz defaults apply: Hz, Z, RI, R 50.
+// '%' starts a comment in either format; a '%' comment after a data record,
+// e.g. "% 0.57 uH, 181 pF", is decoded as an L/C match annotation. Other
+// non-numeric text after a complete record is ignored up to the end of line.
+class SweepParser {
+public:
+    enum class Param : uint8_t { S, Y, Z };
+    enum class Format : uint8_t { RI, MA, DB };
+    enum class Status : uint8_t { Ok, BufferFull, BadToken, BadOption };
+
+    // Match annotation found on a data line. The order of the values gives the
+    // topology: "L, C" (series L at the antenna) or "C, L".
+    struct Annotation {
+        float freqHz;
+        float henries;    // 0 if absent
+        float farads;     // 0 if absent
+        bool  capFirst;   // written as "C, L"
+    };
+
+    // ports: 1 for .s1p / Longz, 2 for .s2p (S11 S21 S12 S22 per record)
+    explicit SweepParser(uint8_t ports = 1);
+
+    // re/im hold capacity * ports^2 values, sample i parameter p at [i * ports^2 + p]
+    void setSampleBuffer(float* freqHz, float* re, float* im, size_t capacity);
+    void setAnnotationBuffer(Annotation* annotations, size_t capacity);
+    // 1-port only: convert S or Y data to impedance on output
+    void setConvertToImpedance(bool convert) { _toImpedance = convert; }
+
+    size_t feed(const char* data, size_t len);
+    // End of input: completes a final unterminated line
+    void finish();
+    void reset();
+
+    Status status() const { return _status; }
+    bool full() const { return _status == Status::BufferFull; }
+    size_t sampleCount() const { return _count; }
+    size_t annotationCount() const { return _annCount; }
+    // Lets the caller reuse the buffers; a BufferFull status clears
+    void clearSamples();
+    size_t totalSamples() const { return _total; }
+    size_t lineCount() const { return _lines; }
+
+    Param param() const { return _param; }
+    Format format() const { return _format; }
+    float z0() const { return _z0; }
+
+private:
+    enum class State : uint8_t { LineStart, Data, Token, Comment, Annotation, Option };
+
+    void endToken();
+    void endLine();
+    void emitRecord();
+    void parseOption();
+    void parseAnnotation();
+
+    uint8_t     _params;     // complex values per record: 1 or 4
+    bool        _toImpedance;
+    State       _state;
+    Status      _status;
+    Param       _param;
+    Format      _format;
+    float       _freqScale;
+    float       _z0;
+    bool        _normalised; // Touchstone v1 Y/Z data is normalised to z0
+
+    float*      _freq;
+    float*      _re;
+    float*      _im;
+    size_t      _capacity;
+    size_t      _count;
+    size_t      _total;
+    size_t      _lines;
+    Annotation* _ann;
+    size_t      _annCapacity;
+    size_t      _annCount;
+    bool        _lineHadRecord;
+
+    float       _record[9];   // numbers of the record being assembled
+    uint8_t     _recordFill;
+    char        _token[32];
+    uint8_t     _tokenLen;
+    char        _line[80];    // option line or annotation text
+    uint8_t     _lineLen;
+};
+
+#endif // SWEEP_PARSER_H
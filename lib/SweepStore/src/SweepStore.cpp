@@ -0,0 +1,148 @@
+#include "SweepStore.h"
+#include <string.h>
+
+static constexpr uint32_t ARRAY_BYTES = SWEEP_SLOT_MAX_POINTS * sizeof(float);
+
+static uint32_t arrayOffset(uint32_t array)
+{
+    return SWEEP_SECTOR_SIZE + array * ARRAY_BYTES;
+}
+
+bool SweepSlotWriter::begin(SweepFlash* flash)
+{
+    _flash = flash;
+    _stored = 0;
+    _parser.reset();
+    _parser.setSampleBuffer(_freq, _re, _im, SWEEP_SLOT_BATCH);
+    _parser.setAnnotationBuffer(_ann, SWEEP_SLOT_MAX_ANNOTATIONS);
+    _parser.setConvertToImpedance(true);
+    // Invalidate the slot before any sample sector is touched
+    _failed = _flash == nullptr || !_flash->flashErase(0, SWEEP_SECTOR_SIZE);
+    return !_failed;
+}
+
+bool SweepSlotWriter::write(const char* text, size_t len)
+{
+    size_t used = 0;
+    while (!_failed && used < len) {
+        used += _parser.feed(text + used, len - used);
+        if (_parser.full()) {
+            _failed = !flushBatch();
+        } else if (_parser.status() != SweepParser::Status::Ok) {
+            _failed = true;
+        }
+    }
+    return !_failed;
+}
+
+// Samples always arrive in whole batches except the last, so every flush
+// starts on a sector boundary of each array.
+bool SweepSlotWriter::flushBatch()
+{
+    const uint32_t n = uint32_t(_parser.sampleCount());
+    if (n == 0) {
+        return true;
+    }
+    if (_stored + n > SWEEP_SLOT_MAX_POINTS) {
+        return false;
+    }
+    const float* arrays[3] = {_freq, _re, _im};
+    const uint32_t sector = _stored * sizeof(float);
+    for (uint32_t a = 0; a < 3; a++) {
+        const uint32_t offset = arrayOffset(a) + sector;
+        if (!_flash->flashErase(offset, SWEEP_SECTOR_SIZE) || !_flash->flashWrite(offset, arrays[a], n * sizeof(float))) {
+            return false;
+        }
+    }
+    _stored += n;
+    _parser.clearSamples();
+    return true;
+}
+
+bool SweepSlotWriter::finish()
+{
+    if (_failed) {
+        return false;
+    }
+    _parser.finish();
+    if (_parser.status() != SweepParser::Status::Ok || !flushBatch() || _stored == 0) {
+        _failed = true;
+        return false;
+    }
+
+    SweepSlotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SWEEP_STORE_MAGIC;
+    header.version = SWEEP_STORE_VERSION;
+    header.headerSize = sizeof(SweepSlotHeader);
+    header.count = _stored;
+    header.annotationCount = uint32_t(_parser.annotationCount());
+    header.freqOffset = arrayOffset(0);
+    header.reOffset = arrayOffset(1);
+    header.imOffset = arrayOffset(2);
+
+    // Annotations first, header last: the magic marks the slot complete
+    for (uint32_t i = 0; i < header.annotationCount; i++) {
+        const SweepSlotAnnotation a{_ann[i].freqHz, _ann[i].henries, _ann[i].farads,
+                                    _ann[i].capFirst ? SWEEP_ANNOTATION_CAP_FIRST : 0};
+        if (!_flash->flashWrite(sizeof(SweepSlotHeader) + i * sizeof(a), &a, sizeof(a))) {
+            _failed = true;
+            return false;
+        }
+    }
+    _failed = !_flash->flashWrite(0, &header, sizeof(header));
+    return !_failed;
+}
+
+bool SweepStoreView::attach(const uint8_t* data, size_t size)
+{
+    if (data == nullptr || size < NUM_GAP_LENGTHS * SWEEP_SLOT_SIZE) {
+        _data = nullptr;
+        return false;
+    }
+    _data = data;
+    _size = size;
+    return true;
+}
+
+const SweepSlotHeader* SweepStoreView::header(GapLength gap) const
+{
+    if (_data == nullptr) {
+        return nullptr;
+    }
+    const SweepSlotHeader* h = reinterpret_cast<const SweepSlotHeader*>(_data + size_t(gap) * SWEEP_SLOT_SIZE);
+    if (h->magic != SWEEP_STORE_MAGIC || h->version != SWEEP_STORE_VERSION ||
+        h->count > SWEEP_SLOT_MAX_POINTS || h->annotationCount > SWEEP_SLOT_MAX_ANNOTATIONS) {
+        return nullptr;
+    }
+    const uint32_t arrayEnd = SWEEP_SLOT_SIZE - h->count * sizeof(float);
+    if (h->freqOffset > arrayEnd || h->reOffset > arrayEnd || h->imOffset > arrayEnd ||
+        ((h->freqOffset | h->reOffset | h->imOffset) & 3) != 0) {
+        return nullptr;
+    }
+    return h;
+}
+
+ImpedanceSweep SweepStoreView::sweep(GapLength gap) const
+{
+    const SweepSlotHeader* h = header(gap);
+    if (h == nullptr) {
+        return ImpedanceSweep();
+    }
+    const uint8_t* slot = reinterpret_cast<const uint8_t*>(h);
+    return ImpedanceSweep(reinterpret_cast<const float*>(slot + h->freqOffset),
+                          reinterpret_cast<const float*>(slot + h->reOffset),
+                          reinterpret_cast<const float*>(slot + h->imOffset), h->count);
+}
+
+size_t SweepStoreView::annotationCount(GapLength gap) const
+{
+    const SweepSlotHeader* h = header(gap);
+    return h ? h->annotationCount : 0;
+}
+
+const SweepSlotAnnotation* SweepStoreView::annotations(GapLength gap) const
+{
+    const SweepSlotHeader* h = header(gap);
+    return h ? reinterpret_cast<const SweepSlotAnnotation*>(reinterpret_cast<const uint8_t*>(h) + h->headerSize) : nullptr;
+}
@@ -0,0 +1,115 @@
+#ifndef SWEEP_STORE_H
+#define SWEEP_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ImpedanceSweep.h"
+#include "SweepParser.h"
+#include "TuneTable.h" // For GapLength
+
+// Parsed antenna sweeps in the "sweeps" partition: one fixed-size slot per
+// gap length, each holding impedance samples as structure-of-arrays so a
+// mapped slot is used directly as an ImpedanceSweep.
+//
+// Slot layout (little endian):
+//   sector 0   SweepSlotHeader, then SweepSlotAnnotation[annotationCount]
+//   freq[]     SWEEP_SLOT_MAX_POINTS floats, sector aligned
+//   re[]       same
+//   im[]       same
+// The header sector is erased when a write starts and written last, so a slot
+// whose upload was interrupted reads as empty rather than half-valid.
+
+static constexpr uint32_t SWEEP_STORE_MAGIC         = 0x53575447; // "GTWS"
+static constexpr uint16_t SWEEP_STORE_VERSION       = 1;
+static constexpr uint8_t  SWEEP_STORE_SUBTYPE       = 0x42;       // custom data partition subtype
+static constexpr uint32_t SWEEP_SLOT_SIZE           = 0x80000;
+static constexpr uint32_t SWEEP_SECTOR_SIZE         = 4096;
+static constexpr uint32_t SWEEP_SLOT_BATCH          = SWEEP_SECTOR_SIZE / sizeof(float);
+static constexpr uint32_t SWEEP_SLOT_MAX_POINTS     = 42 * SWEEP_SLOT_BATCH;
+static constexpr uint32_t SWEEP_SLOT_MAX_ANNOTATIONS = 240;
+
+struct SweepSlotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t count;            // samples
+    uint32_t annotationCount;
+    uint32_t freqOffset;       // byte offsets from the start of the slot
+    uint32_t reOffset;
+    uint32_t imOffset;
+    uint32_t reserved;
+};
+
+// "% 0.57 uH, 181 pF" style hand-computed match from the source file
+struct SweepSlotAnnotation {
+    float    freqHz;
+    float    henries;
+    float    farads;
+    uint32_t flags;            // SWEEP_ANNOTATION_CAP_FIRST
+};
+
+static constexpr uint32_t SWEEP_ANNOTATION_CAP_FIRST = 1;
+
+static_assert(sizeof(SweepSlotHeader) + SWEEP_SLOT_MAX_ANNOTATIONS * sizeof(SweepSlotAnnotation) <= SWEEP_SECTOR_SIZE,
+              "annotations must fit in the header sector");
+static_assert(SWEEP_SECTOR_SIZE + 3 * SWEEP_SLOT_MAX_POINTS * sizeof(float) <= SWEEP_SLOT_SIZE,
+              "sample arrays must fit in a slot");
+
+// Erase/program access to one slot, offsets relative to the slot start
+class SweepFlash {
+public:
+    virtual ~SweepFlash() {}
+    virtual bool flashErase(uint32_t offset, uint32_t len) = 0;
+    virtual bool flashWrite(uint32_t offset, const void* data, uint32_t len) = 0;
+};
+
+// Parses sweep text as it arrives and stores it in a slot. Samples are
+// buffered one sector per array and each array sector is erased just before
+// it is written, so memory use is fixed and nothing is erased up front
+// beyond the header sector.
+class SweepSlotWriter {
+public:
+    SweepSlotWriter() : _flash(nullptr), _stored(0), _failed(false) {}
+
+    bool begin(SweepFlash* flash);
+    // Any chunking; false once parsing or flash access has failed
+    bool write(const char* text, size_t len);
+    // Flushes the last samples and commits the header
+    bool finish();
+
+    bool failed() const { return _failed; }
+    const SweepParser& parser() const { return _parser; }
+    uint32_t stored() const { return _stored; }
+
+private:
+    bool flushBatch();
+
+    SweepFlash*                _flash;
+    SweepParser                _parser;
+    uint32_t                   _stored;
+    bool                       _failed;
+    float                      _freq[SWEEP_SLOT_BATCH];
+    float                      _re[SWEEP_SLOT_BATCH];
+    float                      _im[SWEEP_SLOT_BATCH];
+    SweepParser::Annotation    _ann[SWEEP_SLOT_MAX_ANNOTATIONS];
+};
+
+// Read-only view over the mapped sweeps partition
+class SweepStoreView {
+public:
+    SweepStoreView() : _data(nullptr), _size(0) {}
+
+    bool attach(const uint8_t* data, size_t size);
+    // Empty (size() == 0) if the slot holds no valid sweep
+    ImpedanceSweep sweep(GapLength gap) const;
+    size_t annotationCount(GapLength gap) const;
+    const SweepSlotAnnotation* annotations(GapLength gap) const;
+
+private:
+    const SweepSlotHeader* header(GapLength gap) const;
+
+    const uint8_t* _data;
+    size_t         _size;
+};
+
+#endif // SWEEP_STORE_H
@@ -0,0 +1,101 @@
+#include "TuneTable.h"
+#include "Crc32.h"
+
+TuneTableEntry TuneTableEntry::make(uint32_t freqHz, const TuneState& state, float swr)
+{
+    float tenths = (swr - 1.0f) * 10.0f + 0.5f;
+    if (!(tenths < 127.0f)) tenths = 127.0f; // also catches an infinite SWR
+    if (tenths < 0.0f) tenths = 0.0f;
+    TuneTableEntry e;
+    e.freqHz = freqHz;
+    e.packed = (uint32_t(state.lMask) & 0xFFF)
+             | ((uint32_t(state.cMask) & 0xFFF) << 12)
+             | (uint32_t(state.topology == Topology::CL) << 24)
+             | (uint32_t(tenths) << 25);
+    return e;
+}
+
+TuneState TuneTableEntry::state() const
+{
+    return TuneState{uint16_t(packed & 0xFFF), uint16_t((packed >> 12) & 0xFFF),
+                     (packed >> 24) & 1 ? Topology::CL : Topology::LC};
+}
+
+float TuneTableEntry::swr() const
+{
+    return 1.0f + float(packed >> 25) * 0.1f;
+}
+
+bool TuneTableView::attach(const uint8_t* data, size_t size)
+{
+    _header = nullptr;
+    _size = 0;
+    if (data == nullptr || size < sizeof(TuneTableHeader) || (uintptr_t(data) & 3) != 0) {
+        return false;
+    }
+    const TuneTableHeader* h = reinterpret_cast<const TuneTableHeader*>(data);
+    if (h->magic != TUNE_TABLE_MAGIC || h->version != TUNE_TABLE_VERSION ||
+        h->headerSize != sizeof(TuneTableHeader)) {
+        return false;
+    }
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        if ((h->offset[g] & 3) != 0 || h->offset[g] < sizeof(TuneTableHeader) ||
+            h->offset[g] > size || h->count[g] > (size - h->offset[g]) / sizeof(TuneTableEntry)) {
+            return false;
+        }
+    }
+    _header = h;
+    _size = size;
+    return true;
+}
+
+bool TuneTableView::verifyCrc() const
+{
+    if (!_header) {
+        return false;
+    }
+    // The payload ends with the last section; a partition is usually larger than the table
+    size_t end = sizeof(TuneTableHeader);
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        const size_t sectionEnd = _header->offset[g] + _header->count[g] * sizeof(TuneTableEntry);
+        if (sectionEnd > end) end = sectionEnd;
+    }
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(_header);
+    return crc32(base + sizeof(TuneTableHeader), end - sizeof(TuneTableHeader)) == _header->crc32;
+}
+
+size_t TuneTableView::count(GapLength gap) const
+{
+    return _header ? _header->count[size_t(gap)] : 0;
+}
+
+const TuneTableEntry* TuneTableView::entries(GapLength gap) const
+{
+    if (!_header) {
+        return nullptr;
+    }
+    return reinterpret_cast<const TuneTableEntry*>(
+        reinterpret_cast<const uint8_t*>(_header) + _header->offset[size_t(gap)]);
+}
+
+const TuneTableEntry* TuneTableView::find(GapLength gap, uint32_t freqHz) const
+{
+    const size_t n = count(gap);
+    if (n == 0) {
+        return nullptr;
+    }
+    const TuneTableEntry* e = entries(gap);
+    const uint32_t step = _header->stepHz;
+    if (freqHz + step < e[0].freqHz || freqHz > e[n - 1].freqHz + step) {
+        return nullptr;
+    }
+    // First entry at or above freqHz
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (e[mid].freqHz < freqHz) lo = mid + 1; else hi = mid;
+    }
+    if (lo == n) return &e[n - 1];
+    if (lo == 0) return &e[0];
+    return (freqHz - e[lo - 1].freqHz <= e[lo].freqHz - freqHz) ? &e[lo - 1] : &e[lo];
+}
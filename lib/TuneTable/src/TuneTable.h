@@ -0,0 +1,76 @@
+#ifndef TUNE_TABLE_H
+#define TUNE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "TuneState.h"
+
+// Precomputed band-plan tune table: for each gap length, a list of
+// (frequency, relay state) entries sorted by frequency. Generated on the host
+// by `program gen-table` and written to the "tunetab" partition; the firmware
+// maps it in place, so a QSY is a binary search with no parsing or heap use.
+//
+// Layout (little endian, all sections 4-byte aligned):
+//   TuneTableHeader
+//   TuneTableEntry[count[0]]   GapLength::Long
+//   TuneTableEntry[count[1]]   GapLength::Short
+
+enum class GapLength : uint8_t {
+    Long  = 0, // gap relays closed (docs/Longz)
+    Short = 1  // gap relays open (docs/Shortz)
+};
+
+static constexpr uint32_t TUNE_TABLE_MAGIC   = 0x54544147; // "GATT"
+static constexpr uint16_t TUNE_TABLE_VERSION = 1;
+static constexpr uint8_t  TUNE_TABLE_SUBTYPE = 0x40;       // custom data partition subtype
+static constexpr size_t   NUM_GAP_LENGTHS    = 2;
+
+struct TuneTableHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint8_t  lBits;                     // bank geometry the table was solved for
+    uint8_t  cBits;
+    uint16_t reserved;
+    uint32_t stepHz;                    // generator step, also the lookup capture range
+    uint32_t offset[NUM_GAP_LENGTHS];   // byte offset of each section from the header
+    uint32_t count[NUM_GAP_LENGTHS];    // entries in each section
+    uint32_t crc32;                     // CRC-32 of everything after the header
+};
+
+// 8 bytes per entry. `packed` holds lMask (bits 0-11), cMask (12-23),
+// topology (24) and the predicted SWR in tenths above 1.0 (25-31, saturating).
+struct TuneTableEntry {
+    uint32_t freqHz;
+    uint32_t packed;
+
+    static TuneTableEntry make(uint32_t freqHz, const TuneState& state, float swr);
+    TuneState state() const;
+    float swr() const;
+};
+
+static_assert(sizeof(TuneTableEntry) == 8, "TuneTableEntry must stay packed");
+
+// Read-only view over a mapped table. attach() checks the header and section
+// bounds only; verifyCrc() walks the whole payload and is optional.
+class TuneTableView {
+public:
+    TuneTableView() : _header(nullptr), _size(0) {}
+
+    bool attach(const uint8_t* data, size_t size);
+    bool isValid() const { return _header != nullptr; }
+    bool verifyCrc() const;
+
+    const TuneTableHeader& header() const { return *_header; }
+    size_t count(GapLength gap) const;
+    const TuneTableEntry* entries(GapLength gap) const;
+
+    // Nearest entry to freqHz, which must lie within stepHz of the table range
+    const TuneTableEntry* find(GapLength gap, uint32_t freqHz) const;
+
+private:
+    const TuneTableHeader* _header;
+    size_t                 _size;
+};
+
+#endif // TUNE_TABLE_H
@@ -0,0 +1,124 @@
+#include "CalStore.h"
+#include <string.h>
+
+static constexpr uint32_t ARRAY_BYTES = CAL_SLOT_MAX_POINTS * sizeof(float);
+
+static const char* const s_sweepNames[] = {"open", "short", "load", "antenna_long", "antenna_short", "verify"};
+static_assert(sizeof(s_sweepNames) / sizeof(s_sweepNames[0]) == size_t(CalSweep::Count), "names vs CalSweep");
+
+static uint32_t arrayOffset(uint32_t array)
+{
+    return SWEEP_SECTOR_SIZE + array * ARRAY_BYTES;
+}
+
+bool CalSlotWriter::begin(SweepFlash* flash, CalSweep sweep)
+{
+    _flash = flash;
+    _base = uint32_t(sweep) * CAL_SLOT_SIZE;
+    _stored = 0;
+    _parser.reset();
+    _parser.setSampleBuffer(_freq, _re, _im, CAL_SLOT_BATCH);
+    // Invalidate the slot before any sample sector is touched
+    _failed = _flash == nullptr || sweep >= CalSweep::Count || !_flash->flashErase(_base, SWEEP_SECTOR_SIZE);
+    return !_failed;
+}
+
+bool CalSlotWriter::write(const char* text, size_t len)
+{
+    size_t used = 0;
+    while (!_failed && used < len && !_parser.done()) {
+        used += _parser.feed(text + used, len - used);
+        if (_parser.full()) {
+            _failed = !flushBatch();
+        } else if (_parser.status() != ScpiTraceParser::Status::Ok) {
+            _failed = true;
+        }
+    }
+    return !_failed;
+}
+
+bool CalSlotWriter::flushBatch()
+{
+    const uint32_t n = uint32_t(_parser.sampleCount());
+    if (n == 0) {
+        return true;
+    }
+    if (_stored + n > CAL_SLOT_MAX_POINTS) {
+        return false;
+    }
+    const float* arrays[3] = {_freq, _re, _im};
+    const uint32_t sector = _stored * sizeof(float);
+    for (uint32_t a = 0; a < 3; a++) {
+        const uint32_t offset = _base + arrayOffset(a) + sector;
+        if (!_flash->flashErase(offset, SWEEP_SECTOR_SIZE) || !_flash->flashWrite(offset, arrays[a], n * sizeof(float))) {
+            return false;
+        }
+    }
+    _stored += n;
+    _parser.clearSamples();
+    return true;
+}
+
+bool CalSlotWriter::finish(CalSlotHeader header)
+{
+    if (_failed || !_parser.done() || !flushBatch() || _stored == 0) {
+        _failed = true;
+        return false;
+    }
+    header.magic = CAL_STORE_MAGIC;
+    header.version = CAL_STORE_VERSION;
+    header.headerSize = sizeof(CalSlotHeader);
+    header.count = _stored;
+    header.freqOffset = arrayOffset(0);
+    header.reOffset = arrayOffset(1);
+    header.imOffset = arrayOffset(2);
+    // The magic marks the slot complete
+    _failed = !_flash->flashWrite(_base, &header, sizeof(header));
+    return !_failed;
+}
+
+bool CalStoreView::attach(const uint8_t* data, size_t size)
+{
+    if (data == nullptr || size < CAL_STORE_SIZE) {
+        _data = nullptr;
+        return false;
+    }
+    _data = data;
+    _size = size;
+    return true;
+}
+
+const CalSlotHeader* CalStoreView::header(CalSweep sweep) const
+{
+    if (_data == nullptr || sweep >= CalSweep::Count) {
+        return nullptr;
+    }
+    const CalSlotHeader* h = reinterpret_cast<const CalSlotHeader*>(_data + size_t(sweep) * CAL_SLOT_SIZE);
+    if (h->magic != CAL_STORE_MAGIC || h->version != CAL_STORE_VERSION || h->count > CAL_SLOT_MAX_POINTS ||
+        h->sweep != uint8_t(sweep)) {
+        return nullptr;
+    }
+    const uint32_t arrayEnd = CAL_SLOT_SIZE - h->count * sizeof(float);
+    if (h->freqOffset > arrayEnd || h->reOffset > arrayEnd || h->imOffset > arrayEnd ||
+        ((h->freqOffset | h->reOffset | h->imOffset) & 3) != 0) {
+        return nullptr;
+    }
+    return h;
+}
+
+CalTrace CalStoreView::trace(CalSweep sweep) const
+{
+    const CalSlotHeader* h = header(sweep);
+    if (h == nullptr) {
+        return CalTrace();
+    }
+    const uint8_t* slot = reinterpret_cast<const uint8_t*>(h);
+    return CalTrace(reinterpret_cast<const float*>(slot + h->freqOffset),
+                    reinterpret_cast<const float*>(slot + h->reOffset),
+                    reinterpret_cast<const float*>(slot + h->imOffset), h->count);
+}
+
+const char* CalStoreView::sweepName(CalSweep sweep)
+{
+    return sweep < CalSweep::Count ? s_sweepNames[size_t(sweep)] : "?";
+}
@@ -0,0 +1,131 @@
+#ifndef CAL_STORE_H
+#define CAL_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Cplx.h"
+#include "ScpiTrace.h"
+#include "SweepStore.h" // For SweepFlash, SWEEP_SECTOR_SIZE
+
+// Raw VNA sweeps of one calibration run in the "vnacal" partition, one
+// fixed-size slot per step of the sequence (see VnaSequencer). Each slot
+// holds the uncorrected reflection (S11) at the VNA port as
+// structure-of-arrays, in the same layout as a SweepStore slot:
+//   sector 0   CalSlotHeader
+//   freq[]     CAL_SLOT_MAX_POINTS floats, sector aligned
+//   re[]       same
+//   im[]       same
+// The header is erased when a sweep starts and written last. All slots of a
+// run carry the same run id, so standards and antenna sweeps of different
+// runs are never mixed up by the error correction.
+enum class CalSweep : uint8_t {
+    Open,
+    Short,
+    Load,
+    AntennaLong,   // K4 energised: antenna straight through the balun
+    AntennaShort,
+    Verify,        // through the matching network
+    Count
+};
+
+static constexpr uint32_t CAL_STORE_MAGIC     = 0x4C435447; // "GTCL"
+static constexpr uint16_t CAL_STORE_VERSION   = 1;
+static constexpr uint8_t  CAL_STORE_SUBTYPE   = 0x43;       // custom data partition subtype
+static constexpr uint32_t CAL_SLOT_SIZE       = 0x10000;
+static constexpr uint32_t CAL_SLOT_BATCH      = SWEEP_SLOT_BATCH;
+static constexpr uint32_t CAL_SLOT_MAX_POINTS = 4 * CAL_SLOT_BATCH;
+static constexpr uint32_t CAL_STORE_SIZE      = uint32_t(CalSweep::Count) * CAL_SLOT_SIZE;
+
+struct CalSlotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t count;            // samples
+    uint32_t runId;
+    uint32_t startHz;          // as configured on the VNA
+    uint32_t stopHz;
+    uint32_t freqOffset;       // byte offsets from the start of the slot
+    uint32_t reOffset;
+    uint32_t imOffset;
+    uint32_t tunedHz;          // Verify: band-plan frequency tuned, 0 for the relays as found
+    uint8_t  sweep;            // CalSweep
+    uint8_t  gap;              // GapLength the sweep was taken at
+    uint16_t reserved;
+};
+
+static_assert(SWEEP_SECTOR_SIZE + 3 * CAL_SLOT_MAX_POINTS * sizeof(float) <= CAL_SLOT_SIZE,
+              "sample arrays must fit in a slot");
+
+// One stored sweep, reflection coefficients as measured
+class CalTrace {
+public:
+    CalTrace() : _freqHz(nullptr), _re(nullptr), _im(nullptr), _count(0) {}
+    CalTrace(const float* freqHz, const float* re, const float* im, size_t count) :
+        _freqHz(freqHz), _re(re), _im(im), _count(count) {}
+
+    size_t size() const { return _count; }
+    float freqAt(size_t i) const { return _freqHz[i]; }
+    Cplx gammaAt(size_t i) const { return Cplx{_re[i], _im[i]}; }
+    const float* freqs() const { return _freqHz; }
+    const float* re() const { return _re; }
+    const float* im() const { return _im; }
+
+private:
+    const float* _freqHz;
+    const float* _re;
+    const float* _im;
+    size_t       _count;
+};
+
+// Stores a trace reply as it is read from the VNA, with the same batching as
+// SweepSlotWriter: one sector per array buffered, each sector erased just
+// before it is written. flash addresses the whole partition.
+class CalSlotWriter {
+public:
+    CalSlotWriter() : _flash(nullptr), _base(0), _stored(0), _failed(false) {}
+
+    bool begin(SweepFlash* flash, CalSweep sweep);
+    // Any chunking of the reply; false once parsing or flash access has failed
+    bool write(const char* text, size_t len);
+    // The reply's newline has been seen
+    bool done() const { return _parser.done(); }
+    // Flushes the last samples and commits the header; header.count and
+    // the offsets are filled in here
+    bool finish(CalSlotHeader header);
+
+    bool failed() const { return _failed; }
+    const ScpiTraceParser& parser() const { return _parser; }
+    uint32_t stored() const { return _stored; }
+
+private:
+    bool flushBatch();
+
+    SweepFlash*      _flash;
+    uint32_t         _base;
+    ScpiTraceParser  _parser;
+    uint32_t         _stored;
+    bool             _failed;
+    float            _freq[CAL_SLOT_BATCH];
+    float            _re[CAL_SLOT_BATCH];
+    float            _im[CAL_SLOT_BATCH];
+};
+
+// Read-only view over the mapped vnacal partition
+class CalStoreView {
+public:
+    CalStoreView() : _data(nullptr), _size(0) {}
+
+    bool attach(const uint8_t* data, size_t size);
+    // nullptr if the slot holds no complete sweep
+    const CalSlotHeader* header(CalSweep sweep) const;
+    // Empty (size() == 0) if the slot holds no complete sweep
+    CalTrace trace(CalSweep sweep) const;
+
+    static const char* sweepName(CalSweep sweep);
+
+private:
+    const uint8_t* _data;
+    size_t         _size;
+};
+
+#endif // CAL_STORE_H
@@ -0,0 +1,184 @@
+#include "OslCorrection.h"
+#include <math.h>
+
+static const double TWO_PI = 6.283185307179586;
+
+// Double precision for the one-off solve; the table itself is float
+struct CplxD {
+    double re;
+    double im;
+};
+
+static inline CplxD operator+(CplxD a, CplxD b) { return CplxD{a.re + b.re, a.im + b.im}; }
+static inline CplxD operator-(CplxD a, CplxD b) { return CplxD{a.re - b.re, a.im - b.im}; }
+static inline CplxD operator*(CplxD a, CplxD b) { return CplxD{a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re}; }
+static inline double norm2(CplxD a) { return a.re * a.re + a.im * a.im; }
+static inline CplxD operator/(CplxD a, CplxD b)
+{
+    const double k = 1.0 / norm2(b);
+    return CplxD{(a.re * b.re + a.im * b.im) * k, (a.im * b.re - a.re * b.im) * k};
+}
+static inline CplxD widen(Cplx a) { return CplxD{a.re, a.im}; }
+
+static Cplx reflection(CplxD z, double z0)
+{
+    const CplxD g = (z - CplxD{z0, 0.0}) / (z + CplxD{z0, 0.0});
+    return Cplx{float(g.re), float(g.im)};
+}
+
+Cplx CalKit::open(double hz) const
+{
+    // 1 / (j w C)
+    return reflection(CplxD{0.0, -1.0 / (TWO_PI * hz * openFarads)}, z0);
+}
+
+Cplx CalKit::shortCircuit(double hz) const
+{
+    return reflection(CplxD{0.0, TWO_PI * hz * shortHenries}, z0);
+}
+
+Cplx CalKit::load(double hz) const
+{
+    return reflection(CplxD{loadOhms, TWO_PI * hz * loadHenries}, z0);
+}
+
+OslCorrection::OslCorrection() :
+    _kernels(&cplxKernelsBest()), _capacity(0), _count(0), _runId(0), _z0(50.0f),
+    _freq(nullptr), _e00Re(nullptr), _e00Im(nullptr), _e11Re(nullptr), _e11Im(nullptr), _deltaRe(nullptr),
+    _deltaIm(nullptr)
+{
+}
+
+void OslCorrection::setTable(float* storage, size_t capacity)
+{
+    _capacity = storage ? capacity : 0;
+    _freq = storage;
+    _e00Re = storage + 1 * _capacity;
+    _e00Im = storage + 2 * _capacity;
+    _e11Re = storage + 3 * _capacity;
+    _e11Im = storage + 4 * _capacity;
+    _deltaRe = storage + 5 * _capacity;
+    _deltaIm = storage + 6 * _capacity;
+    clear();
+}
+
+void OslCorrection::clear()
+{
+    _count = 0;
+    _runId = 0;
+}
+
+bool OslCorrection::solve(const CalTrace& open, const CalTrace& shortSweep, const CalTrace& load, const CalKit& kit)
+{
+    clear();
+    const size_t n = open.size();
+    if (n == 0 || n > _capacity || shortSweep.size() != n || load.size() != n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const float hz = open.freqAt(i);
+        if (shortSweep.freqAt(i) != hz || load.freqAt(i) != hz) {
+            return false;
+        }
+        const CplxD go = widen(kit.open(hz)), gs = widen(kit.shortCircuit(hz)), gl = widen(kit.load(hz));
+        const CplxD mo = widen(open.gammaAt(i)), ms = widen(shortSweep.gammaAt(i)), ml = widen(load.gammaAt(i));
+        // e00 + (G m) e11 - G delta = m for each standard; the open's row
+        // minus the others leaves two equations in e11 and delta
+        const CplxD a1 = go * mo - gs * ms, b1 = gs - go, r1 = mo - ms;
+        const CplxD a2 = go * mo - gl * ml, b2 = gl - go, r2 = mo - ml;
+        const CplxD det = a1 * b2 - a2 * b1;
+        const double scale = sqrt(norm2(a1) * norm2(b2)) + sqrt(norm2(a2) * norm2(b1));
+        if (!(norm2(det) > 1e-18 * scale * scale)) {
+            return false;
+        }
+        const CplxD e11 = (r1 * b2 - r2 * b1) / det;
+        const CplxD delta = (a1 * r2 - a2 * r1) / det;
+        const CplxD e00 = mo - go * mo * e11 + go * delta;
+        // Reflection tracking e10e01 = e00 e11 - delta: near zero when the
+        // standards read the same, i.e. the VNA does not see the port
+        if (!(norm2(e00 * e11 - delta) > MIN_TRACKING * MIN_TRACKING)) {
+            return false;
+        }
+        _freq[i] = hz;
+        _e00Re[i] = float(e00.re);
+        _e00Im[i] = float(e00.im);
+        _e11Re[i] = float(e11.re);
+        _e11Im[i] = float(e11.im);
+        _deltaRe[i] = float(delta.re);
+        _deltaIm[i] = float(delta.im);
+    }
+    _z0 = kit.z0;
+    _count = n;
+    return true;
+}
+
+bool OslCorrection::solve(const CalStoreView& store, const CalKit& kit)
+{
+    const CalSlotHeader* open = store.header(CalSweep::Open);
+    const CalSlotHeader* shortSweep = store.header(CalSweep::Short);
+    const CalSlotHeader* load = store.header(CalSweep::Load);
+    if (open == nullptr || shortSweep == nullptr || load == nullptr || shortSweep->runId != open->runId ||
+        load->runId != open->runId) {
+        clear();
+        return false;
+    }
+    if (!solve(store.trace(CalSweep::Open), store.trace(CalSweep::Short), store.trace(CalSweep::Load), kit)) {
+        return false;
+    }
+    _runId = open->runId;
+    return true;
+}
+
+void OslCorrection::terms(size_t i, Cplx& e00, Cplx& e11, Cplx& delta) const
+{
+    e00 = Cplx{_e00Re[i], _e00Im[i]};
+    e11 = Cplx{_e11Re[i], _e11Im[i]};
+    delta = Cplx{_deltaRe[i], _deltaIm[i]};
+}
+
+bool OslCorrection::matches(const CalTrace& trace) const
+{
+    if (trace.size() != _count) {
+        return false;
+    }
+    for (size_t i = 0; i < _count; i++) {
+        if (trace.freqAt(i) != _freq[i]) return false;
+    }
+    return true;
+}
+
+void OslCorrection::correctGamma(size_t first, CplxIn raw, CplxOut gamma, size_t n) const
+{
+    float numRe[CHUNK], numIm[CHUNK], denRe[CHUNK], denIm[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const size_t len = n - i < CHUNK ? n - i : CHUNK;
+        const size_t t = first + i;
+        // den = m e11 - delta, num = m - e00; raw is read in full before
+        // gamma is written, so the two may alias
+        _kernels->mul(CplxIn{raw.re + i, raw.im + i}, CplxIn{_e11Re + t, _e11Im + t}, CplxOut{denRe, denIm}, len);
+        for (size_t j = 0; j < len; j++) {
+            denRe[j] -= _deltaRe[t + j];
+            denIm[j] -= _deltaIm[t + j];
+            numRe[j] = raw.re[i + j] - _e00Re[t + j];
+            numIm[j] = raw.im[i + j] - _e00Im[t + j];
+        }
+        _kernels->div(CplxIn{numRe, numIm}, CplxIn{denRe, denIm}, CplxOut{gamma.re + i, gamma.im + i}, len);
+    }
+}
+
+void OslCorrection::correct(size_t first, CplxIn raw, CplxOut z, size_t n) const
+{
+    float gRe[CHUNK], gIm[CHUNK], numRe[CHUNK], numIm[CHUNK], denRe[CHUNK], denIm[CHUNK];
+    for (size_t i = 0; i < n; i += CHUNK) {
+        const size_t len = n - i < CHUNK ? n - i : CHUNK;
+        correctGamma(first + i, CplxIn{raw.re + i, raw.im + i}, CplxOut{gRe, gIm}, len);
+        // z = z0 (1 + G) / (1 - G)
+        for (size_t j = 0; j < len; j++) {
+            numRe[j] = _z0 * (1.0f + gRe[j]);
+            numIm[j] = _z0 * gIm[j];
+            denRe[j] = 1.0f - gRe[j];
+            denIm[j] = -gIm[j];
+        }
+        _kernels->div(CplxIn{numRe, numIm}, CplxIn{denRe, denIm}, CplxOut{z.re + i, z.im + i}, len);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef OSL_CORRECTION_H
+#define OSL_CORRECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "CalStore.h"
+#include "CplxKernels.h"
+#include "Cplx.h"
+
+// What the tuner's calibration standards really reflect at the reference
+// plane (K1-K3), rather than the ideal +1 / -1 / 0: an open with fringe
+// capacitance, a short and a load with some series inductance.
+struct CalKit {
+    float openFarads   = 2.0e-12f;
+    float shortHenries = 3.0e-9f;
+    float loadOhms     = 50.0f;
+    float loadHenries  = 1.5e-9f;
+    float z0           = 50.0f;
+
+    Cplx open(double hz) const;
+    Cplx shortCircuit(double hz) const;
+    Cplx load(double hz) const;
+};
+
+// One-port Open/Short/Load error correction. The VNA reads
+//   m = e00 + e10e01 G / (1 - e11 G)
+// for a reflection G at the reference plane, so with delta = e00 e11 - e10e01
+//   G = (m - e00) / (m e11 - delta)
+// solve() finds e00 (directivity), e11 (source match) and delta at every
+// point of the standards' frequency grid once; correct() then maps raw
+// samples to impedance, in chunks through the batched complex kernels.
+//
+// The table is structure-of-arrays in caller-owned storage of
+// TABLE_FLOATS floats per point (frequency and three complex terms), e.g.
+// 28 KB for a 1001-point sweep.
+class OslCorrection {
+public:
+    static constexpr size_t TABLE_FLOATS = 7;
+    static constexpr size_t CHUNK        = 64; // points per kernel call, on the stack
+    static constexpr double MIN_TRACKING = 1e-3; // |e10e01|, -60 dB round trip
+
+    OslCorrection();
+
+    void setTable(float* storage, size_t capacity);
+    void setKernels(const CplxKernels& kernels) { _kernels = &kernels; }
+
+    // false if the sweeps are not on one grid, do not fit the table or a
+    // point cannot be solved (standards that read the same); the table is then empty
+    bool solve(const CalTrace& open, const CalTrace& shortSweep, const CalTrace& load, const CalKit& kit);
+    // The standards of one run from the store, which must be complete
+    bool solve(const CalStoreView& store, const CalKit& kit);
+    void clear();
+
+    size_t size() const { return _count; }
+    uint32_t runId() const { return _runId; }
+    float z0() const { return _z0; }
+    float freqAt(size_t i) const { return _freq[i]; }
+    void terms(size_t i, Cplx& e00, Cplx& e11, Cplx& delta) const;
+    // Same points and frequencies as the table
+    bool matches(const CalTrace& trace) const;
+
+    // Raw samples at table points [first, first + n) to reflection and to
+    // impedance at the reference plane. Output may alias the input.
+    void correctGamma(size_t first, CplxIn raw, CplxOut gamma, size_t n) const;
+    void correct(size_t first, CplxIn raw, CplxOut z, size_t n) const;
+
+private:
+    const CplxKernels* _kernels;
+    size_t             _capacity;
+    size_t             _count;
+    uint32_t           _runId;
+    float              _z0;
+    float*             _freq;
+    float*             _e00Re;
+    float*             _e00Im;
+    float*             _e11Re;
+    float*             _e11Im;
+    float*             _deltaRe;
+    float*             _deltaIm;
+};
+
+#endif // OSL_CORRECTION_H
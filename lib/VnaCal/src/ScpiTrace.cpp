@@ -0,0 +1,112 @@
+#include "ScpiTrace.h"
+#include <stdlib.h>
+
+ScpiTraceParser::ScpiTraceParser() :
+    _freq(nullptr), _re(nullptr), _im(nullptr), _capacity(0)
+{
+    reset();
+}
+
+void ScpiTraceParser::setSampleBuffer(float* freqHz, float* re, float* im, size_t capacity)
+{
+    _freq = freqHz;
+    _re = re;
+    _im = im;
+    _capacity = capacity;
+    _count = 0;
+}
+
+void ScpiTraceParser::reset()
+{
+    _state = State::Open;
+    _status = Status::Ok;
+    _done = false;
+    _count = 0;
+    _total = 0;
+    _field = 0;
+    _tokenLen = 0;
+}
+
+void ScpiTraceParser::clearSamples()
+{
+    _count = 0;
+    if (_status == Status::BufferFull) {
+        _status = Status::Ok;
+    }
+}
+
+bool ScpiTraceParser::endNumber()
+{
+    if (_tokenLen == 0 || _field >= 3) {
+        return false;
+    }
+    _token[_tokenLen] = '\0';
+    char* end = nullptr;
+    _tuple[_field++] = strtod(_token, &end);
+    _tokenLen = 0;
+    return end != nullptr && *end == '\0';
+}
+
+size_t ScpiTraceParser::feed(const char* data, size_t len)
+{
+    size_t i = 0;
+    for (; i < len && _status == Status::Ok && !_done; i++) {
+        const char c = data[i];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            continue;
+        }
+        switch (_state) {
+        case State::Open:
+            if (c == '[') {
+                if (_count == _capacity) {
+                    _status = Status::BufferFull; // '[' is fed again after clearSamples()
+                    return i;
+                }
+                _field = 0;
+                _tokenLen = 0;
+                _state = State::Number;
+            } else if (c == '\n' && _total == 0) {
+                _done = true; // empty trace
+            } else {
+                // "ERROR" or any other reply in place of the trace
+                _status = c == 'E' ? Status::Error : Status::BadToken;
+            }
+            break;
+        case State::Number:
+            if (c == ',' || c == ']') {
+                if (!endNumber()) {
+                    _status = Status::BadToken;
+                } else if (c == ']') {
+                    if (_field != 3) {
+                        _status = Status::BadToken;
+                        break;
+                    }
+                    _freq[_count] = float(_tuple[0]);
+                    _re[_count] = float(_tuple[1]);
+                    _im[_count] = float(_tuple[2]);
+                    _count++;
+                    _total++;
+                    _state = State::Separator;
+                }
+            } else if (size_t(_tokenLen) + 1 < sizeof(_token) &&
+                       ((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E')) {
+                _token[_tokenLen++] = c;
+            } else {
+                _status = Status::BadToken;
+            }
+            break;
+        case State::Separator:
+            if (c == ',') {
+                _state = State::Open;
+            } else if (c == '\n') {
+                _done = true;
+            } else {
+                _status = Status::BadToken;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return i;
+}
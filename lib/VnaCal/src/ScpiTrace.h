@@ -0,0 +1,52 @@
+#ifndef SCPI_TRACE_H
+#define SCPI_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Push-style parser for the reply to a LibreVNA style ":VNA:TRACE:DATA? S11"
+// query: one line of "[freq,re,im]" tuples separated by commas, e.g.
+//   [1500000,0.0123,-0.9981],[1528500,0.0119,-0.9979],...\n
+// Numbers may be in any strtod() format and tuples may straddle chunk
+// boundaries. Like SweepParser, samples go into caller-supplied
+// structure-of-arrays buffers; when they fill, feed() stops and returns the
+// bytes consumed so the caller can drain them (clearSamples()) and go on.
+class ScpiTraceParser {
+public:
+    enum class Status : uint8_t { Ok, BufferFull, BadToken, Error };
+
+    ScpiTraceParser();
+
+    void setSampleBuffer(float* freqHz, float* re, float* im, size_t capacity);
+    size_t feed(const char* data, size_t len);
+    void reset();
+
+    Status status() const { return _status; }
+    bool full() const { return _status == Status::BufferFull; }
+    // The terminating newline has been seen
+    bool done() const { return _done; }
+    size_t sampleCount() const { return _count; }
+    size_t totalSamples() const { return _total; }
+    void clearSamples();
+
+private:
+    enum class State : uint8_t { Open, Number, Separator };
+
+    bool endNumber();
+
+    State    _state;
+    Status   _status;
+    bool     _done;
+    float*   _freq;
+    float*   _re;
+    float*   _im;
+    size_t   _capacity;
+    size_t   _count;
+    size_t   _total;
+    double   _tuple[3];
+    uint8_t  _field;
+    char     _token[32];
+    uint8_t  _tokenLen;
+};
+
+#endif // SCPI_TRACE_H
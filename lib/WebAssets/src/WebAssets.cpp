@@ -0,0 +1,23 @@
+#include "WebAssets.h"
+#include <string.h>
+
+bool webEtagMatches(const char* ifNoneMatch, const char* etag)
+{
+    if (ifNoneMatch == nullptr || etag == nullptr) {
+        return false;
+    }
+    const size_t etagLen = strlen(etag);
+    const char* p = ifNoneMatch;
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (*p == '\0') return false;
+        if (*p == '*') return true;
+        if (p[0] == 'W' && p[1] == '/') p += 2;
+        // One entity tag: a quoted string without escapes (RFC 7232)
+        const char* end = *p == '"' ? strchr(p + 1, '"') : nullptr;
+        if (end == nullptr) return false;
+        end++;
+        if (size_t(end - p) == etagLen && memcmp(p, etag, etagLen) == 0) return true;
+        p = end;
+    }
+}
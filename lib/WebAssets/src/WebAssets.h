@@ -0,0 +1,24 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A file of the web UI as embedded by tools/embed_web.py (WebAssetData.h):
+// minified, gzip-compressed and served as stored with
+// "Content-Encoding: gzip". There is no uncompressed copy; every browser
+// accepts gzip.
+struct WebAsset {
+    const char*    path;         // URL; content-hashed for immutable assets
+    const char*    contentType;
+    const uint8_t* gzip;
+    size_t         gzipSize;
+    const char*    etag;         // strong, quoted: hash of the gzip bytes
+    const char*    cacheControl;
+};
+
+// If-None-Match against an ETag: true if the header lists it (weak
+// comparison, so W/"x" matches "x") or is "*"; a 304 is then enough
+bool webEtagMatches(const char* ifNoneMatch, const char* etag);
+
+#endif // WEB_ASSETS_H
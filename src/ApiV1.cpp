@@ -0,0 +1,106 @@
+#include "ApiV1.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GAPTuner.h"
+#include "JsonWriter.h"
+#include "RelayExecutor.h"
+#include "TunerState.h"
+
+// Whole decimal number within 32 bits, else false
+static bool parseUnsigned(const char* s, uint32_t& out)
+{
+    if (s == nullptr || *s < '0' || *s > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    const unsigned long long v = strtoull(s, &end, 10);
+    if (*end != '\0' || v > UINT32_MAX) {
+        return false;
+    }
+    out = uint32_t(v);
+    return true;
+}
+
+ApiV1::ApiV1(GAPTuner& tuner, RelayExecutor& executor, TunerState& state) :
+    _tuner(tuner), _executor(executor), _state(state)
+{
+}
+
+int ApiV1::error(int status, const char* message, char* out, size_t size, size_t& length) const
+{
+    JsonWriter json(out, size);
+    json.beginObject().string("error", message).endObject();
+    length = json.finish();
+    return status;
+}
+
+int ApiV1::jobAccepted(uint32_t jobId, char* out, size_t size, size_t& length) const
+{
+    if (jobId == 0) {
+        return error(503, "Relay queue full, try again", out, size, length);
+    }
+    JsonWriter json(out, size);
+    json.beginObject().number("id", jobId).string("state", "queued").endObject();
+    length = json.finish();
+    return 202;
+}
+
+size_t ApiV1::formatJob(const RelayJobStatus& status, char* out, size_t size)
+{
+    JsonWriter json(out, size);
+    json.beginObject()
+        .number("id", status.id)
+        .string("state", RelayExecutor::stateName(status.state))
+        .string("message", status.message)
+        .string("details", status.details)
+        .endObject();
+    return json.finish();
+}
+
+int ApiV1::handle(const char* path, ParamLookup param, void* context, char* out, size_t size, size_t& length) const
+{
+    length = 0;
+    if (strncmp(path, PREFIX, strlen(PREFIX)) == 0) {
+        path += strlen(PREFIX);
+    }
+    uint32_t value = 0;
+    int status = 200;
+    if (strcmp(path, "state") == 0) {
+        uint32_t version = 0;
+        length = _state.format(out, size, version);
+    } else if (strcmp(path, "wifi") == 0) {
+        TunerState::Snapshot s;
+        _state.snapshot(s);
+        JsonWriter json(out, size);
+        json.beginObject().boolean("online", s.online).number("rssi", int32_t(s.rssi)).endObject();
+        length = json.finish();
+    } else if (strcmp(path, "button") == 0) {
+        if (!parseUnsigned(param(context, "id"), value) || value < 1 || value > uint32_t(GAPTuner::NUM_ACTIONS)) {
+            char message[48];
+            snprintf(message, sizeof(message), "id must be a button number, 1 to %d", GAPTuner::NUM_ACTIONS);
+            return error(400, message, out, size, length);
+        }
+        return jobAccepted(_executor.submitButton(int(value)), out, size, length);
+    } else if (strcmp(path, "tune") == 0) {
+        if (!parseUnsigned(param(context, "freq"), value) || value == 0) {
+            return error(400, "freq must be a frequency in Hz", out, size, length);
+        }
+        if (!_tuner.canTune()) {
+            return error(503, "No tune table or antenna sweep loaded", out, size, length);
+        }
+        return jobAccepted(_executor.submitTune(value), out, size, length);
+    } else if (strcmp(path, "job") == 0) {
+        RelayJobStatus job;
+        if (!parseUnsigned(param(context, "id"), value) || !_executor.status(value, job)) {
+            return error(404, "Unknown job", out, size, length);
+        }
+        length = formatJob(job, out, size);
+    } else {
+        return error(404, "Unknown endpoint", out, size, length);
+    }
+    if (length == 0) {
+        status = error(500, "Reply too large", out, size, length);
+    }
+    return status;
+}
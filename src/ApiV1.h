@@ -0,0 +1,49 @@
+#ifndef API_V1_H
+#define API_V1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class GAPTuner;
+class RelayExecutor;
+class TunerState;
+struct RelayJobStatus;
+
+// /api/v1/<endpoint>: the tuner as a JSON API for scripts and apps, beside
+// the UI's routes. Every reply, errors included, is one JSON object written
+// straight into the caller's buffer (JsonWriter), so answering allocates
+// nothing; WebServerManager hands it to a single response stream.
+//
+//   GET state              the /events state (see TunerState)
+//   GET wifi               {"online":..,"rssi":..}
+//   GET button?id=<1..8>   202 {"id":<job>,"state":"queued"}, see /job
+//   GET tune?freq=<Hz>     the same for a band-plan tune
+//   GET job?id=<job>       {"id":..,"state":..,"message":..,"details":..}
+//   errors                 400/404/503 {"error":".."}
+class ApiV1 {
+public:
+    static constexpr const char* PREFIX     = "/api/v1/";
+    static constexpr size_t      REPLY_SIZE = 1536; // a job with its relay details
+
+    // Query parameter by name, nullptr if absent
+    typedef const char* (*ParamLookup)(void* context, const char* name);
+
+    ApiV1(GAPTuner& tuner, RelayExecutor& executor, TunerState& state);
+
+    // path with or without PREFIX. Returns the HTTP status; length receives
+    // the length of the JSON in out (NUL-terminated)
+    int handle(const char* path, ParamLookup param, void* context, char* out, size_t size, size_t& length) const;
+
+    // The job object of /job and /api/v1/job; 0 if it did not fit
+    static size_t formatJob(const RelayJobStatus& status, char* out, size_t size);
+
+private:
+    int error(int status, const char* message, char* out, size_t size, size_t& length) const;
+    int jobAccepted(uint32_t jobId, char* out, size_t size, size_t& length) const;
+
+    GAPTuner&      _tuner;
+    RelayExecutor& _executor;
+    TunerState&    _state;
+};
+
+#endif // API_V1_H
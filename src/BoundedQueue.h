@@ -0,0 +1,78 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-capacity lock-free queue (D. Vyukov's bounded MPMC design). Each cell
+// carries a sequence number that tells producers and consumers whether it is
+// theirs to fill or drain, so push and pop are a single compare-exchange on
+// the shared index plus one store. No allocation; N must be a power of two.
+template <typename T, size_t N>
+class BoundedQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "BoundedQueue size must be a power of two");
+
+public:
+    BoundedQueue() : _head(0), _tail(0) {
+        for (size_t i = 0; i < N; i++) {
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // false if the queue is full
+    bool push(const T& value) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & (N - 1)];
+            const size_t seq = cell.seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // false if the queue is empty
+    bool pop(T& out) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & (N - 1)];
+            const size_t seq = cell.seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = cell.value;
+                    cell.seq.store(pos + N, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T                   value;
+    };
+
+    Cell                _cells[N];
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,93 @@
+#include "CalCorrector.h"
+#include "DebugUtils.h"
+
+CalCorrector::CalCorrector() : _store(nullptr), _arena(nullptr)
+{
+}
+
+void CalCorrector::setArena(Arena* arena)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _store = nullptr;
+    _osl.setTable(nullptr, 0); // cleared, the arena's contents are about to go
+    _arena = arena;
+}
+
+void CalCorrector::setKit(const CalKit& kit)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _kit = kit;
+}
+
+bool CalCorrector::rebuild(const CalStoreView* store)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _store = nullptr;
+    _osl.setTable(nullptr, 0); // cleared, the arena's contents are about to go
+    if (store == nullptr || _arena == nullptr) {
+        return false;
+    }
+    // Sized for the run, 28 bytes a point
+    const size_t points = store->trace(CalSweep::Open).size();
+    _arena->reset();
+    float* table = _arena->allocateArray<float>(OslCorrection::TABLE_FLOATS * points, "osl table");
+    if (table == nullptr) {
+        DEBUG_PRINTF("CalCorrector: %u points do not fit the %u byte %s arena.\n", (unsigned)points,
+                     (unsigned)_arena->capacity(), _arena->name());
+        return false;
+    }
+    _osl.setTable(table, points);
+    const uint32_t t0 = micros();
+    if (!_osl.solve(*store, _kit)) {
+        DEBUG_PRINTLN("CalCorrector: No usable Open/Short/Load sweeps of one run.");
+        return false;
+    }
+    _store = store;
+    DEBUG_PRINTF("CalCorrector: Run %08x, error terms for %u points in %u us.\n", (unsigned)_osl.runId(),
+                 (unsigned)_osl.size(), (unsigned)(micros() - t0));
+    return true;
+}
+
+uint32_t CalCorrector::runId() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _store ? _osl.runId() : 0;
+}
+
+CalTrace CalCorrector::traceLocked(CalSweep sweep) const
+{
+    const CalSlotHeader* h = _store ? _store->header(sweep) : nullptr;
+    if (h == nullptr || h->runId != _osl.runId()) {
+        return CalTrace();
+    }
+    return _store->trace(sweep);
+}
+
+size_t CalCorrector::points(CalSweep sweep) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    const CalTrace trace = traceLocked(sweep);
+    return trace.size() != 0 && _osl.matches(trace) ? trace.size() : 0;
+}
+
+size_t CalCorrector::read(CalSweep sweep, uint32_t runId, size_t first, size_t n, float* freqHz, float* re,
+                          float* im) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_store == nullptr || _osl.runId() != runId) {
+        return 0;
+    }
+    // Slots of one run share the grid (checked by points())
+    const CalTrace trace = traceLocked(sweep);
+    if (trace.size() != _osl.size() || first >= trace.size()) {
+        return 0;
+    }
+    if (n > trace.size() - first) {
+        n = trace.size() - first;
+    }
+    for (size_t i = 0; i < n; i++) {
+        freqHz[i] = trace.freqAt(first + i);
+    }
+    _osl.correct(first, CplxIn{trace.re() + first, trace.im() + first}, CplxOut{re, im}, n);
+    return n;
+}
@@ -0,0 +1,51 @@
+#ifndef CAL_CORRECTOR_H
+#define CAL_CORRECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include "Arena.h"
+#include "CalStore.h"
+#include "OslCorrection.h"
+
+// Error-corrected sweeps of the last VNA calibration run. The OSL table is
+// solved once when a run completes; a sweep is then corrected as it is read,
+// a chunk at a time, straight from the mapped vnacal partition.
+//
+// The partition is rewritten by the next run: VnaSequencer's store hook
+// calls rebuild(nullptr) before the mapping goes away, and readers name the
+// run they started on so a reply never mixes two runs.
+//
+// The table lives in an arena of its own (MemoryArenas::cal()), reset and
+// refilled by each rebuild; a run with more points than it holds is refused.
+class CalCorrector {
+public:
+    CalCorrector();
+
+    void setArena(Arena* arena);
+    void setKit(const CalKit& kit);
+    // With the store mapped: solves the table from its standards (false if
+    // they are missing or unusable, or too many points for the arena).
+    // nullptr drops table and store.
+    bool rebuild(const CalStoreView* store);
+
+    // Run of the current table, 0 if there is none
+    uint32_t runId() const;
+    // Points of a stored sweep of that run on the table's grid, else 0
+    size_t points(CalSweep sweep) const;
+    // Corrected impedance of points [first, first + n) of a sweep of run
+    // runId, with their frequencies; 0 once past the end or if the run has
+    // been replaced meanwhile
+    size_t read(CalSweep sweep, uint32_t runId, size_t first, size_t n, float* freqHz, float* re, float* im) const;
+
+private:
+    CalTrace traceLocked(CalSweep sweep) const;
+
+    mutable std::mutex  _lock;     // everything below
+    const CalStoreView* _store;
+    CalKit              _kit;
+    OslCorrection       _osl;
+    Arena*              _arena;    // the table, PSRAM if there is any
+};
+
+#endif // CAL_CORRECTOR_H
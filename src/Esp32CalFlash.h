@@ -0,0 +1,33 @@
+#ifndef ESP32_CAL_FLASH_H
+#define ESP32_CAL_FLASH_H
+
+#include <esp_partition.h>
+#include "CalStore.h"
+
+// The "vnacal" partition for VnaSequencer, offsets from its start
+class Esp32CalFlash : public SweepFlash {
+public:
+    Esp32CalFlash() : _part(nullptr) {}
+
+    bool flashErase(uint32_t offset, uint32_t len) override {
+        return open() && esp_partition_erase_range(_part, offset, len) == ESP_OK;
+    }
+    bool flashWrite(uint32_t offset, const void* data, uint32_t len) override {
+        return open() && esp_partition_write(_part, offset, data, len) == ESP_OK;
+    }
+
+private:
+    bool open() {
+        if (_part == nullptr) {
+            _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)CAL_STORE_SUBTYPE, "vnacal");
+            if (_part != nullptr && _part->size < CAL_STORE_SIZE) {
+                _part = nullptr;
+            }
+        }
+        return _part != nullptr;
+    }
+
+    const esp_partition_t* _part;
+};
+
+#endif // ESP32_CAL_FLASH_H
@@ -0,0 +1,83 @@
+#ifndef ESP32_RELAY_HAL_H
+#define ESP32_RELAY_HAL_H
+
+#include <Arduino.h>     // For pinMode, digitalWrite, delay, micros
+#include "driver/gpio.h" // For gpio_set_drive_capability
+#include "soc/gpio_struct.h" // For GPIO (W1TS / W1TC registers)
+#include "RelayHal.h"
+
+// The LC bank coils hang off two daisy-chained 74HC595s, output Qn as pin
+// EXPANDER_PIN_BASE + n. /OE has a pull-up and the coil drivers' inputs
+// pull-downs, so whatever a 595 holds at power-up stays off until the first
+// all-zero word is latched.
+#define BANK_SR_DATA_PIN  GPIO_NUM_4
+#define BANK_SR_CLOCK_PIN GPIO_NUM_5
+#define BANK_SR_LATCH_PIN GPIO_NUM_6
+#define BANK_SR_OE_PIN    GPIO_NUM_7
+#define BANK_SR_OUTPUTS   16
+
+// RelayHal on the ESP32 GPIOs via the Arduino core
+class Esp32RelayHal : public RelayHal {
+public:
+    Esp32RelayHal() : _banks(0), _banksReady(false) {}
+
+    void pinMode(uint8_t pin, uint8_t mode) override {
+        if (pin < EXPANDER_PIN_BASE) ::pinMode(pin, mode);
+        else if (!_banksReady) beginBanks();
+    }
+    void digitalWrite(uint8_t pin, uint8_t value) override {
+        if (pin < EXPANDER_PIN_BASE) {
+            ::digitalWrite(pin, value);
+            return;
+        }
+        const uint32_t bit = 1u << (pin - EXPANDER_PIN_BASE);
+        shiftBanks(value ? _banks | bit : _banks & ~bit);
+    }
+    // Releases first, then all set pins of a bank in the same cycle; the
+    // shift register latches its releases and sets together in between
+    void writeMask(const GpioMask& mask) override {
+        if (mask.clear[0]) GPIO.out_w1tc = mask.clear[0];
+        if (mask.clear[1]) GPIO.out1_w1tc.val = mask.clear[1];
+        if (mask.set[2] | mask.clear[2]) shiftBanks((_banks & ~mask.clear[2]) | mask.set[2]);
+        if (mask.set[0]) GPIO.out_w1ts = mask.set[0];
+        if (mask.set[1]) GPIO.out1_w1ts.val = mask.set[1];
+    }
+    void setDriveCapability(uint8_t pin, uint8_t level) override {
+        if (pin < EXPANDER_PIN_BASE) gpio_set_drive_capability((gpio_num_t)pin, (gpio_drive_cap_t)level);
+    }
+    void delayMs(uint32_t ms) override { ::delay(ms); }
+    uint32_t micros() override { return ::micros(); }
+
+private:
+    // Outputs disabled until they hold zeros, then enabled for good
+    void beginBanks() {
+        ::pinMode(BANK_SR_OE_PIN, OUTPUT);
+        ::digitalWrite(BANK_SR_OE_PIN, HIGH);
+        ::pinMode(BANK_SR_DATA_PIN, OUTPUT);
+        ::pinMode(BANK_SR_CLOCK_PIN, OUTPUT);
+        ::pinMode(BANK_SR_LATCH_PIN, OUTPUT);
+        ::digitalWrite(BANK_SR_CLOCK_PIN, LOW);
+        ::digitalWrite(BANK_SR_LATCH_PIN, LOW);
+        shiftBanks(0);
+        ::digitalWrite(BANK_SR_OE_PIN, LOW);
+        _banksReady = true;
+    }
+    // Highest output first, so bit 0 ends on Q0 of the first 595; a few us
+    // through the W1TS / W1TC registers
+    void shiftBanks(uint32_t bits) {
+        for (int i = BANK_SR_OUTPUTS - 1; i >= 0; i--) {
+            if ((bits >> i) & 1u) GPIO.out_w1ts = 1u << BANK_SR_DATA_PIN;
+            else GPIO.out_w1tc = 1u << BANK_SR_DATA_PIN;
+            GPIO.out_w1ts = 1u << BANK_SR_CLOCK_PIN;
+            GPIO.out_w1tc = 1u << BANK_SR_CLOCK_PIN;
+        }
+        GPIO.out_w1ts = 1u << BANK_SR_LATCH_PIN;
+        GPIO.out_w1tc = 1u << BANK_SR_LATCH_PIN;
+        _banks = bits;
+    }
+
+    uint32_t _banks; // levels latched on the shift register outputs
+    bool     _banksReady;
+};
+
+#endif // ESP32_RELAY_HAL_H
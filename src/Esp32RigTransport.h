@@ -0,0 +1,89 @@
+#ifndef ESP32_RIG_TRANSPORT_H
+#define ESP32_RIG_TRANSPORT_H
+
+#include <Arduino.h> // For HardwareSerial, millis, delay
+#include <WiFi.h>    // For WiFiClient
+#include "RigTransport.h"
+
+// UART1 through the GPIO matrix, on ordinary pins: none of the strapping
+// pins (0, 3, 45, 46) may see the rig's interface while the tuner resets
+#define CIV_RX_PIN 15
+#define CIV_TX_PIN 16
+// The VNA's SCPI UART, wired straight to the VNA: no echo
+#define VNA_RX_PIN 17
+#define VNA_TX_PIN 21
+
+// rigctld over WiFi
+class Esp32RigctldTransport : public RigTransport {
+public:
+    bool open(const RigConfig& config) override {
+        if (config.host[0] == '\0' || !_client.connect(config.host, config.port)) {
+            return false;
+        }
+        _client.setNoDelay(true);
+        return true;
+    }
+    void close() override { _client.stop(); }
+    bool write(const uint8_t* data, size_t len) override {
+        return _client.connected() && _client.write(data, len) == len;
+    }
+    int read(uint8_t* out, size_t size, uint32_t timeoutMs) override {
+        const uint32_t t0 = millis();
+        while (_client.available() == 0) {
+            if (!_client.connected()) return -1;
+            if (millis() - t0 >= timeoutMs) return 0;
+            delay(1);
+        }
+        const int n = _client.read(out, size);
+        return n < 0 ? -1 : n;
+    }
+
+private:
+    WiFiClient _client;
+};
+
+// A hardware UART on two pins; the baud rate comes with each open()
+class Esp32UartTransport : public RigTransport {
+public:
+    Esp32UartTransport(HardwareSerial& port, int rxPin, int txPin) : _port(port), _rxPin(rxPin), _txPin(txPin) {}
+
+    bool open(const RigConfig& config) override {
+        _port.begin(config.baud, SERIAL_8N1, _rxPin, _txPin);
+        while (_port.available() > 0) _port.read(); // stale bytes
+        return true;
+    }
+    void close() override { _port.end(); }
+    bool write(const uint8_t* data, size_t len) override { return _port.write(data, len) == len; }
+    int read(uint8_t* out, size_t size, uint32_t timeoutMs) override {
+        const uint32_t t0 = millis();
+        while (_port.available() == 0) {
+            if (millis() - t0 >= timeoutMs) return 0;
+            delay(1);
+        }
+        size_t n = 0;
+        while (n < size && _port.available() > 0) {
+            out[n++] = uint8_t(_port.read());
+        }
+        return int(n);
+    }
+
+private:
+    HardwareSerial& _port;
+    int             _rxPin;
+    int             _txPin;
+};
+
+// CI-V on Serial1; TX and RX are tied together by the level shifter, so
+// every frame sent is read back and dropped by CivDecoder
+class Esp32CivTransport : public Esp32UartTransport {
+public:
+    Esp32CivTransport() : Esp32UartTransport(Serial1, CIV_RX_PIN, CIV_TX_PIN) {}
+};
+
+// SCPI to a VNA on Serial2, on its own pins
+class Esp32VnaUartTransport : public Esp32UartTransport {
+public:
+    Esp32VnaUartTransport() : Esp32UartTransport(Serial2, VNA_RX_PIN, VNA_TX_PIN) {}
+};
+
+#endif // ESP32_RIG_TRANSPORT_H
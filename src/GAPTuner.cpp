@@ -1,64 +1,214 @@
 #include "GAPTuner.h"
 #include "DebugUtils.h" // For DEBUG_PRINTLN, DEBUG_PRINTF
+#include "Metrics.h"    // For metricsMicros
 
 // Constructor
-GAPTuner::GAPTuner(RelayController& rc) : _relayController(rc)
+GAPTuner::GAPTuner(RelayController& rc) :
+    _relayController(rc), _tuneTable(nullptr), _sweeps(nullptr), _personality(nullptr),
+    _model(TunerDesign::model()), _solver(_model), _lastSolveUs(0), _gapLength(GapLength::Long)
 {  
 }
 
+void GAPTuner::attachSolverData(const SweepStoreView* sweeps, const PersonalityView* personality)
+{
+    _sweeps = sweeps;
+    _personality = personality;
+}
+
+bool GAPTuner::attachTuneTable(const TuneTableView* table)
+{
+    if (table == nullptr) {
+        _tuneTable = nullptr; // detached, e.g. while a new table is uploaded
+        return false;
+    }
+    if (!table->isValid() ||
+        table->header().lBits != TunerDesign::L_BITS || table->header().cBits != TunerDesign::C_BITS) {
+        DEBUG_PRINTLN("GAPTuner: Tune table missing or built for a different bank geometry.");
+        _tuneTable = nullptr;
+        return false;
+    }
+    _tuneTable = table;
+    DEBUG_PRINTF("GAPTuner: Tune table attached, %u long / %u short entries.\n",
+                 (unsigned)table->count(GapLength::Long), (unsigned)table->count(GapLength::Short));
+    return true;
+}
+
 void GAPTuner::applyDefaultState()
 {
     DEBUG_PRINTLN("GAPTuner: Applying default power-up state (All Off)...");
-    _relayController.applyActions(s_allOff, sizeof(s_allOff) / sizeof(s_allOff[0]));
+    _relayController.applyMask(s_allOffMask);
+}
+
+void GAPTuner::restoreLatched(const RelayTarget& latched, GapLength gap)
+{
+    _relayController.restoreLatched(latched);
+    _gapLength = gap;
 }
 
-String GAPTuner::processButtonAction(int buttonId_int, String& outMessage)
+bool GAPTuner::processButtonAction(int buttonId_int, char* outMessage, size_t size)
 {
-    String actionDetails = ""; 
+    bool ok = false;
     ButtonID buttonId = static_cast<ButtonID>(buttonId_int);
     const char* buttonNameStr = getButtonName(buttonId);
     DEBUG_PRINTF("GAPTuner: Processing action for Button ID %d (%s)\n", buttonId_int, buttonNameStr);
 
+    RelayTarget target;
     switch(buttonId) {
-        // Gap relay functionality: K7 sets polarity (latching direction of K8, K9), then pulse k5,k6, which sets latching replays  K8 and K9'
+        // Gap relays K8, K9: K7 sets the polarity, then K5 and K6 together pulse them (see RelayScheduler)
     case ButtonID::ANTENNA_SHORT:
-        actionDetails = applyRelayActions(outMessage, "Antenna set to Short:", s_antennaLengthShort);
-        actionDetails += _relayController.pulse(RELAY_K5);
-        actionDetails += _relayController.pulse(RELAY_K6);
-         digitalWrite(RELAY_K7, LOW);
+        RelayController::setTarget(target, RelayId::K8, false);
+        RelayController::setTarget(target, RelayId::K9, false);
+        ok = applyTarget(outMessage, size, "Antenna set to Short:", target);
+        if (ok) _gapLength = GapLength::Short;
         break;
     case ButtonID::ANTENNA_LONG:
-        actionDetails = applyRelayActions(outMessage, "Antenna set to Long:", s_antennaLengthLong);
-        actionDetails += _relayController.pulse(RELAY_K5);
-        actionDetails += _relayController.pulse(RELAY_K6);
-        digitalWrite(RELAY_K7, LOW);
+        RelayController::setTarget(target, RelayId::K8, true);
+        RelayController::setTarget(target, RelayId::K9, true);
+        ok = applyTarget(outMessage, size, "Antenna set to Long:", target);
+        if (ok) _gapLength = GapLength::Long;
         break;
     case ButtonID::TUNING_NONE:
-        actionDetails = applyRelayActions(outMessage, "Tuning Network set to None:", s_tuningNetNone);
+        ok = applyRelayActions(outMessage, size, "Tuning Network set to None:", s_tuningNetNoneMask);
         break;
     case ButtonID::TUNING_1:
-        actionDetails = applyRelayActions(outMessage, "Tuning Network set to 1:", s_tuningNet1);
-        actionDetails += _relayController.pulse(RELAY_LK99_SET);
+        RelayController::setTarget(target, RelayId::LK99, true);
+        ok = applyRelayActions(outMessage, size, "Tuning Network set to 1:", s_tuningNet1Mask, target);
         break;
     case ButtonID::TUNING_2:
-        actionDetails = applyRelayActions(outMessage, "Tuning Network set to 2:", s_tuningNet2);
-        actionDetails += _relayController.pulse(RELAY_LK99_RESET);
+        RelayController::setTarget(target, RelayId::LK99, false);
+        ok = applyRelayActions(outMessage, size, "Tuning Network set to 2:", s_tuningNet2Mask, target);
         break;
     case ButtonID::CAL_OPEN:
-        actionDetails = applyRelayActions(outMessage, "Calibration set to Open:", s_calOpen);
+        ok = applyRelayActions(outMessage, size, "Calibration set to Open:", s_calOpenMask);
         break;
     case ButtonID::CAL_SHORT:
-        actionDetails = applyRelayActions(outMessage, "Calibration set to Short:", s_calShort);
+        ok = applyRelayActions(outMessage, size, "Calibration set to Short:", s_calShortMask);
         break;
     case ButtonID::CAL_LOAD:
-        actionDetails = applyRelayActions(outMessage, "Calibration set to Load:", s_calLoad);
+        ok = applyRelayActions(outMessage, size, "Calibration set to Load:", s_calLoadMask);
         break;
     default:
-        outMessage = "Internal error: Unhandled Button ID";
+        snprintf(outMessage, size, "Internal error: Unhandled Button ID");
         DEBUG_PRINTF("  GAPTuner: Error - Unhandled Button ID %d (%s) in switch\n", buttonId_int, buttonNameStr);
         break;
     }
-    return actionDetails;
+    return ok;
+}
+
+bool GAPTuner::tuneToFrequency(uint32_t freqHz, char* outMessage, size_t size)
+{
+    const TuneTableEntry* entry = hasTuneTable() ? _tuneTable->find(_gapLength, freqHz) : nullptr;
+    char buffer[80];
+    if (entry != nullptr) {
+        const TuneState state = entry->state();
+        DEBUG_PRINTF("GAPTuner: Tuning %u Hz -> table entry %u Hz, L=0x%X C=0x%X %s, SWR %.1f\n",
+                     freqHz, entry->freqHz, state.lMask, state.cMask,
+                     state.topology == Topology::LC ? "L,C" : "C,L", entry->swr());
+        _lastSolveUs = 0;
+        snprintf(buffer, sizeof(buffer), "Tuned to %.3f MHz (predicted SWR %.1f):",
+                 entry->freqHz * 1e-6, entry->swr());
+        return applyTuneState(state, outMessage, size, buffer);
+    }
+    MatchResult match;
+    if (!solveMatch(freqHz, match)) {
+        snprintf(outMessage, size, hasTuneTable() ? "Frequency outside the tune table and the antenna sweep"
+                                                  : "No tune table or antenna sweep for this frequency");
+        DEBUG_PRINTF("GAPTuner: %u Hz covered by neither the tune table nor the sweep\n", freqHz);
+        return false;
+    }
+    DEBUG_PRINTF("GAPTuner: Tuning %u Hz -> solved in %u us, L=0x%X C=0x%X %s, SWR %.1f\n",
+                 freqHz, (unsigned)_lastSolveUs, match.state.lMask, match.state.cMask,
+                 match.state.topology == Topology::LC ? "L,C" : "C,L", match.swr);
+    snprintf(buffer, sizeof(buffer), "Tuned to %.3f MHz (solved in %u us, predicted SWR %.1f):",
+             freqHz * 1e-6, (unsigned)_lastSolveUs, match.swr);
+    return applyTuneState(match.state, outMessage, size, buffer);
+}
+
+// The measured bank tables at the personality's nearest frequency point
+// where available, else the nominal model at freqHz. Runs on the relay task.
+bool GAPTuner::solveMatch(uint32_t freqHz, MatchResult& out)
+{
+    const uint32_t start = metricsMicros();
+    const ImpedanceSweep sweep = _sweeps != nullptr ? _sweeps->sweep(_gapLength) : ImpedanceSweep();
+    Cplx zAntenna;
+    if (!sweep.impedanceAt(float(freqHz), zAntenna)) {
+        return false;
+    }
+    Cplx zL[size_t(1) << TunerDesign::L_BITS];
+    Cplx yC[size_t(1) << TunerDesign::C_BITS];
+    const size_t point = _personality != nullptr && _personality->isValid() ? _personality->nearestFreq(float(freqHz)) : 0;
+    if (_personality != nullptr && _personality->isValid() &&
+        _personality->seriesImpedances(point, zL, sizeof(zL) / sizeof(zL[0])) &&
+        _personality->shuntAdmittances(point, yC, sizeof(yC) / sizeof(yC[0]))) {
+        _solver.prepareTables(zL, yC);
+    } else {
+        _solver.prepare(float(freqHz));
+    }
+    out = _solver.solvePrepared(zAntenna);
+    _lastSolveUs = metricsMicros() - start;
+    return true;
+}
+
+uint32_t GAPTuner::tuneSegment(uint32_t freqHz) const
+{
+    const TuneTableEntry* entry = hasTuneTable() ? _tuneTable->find(_gapLength, freqHz) : nullptr;
+    if (entry == nullptr) {
+        return 0;
+    }
+    // Relay masks and topology (bits 0-24), not the SWR; never 0
+    return (entry->packed & 0x01FFFFFFu) + 1;
+}
+
+// Routes RF through the matching network and latches the bank relays and
+// KM1 (LK99); RelayController pulses only those not yet in position, in
+// parallel as far as the coil budget allows.
+bool GAPTuner::applyTuneState(const TuneState& state, char* outMsg, size_t size, const char* successMsgPrefix)
+{
+    RelayTarget target;
+    for (size_t i = 0; i < TunerDesign::L_BITS; i++) {
+        RelayController::setTarget(target, s_inductorBank[i], state.lMask & (1u << i));
+    }
+    for (size_t i = 0; i < TunerDesign::C_BITS; i++) {
+        RelayController::setTarget(target, s_capacitorBank[i], state.cMask & (1u << i));
+    }
+    // KM1: SET puts the shunt capacitor on the antenna side ("C, L")
+    RelayController::setTarget(target, RelayId::LK99, state.topology == Topology::CL);
+    return applyRelayActions(outMsg, size, successMsgPrefix, s_tuneRouteMask, target);
+}
+
+bool GAPTuner::applyRelayActions(char* outMsg, size_t size, const char* successMsgPrefix, const GpioMask& actions,
+                                 RelayTarget target)
+{
+    RelayController::addMask(target, actions);
+    return applyTarget(outMsg, size, successMsgPrefix, target);
+}
+
+bool GAPTuner::applyTarget(char* outMsg, size_t size, const char* successMsgPrefix, const RelayTarget& target)
+{
+    if (!_relayController.applyTarget(target)) {
+        snprintf(outMsg, size, "Internal error: %s", _relayController.lastPlan().error);
+        return false;
+    }
+    snprintf(outMsg, size, "%s", successMsgPrefix);
+    return true;
+}
+
+size_t GAPTuner::describeLastAction(char* out, size_t size) const
+{
+    return RelayController::describePlan(_relayController.lastPlan(), out, size);
+}
+
+const GAPTuner::ActionTable* GAPTuner::actionTables(size_t& count)
+{
+#define ACTION_TABLE(t) {#t, t, sizeof(t) / sizeof(t[0]), t##Mask}
+    static const ActionTable tables[] = {
+        ACTION_TABLE(s_tuningNetNone), ACTION_TABLE(s_tuningNet1), ACTION_TABLE(s_tuningNet2),
+        ACTION_TABLE(s_calOpen), ACTION_TABLE(s_calShort), ACTION_TABLE(s_calLoad),
+        ACTION_TABLE(s_allOff), ACTION_TABLE(s_tuneRoute)
+    };
+#undef ACTION_TABLE
+    count = sizeof(tables) / sizeof(tables[0]);
+    return tables;
 }
 
 const char* GAPTuner::getButtonName(ButtonID buttonId)
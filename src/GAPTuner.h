@@ -1,8 +1,13 @@
 #ifndef GAP_TUNER_H
 #define GAP_TUNER_H
 
-#include <Arduino.h> // For String, size_t (implicitly for array size calculations if needed)
+#include <Arduino.h> // For size_t (implicitly for array size calculations if needed)
 #include "RelayController.h" // For pinValue_t and RELAY_Kx enums (used in static arrays)
+#include "TuneTable.h"       // For TuneTableView, GapLength
+#include "TunerDesign.h"     // For the LC bank geometry
+#include "MatchSolver.h"
+#include "Personality.h"
+#include "SweepStore.h"
 
 class GAPTuner {
 public:
@@ -17,17 +22,50 @@ public:
     GAPTuner(RelayController& rc);
 
     void applyDefaultState();
-    String processButtonAction(int buttonId_int, String& outMessage);
+    // false (with outMessage saying why) if the relays could not be set;
+    // the message is truncated to size
+    bool processButtonAction(int buttonId_int, char* outMessage, size_t size);
+
+    // Band-plan tuning from the precomputed table in the tunetab partition
+    bool attachTuneTable(const TuneTableView* table);
+    bool hasTuneTable() const { return _tuneTable != nullptr && _tuneTable->isValid(); }
+    // Where the table has no entry (or there is no table), the match is
+    // solved at the QSY from the antenna sweep of the current gap length,
+    // with the personality's measured bank data if it has them and the
+    // nominal TunerDesign values otherwise; either may be nullptr
+    void attachSolverData(const SweepStoreView* sweeps, const PersonalityView* personality);
+    // A table or a sweep for the current gap length to tune from
+    bool canTune() const { return hasTuneTable() || (_sweeps != nullptr && _sweeps->sweep(_gapLength).size() > 0); }
+    bool tuneToFrequency(uint32_t freqHz, char* outMessage, size_t size);
+    // Time the last solve took (microseconds), 0 if the table was used
+    uint32_t lastSolveUs() const { return _lastSolveUs; }
+    // Key of the relay state tuneToFrequency() would set (equal keys, equal
+    // relays), 0 if the table does not cover freqHz; for FollowPolicy
+    uint32_t tuneSegment(uint32_t freqHz) const;
+    GapLength gapLength() const { return _gapLength; }
+    // After a wake from deep sleep: the latched relays and gap length as they
+    // were left (see PowerManager); the relays are not pulsed again
+    void restoreLatched(const RelayTarget& latched, GapLength gap);
+    const RelayController& relays() const { return _relayController; }
+
+    // Relay details of the last action (see RelayController::describePlan),
+    // built only when asked for
+    size_t describeLastAction(char* out, size_t size) const;
+
+    // The fixed relay action tables with their compile-time GPIO masks, so
+    // the host build can check one against the other
+    struct ActionTable {
+        const char*       name;
+        const pinValue_t* actions;
+        size_t            count;
+        GpioMask          mask;
+    };
+    static const ActionTable* actionTables(size_t& count);
 
 private:
     // Static relay configurations for each button action
     // Each array contains pin-value pairs to set the relays accordingly
 
-    // Relay configuration for setting antenna length to "Short"
-    static constexpr pinValue_t s_antennaLengthShort[] = {{RELAY_K7, LOW}};
-    // Relay configuration for setting antenna length to "Long"
-    static constexpr pinValue_t s_antennaLengthLong[]  = {{RELAY_K7, HIGH}};
-
     // Relay configuration for setting Tuning Network to "None" (all tuning relays off)
     static constexpr pinValue_t s_tuningNetNone[]      = {{RELAY_K1, LOW}, {RELAY_K2, LOW}, {RELAY_K3, LOW}, {RELAY_K4, HIGH}, {RELAY_K5, LOW}, {RELAY_K6, LOW}, {RELAY_K7, LOW}};
     // Relay configuration for setting Tuning Network to "1"
@@ -44,22 +82,52 @@ private:
 
     // Relay configuration to turn all relays OFF (default power-up state)
     static constexpr pinValue_t s_allOff[]  = {{RELAY_K1, LOW}, {RELAY_K2, LOW}, {RELAY_K3, LOW}, {RELAY_K4, LOW}, {RELAY_K5, LOW}, {RELAY_K6, LOW},
-        {RELAY_K7, LOW}, {RELAY_LK99_SET, LOW}, {RELAY_LK99_RESET, LOW}};
+        {RELAY_K7, LOW}, {RELAY_LK99_SET, LOW}, {RELAY_LK99_RESET, LOW},
+        {RELAY_KML1_SET, LOW}, {RELAY_KML1_RESET, LOW}, {RELAY_KML2_SET, LOW}, {RELAY_KML2_RESET, LOW},
+        {RELAY_KML3_SET, LOW}, {RELAY_KML3_RESET, LOW}, {RELAY_KML4_SET, LOW}, {RELAY_KML4_RESET, LOW},
+        {RELAY_KMC1_SET, LOW}, {RELAY_KMC1_RESET, LOW}, {RELAY_KMC2_SET, LOW}, {RELAY_KMC2_RESET, LOW},
+        {RELAY_KMC3_SET, LOW}, {RELAY_KMC3_RESET, LOW}, {RELAY_KMC4_SET, LOW}, {RELAY_KMC4_RESET, LOW}};
 
+    // RF path through the matching network: calibration relays and K4 released
+    static constexpr pinValue_t s_tuneRoute[]          = {{RELAY_K1, LOW}, {RELAY_K2, LOW}, {RELAY_K3, LOW}, {RELAY_K4, LOW}};
 
+    // The tables above as GPIO set/clear masks; applying one is a single
+    // register write per GPIO bank
+    static constexpr GpioMask s_tuningNetNoneMask = RelayController::maskOf(s_tuningNetNone);
+    static constexpr GpioMask s_tuningNet1Mask    = RelayController::maskOf(s_tuningNet1);
+    static constexpr GpioMask s_tuningNet2Mask    = RelayController::maskOf(s_tuningNet2);
+    static constexpr GpioMask s_calOpenMask       = RelayController::maskOf(s_calOpen);
+    static constexpr GpioMask s_calShortMask      = RelayController::maskOf(s_calShort);
+    static constexpr GpioMask s_calLoadMask       = RelayController::maskOf(s_calLoad);
+    static constexpr GpioMask s_allOffMask        = RelayController::maskOf(s_allOff);
+    static constexpr GpioMask s_tuneRouteMask     = RelayController::maskOf(s_tuneRoute);
 
-    template<size_t N>
-    String applyRelayActions(String& outMsg, const char* successMsgPrefix, const pinValue_t (&actions)[N]);
+    // LC bank relays, index n switches bank element n (bit n of TuneState masks)
+    static constexpr RelayId s_inductorBank[]  = {RelayId::KML1, RelayId::KML2, RelayId::KML3, RelayId::KML4};
+    static constexpr RelayId s_capacitorBank[] = {RelayId::KMC1, RelayId::KMC2, RelayId::KMC3, RelayId::KMC4};
+    static_assert(sizeof(s_inductorBank) / sizeof(s_inductorBank[0]) == TunerDesign::L_BITS, "inductor bank relays vs TunerDesign");
+    static_assert(sizeof(s_capacitorBank) / sizeof(s_capacitorBank[0]) == TunerDesign::C_BITS, "capacitor bank relays vs TunerDesign");
 
-    RelayController& _relayController;
+
+
+    // Schedules and runs target plus the monostable levels in actions; the
+    // gap relays (antenna length) and latching relays are set in target
+    bool applyRelayActions(char* outMsg, size_t size, const char* successMsgPrefix, const GpioMask& actions,
+                           RelayTarget target = RelayTarget());
+    bool applyTarget(char* outMsg, size_t size, const char* successMsgPrefix, const RelayTarget& target);
+
+    bool applyTuneState(const TuneState& state, char* outMsg, size_t size, const char* successMsgPrefix);
+    bool solveMatch(uint32_t freqHz, MatchResult& out);
+
+    RelayController&     _relayController;
+    const TuneTableView* _tuneTable;
+    const SweepStoreView*  _sweeps;
+    const PersonalityView* _personality;
+    TunerModel           _model;  // nominal element values, for _solver
+    MatchSolver          _solver; // its tables and search trees are allocated once, here
+    uint32_t             _lastSolveUs;
+    GapLength            _gapLength; // last commanded gap length; the gap relays latch it
     const char* getButtonName(ButtonID buttonId);
 };
 
-// Template method definition must be in the header or included if not specialized for known types.
-template<size_t N>
-String GAPTuner::applyRelayActions(String& outMsg, const char* successMsgPrefix, const pinValue_t (&actions)[N]) {
-    outMsg = successMsgPrefix;
-    return _relayController.applyActions(actions, N); // N is the size deduced by the template
-}
-
 #endif // GAP_TUNER_H
@@ -0,0 +1,29 @@
+#include "MemoryArenas.h"
+#include <esp_heap_caps.h>
+#include "DebugUtils.h"
+
+MemoryArenas::MemoryArenas() : _inPsram(false)
+{
+}
+
+bool MemoryArenas::begin()
+{
+    // Reserved for good: the arenas never hand memory back to the heap
+    size_t bytes = PSRAM_BYTES;
+    void* region = heap_caps_aligned_alloc(Arena::DEFAULT_ALIGN, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _inPsram = region != nullptr;
+    if (region == nullptr) {
+        bytes = INTERNAL_BYTES;
+        region = heap_caps_aligned_alloc(Arena::DEFAULT_ALIGN, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (region == nullptr) {
+        DEBUG_PRINTLN("MemoryArenas: No memory for the dataset arena.");
+        return false;
+    }
+    _datasets.begin("datasets", region, bytes);
+    const size_t calBytes = CAL_BYTES < _datasets.available() ? CAL_BYTES : _datasets.available();
+    _datasets.carve(_cal, "cal", calBytes);
+    DEBUG_PRINTF("MemoryArenas: %u KB of %s for datasets, %u KB of it for calibration.\n", (unsigned)(bytes / 1024),
+                 _inPsram ? "PSRAM" : "internal SRAM", (unsigned)(_cal.capacity() / 1024));
+    return true;
+}
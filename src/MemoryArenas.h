@@ -0,0 +1,40 @@
+#ifndef MEMORY_ARENAS_H
+#define MEMORY_ARENAS_H
+
+#include <stddef.h>
+#include "Arena.h"
+#include "CalStore.h"
+#include "OslCorrection.h"
+
+// The firmware's arenas. Large datasets share one PSRAM region reserved at
+// boot, before anything can fragment it, and each user gets a fixed budget
+// carved from it; small hot structures stay in internal SRAM as globals and
+// members. Without PSRAM a small internal region stands in, and whatever
+// does not fit fails cleanly in its user.
+// The region is the sum of the budgets, so a new user adds its own. The
+// OSL table is the only one so far: decoded sweeps are read in place from
+// flash and the solver's scratch for a 4+4 relay bank is a few hundred
+// bytes of GAPTuner's own.
+class MemoryArenas {
+public:
+    // OSL table of a full calibration slot, 112 KB
+    static constexpr size_t CAL_BYTES =
+        OslCorrection::TABLE_FLOATS * CAL_SLOT_MAX_POINTS * sizeof(float) + Arena::DEFAULT_ALIGN;
+    static constexpr size_t PSRAM_BYTES    = CAL_BYTES;
+    static constexpr size_t INTERNAL_BYTES = 32 * 1024; // a 1001-point OSL table
+
+    MemoryArenas();
+
+    bool begin();
+    bool inPsram() const { return _inPsram; }
+
+    Arena& datasets() { return _datasets; } // the whole region, carved up below
+    Arena& cal() { return _cal; }           // CalCorrector
+
+private:
+    Arena _datasets;
+    Arena _cal;
+    bool  _inPsram;
+};
+
+#endif // MEMORY_ARENAS_H
@@ -1,8 +1,11 @@
 #include "NetworkMgr.h"
 #include "DebugUtils.h" // For DEBUG_PRINT, DEBUG_PRINTLN, DEBUG_PRINTF
+#include "WebServerManager.h" // For sendAsset
+#include "WebAssetData.h"     // Generated by tools/embed_web.py
 #include <nvs_flash.h>  // For nvs_flash_init()
 #include <nvs.h>        // For nvs_open, nvs_get_str, nvs_set_str, nvs_commit, nvs_close
 #include <esp_system.h> // For ESP.restart()
+#include "Metrics.h"    // For metricsMicros
 // #include <esp_mac.h> // No longer needed for esp_read_mac()
 
 // NVS Namespace for WiFi credentials
@@ -10,10 +13,21 @@
 #define NVS_KEY_SSID "ssid"
 #define NVS_KEY_PASS "password"
 
+#define NVS_KEY_CACHE "cache"
+#define NVS_KEY_STATIC_IP "static_ip"
+
+#define EVENT_GOT_IP       (1 << 0)
+#define EVENT_DISCONNECTED (1 << 1)
+#define EVENT_LEASE        (1 << 2) // DHCP bound after a fast connect
+
 // Constructor
 NetworkMgr::NetworkMgr(const char* confHostname) :
-    _hostname(confHostname), _configWebServer(80), _wifiResetButtonPin(WIFI_RESET_BUTTON_PIN) { // Initialize _configWebServer and _wifiResetButtonPin
-    // Initialize NVS
+    _hostname(confHostname), _configWebServer(80), _wifiResetButtonPin(WIFI_RESET_BUTTON_PIN), // Initialize _configWebServer and _wifiResetButtonPin
+    _gotIp(0), _reconnects(0), _leaseBorrowed(false), _events(nullptr), _connecting(false), _fastAttempt(false),
+    _fastConnected(false), _connectStartUs(0), _connectUs(0), _cache(), _staticIp(), _nvsHandle(0) {
+}
+
+bool NetworkMgr::initNvs() {
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         DEBUG_PRINTLN("NetworkMgr: NVS partition was truncated and needs to be erased.");
@@ -21,14 +35,49 @@ NetworkMgr::NetworkMgr(const char* confHostname) :
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    return ret == ESP_OK;
+}
 
-    // Open NVS handle
-    ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &_nvsHandle);
+bool NetworkMgr::begin() {
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &_nvsHandle);
     if (ret != ESP_OK) {
         DEBUG_PRINTF("NetworkMgr: Error (%s) opening NVS handle!\n", esp_err_to_name(ret));
+        _nvsHandle = 0;
     } else {
         DEBUG_PRINTLN("NetworkMgr: NVS opened successfully.");
     }
+    _events = xEventGroupCreate();
+    // The station reconnects on its own after a drop; count it for /metrics.
+    // DHCP binding after a fast connect is the same link, not a reconnect.
+    WiFi.onEvent([this](arduino_event_id_t, arduino_event_info_t) {
+        if (_leaseBorrowed.exchange(false)) {
+            xEventGroupSetBits(_events, EVENT_LEASE);
+            return;
+        }
+        if (_gotIp.fetch_add(1) > 0) _reconnects.fetch_add(1);
+        xEventGroupSetBits(_events, EVENT_GOT_IP);
+    }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent([this](arduino_event_id_t, arduino_event_info_t) {
+        xEventGroupSetBits(_events, EVENT_DISCONNECTED);
+    }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    return ret == ESP_OK && _events != nullptr;
+}
+
+bool NetworkMgr::loadBlob(const char* key, void* out, size_t size) {
+    size_t len = size;
+    return _nvsHandle != 0 && nvs_get_blob(_nvsHandle, key, out, &len) == ESP_OK && len == size;
+}
+
+bool NetworkMgr::saveBlob(const char* key, const void* value, size_t size) {
+    return _nvsHandle != 0 && nvs_set_blob(_nvsHandle, key, value, size) == ESP_OK && nvs_commit(_nvsHandle) == ESP_OK;
+}
+
+bool NetworkMgr::saveStaticIp(const WiFiIpConfig& config) {
+    if (config.ip == 0) {
+        const esp_err_t ret = _nvsHandle != 0 ? nvs_erase_key(_nvsHandle, NVS_KEY_STATIC_IP) : ESP_FAIL;
+        return (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) && nvs_commit(_nvsHandle) == ESP_OK;
+    }
+    return saveBlob(NVS_KEY_STATIC_IP, &config, sizeof(config));
 }
 
 // Save WiFi credentials to NVS
@@ -50,6 +99,8 @@ bool NetworkMgr::saveCredentials(const char* ssid, const char* password) {
         return false;
     }
 
+    nvs_erase_key(_nvsHandle, NVS_KEY_CACHE); // another network: nothing cached applies
+
     ret = nvs_commit(_nvsHandle);
     if (ret != ESP_OK) {
         DEBUG_PRINTF("NetworkMgr: Failed to commit NVS changes (%s)\n", esp_err_to_name(ret));
@@ -66,19 +117,17 @@ bool NetworkMgr::loadCredentials() {
         return false;
     }
 
-    size_t required_size;
+    // On the stack, no heap round trip: an SSID is at most 32 characters
+    // and a WPA passphrase 64
+    char value[65];
+    size_t required_size = sizeof(value);
     esp_err_t ret;
 
     // Read SSID
-    ret = nvs_get_str(_nvsHandle, NVS_KEY_SSID, NULL, &required_size);
+    ret = nvs_get_str(_nvsHandle, NVS_KEY_SSID, value, &required_size);
     if (ret == ESP_OK) {
-        char* temp_ssid = (char*)malloc(required_size);
-        ret = nvs_get_str(_nvsHandle, NVS_KEY_SSID, temp_ssid, &required_size);
-        if (ret == ESP_OK) {
-            _ssid = temp_ssid;
-            DEBUG_PRINTF("NetworkMgr: Loaded SSID: %s\n", _ssid.c_str());
-        }
-        free(temp_ssid);
+        _ssid = value;
+        DEBUG_PRINTF("NetworkMgr: Loaded SSID: %s\n", _ssid.c_str());
     } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
         DEBUG_PRINTLN("NetworkMgr: SSID not found in NVS.");
         return false;
@@ -88,15 +137,11 @@ bool NetworkMgr::loadCredentials() {
     }
 
     // Read Password
-    ret = nvs_get_str(_nvsHandle, NVS_KEY_PASS, NULL, &required_size);
+    required_size = sizeof(value);
+    ret = nvs_get_str(_nvsHandle, NVS_KEY_PASS, value, &required_size);
     if (ret == ESP_OK) {
-        char* temp_password = (char*)malloc(required_size);
-        ret = nvs_get_str(_nvsHandle, NVS_KEY_PASS, temp_password, &required_size);
-        if (ret == ESP_OK) {
-            _password = temp_password;
-            DEBUG_PRINTF("NetworkMgr: Loaded Password: %s\n", _password.c_str());
-        }
-        free(temp_password);
+        _password = value;
+        DEBUG_PRINTF("NetworkMgr: Loaded Password: %s\n", _password.c_str());
     } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
         DEBUG_PRINTLN("NetworkMgr: Password not found in NVS.");
         return false;
@@ -121,6 +166,8 @@ void NetworkMgr::clearCredentials() {
     if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
         DEBUG_PRINTF("NetworkMgr: Failed to erase Password from NVS (%s)\n", esp_err_to_name(ret));
     }
+    nvs_erase_key(_nvsHandle, NVS_KEY_CACHE);
+    nvs_erase_key(_nvsHandle, NVS_KEY_STATIC_IP);
     ret = nvs_commit(_nvsHandle);
     if (ret != ESP_OK) {
         DEBUG_PRINTF("NetworkMgr: Failed to commit NVS erase (%s)\n", esp_err_to_name(ret));
@@ -129,34 +176,142 @@ void NetworkMgr::clearCredentials() {
     }
 }
 
-// Connect to WiFi using loaded credentials or start AP
-bool NetworkMgr::connect() {
-    if (loadCredentials()) {
-        WiFi.mode(WIFI_STA);
+// Connect to WiFi using loaded credentials; waitConnected() starts the AP
+bool NetworkMgr::beginConnect() {
+    _connecting = loadCredentials();
+    if (!_connecting) {
+        DEBUG_PRINTLN("NetworkMgr: No saved credentials found.");
+        return false;
+    }
+    if (!loadBlob(NVS_KEY_CACHE, &_cache, sizeof(_cache))) {
+        _cache = WiFiCache();
+    }
+    if (!loadBlob(NVS_KEY_STATIC_IP, &_staticIp, sizeof(_staticIp))) {
+        _staticIp = WiFiIpConfig();
+    }
+    WiFi.persistent(false); // credentials live in our namespace; no flash write per begin()
+    WiFi.mode(WIFI_STA);
+    _connectStartUs = metricsMicros();
+    startStation(_cache.channel != 0);
+    DEBUG_PRINTF("NetworkMgr: Connecting to WiFi '%s'%s...\n", _ssid.c_str(),
+                 _fastAttempt ? " (cached AP and lease)" : "");
+    return true;
+}
+
+// fast: straight to the cached AP on its channel (no scan), on the cached
+// lease unless a static address is set (no wait for DHCP, see resumeDhcp())
+void NetworkMgr::startStation(bool fast) {
+    _fastAttempt = fast;
+    const WiFiIpConfig& ip = _staticIp.ip != 0 ? _staticIp : fast ? _cache.lease : _staticIp;
+    WiFi.config(IPAddress(ip.ip), IPAddress(ip.gateway), IPAddress(ip.subnet), IPAddress(ip.dns));
+    xEventGroupClearBits(_events, EVENT_GOT_IP | EVENT_DISCONNECTED);
+    if (fast) {
+        WiFi.begin(_ssid.c_str(), _password.c_str(), _cache.channel, _cache.bssid);
+    } else {
         WiFi.begin(_ssid.c_str(), _password.c_str());
-        DEBUG_PRINT("NetworkMgr: Connecting to WiFi '"); DEBUG_PRINT(_ssid); DEBUG_PRINT("' ...");
-        int retries = 0;
-        while (WiFi.status() != WL_CONNECTED && retries < 60) { // 30 seconds timeout
-            delay(500); DEBUG_PRINT("."); retries++;
+    }
+}
+
+EventBits_t NetworkMgr::waitEvents(EventBits_t bits, uint32_t timeoutMs) {
+    return xEventGroupWaitBits(_events, bits, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeoutMs));
+}
+
+// The cached lease got the station going without waiting for DHCP, but as
+// a static address nobody renews it, and after it expires the server may give
+// it to another host. So once associated the DHCP client takes over: the
+// address is gone for one DHCP exchange, then the server renews it (usually)
+// or hands out another.
+void NetworkMgr::resumeDhcp() {
+    if (!_fastConnected || _staticIp.ip != 0) {
+        return;
+    }
+    _leaseBorrowed.store(true);
+    WiFi.config(IPAddress(), IPAddress(), IPAddress()); // all 0: DHCP client on
+}
+
+void NetworkMgr::service() {
+    if (xEventGroupClearBits(_events, EVENT_LEASE) & EVENT_LEASE) {
+        DEBUG_PRINTF("NetworkMgr: DHCP lease %s\n", WiFi.localIP().toString().c_str());
+        saveCache();
+    }
+}
+
+bool NetworkMgr::waitConnected() {
+    if (_connecting) {
+        // A moved or missing AP ends the fast attempt early
+        if (_fastAttempt && !(waitEvents(EVENT_GOT_IP | EVENT_DISCONNECTED, FAST_CONNECT_MS) & EVENT_GOT_IP)) {
+            DEBUG_PRINTLN("NetworkMgr: Fast reconnect failed, scanning.");
+            WiFi.disconnect();
+            startStation(false);
         }
-        if (WiFi.status() == WL_CONNECTED) {
-            DEBUG_PRINTLN("\nNetworkMgr: WiFi Connected!");
-            DEBUG_PRINT("  IP Address: http://"); DEBUG_PRINTLN(WiFi.localIP()); 
+        _connecting = false;
+        if (waitEvents(EVENT_GOT_IP, FULL_CONNECT_MS) & EVENT_GOT_IP) {
+            _connectUs = metricsMicros() - _connectStartUs;
+            _fastConnected = _fastAttempt;
+            saveCache();
+            DEBUG_PRINTF("NetworkMgr: WiFi Connected in %u ms%s, IP Address: http://%s\n", (unsigned)(_connectUs / 1000),
+                         _fastConnected ? " (fast)" : "", WiFi.localIP().toString().c_str());
+            resumeDhcp();
             return true;
-        } else {
-            DEBUG_PRINTLN("\nNetworkMgr: WiFi Connection Failed with saved credentials!"); 
-            // Fall through to startConfigAP
         }
-    } else {
-        DEBUG_PRINTLN("NetworkMgr: No saved credentials found.");
-        // Fall through to startConfigAP
+        DEBUG_PRINTLN("NetworkMgr: WiFi Connection Failed with saved credentials!");
     }
-
     // If connection failed or no credentials, start configuration AP
     startConfigAP();
     return false; // Return false as STA connection is not established
 }
 
+void NetworkMgr::radioOff() {
+    _connecting = false;
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+}
+
+bool NetworkMgr::radioOn() {
+    return beginConnect();
+}
+
+bool NetworkMgr::pollConnect() {
+    if (!_connecting) {
+        return false;
+    }
+    const EventBits_t bits = xEventGroupGetBits(_events);
+    if (bits & EVENT_GOT_IP) {
+        _connecting = false;
+        _connectUs = metricsMicros() - _connectStartUs;
+        _fastConnected = _fastAttempt;
+        saveCache();
+        DEBUG_PRINTF("NetworkMgr: WiFi back in %u ms%s\n", (unsigned)(_connectUs / 1000), _fastConnected ? " (fast)" : "");
+        resumeDhcp();
+        return true;
+    }
+    if (_fastAttempt && ((bits & EVENT_DISCONNECTED) || metricsMicros() - _connectStartUs >= FAST_CONNECT_MS * 1000)) {
+        DEBUG_PRINTLN("NetworkMgr: Fast reconnect failed, scanning.");
+        WiFi.disconnect();
+        startStation(false);
+    }
+    return false;
+}
+
+// Written only when something changed, not on every boot
+void NetworkMgr::saveCache() {
+    WiFiCache cache = WiFiCache();
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid == nullptr) {
+        return;
+    }
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = uint8_t(WiFi.channel());
+    if (_staticIp.ip == 0) {
+        cache.lease = WiFiIpConfig{uint32_t(WiFi.localIP()), uint32_t(WiFi.gatewayIP()), uint32_t(WiFi.subnetMask()),
+                                   uint32_t(WiFi.dnsIP())};
+    }
+    if (memcmp(&cache, &_cache, sizeof(cache)) != 0 && saveBlob(NVS_KEY_CACHE, &cache, sizeof(cache))) {
+        _cache = cache;
+        DEBUG_PRINTF("NetworkMgr: Cached AP channel %u for the next boot.\n", (unsigned)cache.channel);
+    }
+}
+
 void NetworkMgr::setupMDNS() {
     if (WiFi.status() != WL_CONNECTED) {
         DEBUG_PRINTLN("NetworkMgr: Cannot setup mDNS, WiFi not connected."); return;
@@ -212,183 +367,9 @@ void NetworkMgr::startConfigAP() {
     DEBUG_PRINTLN("NetworkMgr: Configuration Web Server started.");
 }
 
-//
-//Access point UI HTML and Javascript
-//
-
+// WiFi setup page, embedded from web/config.html by tools/embed_web.py
 void NetworkMgr::handleConfigRoot(AsyncWebServerRequest *request) {
-    const char* html = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0, user-scalable=no">
-    <title>WiFi Setup</title>
-    <style>
-        :root{
-            --icom-black:#1a1a1a;
-            --icom-dark-grey:#2c2c2c;
-            --icom-light-grey:#e0e0e0;
-            --icom-blue-accent:#00aaff;
-            --icom-shadow-dark:rgba(0,0,0,0.6);
-            --icom-shadow-light:rgba(255,255,255,0.05);
-            --border-radius:5px;
-            --button-bg:var(--icom-button-grey);
-            --button-text:var(--icom-light-grey);
-            --icom-button-grey:#424242; /* Midway dark grey */
-        }
-        body {
-            font-family: -apple-system, BlinkMacSystemFont, "Segoe UI", Roboto, Helvetica, Arial, sans-serif;
-            display: flex;
-            justify-content: center;
-            align-items: flex-start;
-            min-height: 100vh;
-            background-color: var(--icom-black);
-            margin: 0;
-            padding: 20px 15px;
-            box-sizing: border-box;
-            -webkit-tap-highlight-color: transparent;
-            color: var(--icom-light-grey); /* Default text color */
-        }
-        .container {
-            background: var(--icom-dark-grey);
-            padding: 25px 30px;
-            border-radius: var(--border-radius);
-            box-shadow: 0 0 15px var(--icom-shadow-dark), inset 0 0 5px var(--icom-shadow-light);
-            text-align: center;
-            width: 100%;
-            max-width: 380px;
-            box-sizing: border-box;
-        }
-        h1 {
-            color: var(--icom-light-grey);
-            margin-top: 0;
-            margin-bottom: 20px;
-            font-weight: 600;
-            font-size: 1.6em;
-        }
-        label {
-            display: block;
-            margin-bottom: 8px;
-            color: var(--icom-light-grey);
-            text-align: left;
-            font-size: 0.95em;
-        }
-        input[type="text"], input[type="password"] {
-            width: calc(100% - 22px); /* Adjust for padding and border */
-            padding: 10px;
-            margin-bottom: 15px;
-            border: 1px solid var(--icom-black);
-            border-radius: var(--border-radius);
-            background-color: var(--icom-black);
-            color: var(--icom-light-grey);
-            box-shadow: inset 0 1px 3px var(--icom-shadow-dark);
-            box-sizing: border-box;
-            outline: none;
-        }
-        input[type="text"]:focus, input[type="password"]:focus {
-            border-color: var(--icom-blue-accent);
-            box-shadow: inset 0 1px 3px var(--icom-shadow-dark), 0 0 0 2px var(--icom-blue-accent);
-        }
-        button {
-            padding: 12px 10px;
-            font-size: 0.95rem;
-            font-weight: 500;
-            text-align: center;
-            cursor: pointer;
-            border: 1px solid var(--icom-black);
-            border-radius: var(--border-radius);
-            background-color: var(--button-bg);
-            color: var(--button-text);
-            transition: background-color 0.15s ease, transform 0.05s ease, box-shadow 0.15s ease;
-            -webkit-tap-highlight-color: transparent;
-            box-sizing: border-box;
-            outline: none;
-            box-shadow: inset 0 2px 5px var(--icom-shadow-light), inset 0 -2px 5px var(--icom-shadow-dark), 0 2px 4px var(--icom-shadow-dark);
-            text-shadow: 0 1px 2px rgba(0,0,0,0.5);
-            width: 100%; /* Ensure buttons take full width */
-        }
-        button:focus, button:focus-visible {
-            background-color: var(--icom-blue-accent);
-            color: var(--icom-black);
-            box-shadow: inset 0 1px 3px var(--icom-shadow-dark), 0 1px 2px var(--icom-shadow-dark);
-        }
-        button:active {
-            background-color: var(--icom-blue-accent);
-            transform: translateY(1px) scale(0.98);
-            box-shadow: inset 0 1px 3px var(--icom-shadow-dark);
-        }
-        .message {
-            text-align: center;
-            margin-top: 20px;
-            padding: 10px;
-            border-radius: 4px;
-            font-size: 0.9em;
-        }
-        .success {
-            background-color: #28a745; /* Icom green */
-            color: var(--icom-black);
-            border: 1px solid #218838;
-        }
-        .error {
-            background-color: #dc3545; /* Icom red */
-            color: var(--icom-black);
-            border: 1px solid #c82333;
-        }
-        .reset-button {
-            background-color: var(--icom-dark-grey); /* Use dark grey for reset button */
-            margin-top: 10px;
-            border: 1px solid var(--icom-black);
-            box-shadow: inset 0 2px 5px var(--icom-shadow-light), inset 0 -2px 5px var(--icom-shadow-dark), 0 2px 4px var(--icom-shadow-dark);
-        }
-        .reset-button:hover {
-            background-color: var(--icom-dark-grey); /* Keep same on hover */
-        }
-        .reset-button:active {
-            background-color: var(--icom-dark-grey);
-            transform: translateY(1px) scale(0.98);
-            box-shadow: inset 0 1px 3px var(--icom-shadow-dark);
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>Gap Tuner WiFi Configuration</h1>
-        <form action="/save" method="post">
-            <label for="ssid">SSID:</label>
-            <input type="text" id="ssid" name="ssid" required><br>
-            <label for="password">Password:</label>
-            <input type="password" id="password" name="password"><br>
-            <button type="submit">Save and Connect</button>
-        </form>
-        <div id="message" class="message"></div>
-    </div>
-    <script>
-        const form = document.querySelector('form');
-        const messageDiv = document.getElementById('message');
-
-        form.addEventListener('submit', async (e) => {
-            e.preventDefault();
-            const formData = new FormData(form);
-            const response = await fetch('/save', {
-                method: 'POST',
-                body: new URLSearchParams(formData)
-            });
-            const text = await response.text();
-            messageDiv.textContent = text;
-            messageDiv.className = 'message ' + (response.ok ? 'success' : 'error');
-            if (response.ok) {
-                setTimeout(() => {
-                    messageDiv.textContent = 'Restarting device...';
-                    // Optionally redirect or show status after restart
-                }, 2000);
-            }
-        });
-    </script>
-</body>
-</html>
-)rawliteral";
-    request->send(200, "text/html", html);
+    WebServerManager::sendAsset(request, g_webConfigPage);
 }
 
 void NetworkMgr::handleConfigSave(AsyncWebServerRequest *request) {
@@ -401,9 +382,26 @@ void NetworkMgr::handleConfigSave(AsyncWebServerRequest *request) {
     if (request->hasParam("password", true)) {
         password_str = request->getParam("password", true)->value();
     }
+    // Optional static address; subnet defaults to /24, DNS to the gateway
+    WiFiIpConfig ipConfig = WiFiIpConfig();
+    if (request->hasParam("ip", true) && request->getParam("ip", true)->value().length() > 0) {
+        IPAddress ip, gateway, subnet(255, 255, 255, 0), dns;
+        const bool ok = ip.fromString(request->getParam("ip", true)->value()) &&
+                        request->hasParam("gateway", true) && gateway.fromString(request->getParam("gateway", true)->value()) &&
+                        (!request->hasParam("subnet", true) || request->getParam("subnet", true)->value().length() == 0 ||
+                         subnet.fromString(request->getParam("subnet", true)->value()));
+        if (!ok) {
+            request->send(400, "text/plain", "Invalid static IP, gateway or subnet.");
+            return;
+        }
+        if (!request->hasParam("dns", true) || !dns.fromString(request->getParam("dns", true)->value())) {
+            dns = gateway;
+        }
+        ipConfig = WiFiIpConfig{uint32_t(ip), uint32_t(gateway), uint32_t(subnet), uint32_t(dns)};
+    }
 
     if (ssid_str.length() > 0) {
-        if (saveCredentials(ssid_str.c_str(), password_str.c_str())) {
+        if (saveCredentials(ssid_str.c_str(), password_str.c_str()) && saveStaticIp(ipConfig)) {
             request->send(200, "text/plain", "WiFi credentials saved. Restarting...");
             DEBUG_PRINTLN("NetworkMgr: Saved credentials, restarting ESP.");
             delay(1000); // Give time for response to send
@@ -435,13 +433,15 @@ void NetworkMgr::checkAndHandleWiFiResetButton() {
     // Configure the WiFi reset button pin
     pinMode(_wifiResetButtonPin, INPUT_PULLUP);
 
-    // A short delay to allow the pin to settle after power-up
-    delay(500); 
-    if (digitalRead(_wifiResetButtonPin) == LOW) {
+    // The pull-up settles in microseconds; pressed means low on 5 reads 1 ms apart
+    bool pressed = true;
+    for (int i = 0; i < 5 && pressed; i++) {
+        delay(1);
+        pressed = digitalRead(_wifiResetButtonPin) == LOW;
+    }
+    if (pressed) {
         DEBUG_PRINTLN("NetworkMgr: WiFi Reset Button pressed. Clearing WiFi credentials...");
-        clearCredentials();
-        // A small delay to ensure NVS write completes before proceeding
-        delay(500); 
+        clearCredentials(); // nvs_commit() has written them when it returns
     }
     else {
         DEBUG_PRINTLN("NetworkMgr: WiFi Reset Button not pressed.");
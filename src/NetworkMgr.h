@@ -2,22 +2,75 @@
 #define NETWORK_MGR_H
 
 #include <Arduino.h> // For String, delay (used in .cpp)
+#include <atomic>
 #include <WiFi.h>
 #include <ESPmDNS.h>
 #include <nvs_flash.h> // For NVS flash operations
 #include <nvs.h>       // For NVS API
 #include <ESPAsyncWebServer.h> // For AsyncWebServerRequest
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 
 // Define the WiFi reset button pin
 #define WIFI_RESET_BUTTON_PIN GPIO_NUM_1
 
+// IPv4 settings as IPAddress values; ip 0: use DHCP
+struct WiFiIpConfig {
+    uint32_t ip, gateway, subnet, dns;
+};
+
+// Where the last connection went: the AP and channel (so the next one can
+// skip the scan) and the DHCP lease (so it can start on that address while
+// DHCP runs)
+struct WiFiCache {
+    uint8_t      bssid[6];
+    uint8_t      channel;  // 0: nothing cached
+    uint8_t      reserved;
+    WiFiIpConfig lease;
+};
+
 class NetworkMgr {
 public:
+    static constexpr uint32_t FAST_CONNECT_MS = 1500;  // cached AP and lease, then a full connect
+    static constexpr uint32_t FULL_CONNECT_MS = 30000; // scan and DHCP, then the configuration AP
+
     // Constructor now only takes hostname; SSID/password handled via NVS/AP
     NetworkMgr(const char* confHostname);
-    bool connect();
+    // Once at boot, before anything uses NVS
+    static bool initNvs();
+    // Opens the NVS namespace and registers the WiFi event handlers
+    bool begin();
+    // Starts connecting with the saved credentials and returns at once, so
+    // the rest of the boot runs while the station associates; false without
+    // credentials
+    bool beginConnect();
+    // Waits for the connection started by beginConnect(). A fast attempt
+    // with the cached AP, channel and lease that fails falls back to a scan
+    // and DHCP; without a connection the configuration AP is started.
+    // The cached lease is only borrowed: once associated, the DHCP client
+    // takes the interface back and renews it or hands out another address.
+    bool waitConnected();
+    bool connect() { beginConnect(); return waitConnected(); }
+    // WiFi off for a sleep, and back on after it: radioOn() starts the same
+    // connect as beginConnect() and pollConnect() (from loop()) finishes it
+    // without blocking, falling back to a scan if the cached AP is gone
+    void radioOff();
+    bool radioOn();
+    // true once, when the connect started by radioOn() has an address
+    bool pollConnect();
+    // From loop(): caches the lease DHCP confirmed after a fast connect
+    void service();
     void setupMDNS();
     bool isConnected();
+    // Station (re)connections after the first one, counted from WiFi events
+    uint32_t reconnectCount() const { return _reconnects.load(); }
+    // From beginConnect() until the first IP address, and whether the cached
+    // AP and lease were enough
+    uint32_t connectUs() const { return _connectUs; }
+    bool fastConnected() const { return _fastConnected; }
+
+    // Optional fixed address instead of DHCP; ip 0 clears it
+    bool saveStaticIp(const WiFiIpConfig& config);
 
     // New methods for NVS credential management
     bool saveCredentials(const char* ssid, const char* password);
@@ -30,6 +83,17 @@ private:
     String _password;  // Stored Password from NVS or AP config
     const char* _hostname;
     const int _wifiResetButtonPin; // Pin for the WiFi reset button
+    std::atomic<uint32_t> _gotIp;      // GOT_IP events since boot
+    std::atomic<uint32_t> _reconnects;
+    std::atomic<bool>     _leaseBorrowed; // on the cached lease, DHCP restarted
+    EventGroupHandle_t    _events;     // GOT_IP / DISCONNECTED while connecting
+    bool                  _connecting;
+    bool                  _fastAttempt;
+    bool                  _fastConnected;
+    uint32_t              _connectStartUs;
+    uint32_t              _connectUs;
+    WiFiCache             _cache;      // as loaded at boot
+    WiFiIpConfig          _staticIp;   // ip 0: DHCP
 
     // NVS handle
     nvs_handle_t _nvsHandle;
@@ -37,6 +101,13 @@ private:
     // Web server for configuration AP
     AsyncWebServer _configWebServer; // New member for config AP web server
 
+    bool loadBlob(const char* key, void* out, size_t size);
+    bool saveBlob(const char* key, const void* value, size_t size);
+    void saveCache();
+    void startStation(bool fast);
+    void resumeDhcp();
+    EventBits_t waitEvents(EventBits_t bits, uint32_t timeoutMs);
+
     // Helper for starting AP for configuration
     void startConfigAP();
     // Helper for handling web server on AP
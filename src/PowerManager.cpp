@@ -0,0 +1,283 @@
+#include "PowerManager.h"
+#include <string.h>
+#include <sys/time.h>
+#include <WiFi.h>
+#include <nvs.h>
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "DebugUtils.h"
+#include "Esp32RelayHal.h"     // For BANK_SR_*_PIN
+#include "Esp32RigTransport.h" // For CIV_RX_PIN
+#include "GAPTuner.h"
+#include "Metrics.h"
+#include "NetworkMgr.h"        // For WIFI_RESET_BUTTON_PIN
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "RigFollower.h"
+#include "TunerMetrics.h"
+
+#define POWER_NVS_NAMESPACE "power"
+#define POWER_NVS_KEY       "config"
+
+static const uint32_t RTC_MAGIC = 0x50575231; // "PWR1"
+
+// Kept in RTC slow memory through a deep sleep (lost on power-off). Plain
+// arrays only: a constructor would run again on the wake-up boot.
+struct PowerRtc {
+    uint32_t    magic;
+    int8_t      latched[RELAY_SCHEDULE_MAX_RELAYS]; // RelayTarget::state
+    uint8_t     gap;                                // GapLength
+    uint64_t    sleptAtMs;                          // gettimeofday(), runs on in deep sleep
+    PowerTotals totals;
+};
+RTC_DATA_ATTR static PowerRtc s_rtc;
+
+static uint64_t rtcTimeMs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return uint64_t(tv.tv_sec) * 1000 + uint64_t(tv.tv_usec) / 1000;
+}
+
+// Every relay coil pin, held low through a deep sleep so no driver floats;
+// the LC bank coils keep their zeros in the shift register, whose lines are
+// held instead
+template<typename Fn>
+static void forEachCoilPin(Fn fn)
+{
+    const RelayProfile* profiles = RelayController::profiles();
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        if (profiles[r].kind == RelayKind::Bipolar) continue; // pulsed through K5-K7
+        if (profiles[r].pin >= EXPANDER_PIN_BASE) continue;
+        fn(gpio_num_t(profiles[r].pin));
+        if (profiles[r].kind == RelayKind::Monopolar) fn(gpio_num_t(profiles[r].resetPin));
+    }
+    fn(BANK_SR_DATA_PIN);
+    fn(BANK_SR_CLOCK_PIN);
+    fn(BANK_SR_LATCH_PIN);
+    fn(BANK_SR_OE_PIN);
+}
+
+PowerManager::PowerManager(NetworkMgr& net, RelayExecutor& executor, GAPTuner& tuner, RelayController& relays,
+                           RigFollower& rig, TunerMetrics& metrics) :
+    _net(net), _executor(executor), _tuner(tuner), _relays(relays), _rig(rig), _metrics(metrics),
+    _configChanged(false), _totals(), _activity(false), _state(uint8_t(PowerState::Active)), _policy(PowerConfig(), 0),
+    _resuming(false), _wakeUs(0)
+{
+}
+
+bool PowerManager::wokenByButton()
+{
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0;
+}
+
+bool PowerManager::restoreAfterSleep()
+{
+    // applyDefaultState() has written the levels the pins were held at
+    forEachCoilPin([](gpio_num_t pin) { gpio_hold_dis(pin); });
+    gpio_deep_sleep_hold_dis();
+    const bool woken = esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED && s_rtc.magic == RTC_MAGIC;
+    s_rtc.magic = 0;
+    if (!woken) {
+        return false;
+    }
+    RelayTarget latched;
+    memcpy(latched.state, s_rtc.latched, sizeof(latched.state));
+    _tuner.restoreLatched(latched, GapLength(s_rtc.gap));
+    const uint64_t sleptMs = rtcTimeMs() - s_rtc.sleptAtMs;
+    _policy.restoreTotals(s_rtc.totals, uint32_t(sleptMs));
+    publish();
+    DEBUG_PRINTF("PowerManager: Woke from deep sleep after %u s, relay state restored.\n", (unsigned)(sleptMs / 1000));
+    return true;
+}
+
+void PowerManager::service(uint32_t nowMs)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_configChanged) {
+            _policy.configure(_config);
+            _configChanged = false;
+        }
+    }
+    if (_activity.exchange(false)) {
+        _policy.activity(nowMs);
+    }
+    if (_resuming && _net.pollConnect()) {
+        _resuming = false;
+        _metrics.powerWakeUs.set(int32_t(metricsMicros() - _wakeUs));
+    }
+    const PowerState before = _policy.state();
+    const PowerState now = _policy.update(nowMs, hold());
+    if (now != before) {
+        enter(now, nowMs);
+    }
+    publish();
+}
+
+PowerHold PowerManager::hold() const
+{
+    PowerHold hold;
+    // The configuration AP has to stay up, at full power
+    hold.busy = !_executor.idle() || (WiFi.getMode() & WIFI_AP) != 0;
+    const RigLink link = _rig.config().link;
+    hold.networkNeeded = link == RigLink::Rigctld;
+    hold.lightSleepOnly = link == RigLink::Civ;
+    // Deep sleep would drop an energised monostable relay (calibration, K4)
+    const RelayProfile* profiles = RelayController::profiles();
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        if (profiles[r].kind == RelayKind::Monostable && _relays.state(RelayId(r)) == 1) {
+            hold.lightSleepOnly = true;
+        }
+    }
+    return hold;
+}
+
+void PowerManager::enter(PowerState state, uint32_t nowMs)
+{
+    const PowerConfig& config = _policy.config();
+    DEBUG_PRINTF("PowerManager: %s\n", PowerPolicy::stateName(state));
+    _state.store(uint8_t(state));
+    switch (state) {
+    case PowerState::Active:
+        setCpuFrequencyMhz(config.activeCpuMhz);
+        WiFi.setSleep(WIFI_PS_MIN_MODEM); // the Arduino default
+        break;
+    case PowerState::TunedIdle:
+        WiFi.setSleep(WIFI_PS_MAX_MODEM);
+        setCpuFrequencyMhz(config.idleCpuMhz);
+        break;
+    case PowerState::Dormant:
+        publish();
+        sleep(nowMs);
+        break;
+    default:
+        break;
+    }
+}
+
+void PowerManager::sleep(uint32_t nowMs)
+{
+    // No job may be half way through its pulses when the CPU stops, and none
+    // can start until resume()
+    _executor.suspend();
+    if (!_executor.idle()) {
+        _executor.resume();
+        _policy.activity(nowMs);
+        enter(_policy.update(nowMs, hold()), nowMs);
+        return;
+    }
+    const PowerConfig& config = _policy.config();
+    if (_policy.sleepMode() == SleepMode::Deep) {
+        deepSleep(); // does not return
+    }
+    const bool civ = _rig.config().link == RigLink::Civ;
+    _net.radioOff();
+    gpio_wakeup_enable(gpio_num_t(WIFI_RESET_BUTTON_PIN), GPIO_INTR_LOW_LEVEL);
+    if (civ) {
+        gpio_wakeup_enable(gpio_num_t(CIV_RX_PIN), GPIO_INTR_LOW_LEVEL); // idle high; a start bit wakes
+    }
+    esp_sleep_enable_gpio_wakeup();
+    if (config.wakeEveryMs != 0) {
+        esp_sleep_enable_timer_wakeup(uint64_t(config.wakeEveryMs) * 1000);
+    }
+    DEBUG_PRINTLN("PowerManager: Light sleep.");
+    esp_light_sleep_start();
+
+    _wakeUs = metricsMicros();
+    const esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    gpio_wakeup_disable(gpio_num_t(WIFI_RESET_BUTTON_PIN));
+    if (civ) {
+        gpio_wakeup_disable(gpio_num_t(CIV_RX_PIN));
+    }
+    _executor.resume();
+    DEBUG_PRINTF("PowerManager: Woke (%s).\n", cause == ESP_SLEEP_WAKEUP_TIMER ? "timer" : "pin");
+    // The follower polls the rig again by itself; a VFO change becomes a job
+    _resuming = _net.radioOn();
+    const uint32_t wokeMs = millis();
+    _policy.activity(wokeMs);
+    enter(_policy.update(wokeMs, hold()), wokeMs);
+}
+
+void PowerManager::deepSleep()
+{
+    s_rtc.magic = RTC_MAGIC;
+    memcpy(s_rtc.latched, _relays.state().state, sizeof(s_rtc.latched));
+    s_rtc.gap = uint8_t(_tuner.gapLength());
+    s_rtc.totals = _policy.totals();
+    s_rtc.sleptAtMs = rtcTimeMs();
+    _net.radioOff();
+    forEachCoilPin([](gpio_num_t pin) { gpio_hold_en(pin); });
+    gpio_deep_sleep_hold_en();
+    rtc_gpio_pullup_en(gpio_num_t(WIFI_RESET_BUTTON_PIN));
+    rtc_gpio_pulldown_dis(gpio_num_t(WIFI_RESET_BUTTON_PIN));
+    esp_sleep_enable_ext0_wakeup(gpio_num_t(WIFI_RESET_BUTTON_PIN), 0);
+    if (_policy.config().wakeEveryMs != 0) {
+        esp_sleep_enable_timer_wakeup(uint64_t(_policy.config().wakeEveryMs) * 1000);
+    }
+    DEBUG_PRINTLN("PowerManager: Deep sleep.");
+    esp_deep_sleep_start();
+}
+
+void PowerManager::publish()
+{
+    const PowerTotals& totals = _policy.totals();
+    _metrics.powerState.set(int32_t(_policy.state()));
+    for (size_t i = 0; i < size_t(PowerState::Count); i++) {
+        _metrics.powerStateMs[i].set(uint32_t(totals.ms[i]));
+        _metrics.powerEnergyMj[i].set(uint32_t(totals.mj[i]));
+        _metrics.powerEntries[i].set(totals.entries[i]);
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _totals = totals;
+}
+
+void PowerManager::configure(const PowerConfig& config)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _config = config;
+    _configChanged = true;
+}
+
+PowerConfig PowerManager::config() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _config;
+}
+
+PowerTotals PowerManager::totals() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _totals;
+}
+
+bool PowerManager::loadConfig()
+{
+    nvs_handle_t handle;
+    if (nvs_open(POWER_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    PowerConfig config;
+    size_t size = sizeof(config);
+    const bool ok = nvs_get_blob(handle, POWER_NVS_KEY, &config, &size) == ESP_OK && size == sizeof(config);
+    nvs_close(handle);
+    if (ok) {
+        configure(config);
+    }
+    return ok;
+}
+
+bool PowerManager::saveConfig() const
+{
+    const PowerConfig config = this->config();
+    nvs_handle_t handle;
+    if (nvs_open(POWER_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    const bool ok = nvs_set_blob(handle, POWER_NVS_KEY, &config, sizeof(config)) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
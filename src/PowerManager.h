@@ -0,0 +1,77 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include "PowerPolicy.h"
+
+class GAPTuner;
+class NetworkMgr;
+class RelayController;
+class RelayExecutor;
+class RigFollower;
+class TunerMetrics;
+
+// Runs PowerPolicy on the board. Once tuned, the latching relays hold the
+// match with no DC, so the controller can step down: TUNED-IDLE clocks the
+// CPU down and puts WiFi in modem sleep, DORMANT switches WiFi off and
+// sleeps until the wake pin (the WiFi reset button, GPIO1), a CI-V byte when
+// following the rig over CI-V, or the optional wake timer.
+//
+// Light sleep resumes in service() and reconnects WiFi from the cached AP
+// and lease. Deep sleep reboots; the latched relay positions, gap length
+// and power totals kept in RTC memory are restored by restoreAfterSleep(),
+// so nothing is pulsed again and the UI still knows the relays.
+class PowerManager {
+public:
+    PowerManager(NetworkMgr& net, RelayExecutor& executor, GAPTuner& tuner, RelayController& relays,
+                 RigFollower& rig, TunerMetrics& metrics);
+
+    // Right after applyDefaultState(): true if this boot is a wake from deep
+    // sleep and the relay state was restored
+    bool restoreAfterSleep();
+    // This boot was woken by the wake pin, which is also the WiFi reset
+    // button: the reset check must not run
+    static bool wokenByButton();
+
+    // From any task: a request or relay job, back to ACTIVE
+    void activity() { _activity.store(true); }
+    // From loop(): applies state changes; sleeps here while DORMANT
+    void service(uint32_t nowMs);
+
+    void configure(const PowerConfig& config);
+    PowerConfig config() const;
+    PowerState state() const { return PowerState(_state.load()); }
+    // Time and estimated energy per state, as of the last service()
+    PowerTotals totals() const;
+    // Settings kept in NVS across restarts
+    bool loadConfig();
+    bool saveConfig() const;
+
+private:
+    PowerHold hold() const;
+    void enter(PowerState state, uint32_t nowMs);
+    void sleep(uint32_t nowMs);
+    void deepSleep();
+    void publish();
+
+    NetworkMgr&          _net;
+    RelayExecutor&       _executor;
+    GAPTuner&            _tuner;
+    RelayController&     _relays;
+    RigFollower&         _rig;
+    TunerMetrics&        _metrics;
+
+    mutable std::mutex   _lock;       // _config, _configChanged, _totals
+    PowerConfig          _config;     // as last configured, applied by service()
+    bool                 _configChanged;
+    PowerTotals          _totals;
+    std::atomic<bool>    _activity;
+    std::atomic<uint8_t> _state;
+    PowerPolicy          _policy;     // loop() task only
+    bool                 _resuming;   // WiFi reconnecting after a light sleep
+    uint32_t             _wakeUs;
+};
+
+#endif // POWER_MANAGER_H
@@ -1,49 +1,208 @@
 #include "RelayController.h"
 #include "DebugUtils.h" // For DEBUG_PRINTF, DEBUG_PRINTLN
+#include "TunerMetrics.h"
 #include <stdio.h>      // For snprintf
 
-RelayController::RelayController() {
-    // Constructor body, if needed
+// Every LC bank coil line, for pin setup
+static const pin_t s_bankCoils[] = {
+    RELAY_KML1_SET, RELAY_KML1_RESET, RELAY_KML2_SET, RELAY_KML2_RESET,
+    RELAY_KML3_SET, RELAY_KML3_RESET, RELAY_KML4_SET, RELAY_KML4_RESET,
+    RELAY_KMC1_SET, RELAY_KMC1_RESET, RELAY_KMC2_SET, RELAY_KMC2_RESET,
+    RELAY_KMC3_SET, RELAY_KMC3_RESET, RELAY_KMC4_SET, RELAY_KMC4_RESET
+};
+
+// Timing and coil current per relay, indexed by RelayId. Latching relays
+// need a pulse of circa 50 ms (docs/circuit_description.md); signal relays
+// are given their operate time plus bounce.
+static const RelayProfile s_profiles[] = {
+    {"K1",   RelayKind::Monostable, RELAY_K1, 0, 10, 0, 40},
+    {"K2",   RelayKind::Monostable, RELAY_K2, 0, 10, 0, 40},
+    {"K3",   RelayKind::Monostable, RELAY_K3, 0, 10, 0, 40},
+    {"K4",   RelayKind::Monostable, RELAY_K4, 0, 10, 0, 40},
+    {"K5",   RelayKind::Monostable, RELAY_K5, 0, 10, 0, 40},
+    {"K6",   RelayKind::Monostable, RELAY_K6, 0, 10, 0, 40},
+    {"K7",   RelayKind::Monostable, RELAY_K7, 0, 10, 0, 40},
+    {"K8",   RelayKind::Bipolar,    0, 0, 0, 50, 60},
+    {"K9",   RelayKind::Bipolar,    0, 0, 0, 50, 60},
+    {"LK99", RelayKind::Monopolar,  RELAY_LK99_SET, RELAY_LK99_RESET, 0, 50, 45},
+    {"KML1", RelayKind::Monopolar,  RELAY_KML1_SET, RELAY_KML1_RESET, 0, 50, 45},
+    {"KML2", RelayKind::Monopolar,  RELAY_KML2_SET, RELAY_KML2_RESET, 0, 50, 45},
+    {"KML3", RelayKind::Monopolar,  RELAY_KML3_SET, RELAY_KML3_RESET, 0, 50, 45},
+    {"KML4", RelayKind::Monopolar,  RELAY_KML4_SET, RELAY_KML4_RESET, 0, 50, 45},
+    {"KMC1", RelayKind::Monopolar,  RELAY_KMC1_SET, RELAY_KMC1_RESET, 0, 50, 45},
+    {"KMC2", RelayKind::Monopolar,  RELAY_KMC2_SET, RELAY_KMC2_RESET, 0, 50, 45},
+    {"KMC3", RelayKind::Monopolar,  RELAY_KMC3_SET, RELAY_KMC3_RESET, 0, 50, 45},
+    {"KMC4", RelayKind::Monopolar,  RELAY_KMC4_SET, RELAY_KMC4_RESET, 0, 50, 45},
+};
+static_assert(sizeof(s_profiles) / sizeof(s_profiles[0]) == size_t(RelayId::Count), "relay profiles vs RelayId");
+
+static const BipolarDrive s_gapDrive = {uint8_t(RelayId::K7), {uint8_t(RelayId::K5), uint8_t(RelayId::K6)}};
+
+RelayController::RelayController(RelayHal& hal) :
+    _hal(hal), _scheduler(s_profiles, size_t(RelayId::Count), s_gapDrive, RELAY_COIL_BUDGET_MA),
+    _lastPlan(), _lastSaved(0), _totalSaved(0), _metrics(nullptr), _rfApplied(0) {
 }
 
+const RelayProfile* RelayController::profiles() { return s_profiles; }
+const BipolarDrive& RelayController::bipolarDrive() { return s_gapDrive; }
+
 void RelayController::initializePins() {
     DEBUG_PRINTLN("RelayController: Initializing relay pins as OUTPUT...");
-    pinMode(RELAY_K1, OUTPUT); pinMode(RELAY_K2, OUTPUT); pinMode(RELAY_K3, OUTPUT);
-    pinMode(RELAY_K4, OUTPUT); pinMode(RELAY_K5, OUTPUT); pinMode(RELAY_K6, OUTPUT);
-    pinMode(RELAY_K7, OUTPUT); 
-    pinMode(RELAY_LK99_SET, OUTPUT); pinMode(RELAY_LK99_RESET, OUTPUT);
+    _state.clear(); // nothing known until written
+    _hal.pinMode(RELAY_K1, OUTPUT); _hal.pinMode(RELAY_K2, OUTPUT); _hal.pinMode(RELAY_K3, OUTPUT);
+    _hal.pinMode(RELAY_K4, OUTPUT); _hal.pinMode(RELAY_K5, OUTPUT); _hal.pinMode(RELAY_K6, OUTPUT);
+    _hal.pinMode(RELAY_K7, OUTPUT);
+    _hal.pinMode(RELAY_LK99_SET, OUTPUT); _hal.pinMode(RELAY_LK99_RESET, OUTPUT);
+    for (pin_t pin : s_bankCoils) {
+        _hal.pinMode(pin, OUTPUT);
+    }
     // boost current output to 3.3v load selection latching relay
-    gpio_set_drive_capability((gpio_num_t)RELAY_LK99_SET, GPIO_DRIVE_CAP_3);
-    gpio_set_drive_capability((gpio_num_t)RELAY_LK99_RESET, GPIO_DRIVE_CAP_3);
+    _hal.setDriveCapability(RELAY_LK99_SET, GPIO_DRIVE_CAP_3);
+    _hal.setDriveCapability(RELAY_LK99_RESET, GPIO_DRIVE_CAP_3);
+
+}
+
+void RelayController::applyMask(const GpioMask& mask) {
+    DEBUG_PRINTF("  RelayController: GPIO set %08X %08X, clear %08X %08X; banks set %04X, clear %04X\n",
+                 (unsigned)mask.set[0], (unsigned)mask.set[1], (unsigned)mask.clear[0], (unsigned)mask.clear[1],
+                 (unsigned)mask.set[2], (unsigned)mask.clear[2]);
+    _hal.writeMask(mask);
+    addMask(_state, mask);
+}
+
+void RelayController::addMask(RelayTarget& target, const GpioMask& mask) {
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        const RelayProfile& p = s_profiles[r];
+        if (p.kind != RelayKind::Monostable) continue;
+        if (mask.sets(p.pin)) target.set(r, true);
+        if (mask.clears(p.pin)) target.set(r, false);
+    }
+}
+
+void RelayController::forgetLatched() {
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        if (s_profiles[r].kind != RelayKind::Monostable) _state.state[r] = -1;
+    }
+}
 
+void RelayController::restoreLatched(const RelayTarget& latched) {
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        if (s_profiles[r].kind != RelayKind::Monostable) _state.state[r] = latched.state[r];
+    }
 }
 
-String RelayController::applyActions(const pinValue_t actions[], size_t count) {
-    String details = ""; char buffer[100]; const size_t bufferSize = sizeof(buffer);
-    DEBUG_PRINTF("  RelayController: Applying %zu pin actions:\n", count);
-    for (size_t i = 0; i < count; i++) {
-        const char* relayName = getRelayName(actions[i].pin);
-        const char* stateStr = actions[i].value == HIGH ? "HIGH" : "LOW";
-        DEBUG_PRINTF("     - %s (pin %d) -> %s\n", relayName, actions[i].pin, stateStr);
-        snprintf(buffer, bufferSize, " - %s (%d) set to %s\n", relayName, actions[i].pin, stateStr);
-        details += buffer;
-        digitalWrite(actions[i].pin, actions[i].value);
+bool RelayController::applyTarget(const RelayTarget& target) {
+    if (!_scheduler.plan(target, _state, rfApplied(), _lastPlan)) {
+        DEBUG_PRINTF("RelayController: no relay plan: %s\n", _lastPlan.error);
+        return false;
     }
-    if (details.endsWith("\n")) {
-        details.remove(details.length() - 1);
+    const uint32_t t0 = _hal.micros();
+    runPlan(_lastPlan);
+    if (_metrics != nullptr) recordMetrics(_lastPlan, _hal.micros() - t0);
+    commit(target, _lastPlan);
+    _lastSaved = _lastPlan.skipped;
+    _totalSaved += _lastPlan.skipped;
+    return true;
+}
+
+// Monostable relays end at the last level the plan wrote to them (the gap
+// drive relays are dropped again), latching relays where the target put them
+void RelayController::commit(const RelayTarget& target, const RelayPlan& plan) {
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        if (s_profiles[r].kind != RelayKind::Monostable) {
+            if (target.state[r] >= 0) _state.state[r] = target.state[r];
+            continue;
+        }
+        for (size_t i = 0; i < plan.count; i++) {
+            if (plan.steps[i].pin == s_profiles[r].pin) _state.state[r] = int8_t(plan.steps[i].level);
+        }
     }
-    return details;
 }
 
-String RelayController::pulse(const pin_t relay) {
-    char buffer[100]; const size_t bufferSize = sizeof(buffer);
-    const char* relayName = getRelayName(relay);
-    DEBUG_PRINTF("pulsing relay %s\n", relayName);
-    digitalWrite(relay, HIGH);
-    delay(100);
-    digitalWrite(relay, LOW);
-    snprintf(buffer, bufferSize, "\n - %s Pulsed", relayName);
-    return String(buffer);
+// Every write in a plan changes its coil. Latching relays count one
+// actuation per pulse; the gap relays one per K5+K6 drive pulse.
+void RelayController::recordMetrics(const RelayPlan& plan, uint32_t elapsedUs) {
+    _metrics->relayPlan.observe(elapsedUs);
+    const uint8_t drivePin = s_profiles[s_gapDrive.drive[0]].pin;
+    for (size_t i = 0; i < plan.count; i++) {
+        const RelayStep& step = plan.steps[i];
+        uint16_t pulseMs = 0;
+        for (size_t j = i + 1; step.level == HIGH && j < plan.count; j++) {
+            if (plan.steps[j].pin == step.pin) { pulseMs = uint16_t(plan.steps[j].atMs - step.atMs); break; }
+        }
+        for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+            const RelayProfile& p = s_profiles[r];
+            bool actuated = false;
+            switch (p.kind) {
+            case RelayKind::Monostable:
+                actuated = step.pin == p.pin;
+                break;
+            case RelayKind::Monopolar:
+                actuated = step.level == HIGH && (step.pin == p.pin || step.pin == p.resetPin);
+                break;
+            case RelayKind::Bipolar:
+                actuated = step.level == HIGH && step.pin == drivePin;
+                break;
+            }
+            if (actuated) {
+                _metrics->relayActuations[r].add();
+                if (p.kind != RelayKind::Monostable) _metrics->relayPulseMs[r].add(pulseMs);
+            }
+        }
+    }
+}
+
+void RelayController::runPlan(const RelayPlan& plan) {
+    DEBUG_PRINTF("RelayController: relay plan %u ms, peak %u mA, %u steps, %u saved\n", (unsigned)plan.totalMs,
+                 (unsigned)plan.peakMa, (unsigned)plan.count, (unsigned)plan.skipped);
+    uint32_t now = 0;
+    for (size_t i = 0; i < plan.count;) {
+        const uint16_t at = plan.steps[i].atMs;
+        GpioMask mask;
+        for (; i < plan.count && plan.steps[i].atMs == at; i++) {
+            mask.add(plan.steps[i].pin, plan.steps[i].level);
+        }
+        if (at > now) {
+            _hal.delayMs(at - now);
+            now = at;
+        }
+        _hal.writeMask(mask);
+    }
+    if (plan.totalMs > now) {
+        _hal.delayMs(plan.totalMs - now);
+    }
+}
+
+// Each coil with the interval it was energised, or its new level for coils
+// that are held
+size_t RelayController::describePlan(const RelayPlan& plan, char* out, size_t size) {
+    if (size == 0) return 0;
+    out[0] = '\0';
+    if (plan.error != nullptr) return 0;
+    size_t len = 0;
+    auto append = [&](int n) { if (n > 0) len = len + size_t(n) < size ? len + size_t(n) : size - 1; };
+    append(snprintf(out, size, "Relay plan: %u ms, peak %u mA, %u actuations saved",
+                    (unsigned)plan.totalMs, (unsigned)plan.peakMa, (unsigned)plan.skipped));
+    for (size_t i = 0; i < plan.count; i++) {
+        const RelayStep& step = plan.steps[i];
+        const char* name = getRelayName((pin_t)step.pin);
+        size_t off = plan.count;
+        for (size_t j = i + 1; step.level == HIGH && j < plan.count; j++) {
+            if (plan.steps[j].pin == step.pin) { off = j; break; }
+        }
+        bool pulseEnd = false;
+        for (size_t j = 0; step.level == LOW && j < i; j++) {
+            pulseEnd = pulseEnd || (plan.steps[j].pin == step.pin && plan.steps[j].level == HIGH);
+        }
+        if (off < plan.count) {
+            append(snprintf(out + len, size - len, "\n %3u-%3u ms %s", (unsigned)step.atMs,
+                            (unsigned)plan.steps[off].atMs, name));
+        } else if (!pulseEnd) {
+            append(snprintf(out + len, size - len, "\n %3u     ms %s %s", (unsigned)step.atMs, name,
+                            step.level == HIGH ? "HIGH" : "LOW"));
+        }
+    }
+    return len;
 }
 
 const char* RelayController::getRelayName(pin_t pin_val) {
@@ -54,6 +213,14 @@ const char* RelayController::getRelayName(pin_t pin_val) {
         case RELAY_K7: return "RELAY_K7";
         case RELAY_LK99_SET: return "RELAY_LK99_SET"; 
         case RELAY_LK99_RESET: return "RELAY_LK99_RESET";
+        case RELAY_KML1_SET: return "RELAY_KML1_SET"; case RELAY_KML1_RESET: return "RELAY_KML1_RESET";
+        case RELAY_KML2_SET: return "RELAY_KML2_SET"; case RELAY_KML2_RESET: return "RELAY_KML2_RESET";
+        case RELAY_KML3_SET: return "RELAY_KML3_SET"; case RELAY_KML3_RESET: return "RELAY_KML3_RESET";
+        case RELAY_KML4_SET: return "RELAY_KML4_SET"; case RELAY_KML4_RESET: return "RELAY_KML4_RESET";
+        case RELAY_KMC1_SET: return "RELAY_KMC1_SET"; case RELAY_KMC1_RESET: return "RELAY_KMC1_RESET";
+        case RELAY_KMC2_SET: return "RELAY_KMC2_SET"; case RELAY_KMC2_RESET: return "RELAY_KMC2_RESET";
+        case RELAY_KMC3_SET: return "RELAY_KMC3_SET"; case RELAY_KMC3_RESET: return "RELAY_KMC3_RESET";
+        case RELAY_KMC4_SET: return "RELAY_KMC4_SET"; case RELAY_KMC4_RESET: return "RELAY_KMC4_RESET";
         default: return "UNKNOWN_PIN";
     }
 }
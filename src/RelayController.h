@@ -1,13 +1,20 @@
 #ifndef RELAY_CONTROLLER_H
 #define RELAY_CONTROLLER_H
 
-#include <Arduino.h>    // For String, HIGH, LOW, OUTPUT, pinMode, digitalWrite, uint8_t
+#include <Arduino.h>    // For HIGH, LOW, OUTPUT, uint8_t
+#include <atomic>
 #include "driver/gpio.h" // For GPIO_NUM_x
+#include "RelayHal.h"
+#include "RelaySchedule.h"
 
 // --- Pin Definitions and Structs ---
 // Defines the mapping of logical relay names to physical ESP32 GPIO pins.
 // NOTE: The specific function of each relay (e.g., what K1 controls)
 // should be verified against the hardware schematic.
+// The N16R8 module leaves few GPIOs free: 26-37 are its flash and PSRAM,
+// 19/20 USB, 43/44 the debug UART, 38/48 the board's RGB LED, 39-42 JTAG
+// and 0/45/46 strapping pins. The 16 LC bank coil lines are therefore the
+// outputs of a 74HC595 pair (EXPANDER_PIN_BASE, see Esp32RelayHal.h).
 typedef enum pins {
     RELAY_K1 = GPIO_NUM_14, // part of Tuning Network / Calibration
     RELAY_K2 = GPIO_NUM_13, // part of Tuning Network / Calibration
@@ -17,7 +24,16 @@ typedef enum pins {
     RELAY_K6 = GPIO_NUM_8,  // part of Antenna Length / Tuning Network
     RELAY_K7 = GPIO_NUM_18, //  part of Antenna Length / Tuning Network
     RELAY_LK99_SET = GPIO_NUM_10, // Latching relay SET coil 
-    RELAY_LK99_RESET = GPIO_NUM_9  // Latching relay RESET coil
+    RELAY_LK99_RESET = GPIO_NUM_9, // Latching relay RESET coil
+    // LC_Network bank relays (monopolar latching, see TunerDesign.h), on the shift register
+    RELAY_KML1_SET = EXPANDER_PIN_BASE + 0,  RELAY_KML1_RESET = EXPANDER_PIN_BASE + 1,  // inductor chain, bit 0
+    RELAY_KML2_SET = EXPANDER_PIN_BASE + 2,  RELAY_KML2_RESET = EXPANDER_PIN_BASE + 3,  // inductor chain, bit 1
+    RELAY_KML3_SET = EXPANDER_PIN_BASE + 4,  RELAY_KML3_RESET = EXPANDER_PIN_BASE + 5,  // inductor chain, bit 2
+    RELAY_KML4_SET = EXPANDER_PIN_BASE + 6,  RELAY_KML4_RESET = EXPANDER_PIN_BASE + 7,  // inductor chain, bit 3
+    RELAY_KMC1_SET = EXPANDER_PIN_BASE + 8,  RELAY_KMC1_RESET = EXPANDER_PIN_BASE + 9,  // capacitor bank, bit 0
+    RELAY_KMC2_SET = EXPANDER_PIN_BASE + 10, RELAY_KMC2_RESET = EXPANDER_PIN_BASE + 11, // capacitor bank, bit 1
+    RELAY_KMC3_SET = EXPANDER_PIN_BASE + 12, RELAY_KMC3_RESET = EXPANDER_PIN_BASE + 13, // capacitor bank, bit 2
+    RELAY_KMC4_SET = EXPANDER_PIN_BASE + 14, RELAY_KMC4_RESET = EXPANDER_PIN_BASE + 15  // capacitor bank, bit 3
 } pin_t;
 
 typedef struct PinValueStruct {
@@ -25,15 +41,102 @@ typedef struct PinValueStruct {
     uint8_t value;
 } pinValue_t;
 
+// Scheduler index of each relay (RelayController::profiles()). K8/K9 are the
+// gap relays (KB1/KB2 in docs/circuit_description.md), pulsed through K5+K6
+// with the polarity from K7; LK99 is KM1.
+enum class RelayId : uint8_t {
+    K1, K2, K3, K4, K5, K6, K7, K8, K9, LK99,
+    KML1, KML2, KML3, KML4, KMC1, KMC2, KMC3, KMC4,
+    Count
+};
+
+// Who is putting RF on the relays; each holds its own interlock bit
+enum class RfSource : uint8_t {
+    Rig, // PTT reported by the rig follower
+    Vna  // a calibration sweep in progress
+};
+
+class TunerMetrics;
+
+// Coil current the bias-tee DC feed can supply to relay coils at once
+static constexpr uint16_t RELAY_COIL_BUDGET_MA = 400;
+
 class RelayController {
 public:
-    RelayController();
+    explicit RelayController(RelayHal& hal);
     void initializePins();
-    String applyActions(const pinValue_t actions[], size_t count);
-    String pulse(const pin_t relay);
+    // Relay actuations and plan durations are recorded here if attached
+    void attachMetrics(TunerMetrics* metrics) { _metrics = metrics; }
+
+    // GPIO set/clear masks of a fixed action table, built at compile time
+    template<size_t N>
+    static constexpr GpioMask maskOf(const pinValue_t (&actions)[N]) {
+        GpioMask mask;
+        for (size_t i = 0; i < N; i++) {
+            mask.add(actions[i].pin, actions[i].value);
+        }
+        return mask;
+    }
+    // Writes all pins of a mask at once (no settle wait, no scheduling)
+    void applyMask(const GpioMask& mask);
+
+    // Monostable levels of a mask into a scheduler target
+    static void addMask(RelayTarget& target, const GpioMask& mask);
+    static void setTarget(RelayTarget& target, RelayId relay, bool on) { target.set(size_t(relay), on); }
+    // Plans the shortest schedule from the present state to target within the
+    // coil budget and runs it, skipping relays already in position; false
+    // if there is no legal plan (lastPlan().error says why)
+    bool applyTarget(const RelayTarget& target);
+    // Runs the timed writes of a plan, each instant as one mask write, and
+    // waits until the contacts have settled
+    void runPlan(const RelayPlan& plan);
+
+    // The plan run (or refused) by the last applyTarget(), and its text:
+    // duration, peak current and when each coil was energised. Only built on
+    // request; returns the length written to out.
+    const RelayPlan& lastPlan() const { return _lastPlan; }
+    static size_t describePlan(const RelayPlan& plan, char* out, size_t size);
+
+    // Shadow register: last written level of each monostable relay and the
+    // latched position of each latching one, -1 where unknown
+    int8_t state(RelayId relay) const { return _state.state[size_t(relay)]; }
+    const RelayTarget& state() const { return _state; }
+    // Forgets the latched positions, so the next target pulses every latching
+    // relay it names (e.g. after a supply dropout or a mechanical shock)
+    void forgetLatched();
+    // Latched positions known from before a deep sleep (RTC memory) instead
+    // of unknown; nothing is switched
+    void restoreLatched(const RelayTarget& latched);
+    // Actuations skipped by the last applyTarget() and since power-up
+    uint8_t lastSaved() const { return _lastSaved; }
+    uint32_t totalSaved() const { return _totalSaved; }
+    // Transmitter keyed (e.g. PTT reported by the rig) or a VNA sweeping:
+    // applyTarget() refuses to switch until every source has cleared it
+    void setRfApplied(bool applied) { setRfApplied(RfSource::Rig, applied); }
+    void setRfApplied(RfSource source, bool applied) {
+        const uint8_t bit = uint8_t(1u << uint8_t(source));
+        if (applied) _rfApplied.fetch_or(bit);
+        else _rfApplied.fetch_and(uint8_t(~bit));
+    }
+    bool rfApplied() const { return _rfApplied.load() != 0; }
+
+    RelayScheduler& scheduler() { return _scheduler; }
+    static const RelayProfile* profiles();
+    static const BipolarDrive& bipolarDrive();
+    static const char* getRelayName(pin_t pin_val);
 
 private:
-    const char* getRelayName(pin_t pin_val);
+    void commit(const RelayTarget& target, const RelayPlan& plan);
+    void recordMetrics(const RelayPlan& plan, uint32_t elapsedUs);
+
+    RelayHal&      _hal;
+    RelayScheduler _scheduler;
+    RelayTarget    _state;
+    RelayPlan      _lastPlan;
+    uint8_t        _lastSaved;
+    uint32_t       _totalSaved;
+    TunerMetrics*  _metrics;
+    std::atomic<uint8_t> _rfApplied; // bit per RfSource
 };
 
 #endif // RELAY_CONTROLLER_H
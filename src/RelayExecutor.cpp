@@ -0,0 +1,254 @@
+#include "RelayExecutor.h"
+#include <stdio.h>
+#include <string.h>
+#include "GAPTuner.h"
+#include "TunerMetrics.h"
+#include "TunerState.h"
+#include "DebugUtils.h" // For DEBUG_PRINTF
+
+RelayExecutor::RelayExecutor(GAPTuner& tuner) :
+    _tuner(tuner), _nextId(1), _pending(0), _metrics(nullptr), _state(nullptr)
+#if defined(ESP_PLATFORM)
+    , _task(nullptr)
+#else
+    , _wakePending(false), _stop(false)
+#endif
+{
+    for (std::atomic<uint32_t>& latest : _latest) {
+        latest.store(0);
+    }
+    memset(_status, 0, sizeof(_status));
+}
+
+RelayExecutor::~RelayExecutor()
+{
+    end();
+}
+
+#if defined(ESP_PLATFORM)
+
+bool RelayExecutor::begin()
+{
+    if (_task != nullptr) {
+        return true;
+    }
+    // Core 1 with the Arduino loop; AsyncTCP keeps serving requests meanwhile
+    return xTaskCreatePinnedToCore(taskEntry, "relays", 6144, this, tskIDLE_PRIORITY + 2, &_task, 1) == pdPASS;
+}
+
+void RelayExecutor::end()
+{
+    // The task runs for the lifetime of the firmware
+}
+
+void RelayExecutor::taskEntry(void* arg)
+{
+    RelayExecutor* self = static_cast<RelayExecutor*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->run();
+    }
+}
+
+void RelayExecutor::wake()
+{
+    if (_task != nullptr) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+#else
+
+bool RelayExecutor::begin()
+{
+    if (_thread.joinable()) {
+        return true;
+    }
+    _stop = false;
+    _thread = std::thread([this] {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(_wakeLock);
+                _wakeCond.wait(lock, [this] { return _wakePending || _stop; });
+                if (_stop) return;
+                _wakePending = false;
+            }
+            run();
+        }
+    });
+    return true;
+}
+
+void RelayExecutor::end()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_wakeLock);
+        _stop = true;
+    }
+    _wakeCond.notify_one();
+    _thread.join();
+}
+
+void RelayExecutor::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(_wakeLock);
+        _wakePending = true;
+    }
+    _wakeCond.notify_one();
+}
+
+#endif
+
+uint32_t RelayExecutor::submitButton(int buttonId)
+{
+    return submit(Job{0, buttonId, 0, groupOf(buttonId), metricsMicros(), false});
+}
+
+uint32_t RelayExecutor::submitTune(uint32_t freqHz)
+{
+    return submit(Job{0, 0, freqHz, RelayGroup::TuningNetwork, metricsMicros(), false});
+}
+
+uint32_t RelayExecutor::submitFollow(uint32_t freqHz, uint32_t changedUs)
+{
+    return submit(Job{0, 0, freqHz, RelayGroup::TuningNetwork, changedUs, true});
+}
+
+// The group's latest id is published before the push, so the task can never
+// see a job newer than the one recorded for its group.
+uint32_t RelayExecutor::submit(const Job& request)
+{
+    Job job = request;
+    job.id = _nextId.fetch_add(1);
+    if (job.id == 0) {
+        job.id = _nextId.fetch_add(1); // 0 means "no job"
+    }
+    std::atomic<uint32_t>& latest = _latest[size_t(job.group)];
+    const uint32_t previous = latest.exchange(job.id);
+    setState(job.id, RelayJobState::Queued);
+    _pending.fetch_add(1);
+    if (!_queue.push(job)) {
+        uint32_t expected = job.id;
+        latest.compare_exchange_strong(expected, previous);
+        _pending.fetch_sub(1);
+        setState(job.id, RelayJobState::Unknown);
+        DEBUG_PRINTLN("RelayExecutor: queue full, request dropped");
+        return 0;
+    }
+    wake();
+    return job.id;
+}
+
+void RelayExecutor::run()
+{
+    Job job;
+    while (_queue.pop(job)) {
+        if (_latest[size_t(job.group)].load() != job.id) {
+            setState(job.id, RelayJobState::Superseded);
+        } else {
+            execute(job);
+        }
+        _pending.fetch_sub(1);
+    }
+}
+
+void RelayExecutor::execute(const Job& job)
+{
+    setState(job.id, RelayJobState::Running);
+    if (_state != nullptr) _state->jobStarted(job.id);
+    char message[sizeof(RelayJobStatus::message)] = "";
+    char details[sizeof(RelayJobStatus::details)] = "";
+    bool failed;
+    {
+        std::lock_guard<std::mutex> lock(_runLock);
+        if (job.buttonId != 0) {
+            failed = !_tuner.processButtonAction(job.buttonId, message, sizeof(message));
+        } else {
+            failed = !_tuner.tuneToFrequency(job.freqHz, message, sizeof(message));
+        }
+        // Described after the relays have settled, for /job
+        if (!failed) _tuner.describeLastAction(details, sizeof(details));
+    }
+    setState(job.id, failed ? RelayJobState::Failed : RelayJobState::Done, message, details);
+    // After the status, so a client told by the push can fetch /job at once
+    if (_state != nullptr) {
+        _state->jobFinished(job.id, failed, message, _tuner, job.buttonId, job.freqHz);
+    }
+    if (_metrics != nullptr) {
+        if (failed) {
+            _metrics->jobsFailed.add();
+        } else {
+            MetricHistogram& qsy = job.buttonId != 0 ? _metrics->qsyButton : (job.follow ? _metrics->qsyFollow : _metrics->qsyTune);
+            qsy.observe(metricsMicros() - job.submittedUs);
+            if (job.buttonId == 0 && _tuner.lastSolveUs() != 0) {
+                _metrics->solve.observe(_tuner.lastSolveUs());
+            }
+        }
+    }
+    DEBUG_PRINTF("RelayExecutor: job %u %s\n", (unsigned)job.id, failed ? "failed" : "done");
+}
+
+void RelayExecutor::setState(uint32_t id, RelayJobState state, const char* message, const char* details)
+{
+    std::lock_guard<std::mutex> lock(_statusLock);
+    RelayJobStatus& slot = _status[id % STATUS_SLOTS];
+    if (slot.id != id) {
+        slot.id = id;
+        slot.message[0] = '\0';
+        slot.details[0] = '\0';
+    }
+    slot.state = state;
+    if (message != nullptr) {
+        snprintf(slot.message, sizeof(slot.message), "%s", message);
+    }
+    if (details != nullptr) {
+        snprintf(slot.details, sizeof(slot.details), "%s", details);
+    }
+}
+
+bool RelayExecutor::status(uint32_t id, RelayJobStatus& out)
+{
+    std::lock_guard<std::mutex> lock(_statusLock);
+    const RelayJobStatus& slot = _status[id % STATUS_SLOTS];
+    if (id == 0 || slot.id != id || slot.state == RelayJobState::Unknown) {
+        return false;
+    }
+    out = slot;
+    return true;
+}
+
+bool RelayExecutor::idle() const
+{
+    return _pending.load() == 0;
+}
+
+RelayGroup RelayExecutor::groupOf(int buttonId)
+{
+    switch (static_cast<GAPTuner::ButtonID>(buttonId)) {
+    case GAPTuner::ButtonID::ANTENNA_SHORT:
+    case GAPTuner::ButtonID::ANTENNA_LONG:
+        return RelayGroup::AntennaLength;
+    case GAPTuner::ButtonID::CAL_OPEN:
+    case GAPTuner::ButtonID::CAL_SHORT:
+    case GAPTuner::ButtonID::CAL_LOAD:
+        return RelayGroup::Calibration;
+    default:
+        return RelayGroup::TuningNetwork;
+    }
+}
+
+const char* RelayExecutor::stateName(RelayJobState state)
+{
+    switch (state) {
+    case RelayJobState::Queued:     return "queued";
+    case RelayJobState::Running:    return "running";
+    case RelayJobState::Done:       return "done";
+    case RelayJobState::Failed:     return "failed";
+    case RelayJobState::Superseded: return "superseded";
+    default:                        return "unknown";
+    }
+}
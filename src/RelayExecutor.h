@@ -0,0 +1,124 @@
+#ifndef RELAY_EXECUTOR_H
+#define RELAY_EXECUTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include "BoundedQueue.h"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <condition_variable>
+#include <thread>
+#endif
+
+class GAPTuner;
+class TunerMetrics;
+class TunerState;
+
+enum class RelayJobState : uint8_t {
+    Unknown,    // never submitted, or its status slot was reused
+    Queued,
+    Running,
+    Done,
+    Failed,
+    Superseded  // a later request for the same relay group replaced it
+};
+
+// Relays a job drives; a queued job is dropped when a later one for the same
+// group is submitted before it starts
+enum class RelayGroup : uint8_t {
+    AntennaLength, // ANTENNA_SHORT / LONG (K5..K9)
+    TuningNetwork, // TUNING_* and band-plan tuning (LK99, LC banks)
+    Calibration,   // CAL_* (K1..K4)
+    Count
+};
+
+struct RelayJobStatus {
+    uint32_t      id;
+    RelayJobState state;
+    char          message[96];  // GAPTuner outMessage
+    char          details[512]; // relay action report, truncated if longer
+};
+
+// Runs GAPTuner relay sequences on a dedicated task (a std::thread in the
+// host build), so HTTP handlers only queue a job and return its id. The
+// sequences themselves still use the relay pulse timings, but the waits put
+// only this task to sleep instead of stalling the AsyncTCP task.
+class RelayExecutor {
+public:
+    static constexpr size_t QUEUE_SIZE   = 8;
+    static constexpr size_t STATUS_SLOTS = 16; // status kept for the last 16 jobs
+
+    explicit RelayExecutor(GAPTuner& tuner);
+    ~RelayExecutor();
+
+    bool begin();
+    void end(); // host build: drains nothing, stops and joins the thread
+    // QSY times (submission to settled relays) are recorded here if attached
+    void attachMetrics(TunerMetrics* metrics) { _metrics = metrics; }
+    // Job starts and results, with the relays they left, are published here
+    void attachState(TunerState* state) { _state = state; }
+
+    // Job id, or 0 if the queue is full
+    uint32_t submitButton(int buttonId);
+    uint32_t submitTune(uint32_t freqHz);
+    // Band-plan tuning asked for by the rig follower; QSY time counts from
+    // changedUs (metricsMicros() when the VFO moved)
+    uint32_t submitFollow(uint32_t freqHz, uint32_t changedUs);
+
+    // false if the id is unknown or its status has been overwritten
+    bool status(uint32_t id, RelayJobStatus& out);
+    // true when nothing is queued or running
+    bool idle() const;
+
+    // Hold off jobs while something they read changes (e.g. the tune table
+    // during an upload); waits for a running job to finish
+    void suspend() { _runLock.lock(); }
+    void resume() { _runLock.unlock(); }
+
+    static RelayGroup groupOf(int buttonId);
+    static const char* stateName(RelayJobState state);
+
+private:
+    struct Job {
+        uint32_t   id;
+        int        buttonId; // 0 for a tune job
+        uint32_t   freqHz;
+        RelayGroup group;
+        uint32_t   submittedUs; // metricsMicros()
+        bool       follow;      // from the rig follower
+    };
+
+    uint32_t submit(const Job& job);
+    void     run();
+    void     execute(const Job& job);
+    void     setState(uint32_t id, RelayJobState state, const char* message = nullptr, const char* details = nullptr);
+    void     wake();
+
+    GAPTuner&                      _tuner;
+    BoundedQueue<Job, QUEUE_SIZE>  _queue;
+    std::atomic<uint32_t>          _nextId;
+    std::atomic<uint32_t>          _latest[size_t(RelayGroup::Count)];
+    std::atomic<uint32_t>          _pending; // submitted and not yet finished
+    std::mutex                     _runLock;
+    std::mutex                     _statusLock;
+    RelayJobStatus                 _status[STATUS_SLOTS];
+    TunerMetrics*                  _metrics;
+    TunerState*                    _state;
+#if defined(ESP_PLATFORM)
+    static void taskEntry(void* arg);
+    TaskHandle_t                   _task;
+#else
+    std::thread                    _thread;
+    std::mutex                     _wakeLock;
+    std::condition_variable        _wakeCond;
+    bool                           _wakePending;
+    bool                           _stop;
+#endif
+};
+
+#endif // RELAY_EXECUTOR_H
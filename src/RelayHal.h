@@ -0,0 +1,58 @@
+#ifndef RELAY_HAL_H
+#define RELAY_HAL_H
+
+#include <stdint.h>
+
+// Pins 0..48 are the ESP32-S3's own GPIOs; from EXPANDER_PIN_BASE up they
+// are the outputs of the shift register that drives the LC bank coils
+// (Esp32RelayHal.h), output Qn as EXPANDER_PIN_BASE + n.
+static constexpr uint8_t EXPANDER_PIN_BASE = 64;
+static constexpr uint8_t MASK_PINS         = 96;
+
+// Levels for several pins to be written at once, laid out as the ESP32
+// GPIO W1TS / W1TC register pairs: bit (pin % 32) of word (pin / 32), with
+// the shift register outputs as word 2.
+// constexpr, so fixed relay tables become masks at compile time.
+struct GpioMask {
+    uint32_t set[3];
+    uint32_t clear[3];
+
+    constexpr GpioMask() : set{0, 0, 0}, clear{0, 0, 0} {}
+
+    // A later level for the same pin replaces an earlier one
+    constexpr void add(uint8_t pin, uint8_t level) {
+        const uint32_t bit = 1u << (pin & 31);
+        set[pin >> 5] = level ? set[pin >> 5] | bit : set[pin >> 5] & ~bit;
+        clear[pin >> 5] = level ? clear[pin >> 5] & ~bit : clear[pin >> 5] | bit;
+    }
+    constexpr bool sets(uint8_t pin) const { return (set[pin >> 5] >> (pin & 31)) & 1u; }
+    constexpr bool clears(uint8_t pin) const { return (clear[pin >> 5] >> (pin & 31)) & 1u; }
+    constexpr bool empty() const { return (set[0] | set[1] | set[2] | clear[0] | clear[1] | clear[2]) == 0; }
+};
+
+// Hardware access used by RelayController: GPIO outputs and time. The
+// firmware uses Esp32RelayHal; the host build uses SimRelayHal
+// (src/host/SimRelayHal.h), which models the relay coils and contacts on a
+// virtual clock so relay sequences can be timed and checked without a board.
+class RelayHal {
+public:
+    virtual ~RelayHal() {}
+    virtual void pinMode(uint8_t pin, uint8_t mode) = 0;
+    virtual void digitalWrite(uint8_t pin, uint8_t value) = 0;
+    // All cleared pins, then all set pins; one write per pin unless the
+    // hardware can do better
+    virtual void writeMask(const GpioMask& mask) {
+        for (uint8_t pin = 0; pin < MASK_PINS; pin++) {
+            if (mask.clears(pin)) digitalWrite(pin, 0);
+        }
+        for (uint8_t pin = 0; pin < MASK_PINS; pin++) {
+            if (mask.sets(pin)) digitalWrite(pin, 1);
+        }
+    }
+    // 0 (weakest) .. 3 (strongest), as gpio_drive_cap_t
+    virtual void setDriveCapability(uint8_t pin, uint8_t level) = 0;
+    virtual void delayMs(uint32_t ms) = 0;
+    virtual uint32_t micros() = 0;
+};
+
+#endif // RELAY_HAL_H
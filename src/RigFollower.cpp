@@ -0,0 +1,399 @@
+#include "RigFollower.h"
+#include <stdio.h>
+#include <string.h>
+#include "GAPTuner.h"
+#include "Metrics.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "DebugUtils.h" // For DEBUG_PRINTF
+
+#if defined(ESP_PLATFORM)
+#include <Arduino.h> // For millis
+#include <nvs.h>
+
+#define RIG_NVS_NAMESPACE "rig"
+#define RIG_NVS_KEY       "config"
+#else
+#include <chrono>
+#endif
+
+RigFollower::RigFollower(RelayExecutor& executor, GAPTuner& tuner, RelayController& relays, RigTransport& tcp,
+                         RigTransport& serial) :
+    _executor(executor), _tuner(tuner), _relays(relays), _tcp(tcp), _serial(serial), _transport(nullptr),
+    _linkLost(false), _generation(0), _policy(FollowConfig(), segmentOf, this), _rxLen(0), _job(0), _stop(false)
+#if defined(ESP_PLATFORM)
+    , _task(nullptr)
+#endif
+{
+    memset(&_status, 0, sizeof(_status));
+}
+
+RigFollower::~RigFollower()
+{
+    end();
+}
+
+#if defined(ESP_PLATFORM)
+
+bool RigFollower::begin()
+{
+    if (_task != nullptr) {
+        return true;
+    }
+    // Core 0 next to WiFi; the relay task keeps core 1
+    return xTaskCreatePinnedToCore(taskEntry, "rig", 4096, this, tskIDLE_PRIORITY + 1, &_task, 0) == pdPASS;
+}
+
+void RigFollower::end()
+{
+    // The task runs for the lifetime of the firmware
+}
+
+void RigFollower::taskEntry(void* arg)
+{
+    static_cast<RigFollower*>(arg)->run();
+    vTaskDelete(nullptr);
+}
+
+void RigFollower::sleepMs(uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+uint32_t RigFollower::nowMs()
+{
+    return millis();
+}
+
+bool RigFollower::loadConfig()
+{
+    nvs_handle_t handle;
+    if (nvs_open(RIG_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    RigConfig config;
+    size_t size = sizeof(config);
+    const bool ok = nvs_get_blob(handle, RIG_NVS_KEY, &config, &size) == ESP_OK && size == sizeof(config);
+    nvs_close(handle);
+    if (ok) {
+        config.host[sizeof(config.host) - 1] = '\0';
+        configure(config);
+    }
+    return ok;
+}
+
+bool RigFollower::saveConfig() const
+{
+    const RigConfig config = this->config();
+    nvs_handle_t handle;
+    if (nvs_open(RIG_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    const bool ok = nvs_set_blob(handle, RIG_NVS_KEY, &config, sizeof(config)) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
+
+#else
+
+bool RigFollower::begin()
+{
+    if (_thread.joinable()) {
+        return true;
+    }
+    _stop = false;
+    _thread = std::thread([this] { run(); });
+    return true;
+}
+
+void RigFollower::end()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+    _stop = true;
+    _thread.join();
+    closeLink();
+}
+
+void RigFollower::sleepMs(uint32_t ms)
+{
+    // In slices, so end() does not wait out a reconnect delay
+    for (uint32_t left = ms; left > 0 && !_stop; left -= left < 10 ? left : 10) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(left < 10 ? left : 10));
+    }
+}
+
+uint32_t RigFollower::nowMs()
+{
+    static const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+}
+
+bool RigFollower::loadConfig()
+{
+    return false;
+}
+
+bool RigFollower::saveConfig() const
+{
+    return false;
+}
+
+#endif
+
+void RigFollower::configure(const RigConfig& config)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _config = config;
+    _config.host[sizeof(_config.host) - 1] = '\0';
+    _generation++;
+}
+
+RigConfig RigFollower::config() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _config;
+}
+
+RigStatus RigFollower::status() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _status;
+}
+
+const char* RigFollower::linkName(RigLink link)
+{
+    switch (link) {
+    case RigLink::Rigctld: return "rigctld";
+    case RigLink::Civ:     return "civ";
+    default:               return "off";
+    }
+}
+
+void RigFollower::run()
+{
+    uint32_t generation = 0;
+    RigConfig config;
+    uint32_t missed = 0;
+    bool first = true;
+    while (!_stop) {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if (first || generation != _generation) {
+                first = false;
+                generation = _generation;
+                config = _config;
+                _status = RigStatus{config.link, false, 0, false, 0, _status.retunes, _status.linkErrors};
+            }
+        }
+        if (_transport != nullptr && (config.link == RigLink::Off || generation != _generation)) {
+            closeLink();
+        }
+        if (config.link == RigLink::Off) {
+            sleepMs(500);
+            continue;
+        }
+        if (_transport == nullptr) {
+            if (!openLink(config)) {
+                sleepMs(RECONNECT_MS);
+                continue;
+            }
+            _policy = FollowPolicy(config.follow, segmentOf, this);
+            missed = 0;
+        }
+        const uint32_t t0 = nowMs();
+        uint32_t freqHz = 0;
+        bool ptt = false;
+        if (poll(config, freqHz, ptt)) {
+            missed = 0;
+            follow(freqHz, ptt);
+        } else {
+            std::lock_guard<std::mutex> lock(_lock);
+            _status.linkErrors++;
+            if (++missed >= MAX_MISSED_POLLS) {
+                DEBUG_PRINTF("RigFollower: %s not answering, reconnecting\n", linkName(config.link));
+                _linkLost = true;
+            }
+        }
+        if (_linkLost) {
+            closeLink();
+            sleepMs(RECONNECT_MS);
+            continue;
+        }
+        const uint32_t spent = nowMs() - t0;
+        sleepMs(spent < config.pollMs ? config.pollMs - spent : 1);
+    }
+}
+
+bool RigFollower::openLink(const RigConfig& config)
+{
+    RigTransport& transport = config.link == RigLink::Civ ? _serial : _tcp;
+    if (!transport.open(config)) {
+        std::lock_guard<std::mutex> lock(_lock);
+        _status.linkErrors++;
+        return false;
+    }
+    _transport = &transport;
+    _linkLost = false;
+    _rxLen = 0;
+    _civ = CivDecoder(config.civAddress);
+    _job = 0;
+    std::lock_guard<std::mutex> lock(_lock);
+    _status.connected = true;
+    DEBUG_PRINTF("RigFollower: %s link open\n", linkName(config.link));
+    return true;
+}
+
+// Without a link nobody reports PTT any more; the interlock is released
+void RigFollower::closeLink()
+{
+    if (_transport != nullptr) {
+        _transport->close();
+        _transport = nullptr;
+    }
+    _relays.setRfApplied(false);
+    std::lock_guard<std::mutex> lock(_lock);
+    _status.connected = false;
+    _status.ptt = false;
+}
+
+bool RigFollower::poll(const RigConfig& config, uint32_t& freqHz, bool& ptt)
+{
+    return config.link == RigLink::Civ ? pollCiv(config, freqHz, ptt) : pollRigctld(freqHz, ptt);
+}
+
+// "f" and "t" in one write; the replies come back in order
+bool RigFollower::pollRigctld(uint32_t& freqHz, bool& ptt)
+{
+    static const uint8_t request[] = {'f', '\n', 't', '\n'};
+    if (!_transport->write(request, sizeof(request))) {
+        _linkLost = true;
+        return false;
+    }
+    char line[40];
+    if (!readLine(line, sizeof(line)) || !rigctldParseFrequency(line, freqHz)) {
+        return false;
+    }
+    // Rigs that cannot report PTT answer "RPRT -11"; they are taken as receiving
+    if (!readLine(line, sizeof(line))) {
+        return false;
+    }
+    if (!rigctldParsePtt(line, ptt)) {
+        ptt = false;
+    }
+    return true;
+}
+
+bool RigFollower::readLine(char* line, size_t size)
+{
+    const uint32_t t0 = nowMs();
+    for (;;) {
+        char* nl = static_cast<char*>(memchr(_rx, '\n', _rxLen));
+        if (nl != nullptr) {
+            const size_t n = size_t(nl - _rx);
+            const size_t copy = n < size - 1 ? n : size - 1;
+            memcpy(line, _rx, copy);
+            line[copy] = '\0';
+            memmove(_rx, nl + 1, _rxLen - n - 1);
+            _rxLen -= n + 1;
+            return true;
+        }
+        if (_rxLen == sizeof(_rx)) {
+            _rxLen = 0; // no line this long in rigctld replies
+        }
+        const uint32_t elapsed = nowMs() - t0;
+        if (elapsed >= REPLY_TIMEOUT_MS) {
+            return false;
+        }
+        const int n = _transport->read(reinterpret_cast<uint8_t*>(_rx) + _rxLen, sizeof(_rx) - _rxLen,
+                                       REPLY_TIMEOUT_MS - elapsed);
+        if (n < 0) {
+            _linkLost = true;
+            return false;
+        }
+        _rxLen += size_t(n);
+    }
+}
+
+// Asks for frequency and PTT; transceive frames that arrive meanwhile count
+// too. Rigs without the PTT command answer NG and are taken as receiving.
+bool RigFollower::pollCiv(const RigConfig& config, uint32_t& freqHz, bool& ptt)
+{
+    uint8_t frame[CIV_MAX_FRAME];
+    const uint8_t rig = config.civAddress;
+    size_t n = civReadFrequency(rig, frame, sizeof(frame));
+    n += civReadPtt(rig, frame + n, sizeof(frame) - n);
+    if (!_transport->write(frame, n)) {
+        _linkLost = true;
+        return false;
+    }
+    bool gotFreq = false, gotPtt = false;
+    ptt = false;
+    const uint32_t t0 = nowMs();
+    uint8_t buffer[32];
+    while (!(gotFreq && gotPtt)) {
+        const uint32_t elapsed = nowMs() - t0;
+        if (elapsed >= REPLY_TIMEOUT_MS) break;
+        const int got = _transport->read(buffer, sizeof(buffer), REPLY_TIMEOUT_MS - elapsed);
+        if (got < 0) {
+            _linkLost = true;
+            return false;
+        }
+        for (int i = 0; i < got; i++) {
+            CivEvent event;
+            if (!_civ.feed(buffer[i], event)) continue;
+            if (event.kind == CivEvent::Frequency) {
+                freqHz = event.freqHz;
+                gotFreq = true;
+            } else {
+                ptt = event.ptt;
+                gotPtt = true;
+            }
+        }
+    }
+    return gotFreq;
+}
+
+void RigFollower::follow(uint32_t freqHz, bool ptt)
+{
+    _relays.setRfApplied(ptt);
+    // A failed retune (e.g. PTT keyed between poll and job) is asked for again
+    if (_job != 0) {
+        RelayJobStatus job;
+        if (!_executor.status(_job, job) || job.state == RelayJobState::Failed) {
+            _policy.reset();
+            _job = 0;
+        } else if (job.state != RelayJobState::Queued && job.state != RelayJobState::Running) {
+            _job = 0;
+        }
+    }
+    // The executor lock also holds off tune table swaps while segments are looked up
+    _executor.suspend();
+    const uint32_t now = nowMs();
+    const uint32_t retuneHz = _policy.update(now, freqHz, ptt);
+    _executor.resume();
+    uint32_t job = 0;
+    if (retuneHz != 0) {
+        const uint32_t changedUs = metricsMicros() - (now - _policy.changedAtMs()) * 1000u;
+        job = _executor.submitFollow(retuneHz, changedUs);
+        if (job != 0) {
+            _job = job;
+        } else {
+            _policy.reset(); // queue full: try again next poll
+        }
+        DEBUG_PRINTF("RigFollower: VFO %u Hz, retune job %u\n", (unsigned)freqHz, (unsigned)job);
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _status.freqHz = freqHz;
+    _status.ptt = ptt;
+    if (job != 0) {
+        _status.tunedHz = retuneHz;
+        _status.retunes++;
+    }
+}
+
+uint32_t RigFollower::segmentOf(void* context, uint32_t freqHz)
+{
+    return static_cast<RigFollower*>(context)->_tuner.tuneSegment(freqHz);
+}
@@ -0,0 +1,102 @@
+#ifndef RIG_FOLLOWER_H
+#define RIG_FOLLOWER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include "FollowPolicy.h"
+#include "RigProtocol.h"
+#include "RigTransport.h"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+class GAPTuner;
+class RelayController;
+class RelayExecutor;
+
+struct RigStatus {
+    RigLink  link;
+    bool     connected;
+    uint32_t freqHz;     // last VFO frequency, 0 if not known yet
+    bool     ptt;
+    uint32_t tunedHz;    // frequency of the last retune asked for
+    uint32_t retunes;
+    uint32_t linkErrors; // dropped connections and unanswered polls
+};
+
+// CAT follow mode: polls the rig's VFO frequency and PTT over rigctld or
+// CI-V on its own task (a std::thread in the host build) and queues a
+// band-plan retune on the RelayExecutor when FollowPolicy says the VFO has
+// settled in a new segment. While the rig reports PTT the RelayController
+// is told RF is applied, so no relay job (retune or button) can switch.
+class RigFollower {
+public:
+    static constexpr uint32_t RECONNECT_MS     = 2000;
+    static constexpr uint32_t REPLY_TIMEOUT_MS = 500;
+    static constexpr uint32_t MAX_MISSED_POLLS = 3; // then the link is reopened
+
+    RigFollower(RelayExecutor& executor, GAPTuner& tuner, RelayController& relays, RigTransport& tcp,
+                RigTransport& serial);
+    ~RigFollower();
+
+    bool begin();
+    void end(); // host build: stops and joins the thread
+
+    // Applied at the next poll; the link is reopened with the new settings
+    void configure(const RigConfig& config);
+    RigConfig config() const;
+    RigStatus status() const;
+    // Settings kept in NVS across restarts (ESP only)
+    bool loadConfig();
+    bool saveConfig() const;
+
+    static const char* linkName(RigLink link);
+
+private:
+    void run();
+    bool openLink(const RigConfig& config);
+    void closeLink();
+    bool poll(const RigConfig& config, uint32_t& freqHz, bool& ptt);
+    bool pollRigctld(uint32_t& freqHz, bool& ptt);
+    bool pollCiv(const RigConfig& config, uint32_t& freqHz, bool& ptt);
+    bool readLine(char* line, size_t size);
+    void follow(uint32_t freqHz, bool ptt);
+    void sleepMs(uint32_t ms);
+
+    static uint32_t nowMs();
+    static uint32_t segmentOf(void* context, uint32_t freqHz);
+
+    RelayExecutor&     _executor;
+    GAPTuner&          _tuner;
+    RelayController&   _relays;
+    RigTransport&      _tcp;
+    RigTransport&      _serial;
+    RigTransport*      _transport; // the open one, or nullptr
+    bool               _linkLost;  // closed by the peer or not answering
+
+    mutable std::mutex _lock;      // _config, _generation, _status
+    RigConfig          _config;
+    uint32_t           _generation;
+    RigStatus          _status;
+
+    FollowPolicy       _policy;
+    CivDecoder         _civ;
+    char               _rx[96];    // rigctld reply bytes not yet consumed
+    size_t             _rxLen;
+    uint32_t           _job;       // last retune job, until it has finished
+    std::atomic<bool>  _stop;
+#if defined(ESP_PLATFORM)
+    static void taskEntry(void* arg);
+    TaskHandle_t       _task;
+#else
+    std::thread        _thread;
+#endif
+};
+
+#endif // RIG_FOLLOWER_H
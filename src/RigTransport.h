@@ -0,0 +1,38 @@
+#ifndef RIG_TRANSPORT_H
+#define RIG_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FollowPolicy.h"
+#include "RigProtocol.h"
+
+enum class RigLink : uint8_t {
+    Off,
+    Rigctld, // hamlib rigctld over TCP
+    Civ      // Icom CI-V on the rig UART
+};
+
+struct RigConfig {
+    RigLink      link       = RigLink::Off;
+    char         host[64]   = "";           // rigctld host name or address
+    uint16_t     port       = RIGCTLD_PORT;
+    uint32_t     baud       = 19200;        // CI-V
+    uint8_t      civAddress = 0;            // CI-V address of the rig, 0: any
+    uint16_t     pollMs     = 50;           // frequency/PTT poll interval
+    FollowConfig follow;
+};
+
+// Byte stream to the rig: a TCP connection to rigctld or the CI-V UART.
+// Implemented by Esp32RigTransport.h on the tuner and by the host tools.
+class RigTransport {
+public:
+    virtual ~RigTransport() {}
+
+    virtual bool open(const RigConfig& config) = 0;
+    virtual void close() = 0;
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+    // Bytes read within timeoutMs, 0 on timeout, -1 once the link is gone
+    virtual int read(uint8_t* out, size_t size, uint32_t timeoutMs) = 0;
+};
+
+#endif // RIG_TRANSPORT_H
@@ -0,0 +1,139 @@
+#include "TunerMetrics.h"
+
+#if defined(ESP_PLATFORM)
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+// Bucket bounds in microseconds
+static const uint32_t s_httpBoundsUs[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+static const uint32_t s_planBoundsUs[] = {
+    5000, 10000, 25000, 50000, 75000, 100000, 150000, 250000, 500000
+};
+static const uint32_t s_solveBoundsUs[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000
+};
+static const uint32_t s_qsyBoundsUs[] = {
+    10000, 25000, 50000, 75000, 100000, 150000, 250000, 500000, 1000000, 2500000
+};
+#define BOUNDS(b) b, sizeof(b) / sizeof(b[0])
+
+static const char* const s_routeLabels[] = {
+    "route=\"/\"", "route=\"static\"", "route=\"/button\"", "route=\"/tune\"", "route=\"/job\"",
+    "route=\"/wifi-status\"", "route=\"/metrics\"", "route=\"/rig\"", "route=\"/power\"", "route=\"/cal\"",
+    "route=\"/api/v1\"", "route=\"not_found\""
+};
+static_assert(sizeof(s_routeLabels) / sizeof(s_routeLabels[0]) == size_t(HttpRoute::Count), "route labels vs HttpRoute");
+
+static const char* const s_relayLabels[] = {
+    "relay=\"K1\"", "relay=\"K2\"", "relay=\"K3\"", "relay=\"K4\"", "relay=\"K5\"", "relay=\"K6\"",
+    "relay=\"K7\"", "relay=\"K8\"", "relay=\"K9\"", "relay=\"LK99\"",
+    "relay=\"KML1\"", "relay=\"KML2\"", "relay=\"KML3\"", "relay=\"KML4\"",
+    "relay=\"KMC1\"", "relay=\"KMC2\"", "relay=\"KMC3\"", "relay=\"KMC4\""
+};
+static_assert(sizeof(s_relayLabels) / sizeof(s_relayLabels[0]) == size_t(RelayId::Count), "relay labels vs RelayId");
+
+static const char* const s_bootPhaseLabels[] = {
+    "phase=\"nvs\"", "phase=\"reset_button\"", "phase=\"relays\"", "phase=\"partitions\"", "phase=\"rig\"",
+    "phase=\"wifi\"", "phase=\"server\""
+};
+static_assert(sizeof(s_bootPhaseLabels) / sizeof(s_bootPhaseLabels[0]) == size_t(BootPhase::Count), "phase labels vs BootPhase");
+static const char* const s_powerStateLabels[] = {"state=\"active\"", "state=\"tuned_idle\"", "state=\"dormant\""};
+static_assert(sizeof(s_powerStateLabels) / sizeof(s_powerStateLabels[0]) == size_t(PowerState::Count), "state labels vs PowerState");
+static const char* const s_arenaLabels[] = {"arena=\"datasets\"", "arena=\"cal\""};
+static_assert(sizeof(s_arenaLabels) / sizeof(s_arenaLabels[0]) == size_t(ArenaId::Count), "arena labels vs ArenaId");
+static const char* const s_bootPhaseNames[] = {"nvs", "reset_button", "relays", "partitions", "rig", "wifi", "server"};
+static_assert(sizeof(s_bootPhaseNames) / sizeof(s_bootPhaseNames[0]) == size_t(BootPhase::Count), "phase names vs BootPhase");
+
+TunerMetrics::TunerMetrics() :
+    httpLatency{{BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)},
+                {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)},
+                {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)}, {BOUNDS(s_httpBoundsUs)},
+                {BOUNDS(s_httpBoundsUs)}},
+    relayPlan(BOUNDS(s_planBoundsUs)),
+    qsyButton(BOUNDS(s_qsyBoundsUs)),
+    qsyTune(BOUNDS(s_qsyBoundsUs)),
+    qsyFollow(BOUNDS(s_qsyBoundsUs)),
+    solve(BOUNDS(s_solveBoundsUs))
+{
+    static_assert(size_t(HttpRoute::Count) == 12, "one httpLatency initializer per route");
+    MetricsRegistry& r = _registry;
+    for (size_t i = 0; i < size_t(HttpRoute::Count); i++) {
+        r.add("gaptuner_http_request_duration_seconds", "Time spent in the HTTP handler.", s_routeLabels[i], httpLatency[i]);
+    }
+    for (size_t i = 0; i < size_t(RelayId::Count); i++) {
+        r.add("gaptuner_relay_actuations_total", "Coil writes that changed a relay.", s_relayLabels[i], relayActuations[i]);
+    }
+    for (size_t i = 0; i < size_t(RelayId::Count); i++) {
+        r.add("gaptuner_relay_pulse_seconds_total", "Summed latching coil pulse time.", s_relayLabels[i], relayPulseMs[i], 1e-3);
+    }
+    r.add("gaptuner_relay_plan_duration_seconds", "Relay plan run time until the contacts settled.", nullptr, relayPlan);
+    r.add("gaptuner_qsy_duration_seconds", "Relay job from request until the relays settled.", "kind=\"button\"", qsyButton);
+    r.add("gaptuner_qsy_duration_seconds", "Relay job from request until the relays settled.", "kind=\"tune\"", qsyTune);
+    r.add("gaptuner_qsy_duration_seconds", "Relay job from request until the relays settled.", "kind=\"follow\"", qsyFollow);
+    r.add("gaptuner_solve_duration_seconds", "Match solved on the device for a QSY outside the tune table.", nullptr, solve);
+    r.add("gaptuner_relay_jobs_failed_total", "Relay jobs that failed.", nullptr, jobsFailed);
+    r.add("gaptuner_heap_free_bytes", "Free internal heap.", nullptr, heapFree);
+    r.add("gaptuner_heap_min_free_bytes", "Lowest free internal heap since boot.", nullptr, heapMinFree);
+    r.add("gaptuner_psram_free_bytes", "Free PSRAM.", nullptr, psramFree);
+    r.add("gaptuner_psram_min_free_bytes", "Lowest free PSRAM since boot.", nullptr, psramMinFree);
+    r.add("gaptuner_async_tcp_stack_free_bytes", "AsyncTCP task stack never used (high-water mark).", nullptr, asyncTcpStackFree);
+    r.add("gaptuner_wifi_rssi_dbm", "WiFi signal strength.", nullptr, wifiRssi);
+    r.add("gaptuner_wifi_reconnects_total", "WiFi station reconnections since boot.", nullptr, wifiReconnects);
+    r.add("gaptuner_event_clients", "Browsers connected to /events.", nullptr, eventClients);
+    for (size_t i = 0; i < size_t(ArenaId::Count); i++) {
+        r.add("gaptuner_arena_used_bytes", "Bytes allocated from the arena.", s_arenaLabels[i], arenaUsed[i]);
+    }
+    for (size_t i = 0; i < size_t(ArenaId::Count); i++) {
+        r.add("gaptuner_arena_high_water_bytes", "Most bytes ever allocated from the arena.", s_arenaLabels[i],
+              arenaHighWater[i]);
+    }
+    for (size_t i = 0; i < size_t(ArenaId::Count); i++) {
+        r.add("gaptuner_arena_failures_total", "Allocations the arena could not fit.", s_arenaLabels[i], arenaFailures[i]);
+    }
+    for (size_t i = 0; i < size_t(BootPhase::Count); i++) {
+        r.add("gaptuner_boot_phase_seconds", "Start-up phase duration.", s_bootPhaseLabels[i], bootPhaseUs[i], 1e-6);
+    }
+    r.add("gaptuner_boot_ready_seconds", "App start until the web server was up.", nullptr, bootReadyUs, 1e-6);
+    r.add("gaptuner_wifi_fast_connect", "1 if the cached AP and lease connected without a scan.", nullptr, wifiFastConnect);
+    r.add("gaptuner_power_state", "0 active, 1 tuned-idle, 2 dormant.", nullptr, powerState);
+    for (size_t i = 0; i < size_t(PowerState::Count); i++) {
+        r.add("gaptuner_power_state_seconds_total", "Time spent in the power state.", s_powerStateLabels[i], powerStateMs[i], 1e-3);
+    }
+    for (size_t i = 0; i < size_t(PowerState::Count); i++) {
+        r.add("gaptuner_power_energy_joules_total", "Estimated energy used in the power state.", s_powerStateLabels[i],
+              powerEnergyMj[i], 1e-3);
+    }
+    for (size_t i = 0; i < size_t(PowerState::Count); i++) {
+        r.add("gaptuner_power_state_entries_total", "Times the power state was entered.", s_powerStateLabels[i], powerEntries[i]);
+    }
+    r.add("gaptuner_power_wake_seconds", "Last wake from dormant until WiFi was connected.", nullptr, powerWakeUs, 1e-6);
+}
+
+const char* TunerMetrics::bootPhaseName(BootPhase phase)
+{
+    return s_bootPhaseNames[size_t(phase)];
+}
+
+void TunerMetrics::sampleSystem()
+{
+#if defined(ESP_PLATFORM)
+    heapFree.set(int32_t(heap_caps_get_free_size(MALLOC_CAP_INTERNAL)));
+    heapMinFree.set(int32_t(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL)));
+    psramFree.set(int32_t(heap_caps_get_free_size(MALLOC_CAP_SPIRAM)));
+    psramMinFree.set(int32_t(heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM)));
+    TaskHandle_t asyncTcp = xTaskGetHandle("async_tcp");
+    if (asyncTcp != nullptr) {
+        asyncTcpStackFree.set(int32_t(uxTaskGetStackHighWaterMark(asyncTcp))); // bytes on ESP-IDF
+    }
+#endif
+    for (size_t i = 0; i < size_t(ArenaId::Count); i++) {
+        if (_arenas[i] == nullptr) continue;
+        arenaUsed[i].set(int32_t(_arenas[i]->used()));
+        arenaHighWater[i].set(int32_t(_arenas[i]->highWater()));
+        arenaFailures[i].set(_arenas[i]->failures());
+    }
+}
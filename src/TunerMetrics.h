@@ -0,0 +1,84 @@
+#ifndef TUNER_METRICS_H
+#define TUNER_METRICS_H
+
+#include "Arena.h"
+#include "Metrics.h"
+#include "RelayController.h" // For RelayId
+#include "PowerPolicy.h"     // For PowerState
+
+// Routes timed by WebServerManager
+enum class HttpRoute : uint8_t {
+    Root, Asset, Button, Tune, Job, WiFiStatus, Metrics, Rig, Power, Cal, Api, NotFound,
+    Count
+};
+
+// Start-up steps timed by setup(); WiFi associates while the relays and
+// partitions are set up, so its phase overlaps theirs
+enum class BootPhase : uint8_t {
+    Nvs, ResetButton, Relays, Partitions, Rig, WiFi, Server,
+    Count
+};
+
+// Arenas of MemoryArenas, watched by sampleSystem()
+enum class ArenaId : uint8_t {
+    Datasets, Cal,
+    Count
+};
+
+// Everything /metrics exports. The firmware keeps one instance (main.cpp)
+// and hands it to the parts that record into it.
+class TunerMetrics {
+public:
+    TunerMetrics();
+
+    // Per WebServerManager route: time spent in the handler
+    MetricHistogram httpLatency[size_t(HttpRoute::Count)];
+    // Per relay: coil actuations and summed latching pulse time
+    MetricCounter   relayActuations[size_t(RelayId::Count)];
+    MetricCounter   relayPulseMs[size_t(RelayId::Count)];
+    // One relay plan, from the first coil write until the contacts settled
+    MetricHistogram relayPlan;
+    // Relay job from submission (HTTP request) until the relays settled
+    MetricHistogram qsyButton;
+    MetricHistogram qsyTune;
+    MetricHistogram qsyFollow; // from the rig's VFO change
+    // Match solved on the device, for a QSY the tune table does not cover
+    MetricHistogram solve;
+    MetricCounter   jobsFailed;
+
+    // Sampled by sampleSystem() before each scrape
+    MetricGauge     heapFree;
+    MetricGauge     heapMinFree;
+    MetricGauge     psramFree;
+    MetricGauge     psramMinFree;
+    MetricGauge     asyncTcpStackFree; // bytes never used by the AsyncTCP task
+    MetricGauge     wifiRssi;
+    MetricCounter   wifiReconnects;
+    MetricGauge     eventClients; // browsers connected to /events
+    MetricGauge     arenaUsed[size_t(ArenaId::Count)];
+    MetricGauge     arenaHighWater[size_t(ArenaId::Count)];
+    MetricCounter   arenaFailures[size_t(ArenaId::Count)]; // allocations refused
+    // Set once by setup(): each phase, and app start until HTTP is served
+    MetricGauge     bootPhaseUs[size_t(BootPhase::Count)];
+    MetricGauge     bootReadyUs;
+    MetricGauge     wifiFastConnect; // 1: cached AP and lease were enough
+    // Set by PowerManager from PowerPolicy::totals()
+    MetricGauge     powerState;      // PowerState
+    MetricCounter   powerStateMs[size_t(PowerState::Count)];
+    MetricCounter   powerEnergyMj[size_t(PowerState::Count)]; // estimated
+    MetricCounter   powerEntries[size_t(PowerState::Count)];
+    MetricGauge     powerWakeUs;     // last wake from DORMANT until WiFi was back
+
+    // Heap, PSRAM and task stack figures (ESP32 only) and watched arenas
+    void sampleSystem();
+    void watchArena(ArenaId id, const Arena* arena) { _arenas[size_t(id)] = arena; }
+
+    const MetricsRegistry& registry() const { return _registry; }
+    static const char* bootPhaseName(BootPhase phase);
+
+private:
+    MetricsRegistry _registry;
+    const Arena*    _arenas[size_t(ArenaId::Count)] = {};
+};
+
+#endif // TUNER_METRICS_H
@@ -0,0 +1,154 @@
+#include "TunerState.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GAPTuner.h"
+#include "JsonWriter.h"
+
+TunerState::TunerState() :
+    _listener(nullptr), _context(nullptr)
+{
+    memset(&_state, 0, sizeof(_state));
+    _state.version = 1; // a new client (Last-Event-ID 0) is always stale
+    memset(_state.relays, '?', size_t(RelayId::Count));
+    _state.jobState = RelayJobState::Unknown;
+}
+
+void TunerState::onChange(Listener listener, void* context)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _listener = listener;
+    _context = context;
+}
+
+// Caller holds _lock
+void TunerState::readRelays(const GAPTuner& tuner)
+{
+    const RelayController& relays = tuner.relays();
+    for (size_t i = 0; i < size_t(RelayId::Count); i++) {
+        const int8_t s = relays.state(RelayId(i));
+        _state.relays[i] = s < 0 ? '?' : char('0' + s);
+    }
+    _state.gapKnown = relays.state(RelayId::K8) >= 0 && relays.state(RelayId::K9) >= 0;
+    _state.gap = tuner.gapLength();
+}
+
+void TunerState::relaysChanged(const GAPTuner& tuner)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        readRelays(tuner);
+        _state.version++;
+    }
+    changed();
+}
+
+void TunerState::jobStarted(uint32_t jobId)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _state.jobId = jobId;
+        _state.jobState = RelayJobState::Running;
+        _state.message[0] = '\0';
+        _state.version++;
+    }
+    changed();
+}
+
+void TunerState::jobFinished(uint32_t jobId, bool failed, const char* message, const GAPTuner& tuner, int buttonId,
+                             uint32_t freqHz)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        readRelays(tuner);
+        _state.jobId = jobId;
+        _state.jobState = failed ? RelayJobState::Failed : RelayJobState::Done;
+        snprintf(_state.message, sizeof(_state.message), "%s", message != nullptr ? message : "");
+        if (!failed && buttonId == 0) {
+            _state.button = 0;
+            _state.freqHz = freqHz;
+        } else if (!failed && RelayExecutor::groupOf(buttonId) != RelayGroup::AntennaLength) {
+            _state.button = uint8_t(buttonId);
+            _state.freqHz = 0;
+        }
+        _state.version++;
+    }
+    changed();
+}
+
+void TunerState::linkChanged(bool online, int rssi)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (online == _state.online && abs(rssi - _state.rssi) < RSSI_STEP_DB) {
+            return;
+        }
+        _state.online = online;
+        _state.rssi = int8_t(rssi < -127 ? -127 : (rssi > 0 ? 0 : rssi));
+        _state.version++;
+    }
+    changed();
+}
+
+void TunerState::changed()
+{
+    Listener listener;
+    void* context;
+    uint32_t version;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        listener = _listener;
+        context = _context;
+        version = _state.version;
+    }
+    if (listener != nullptr) {
+        listener(context, version);
+    }
+}
+
+uint32_t TunerState::version() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _state.version;
+}
+
+void TunerState::snapshot(Snapshot& out) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    out = _state;
+}
+
+// {"v":..,"relays":"0110..","gap":"long|short|unknown","button":..,"freq":..,
+//  "job":{"id":..,"state":..,"message":..},"link":{"online":..,"rssi":..}}
+static constexpr char s_stateFormat[] =
+    "{\"v\":%u,\"relays\":\"%s\",\"gap\":\"%s\",\"button\":%u,\"freq\":%u,"
+    "\"job\":{\"id\":%u,\"state\":\"%s\",\"message\":\"%s\"},\"link\":{\"online\":%s,\"rssi\":%d}}";
+// The 10 conversions at their widest: 3 10-digit numbers, the relays, "unknown",
+// a 3-digit button, "superseded", the message escaped 2 bytes a character
+// (jsonEscape into twice its size), "false" and "-127"
+static_assert(sizeof(s_stateFormat) - 10 * 2 + 3 * 10 + size_t(RelayId::Count) + 7 + 3 + 10 +
+                  2 * (sizeof(TunerState::Snapshot::message) - 1) + 5 + 4 <= TunerState::JSON_MAX,
+              "TunerState::JSON_MAX too small for the state");
+
+size_t TunerState::format(char* out, size_t size, uint32_t& version) const
+{
+    Snapshot s;
+    snapshot(s);
+    version = s.version;
+    char message[sizeof(s.message) * 2];
+    jsonEscape(message, sizeof(message), s.message);
+    const char* gap = !s.gapKnown ? "unknown" : (s.gap == GapLength::Long ? "long" : "short");
+    const int n = snprintf(out, size, s_stateFormat,
+        (unsigned)s.version, s.relays, gap, (unsigned)s.button, (unsigned)s.freqHz,
+        (unsigned)s.jobId, RelayExecutor::stateName(s.jobState), message, s.online ? "true" : "false", int(s.rssi));
+    return n > 0 && size_t(n) < size ? size_t(n) : 0;
+}
+
+size_t TunerState::resync(uint32_t lastVersion, char* out, size_t size, uint32_t& version) const
+{
+    version = this->version();
+    if (lastVersion == version) {
+        return 0;
+    }
+    return format(out, size, version);
+}
@@ -0,0 +1,76 @@
+#ifndef TUNER_STATE_H
+#define TUNER_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include "RelayController.h" // For RelayId
+#include "RelayExecutor.h"   // For RelayJobState
+#include "TuneTable.h"       // For GapLength
+
+class GAPTuner;
+
+// What the UI shows, pushed to browsers over /events (server-sent events)
+// instead of being polled. Every change bumps a version number that goes out
+// as the event id; a browser that reconnects sends the last id it saw
+// (Last-Event-ID) and gets the whole state in one message if it is stale.
+//
+// The state is small (150-200 bytes as JSON, JSON_MAX at most), so each
+// event carries all of it and a client never has to merge partial updates.
+class TunerState {
+public:
+    static constexpr int RSSI_STEP_DB = 6; // smaller RSSI moves are not pushed
+    // format() buffer that always fits: every number at full width and a
+    // message that is escaped throughout
+    static constexpr size_t JSON_MAX = 384;
+
+    struct Snapshot {
+        uint32_t      version;
+        char          relays[size_t(RelayId::Count) + 1]; // '0', '1' or '?' (unknown) per RelayId
+        bool          gapKnown;
+        GapLength     gap;
+        uint8_t       button;  // last tuning/calibration button, 0 after a band-plan tune
+        uint32_t      freqHz;  // last band-plan tune, 0 after a button
+        uint32_t      jobId;
+        RelayJobState jobState;
+        char          message[96];
+        bool          online;
+        int8_t        rssi;
+    };
+
+    // Called after each change, outside the lock, from the task that made it
+    typedef void (*Listener)(void* context, uint32_t version);
+
+    TunerState();
+
+    void onChange(Listener listener, void* context);
+
+    // Relay shadow register and gap length, e.g. after the power-up state
+    void relaysChanged(const GAPTuner& tuner);
+    // A relay job started, or finished and left the relays as tuner has them
+    void jobStarted(uint32_t jobId);
+    void jobFinished(uint32_t jobId, bool failed, const char* message, const GAPTuner& tuner, int buttonId, uint32_t freqHz);
+    // WiFi station link; RSSI changes below RSSI_STEP_DB are ignored
+    void linkChanged(bool online, int rssi);
+
+    uint32_t version() const;
+    void snapshot(Snapshot& out) const;
+
+    // Current state as one JSON object; the returned length is 0 if it did
+    // not fit. version receives the version it describes.
+    size_t format(char* out, size_t size, uint32_t& version) const;
+    // For a client that last saw lastVersion: the state if it is stale,
+    // otherwise 0 (nothing to send)
+    size_t resync(uint32_t lastVersion, char* out, size_t size, uint32_t& version) const;
+
+private:
+    void readRelays(const GAPTuner& tuner);
+    void changed();
+
+    mutable std::mutex _lock;
+    Snapshot           _state;
+    Listener           _listener;
+    void*              _context;
+};
+
+#endif // TUNER_STATE_H
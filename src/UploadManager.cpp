@@ -0,0 +1,282 @@
+#include "UploadManager.h"
+#include "DebugUtils.h" // For DEBUG_PRINTLN, DEBUG_PRINTF
+#include "Personality.h" // For PERSONALITY_SUBTYPE
+#include "TuneTable.h"   // For TUNE_TABLE_SUBTYPE
+
+struct UploadTargetInfo {
+    const char* name;
+    const char* partition;
+    uint8_t     subtype;
+    bool        sweep;  // parsed into a sweeps slot rather than copied
+    GapLength   gap;
+};
+
+static const UploadTargetInfo s_targets[] = {
+    {"tunetab",     "tunetab",     TUNE_TABLE_SUBTYPE,  false, GapLength::Long},
+    {"personality", "personality", PERSONALITY_SUBTYPE, false, GapLength::Long},
+    {"sweep-long",  "sweeps",      SWEEP_STORE_SUBTYPE, true,  GapLength::Long},
+    {"sweep-short", "sweeps",      SWEEP_STORE_SUBTYPE, true,  GapLength::Short},
+};
+
+bool PartitionFlash::open(const char* label, uint8_t subtype)
+{
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+    return _part != nullptr;
+}
+
+bool PartitionFlash::flashErase(uint32_t offset, uint32_t len)
+{
+    if (esp_partition_erase_range(_part, offset, len) != ESP_OK) {
+        DEBUG_PRINTF("PartitionFlash: Erase failed at 0x%x\n", offset);
+        return false;
+    }
+    return true;
+}
+
+bool PartitionFlash::flashWrite(uint32_t offset, const void* data, uint32_t len)
+{
+    if (esp_partition_write(_part, offset, data, len) != ESP_OK) {
+        DEBUG_PRINTF("PartitionFlash: Write failed at 0x%x\n", offset);
+        return false;
+    }
+    return true;
+}
+
+bool SweepUploadSink::open(GapLength gap)
+{
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)SWEEP_STORE_SUBTYPE, "sweeps");
+    _base = (uint32_t)gap * SWEEP_SLOT_SIZE;
+    if (_part != nullptr && _part->size < _base + SWEEP_SLOT_SIZE) {
+        _part = nullptr;
+    }
+    return _part != nullptr;
+}
+
+bool SweepUploadSink::write(uint32_t offset, const uint8_t* data, size_t len)
+{
+    if (!_writer.write((const char*)data, len)) {
+        DEBUG_PRINTF("SweepUploadSink: Sweep rejected near line %u\n", (unsigned)_writer.parser().lineCount() + 1);
+        return false;
+    }
+    return true;
+}
+
+bool SweepUploadSink::finish()
+{
+    if (!_writer.finish()) {
+        DEBUG_PRINTLN("SweepUploadSink: Sweep empty, malformed or too long.");
+        return false;
+    }
+    DEBUG_PRINTF("SweepUploadSink: Stored %u points, %u annotations.\n",
+                 (unsigned)_writer.stored(), (unsigned)_writer.parser().annotationCount());
+    return true;
+}
+
+bool SweepUploadSink::flashErase(uint32_t offset, uint32_t len)
+{
+    return esp_partition_erase_range(_part, _base + offset, len) == ESP_OK;
+}
+
+bool SweepUploadSink::flashWrite(uint32_t offset, const void* data, uint32_t len)
+{
+    return esp_partition_write(_part, _base + offset, data, len) == ESP_OK;
+}
+
+UploadManager::UploadManager(AsyncWebServer& srv) :
+    _server(srv), _target(Target::NONE), _activeRequest(nullptr), _rejectReason(nullptr), _flowClient(nullptr),
+    _holding(false) {}
+
+void UploadManager::setupRoutes() {
+    // Whatever the target now holds is mapped again once its upload ends
+    _writer.onDone([this](bool finished) {
+        DEBUG_PRINTF("UploadManager: %s %s\n", targetName(_target), finished ? "written" : "upload ended unfinished");
+        if (_hook) _hook(_target, true);
+    });
+    _writer.onDrained([this]() {
+        std::lock_guard<std::mutex> lock(_flowLock);
+        releaseWindow();
+    });
+    if (!_writer.start()) {
+        DEBUG_PRINTLN("UploadManager: Could not start the upload writer task.");
+    }
+    _server.on("/upload", HTTP_POST,
+        [this](AsyncWebServerRequest *request) { this->handleUploadRequest(request); },
+        nullptr,
+        [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            this->handleUploadBody(request, data, len, index, total);
+        });
+    _server.on("/upload-status", HTTP_GET, [this](AsyncWebServerRequest *request){
+        this->handleUploadStatus(request);
+    });
+}
+
+const char* UploadManager::targetName(Target target) {
+    return target == Target::NONE ? "none" : s_targets[(size_t)target].name;
+}
+
+UploadManager::Target UploadManager::parseTarget(const String& name) {
+    for (size_t i = 0; i < sizeof(s_targets) / sizeof(s_targets[0]); i++) {
+        if (name == s_targets[i].name) return (Target)i;
+    }
+    return Target::NONE;
+}
+
+// First body chunk of a request: start a new upload or resume the current one
+bool UploadManager::startBody(AsyncWebServerRequest *request) {
+    if (_activeRequest != nullptr) {
+        _rejectReason = "Another upload is in progress";
+        return false;
+    }
+    if (!request->hasParam("target") || !request->hasParam("total")) {
+        _rejectReason = "Missing 'target' or 'total' parameter";
+        return false;
+    }
+    const Target target = parseTarget(request->getParam("target")->value());
+    const uint32_t total = (uint32_t)request->getParam("total")->value().toInt();
+    const uint32_t offset = request->hasParam("offset") ? (uint32_t)request->getParam("offset")->value().toInt() : 0;
+    if (target == Target::NONE) {
+        _rejectReason = "Unknown upload target";
+        return false;
+    }
+
+    if (!_writer.idle()) {
+        _rejectReason = "Previous upload still being written";
+        return false;
+    }
+
+    if (offset == 0) {
+        const UploadTargetInfo& info = s_targets[(size_t)target];
+        UploadSink* sink;
+        bool opened;
+        if (info.sweep) {
+            opened = _sweepSink.open(info.gap);
+            sink = &_sweepSink;
+        } else {
+            opened = _flash.open(info.partition, info.subtype);
+            _imageSink.attach(&_flash, _flash.size());
+            sink = &_imageSink;
+        }
+        if (!opened || total == 0 || total > sink->capacity()) {
+            _rejectReason = "Target partition missing or too small";
+            return false;
+        }
+        // Nothing is written before this point, so a refused upload leaves
+        // the target mapped as it was
+        if (_hook) _hook(target, false);
+        _target = target;
+        _writer.setSink(sink);
+        _receiver.begin(&_writer, total);
+        DEBUG_PRINTF("UploadManager: Receiving %u bytes for %s\n", total, info.name);
+    } else if (target != _target || total != _receiver.total() || !_receiver.resume(offset)) {
+        _rejectReason = "Cannot resume: offset beyond committed data or different upload";
+        return false;
+    } else {
+        if (_hook) _hook(target, false);
+        DEBUG_PRINTF("UploadManager: Resuming %s at %u\n", targetName(target), offset);
+    }
+
+    _activeRequest = request;
+    {
+        std::lock_guard<std::mutex> lock(_flowLock);
+        _flowClient = request->client();
+        _holding = false;
+    }
+    request->onDisconnect([this, request]() {
+        {
+            std::lock_guard<std::mutex> lock(_flowLock);
+            if (_flowClient == request->client()) {
+                _flowClient = nullptr;
+                _holding = false;
+            }
+        }
+        if (_activeRequest == request) {
+            DEBUG_PRINTF("UploadManager: Connection dropped at %u/%u bytes\n", _receiver.committed(), _receiver.total());
+            _activeRequest = nullptr;
+            if (_receiver.status() != UploadStatus::Complete) {
+                _writer.end();
+            }
+        }
+    });
+    return true;
+}
+
+// Flow control: while the writer is behind, the segment just received is
+// left unacknowledged, so the receive window closes and the sender waits.
+// The window reopens here or, once it is shut and nothing more arrives,
+// from the writer task as soon as it catches up.
+void UploadManager::throttle() {
+    std::lock_guard<std::mutex> lock(_flowLock);
+    if (_flowClient == nullptr) {
+        return;
+    }
+    if (_writer.congested()) {
+        _flowClient->ackLater();
+        _holding = true;
+    } else {
+        releaseWindow();
+    }
+}
+
+// Acknowledges everything held back; _flowLock must be held
+void UploadManager::releaseWindow() {
+    if (_holding && _flowClient != nullptr) {
+        _flowClient->ack(SIZE_MAX);
+    }
+    _holding = false;
+}
+
+void UploadManager::handleUploadBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        _rejectReason = nullptr;
+        if (!startBody(request)) {
+            DEBUG_PRINTF("UploadManager: Rejected upload: %s\n", _rejectReason);
+            if (_activeRequest == request) _activeRequest = nullptr;
+            return;
+        }
+    }
+    if (request != _activeRequest || _receiver.failed()) {
+        return; // rejected or failed: drain the rest of the body
+    }
+    if (!_receiver.feed(data, len)) {
+        DEBUG_PRINTF("UploadManager: Upload failed (%s) at %u\n", uploadStatusName(_receiver.status()), _receiver.committed());
+    }
+    throttle();
+}
+
+void UploadManager::handleUploadRequest(AsyncWebServerRequest *request) {
+    if (request != _activeRequest) {
+        request->send(409, "text/plain", _rejectReason ? _rejectReason : "Upload rejected");
+        return;
+    }
+    _activeRequest = nullptr;
+    if (_receiver.status() == UploadStatus::Complete) {
+        DEBUG_PRINTF("UploadManager: %s upload received, %u bytes\n", targetName(_target), _receiver.total());
+    } else {
+        _writer.end(); // the writer remaps the target once the queued blocks are written
+    }
+    // A body that ended early is not an error: the client resumes from `committed`
+    const bool failed = _receiver.failed() || _writer.failed();
+    sendStatus(request, failed ? 422 : (_writer.idle() ? 200 : 202));
+}
+
+void UploadManager::handleUploadStatus(AsyncWebServerRequest *request) {
+    if (request->hasParam("target") && parseTarget(request->getParam("target")->value()) != _target) {
+        request->send(404, "text/plain", "No upload for this target");
+        return;
+    }
+    sendStatus(request, 200);
+}
+
+void UploadManager::sendStatus(AsyncWebServerRequest *request, int code) {
+    // The receiver finishes before the writer: report the flash side too
+    const char* status = uploadStatusName(_receiver.status());
+    if (_writer.failed()) {
+        status = uploadStatusName(UploadStatus::SinkError);
+    } else if (_receiver.status() == UploadStatus::Complete && !_writer.idle()) {
+        status = "writing";
+    }
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "{\"target\":\"%s\",\"status\":\"%s\",\"committed\":%u,\"total\":%u}",
+             targetName(_target), status, _receiver.committed(), _receiver.total());
+    request->send(code, "application/json", buffer);
+}
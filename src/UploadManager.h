@@ -0,0 +1,102 @@
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_partition.h>
+#include <functional>
+#include <mutex>
+#include "BlockUpload.h"
+#include "FlashImageSink.h"
+#include "SweepStore.h"
+#include "UploadWriter.h"
+
+// A data partition as the flash behind a FlashImageSink
+class PartitionFlash : public SweepFlash {
+public:
+    PartitionFlash() : _part(nullptr) {}
+    bool open(const char* label, uint8_t subtype);
+    size_t size() const { return _part ? _part->size : 0; }
+
+    bool flashErase(uint32_t offset, uint32_t len) override;
+    bool flashWrite(uint32_t offset, const void* data, uint32_t len) override;
+
+private:
+    const esp_partition_t* _part;
+};
+
+// Parses sweep text (Longz or .s1p) as it arrives and stores the samples in
+// one slot of the sweeps partition. The text itself is never kept, so its
+// size is only limited by the number of points a slot holds.
+class SweepUploadSink : public UploadSink, public SweepFlash {
+public:
+    SweepUploadSink() : _part(nullptr), _base(0) {}
+    bool open(GapLength gap);
+
+    size_t capacity() const override { return _part ? UINT32_MAX : 0; }
+    bool begin(uint32_t) override { return _part != nullptr && _writer.begin(this); }
+    bool write(uint32_t offset, const uint8_t* data, size_t len) override;
+    bool finish() override;
+
+    bool flashErase(uint32_t offset, uint32_t len) override;
+    bool flashWrite(uint32_t offset, const void* data, uint32_t len) override;
+
+private:
+    const esp_partition_t* _part;
+    uint32_t               _base; // slot offset in the partition
+    SweepSlotWriter        _writer;
+};
+
+// POST /upload?target=<name>&total=<bytes>[&offset=<bytes>]
+//   Body (application/octet-stream): BlockUpload frames. The sweep-long and
+//   sweep-short targets take sweep text, parsed into the sweeps partition. offset=0 starts a new
+//   upload, a non-zero offset resumes the current one after a dropped
+//   connection. Frames are verified as they arrive and handed to the
+//   UploadWriter task, which erases and writes the flash, so peak memory is
+//   independent of the image size and the TCP task never waits for flash.
+//   While the writer is behind, received segments are left unacknowledged:
+//   the receive window closes and the sender waits until it catches up.
+//   The reply is 202 with status "writing" if the last blocks are still
+//   going to flash; poll /upload-status until "complete".
+// GET /upload-status?target=<name>
+//   Committed offset of the current upload, for resuming.
+class UploadManager {
+public:
+    enum class Target : uint8_t { TuneTable = 0, Personality = 1, SweepLong = 2, SweepShort = 3, NONE = 0xFF };
+    // Called with done=false before a target is overwritten (unmap it), and
+    // done=true once the upload to it has ended, finished or not (map what
+    // valid data it holds), the latter from the UploadWriter task
+    typedef std::function<void(Target target, bool done)> TargetHook;
+
+    UploadManager(AsyncWebServer& srv);
+    void setupRoutes();
+    void onTargetChange(TargetHook hook) { _hook = hook; }
+
+    static const char* targetName(Target target);
+
+private:
+    AsyncWebServer&        _server;
+    TargetHook             _hook;
+    BlockReceiver          _receiver;
+    PartitionFlash         _flash;
+    FlashImageSink         _imageSink;
+    SweepUploadSink        _sweepSink;
+    UploadWriter           _writer;
+    Target                 _target;
+    AsyncWebServerRequest* _activeRequest; // request currently streaming a body
+    const char*            _rejectReason;  // set if the active request's body is being ignored
+    std::mutex             _flowLock;      // the receive window, shared with the writer task
+    AsyncClient*           _flowClient;    // connection of the active request
+    bool                   _holding;       // segments left unacknowledged on it
+
+    static Target parseTarget(const String& name);
+    void handleUploadBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+    void handleUploadRequest(AsyncWebServerRequest *request);
+    void handleUploadStatus(AsyncWebServerRequest *request);
+    bool startBody(AsyncWebServerRequest *request);
+    void throttle();
+    void releaseWindow();
+    void sendStatus(AsyncWebServerRequest *request, int code);
+};
+
+#endif // UPLOAD_MANAGER_H
@@ -0,0 +1,211 @@
+#include "UploadWriter.h"
+#include <string.h>
+#include "DebugUtils.h" // For DEBUG_PRINTF
+
+UploadWriter::UploadWriter() :
+    _sink(nullptr), _head(0), _tail(0), _failed(false), _congested(false)
+#if defined(ESP_PLATFORM)
+    , _task(nullptr)
+#else
+    , _wakePending(false), _stop(false)
+#endif
+{
+}
+
+UploadWriter::~UploadWriter()
+{
+    stop();
+}
+
+#if defined(ESP_PLATFORM)
+
+bool UploadWriter::start()
+{
+    if (_task != nullptr) {
+        return true;
+    }
+    // Below AsyncTCP's priority, so requests are served between sectors
+    return xTaskCreatePinnedToCore(taskEntry, "upload", 4096, this, tskIDLE_PRIORITY + 1, &_task, 1) == pdPASS;
+}
+
+void UploadWriter::stop()
+{
+    // The task runs for the lifetime of the firmware
+}
+
+void UploadWriter::taskEntry(void* arg)
+{
+    UploadWriter* self = static_cast<UploadWriter*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->run();
+    }
+}
+
+void UploadWriter::wake()
+{
+    if (_task != nullptr) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+void UploadWriter::pause()
+{
+    vTaskDelay(1);
+}
+
+#else
+
+bool UploadWriter::start()
+{
+    if (_thread.joinable()) {
+        return true;
+    }
+    _stop = false;
+    _thread = std::thread([this] {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(_wakeLock);
+                _wakeCond.wait(lock, [this] { return _wakePending || _stop; });
+                if (_stop) return;
+                _wakePending = false;
+            }
+            run();
+        }
+    });
+    return true;
+}
+
+void UploadWriter::stop()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_wakeLock);
+        _stop = true;
+    }
+    _wakeCond.notify_one();
+    _thread.join();
+}
+
+void UploadWriter::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(_wakeLock);
+        _wakePending = true;
+    }
+    _wakeCond.notify_one();
+}
+
+void UploadWriter::pause()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+#endif
+
+// Next free slot. The queue only fills if the sender ignores the closed
+// receive window for more than SLOTS - HIGH_WATER blocks; then wait.
+UploadWriter::Slot& UploadWriter::claim()
+{
+    while (queued() >= SLOTS) {
+        pause();
+    }
+    return _slots[_tail.load() % SLOTS];
+}
+
+void UploadWriter::push()
+{
+    _tail.fetch_add(1);
+    wake();
+}
+
+bool UploadWriter::begin(uint32_t totalSize)
+{
+    if (_sink == nullptr || !idle()) {
+        return false;
+    }
+    _failed.store(false);
+    Slot& slot = claim();
+    slot.op = Op::Begin;
+    slot.offset = totalSize;
+    push();
+    return true;
+}
+
+bool UploadWriter::write(uint32_t offset, const uint8_t* data, size_t len)
+{
+    if (_failed.load()) {
+        return false;
+    }
+    Slot& slot = claim();
+    slot.op = Op::Write;
+    slot.offset = offset;
+    slot.len = uint32_t(len);
+    memcpy(slot.data, data, len);
+    push();
+    return true;
+}
+
+bool UploadWriter::finish()
+{
+    claim().op = Op::Finish;
+    push();
+    return !_failed.load();
+}
+
+void UploadWriter::end()
+{
+    claim().op = Op::End;
+    push();
+}
+
+bool UploadWriter::congested()
+{
+    // Set before looking, so a task that drains meanwhile still sees it
+    _congested.store(true);
+    if (queued() >= HIGH_WATER) {
+        return true;
+    }
+    _congested.store(false);
+    return false;
+}
+
+void UploadWriter::run()
+{
+    while (queued() > 0) {
+        process(_slots[_head.load() % SLOTS]);
+        _head.fetch_add(1);
+        if (queued() < HIGH_WATER && _congested.exchange(false) && _drained) {
+            _drained();
+        }
+    }
+}
+
+void UploadWriter::process(const Slot& slot)
+{
+    switch (slot.op) {
+    case Op::Begin:
+        if (!_sink->begin(slot.offset)) {
+            DEBUG_PRINTLN("UploadWriter: Sink refused the upload.");
+            _failed.store(true);
+        }
+        break;
+    case Op::Write:
+        if (!_failed.load() && !_sink->write(slot.offset, slot.data, slot.len)) {
+            DEBUG_PRINTF("UploadWriter: Flash write failed at 0x%x\n", (unsigned)slot.offset);
+            _failed.store(true);
+        }
+        break;
+    case Op::Finish: {
+        const bool finished = !_failed.load() && _sink->finish();
+        _failed.store(!finished);
+        if (_done) _done(finished);
+        break;
+    }
+    case Op::End:
+        if (_done) _done(false);
+        break;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef UPLOAD_WRITER_H
+#define UPLOAD_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include "BlockUpload.h"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// Takes an upload's flash work off the AsyncTCP task. BlockReceiver hands
+// each verified block to write(), which copies it into one of SLOTS buffers
+// and returns; a task of its own (a std::thread in the host build) erases
+// and programs them through the target sink, in order. While HIGH_WATER or
+// more blocks wait, congested() tells the body handler to stop opening the
+// TCP receive window, and onDrained() fires once the task has caught up.
+class UploadWriter : public UploadSink {
+public:
+    static constexpr size_t SLOTS      = 4;
+    static constexpr size_t HIGH_WATER = 2;
+
+    // finished: the sink completed the upload; false after end() or an error
+    typedef std::function<void(bool finished)> DoneHook;
+    typedef std::function<void()> DrainHook;
+
+    UploadWriter();
+    ~UploadWriter();
+
+    bool start();
+    void stop(); // host build: stops and joins the thread
+
+    // Sink for the next upload; only while idle()
+    void setSink(UploadSink* sink) { _sink = sink; }
+    // Called on the writer task once a finish() or end() has been written
+    void onDone(DoneHook hook) { _done = hook; }
+    // Called on the writer task when the queue drops below HIGH_WATER after
+    // congested() last returned true
+    void onDrained(DrainHook hook) { _drained = hook; }
+
+    // UploadSink, for BlockReceiver on the HTTP task. Each call is queued;
+    // write() fails once the task has failed an earlier block, and the
+    // result of finish() arrives through onDone().
+    size_t capacity() const override { return _sink ? _sink->capacity() : 0; }
+    bool begin(uint32_t totalSize) override;
+    bool write(uint32_t offset, const uint8_t* data, size_t len) override;
+    bool finish() override;
+
+    // The body stopped short of the end (dropped, failed or resumable later):
+    // report done once what was queued is written
+    void end();
+
+    // true while HIGH_WATER or more blocks wait; onDrained() follows
+    bool congested();
+    bool idle() const { return queued() == 0; }
+    bool failed() const { return _failed.load(); }
+
+private:
+    enum class Op : uint8_t { Begin, Write, Finish, End };
+    struct Slot {
+        Op       op;
+        uint32_t offset; // Write: image offset; Begin: total size
+        uint32_t len;
+        uint8_t  data[BLOCK_UPLOAD_SIZE];
+    };
+
+    Slot& claim();
+    void  push();
+    void  run();
+    void  process(const Slot& slot);
+    void  wake();
+    uint32_t queued() const { return _tail.load() - _head.load(); }
+    static void pause();
+
+    UploadSink*           _sink;
+    Slot                  _slots[SLOTS];
+    std::atomic<uint32_t> _head; // slot the task is writing, freed when done
+    std::atomic<uint32_t> _tail; // next slot the HTTP task fills
+    std::atomic<bool>     _failed;
+    std::atomic<bool>     _congested;
+    DoneHook              _done;
+    DrainHook             _drained;
+#if defined(ESP_PLATFORM)
+    static void taskEntry(void* arg);
+    TaskHandle_t          _task;
+#else
+    std::thread           _thread;
+    std::mutex            _wakeLock;
+    std::condition_variable _wakeCond;
+    bool                  _wakePending;
+    bool                  _stop;
+#endif
+};
+
+#endif // UPLOAD_WRITER_H
@@ -0,0 +1,481 @@
+#include "VnaSequencer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "GAPTuner.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "TunerState.h"
+#include "DebugUtils.h" // For DEBUG_PRINTF
+
+#if defined(ESP_PLATFORM)
+#include <Arduino.h> // For millis
+#include "esp_random.h"
+#else
+#include <chrono>
+#include <random>
+#endif
+
+static const char* const s_stateNames[] = {"idle", "running", "done", "failed"};
+
+static int buttonOf(GAPTuner::ButtonID button)
+{
+    return int(button);
+}
+
+static GAPTuner::ButtonID gapButton(GapLength gap)
+{
+    return gap == GapLength::Long ? GAPTuner::ButtonID::ANTENNA_LONG : GAPTuner::ButtonID::ANTENNA_SHORT;
+}
+
+static CalSweep antennaSweep(GapLength gap)
+{
+    return gap == GapLength::Long ? CalSweep::AntennaLong : CalSweep::AntennaShort;
+}
+
+// Through the matching network without moving KM1: TUNING_1 and _2 differ
+// only in where they latch it
+static GAPTuner::ButtonID networkButton(const RelayTarget& found)
+{
+    return found.state[size_t(RelayId::LK99)] == 0 ? GAPTuner::ButtonID::TUNING_2 : GAPTuner::ButtonID::TUNING_1;
+}
+
+VnaSequencer::VnaSequencer(RelayExecutor& executor, GAPTuner& tuner, RelayController& relays, TunerState& state,
+                           RigTransport& tcp, RigTransport& serial, SweepFlash& store) :
+    _executor(executor), _tuner(tuner), _relays(relays), _state(state), _tcp(tcp), _serial(serial),
+    _transport(nullptr), _store(store), _hook(nullptr), _hookContext(nullptr), _rxLen(0)
+#if defined(ESP_PLATFORM)
+    , _task(nullptr)
+#endif
+{
+    memset(&_status, 0, sizeof(_status));
+}
+
+VnaSequencer::~VnaSequencer()
+{
+    wait();
+}
+
+void VnaSequencer::onStoreChange(StoreHook hook, void* context)
+{
+    _hook = hook;
+    _hookContext = context;
+}
+
+bool VnaSequencer::start(const VnaConfig& config)
+{
+    if (config.points < 2 || config.points > CAL_SLOT_MAX_POINTS || config.startHz == 0 ||
+        config.stopHz <= config.startHz || (config.link == VnaLink::Tcp && config.host[0] == '\0')) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_status.state == CalRunState::Running) {
+            return false;
+        }
+        _config = config;
+        _config.host[sizeof(_config.host) - 1] = '\0';
+        memset(&_status, 0, sizeof(_status));
+        _status.state = CalRunState::Running;
+        _status.runId = newRunId();
+    }
+#if defined(ESP_PLATFORM)
+    // Core 0 next to WiFi, which carries the trace; the relay task keeps core 1
+    if (xTaskCreatePinnedToCore(taskEntry, "vnacal", 4096, this, tskIDLE_PRIORITY + 1, &_task, 0) != pdPASS) {
+        fail("could not start the calibration task");
+        std::lock_guard<std::mutex> lock(_lock);
+        _status.state = CalRunState::Failed;
+        return false;
+    }
+#else
+    if (_thread.joinable()) {
+        _thread.join(); // the previous run, finished
+    }
+    _thread = std::thread([this] { run(); });
+#endif
+    return true;
+}
+
+#if defined(ESP_PLATFORM)
+
+void VnaSequencer::taskEntry(void* arg)
+{
+    VnaSequencer* self = static_cast<VnaSequencer*>(arg);
+    self->run();
+    self->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void VnaSequencer::wait()
+{
+    // The run ends by itself; status() tells when
+}
+
+void VnaSequencer::sleepMs(uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+uint32_t VnaSequencer::nowMs()
+{
+    return millis();
+}
+
+uint32_t VnaSequencer::newRunId()
+{
+    return esp_random() | 1;
+}
+
+#else
+
+void VnaSequencer::wait()
+{
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void VnaSequencer::sleepMs(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+uint32_t VnaSequencer::nowMs()
+{
+    static const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+}
+
+uint32_t VnaSequencer::newRunId()
+{
+    static std::random_device rd;
+    return rd() | 1;
+}
+
+#endif
+
+bool VnaSequencer::running() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _status.state == CalRunState::Running;
+}
+
+CalStatus VnaSequencer::status() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _status;
+}
+
+VnaConfig VnaSequencer::config() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _config;
+}
+
+const char* VnaSequencer::stateName(CalRunState state)
+{
+    return size_t(state) < sizeof(s_stateNames) / sizeof(s_stateNames[0]) ? s_stateNames[size_t(state)] : "?";
+}
+
+// The first failure is the one reported
+void VnaSequencer::fail(const char* format, ...)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_status.error[0] != '\0') {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(_status.error, sizeof(_status.error), format, args);
+    va_end(args);
+    DEBUG_PRINTF("VnaSequencer: %s\n", _status.error);
+}
+
+void VnaSequencer::run()
+{
+    const uint32_t t0 = nowMs();
+    const VnaConfig config = this->config();
+    RigConfig link;
+    link.link = config.link == VnaLink::Serial ? RigLink::Civ : RigLink::Rigctld;
+    memcpy(link.host, config.host, sizeof(link.host));
+    link.port = config.port;
+    link.baud = config.baud;
+    RigTransport& transport = config.link == VnaLink::Serial ? _serial : _tcp;
+
+    bool ok = false;
+    if (!transport.open(link)) {
+        fail("could not open the VNA link");
+    } else {
+        _transport = &transport;
+        _rxLen = 0;
+        if (_hook != nullptr) _hook(_hookContext, false);
+        ok = sequence(config);
+        command(":VNA:ACQ:STOP");
+        transport.close();
+        _transport = nullptr;
+        if (_hook != nullptr) _hook(_hookContext, true);
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _status.totalMs = nowMs() - t0;
+    _status.state = ok ? CalRunState::Done : CalRunState::Failed;
+    DEBUG_PRINTF("VnaSequencer: Run %08x %s after %u ms\n", (unsigned)_status.runId, stateName(_status.state),
+                 (unsigned)_status.totalMs);
+}
+
+bool VnaSequencer::sequence(const VnaConfig& config)
+{
+    char reply[64];
+    if (!query("*IDN?", reply, sizeof(reply))) {
+        fail("no reply from the VNA");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        memcpy(_status.vna, reply, sizeof(_status.vna));
+        for (char* c = _status.vna; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\' || *c < ' ') *c = ' '; // reported in JSON as is
+        }
+    }
+    // Single sweeps only: the VNA's source is off whenever a relay moves
+    char cmd[48];
+    command(":VNA:ACQ:STOP");
+    command(":VNA:ACQ:SINGLE TRUE");
+    snprintf(cmd, sizeof(cmd), ":VNA:FREQ:START %u", (unsigned)config.startHz);
+    command(cmd);
+    snprintf(cmd, sizeof(cmd), ":VNA:FREQ:STOP %u", (unsigned)config.stopHz);
+    command(cmd);
+    snprintf(cmd, sizeof(cmd), ":VNA:ACQ:POINTS %u", (unsigned)config.points);
+    command(cmd);
+    snprintf(cmd, sizeof(cmd), ":VNA:ACQ:IFBW %u", (unsigned)config.ifbwHz);
+    command(cmd);
+    if (!query("*OPC?", reply, sizeof(reply)) || strcmp(reply, "1") != 0) {
+        fail("VNA did not take the sweep settings");
+        return false;
+    }
+
+    const RelayTarget found = _relays.state();
+    const GapLength gap = _tuner.gapLength();
+    const GapLength other = gap == GapLength::Long ? GapLength::Short : GapLength::Long;
+    TunerState::Snapshot snapshot;
+    _state.snapshot(snapshot);
+
+    bool ok = step(CalSweep::Open, _executor.submitButton(buttonOf(GAPTuner::ButtonID::CAL_OPEN)), config) &&
+              step(CalSweep::Short, _executor.submitButton(buttonOf(GAPTuner::ButtonID::CAL_SHORT)), config) &&
+              step(CalSweep::Load, _executor.submitButton(buttonOf(GAPTuner::ButtonID::CAL_LOAD)), config) &&
+              step(antennaSweep(gap), _executor.submitButton(buttonOf(GAPTuner::ButtonID::TUNING_NONE)), config);
+    if (ok && config.bothGaps) {
+        ok = step(antennaSweep(other), _executor.submitButton(buttonOf(gapButton(other))), config) &&
+             relayJob(_executor.submitButton(buttonOf(gapButton(gap))));
+    }
+    if (ok && config.verify) {
+        const uint32_t job = config.verifyHz != 0 ? _executor.submitTune(config.verifyHz)
+                                                  : _executor.submitButton(buttonOf(networkButton(found)));
+        ok = step(CalSweep::Verify, job, config, config.verifyHz);
+    }
+    // Also after a failure: the tuner goes back to what it was doing
+    return restore(found, gap, snapshot.freqHz) && ok;
+}
+
+bool VnaSequencer::step(CalSweep which, uint32_t jobId, const VnaConfig& config, uint32_t tunedHz)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _status.step = which;
+    }
+    uint32_t relayMs = 0;
+    if (!relayJob(jobId, &relayMs)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _status.steps[size_t(which)].relayMs = relayMs;
+    }
+    return sweep(which, config, tunedHz);
+}
+
+bool VnaSequencer::relayJob(uint32_t jobId, uint32_t* ms)
+{
+    if (jobId == 0) {
+        fail("relay queue full");
+        return false;
+    }
+    const uint32_t t0 = nowMs();
+    RelayJobStatus job;
+    for (;;) {
+        if (!_executor.status(jobId, job)) {
+            fail("relay job %u lost", (unsigned)jobId);
+            return false;
+        }
+        if (job.state == RelayJobState::Done) {
+            break;
+        }
+        if (job.state == RelayJobState::Failed || job.state == RelayJobState::Superseded) {
+            fail("relay job %s: %s", RelayExecutor::stateName(job.state), job.message);
+            return false;
+        }
+        if (nowMs() - t0 >= JOB_TIMEOUT_MS) {
+            fail("relay job %u timed out", (unsigned)jobId);
+            return false;
+        }
+        sleepMs(2);
+    }
+    if (ms != nullptr) {
+        *ms = nowMs() - t0;
+    }
+    return true;
+}
+
+// A sweep, then its trace streamed from the link into the slot
+bool VnaSequencer::sweep(CalSweep which, const VnaConfig& config, uint32_t tunedHz)
+{
+    const char* name = CalStoreView::sweepName(which);
+    const uint32_t t0 = nowMs();
+    const RelayTarget before = _relays.state();
+    if (!_writer.begin(&_store, which)) {
+        fail("%s: flash erase failed", name);
+        return false;
+    }
+    // No relay job may switch while the VNA's source is on
+    _relays.setRfApplied(RfSource::Vna, true);
+    const bool swept = runSweep(name, t0);
+    _relays.setRfApplied(RfSource::Vna, false);
+    if (!swept) {
+        return false;
+    }
+    if (memcmp(&before, &_relays.state(), sizeof(before)) != 0) {
+        fail("%s: relays moved during the sweep", name);
+        return false;
+    }
+
+    if (!command(":VNA:TRAC:DATA? S11") || !_writer.write(_rx, _rxLen)) {
+        fail("%s: VNA link lost", name);
+        return false;
+    }
+    _rxLen = 0;
+    while (!_writer.done() && !_writer.failed()) {
+        const int n = _transport->read(reinterpret_cast<uint8_t*>(_rx), sizeof(_rx), REPLY_TIMEOUT_MS);
+        if (n <= 0) {
+            fail("%s: trace cut short after %u points", name, (unsigned)_writer.parser().totalSamples());
+            return false;
+        }
+        _writer.write(_rx, size_t(n));
+    }
+    if (_writer.failed() || _writer.parser().totalSamples() != config.points) {
+        fail("%s: bad trace (%u of %u points)", name, (unsigned)_writer.parser().totalSamples(), (unsigned)config.points);
+        return false;
+    }
+    CalSlotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.runId = status().runId;
+    header.startHz = config.startHz;
+    header.stopHz = config.stopHz;
+    header.tunedHz = tunedHz;
+    header.sweep = uint8_t(which);
+    header.gap = uint8_t(_tuner.gapLength());
+    if (!_writer.finish(header)) {
+        fail("%s: flash write failed", name);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    CalStepStatus& s = _status.steps[size_t(which)];
+    s.done = true;
+    s.points = _writer.stored();
+    s.sweepMs = nowMs() - t0;
+    return true;
+}
+
+// One single sweep, polled until the VNA reports it finished
+bool VnaSequencer::runSweep(const char* name, uint32_t t0)
+{
+    if (!command(":VNA:ACQ:RUN")) {
+        fail("%s: VNA link lost", name);
+        return false;
+    }
+    char reply[16];
+    for (;;) {
+        if (!query(":VNA:ACQ:FIN?", reply, sizeof(reply))) {
+            fail("%s: no reply to FIN?", name);
+            return false;
+        }
+        if (strcmp(reply, "TRUE") == 0) {
+            return true;
+        }
+        if (nowMs() - t0 >= SWEEP_TIMEOUT_MS) {
+            command(":VNA:ACQ:STOP");
+            fail("%s: sweep timed out", name);
+            return false;
+        }
+        sleepMs(SWEEP_POLL_MS);
+    }
+}
+
+// Gap length first, then the RF route as it was; a band-plan tune is
+// applied again, as a verify tune may have moved the banks
+bool VnaSequencer::restore(const RelayTarget& found, GapLength gap, uint32_t freqHz)
+{
+    bool ok = true;
+    if (_tuner.gapLength() != gap) {
+        ok = relayJob(_executor.submitButton(buttonOf(gapButton(gap))));
+    }
+    const int button = routeButton(found);
+    const bool network = button == buttonOf(GAPTuner::ButtonID::TUNING_1) || button == buttonOf(GAPTuner::ButtonID::TUNING_2);
+    if (network && freqHz != 0) {
+        return relayJob(_executor.submitTune(freqHz)) && ok;
+    }
+    return relayJob(_executor.submitButton(button)) && ok;
+}
+
+int VnaSequencer::routeButton(const RelayTarget& found)
+{
+    const int8_t* s = found.state;
+    if (s[size_t(RelayId::K4)] == 1) return buttonOf(GAPTuner::ButtonID::TUNING_NONE);
+    if (s[size_t(RelayId::K1)] == 1) {
+        return buttonOf(s[size_t(RelayId::K2)] == 1 ? GAPTuner::ButtonID::CAL_SHORT : GAPTuner::ButtonID::CAL_OPEN);
+    }
+    if (s[size_t(RelayId::K3)] == 1) return buttonOf(GAPTuner::ButtonID::CAL_LOAD);
+    return buttonOf(networkButton(found));
+}
+
+// Set commands have no reply; errors show up in the *OPC? and FIN? queries
+bool VnaSequencer::command(const char* text)
+{
+    char line[64];
+    const size_t n = size_t(snprintf(line, sizeof(line), "%s\n", text));
+    return _transport != nullptr && n < sizeof(line) && _transport->write(reinterpret_cast<const uint8_t*>(line), n);
+}
+
+bool VnaSequencer::query(const char* text, char* reply, size_t size, uint32_t timeoutMs)
+{
+    return command(text) && readLine(reply, size, timeoutMs);
+}
+
+bool VnaSequencer::readLine(char* line, size_t size, uint32_t timeoutMs)
+{
+    const uint32_t t0 = nowMs();
+    for (;;) {
+        char* nl = static_cast<char*>(memchr(_rx, '\n', _rxLen));
+        if (nl != nullptr) {
+            size_t n = size_t(nl - _rx);
+            const size_t used = n + 1;
+            if (n > 0 && _rx[n - 1] == '\r') n--;
+            const size_t copy = n < size - 1 ? n : size - 1;
+            memcpy(line, _rx, copy);
+            line[copy] = '\0';
+            memmove(_rx, _rx + used, _rxLen - used);
+            _rxLen -= used;
+            return true;
+        }
+        if (_rxLen == sizeof(_rx)) {
+            _rxLen = 0; // no reply but a trace is this long
+        }
+        const uint32_t elapsed = nowMs() - t0;
+        if (elapsed >= timeoutMs) {
+            return false;
+        }
+        const int n = _transport->read(reinterpret_cast<uint8_t*>(_rx) + _rxLen, sizeof(_rx) - _rxLen, timeoutMs - elapsed);
+        if (n < 0) {
+            return false;
+        }
+        _rxLen += size_t(n);
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef VNA_SEQUENCER_H
+#define VNA_SEQUENCER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include "CalStore.h"
+#include "RelaySchedule.h" // For RelayTarget
+#include "RigTransport.h"
+#include "TuneTable.h"     // For GapLength
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+class GAPTuner;
+class RelayController;
+class RelayExecutor;
+class TunerState;
+
+static constexpr uint16_t VNA_SCPI_PORT = 19542; // LibreVNA-GUI SCPI server
+
+enum class VnaLink : uint8_t {
+    Tcp,    // SCPI server of the VNA software, over WiFi
+    Serial  // SCPI over a plain UART of its own on GPIO 17/21 (VNA_RX_PIN /
+            // VNA_TX_PIN), not the CI-V interface, which echoes every byte
+};
+
+struct VnaConfig {
+    VnaLink  link     = VnaLink::Tcp;
+    char     host[64] = "";
+    uint16_t port     = VNA_SCPI_PORT;
+    uint32_t baud     = 115200;
+    uint32_t startHz  = 1500000;
+    uint32_t stopHz   = 30000000;
+    uint16_t points   = 1001;
+    uint32_t ifbwHz   = 1000;
+    bool     bothGaps = false; // antenna sweep at the other gap length too
+    bool     verify   = false; // last, a sweep through the matching network
+    uint32_t verifyHz = 0;     // band-plan tune before the verify sweep, 0: relays as found
+};
+
+enum class CalRunState : uint8_t { Idle, Running, Done, Failed };
+
+struct CalStepStatus {
+    bool     done;
+    uint32_t points;
+    uint32_t relayMs;  // relay job, queued until settled
+    uint32_t sweepMs;  // VNA sweep and trace transfer into flash
+};
+
+struct CalStatus {
+    CalRunState   state;
+    CalSweep      step;      // running or failed at
+    uint32_t      runId;
+    uint32_t      totalMs;
+    char          vna[64];   // *IDN? reply
+    char          error[96];
+    CalStepStatus steps[size_t(CalSweep::Count)];
+};
+
+// Characterises the antenna with an external VNA at the tuner's port:
+// Open, Short and Load through the K1-K3 standards, the antenna with K4
+// energised (straight through the balun, at one or both gap lengths) and
+// optionally a verify sweep through the matching network. Each raw sweep
+// goes straight from the SCPI reply into its CalStore slot; the relays are
+// put back as they were found at the end.
+//
+// The VNA runs single sweeps only and is stopped before the first relay
+// job. While a sweep runs the RelayController's RF interlock is held, so a
+// button press or a rig follower retune fails instead of switching under
+// the VNA's RF; a relay that moved anyway would fail the run.
+//
+// The run has its own task (a std::thread in the host build); relay jobs go
+// through the RelayExecutor like any other.
+class VnaSequencer {
+public:
+    static constexpr uint32_t REPLY_TIMEOUT_MS = 2000;
+    static constexpr uint32_t JOB_TIMEOUT_MS   = 5000;
+    static constexpr uint32_t SWEEP_TIMEOUT_MS = 60000;
+    static constexpr uint32_t SWEEP_POLL_MS    = 10;
+
+    // Called from the run's task before the first slot is erased
+    // (complete = false) and once the run has ended
+    typedef void (*StoreHook)(void* context, bool complete);
+
+    VnaSequencer(RelayExecutor& executor, GAPTuner& tuner, RelayController& relays, TunerState& state,
+                 RigTransport& tcp, RigTransport& serial, SweepFlash& store);
+    ~VnaSequencer();
+
+    void onStoreChange(StoreHook hook, void* context);
+    // false if a run is in progress or the configuration is out of range
+    bool start(const VnaConfig& config);
+    bool running() const;
+    CalStatus status() const;
+    VnaConfig config() const;
+    void wait(); // host build: joins a finished or running run
+
+    static const char* stateName(CalRunState state);
+
+private:
+    void run();
+    bool sequence(const VnaConfig& config);
+    bool step(CalSweep sweep, uint32_t jobId, const VnaConfig& config, uint32_t tunedHz = 0);
+    bool relayJob(uint32_t jobId, uint32_t* ms = nullptr);
+    bool sweep(CalSweep sweep, const VnaConfig& config, uint32_t tunedHz);
+    bool runSweep(const char* name, uint32_t t0);
+    bool restore(const RelayTarget& found, GapLength gap, uint32_t freqHz);
+    static int routeButton(const RelayTarget& found);
+
+    bool command(const char* text);
+    bool query(const char* text, char* reply, size_t size, uint32_t timeoutMs = REPLY_TIMEOUT_MS);
+    bool readLine(char* line, size_t size, uint32_t timeoutMs);
+    void fail(const char* format, ...);
+    void sleepMs(uint32_t ms);
+
+    static uint32_t nowMs();
+    static uint32_t newRunId();
+
+    RelayExecutor&     _executor;
+    GAPTuner&          _tuner;
+    RelayController&   _relays;
+    TunerState&        _state;
+    RigTransport&      _tcp;
+    RigTransport&      _serial;
+    RigTransport*      _transport; // the open one during a run
+    SweepFlash&        _store;
+    StoreHook          _hook;
+    void*              _hookContext;
+
+    mutable std::mutex _lock;      // _config, _status
+    VnaConfig          _config;
+    CalStatus          _status;
+
+    CalSlotWriter      _writer;    // run task only, 12 KB of batch buffers
+    char               _rx[256];   // reply bytes not yet consumed
+    size_t             _rxLen;
+#if defined(ESP_PLATFORM)
+    static void taskEntry(void* arg);
+    TaskHandle_t       _task;
+#else
+    std::thread        _thread;
+#endif
+};
+
+#endif // VNA_SEQUENCER_H
@@ -1,24 +1,63 @@
 #include "WebServerManager.h"
+#include "CalCorrector.h"
 #include "GAPTuner.h"   // Need full definition for _gaptuner usage
 #include "NetworkMgr.h" // Need full definition for _networkMgr usage
+#include "PowerManager.h"
+#include "RelayExecutor.h"
+#include "RigFollower.h"
+#include "VnaSequencer.h"
 #include "DebugUtils.h" // For DEBUG_PRINTLN, DEBUG_PRINTF
+#include "WebAssetData.h" // Generated by tools/embed_web.py
 
-WebServerManager::WebServerManager(AsyncWebServer& srv, GAPTuner& tuner, NetworkMgr& netMgr) :
-    _server(srv), _gaptuner(tuner), _networkMgr(netMgr) {}
+WebServerManager::WebServerManager(AsyncWebServer& srv, GAPTuner& tuner, RelayExecutor& executor, NetworkMgr& netMgr,
+                                   TunerMetrics& metrics, TunerState& state, RigFollower& rig,
+                                   PowerManager& power, VnaSequencer& vna,
+                                   CalCorrector& cal) :
+    _server(srv), _gaptuner(tuner), _executor(executor), _networkMgr(netMgr), _metrics(metrics), _state(state), _rig(rig),
+    _power(power), _vna(vna), _cal(cal), _api(tuner, executor, state),
+    _events("/events"), _lastLinkCheckMs(0), _lastHeartbeatMs(0) {}
 
 void WebServerManager::setupRoutes() {
     DEBUG_PRINTLN("WebServerManager: Setting up routes...");
-    _server.on("/", HTTP_GET, [this](AsyncWebServerRequest *request){
-        this->handleRootRequest(request);
-    });
-    _server.on("/button", HTTP_GET, [this](AsyncWebServerRequest *request){
-        this->handleButtonRequest(request);
-    });
-    _server.on("/wifi-status", HTTP_GET, [this](AsyncWebServerRequest *request){
-        this->handleWiFiStatusRequest(request);
-    });
+    // The page first, then its content-hashed stylesheet and script and the service worker
+    route(g_webUiAssets[0], HttpRoute::Root);
+    for (size_t i = 1; i < sizeof(g_webUiAssets) / sizeof(g_webUiAssets[0]); i++) {
+        route(g_webUiAssets[i], HttpRoute::Asset);
+    }
+    route("/button", HttpRoute::Button, &WebServerManager::handleButtonRequest);
+    route("/tune", HttpRoute::Tune, &WebServerManager::handleTuneRequest);
+    route("/job", HttpRoute::Job, &WebServerManager::handleJobRequest);
+    route("/wifi-status", HttpRoute::WiFiStatus, &WebServerManager::handleWiFiStatusRequest);
+    route("/metrics", HttpRoute::Metrics, &WebServerManager::handleMetricsRequest);
+    route("/rig", HttpRoute::Rig, &WebServerManager::handleRigRequest);
+    route("/power", HttpRoute::Power, &WebServerManager::handlePowerRequest);
+    route("/cal", HttpRoute::Cal, &WebServerManager::handleCalRequest);
+    route("/api/v1/*", HttpRoute::Api, &WebServerManager::handleApiRequest);
+    _events.onConnect([this](AsyncEventSourceClient *client){ this->handleEventsConnect(client); });
+    _server.addHandler(&_events);
+    _state.onChange(&WebServerManager::onStateChange, this);
     _server.onNotFound([this](AsyncWebServerRequest *request){
+        const uint32_t t0 = metricsMicros();
         this->handleNotFoundRequest(request);
+        _metrics.httpLatency[size_t(HttpRoute::NotFound)].observe(metricsMicros() - t0);
+    });
+}
+
+void WebServerManager::route(const char* uri, HttpRoute route, Handler handler) {
+    _server.on(uri, HTTP_GET, [this, route, handler](AsyncWebServerRequest *request){
+        const uint32_t t0 = metricsMicros();
+        if (route != HttpRoute::Metrics) _power.activity(); // a scraper must not keep the tuner awake
+        (this->*handler)(request);
+        _metrics.httpLatency[size_t(route)].observe(metricsMicros() - t0);
+    });
+}
+
+void WebServerManager::route(const WebAsset& asset, HttpRoute route) {
+    _server.on(asset.path, HTTP_GET, [this, &asset, route](AsyncWebServerRequest *request){
+        const uint32_t t0 = metricsMicros();
+        _power.activity();
+        sendAsset(request, asset);
+        _metrics.httpLatency[size_t(route)].observe(metricsMicros() - t0);
     });
 }
 
@@ -27,30 +66,142 @@ void WebServerManager::begin() {
     DEBUG_PRINTLN("WebServerManager: HTTP server started.");
 }
 
-void WebServerManager::handleRootRequest(AsyncWebServerRequest *request) {
-    request->send(200, "text/html", index_html);
+void WebServerManager::service(uint32_t nowMs) {
+    if (nowMs - _lastLinkCheckMs >= LINK_CHECK_MS) {
+        _lastLinkCheckMs = nowMs;
+        const bool online = _networkMgr.isConnected();
+        _state.linkChanged(online, online ? WiFi.RSSI() : 0);
+    }
+    if (nowMs - _lastHeartbeatMs >= HEARTBEAT_MS) {
+        _lastHeartbeatMs = nowMs;
+        if (_events.count() > 0) {
+            _events.send("", "ping"); // no id: the client keeps its last version
+        }
+    }
+}
+
+void WebServerManager::onStateChange(void* context, uint32_t) {
+    WebServerManager* self = static_cast<WebServerManager*>(context);
+    if (self->_events.count() == 0) {
+        return;
+    }
+    char json[TunerState::JSON_MAX];
+    uint32_t version = 0;
+    if (self->_state.format(json, sizeof(json), version) > 0) {
+        self->_events.send(json, "state", version);
+    }
 }
 
+// A reconnecting EventSource sends Last-Event-ID; one message brings it up to date
+void WebServerManager::handleEventsConnect(AsyncEventSourceClient *client) {
+    char json[TunerState::JSON_MAX];
+    uint32_t version = 0;
+    if (_state.resync(client->lastId(), json, sizeof(json), version) > 0) {
+        client->send(json, "state", version, EVENTS_RETRY_MS);
+    }
+}
+
+// Stored gzip-compressed and sent as is; the ETag lets a browser revalidate
+// the page with a 304 instead of the whole file
+void WebServerManager::sendAsset(AsyncWebServerRequest *request, const WebAsset& asset) {
+    const AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+    AsyncWebServerResponse* response;
+    if (ifNoneMatch != nullptr && webEtagMatches(ifNoneMatch->value().c_str(), asset.etag)) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse(200, asset.contentType, asset.gzip, asset.gzipSize);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", asset.cacheControl);
+    request->send(response);
+}
+
+// Relay requests only queue a job for the RelayExecutor task and answer
+// 202 with its id; /job?id=<id> reports progress and the relay details.
 void WebServerManager::handleButtonRequest(AsyncWebServerRequest *request) {
-    String message = "Action request processed."; String actionDetails = ""; String finalResponse = ""; bool error = false;
-    if (request->hasParam("id")) {
-        String idStr = request->getParam("id")->value(); int buttonId = idStr.toInt();
+    const char* message;
+    const AsyncWebParameter* id = request->getParam("id");
+    if (id != nullptr) {
+        const int buttonId = id->value().toInt();
         // GAPTuner::NUM_ACTIONS is accessible via GAPTuner.h
         if (buttonId >= 1 && buttonId <= GAPTuner::NUM_ACTIONS) { 
-            actionDetails = _gaptuner.processButtonAction(buttonId, message);
-            if (message.startsWith("Internal error:")) {
-                error = true;
-            }
-        } else {
-            message = "Invalid Button ID received"; error = true;
-            DEBUG_PRINTF("WebServerManager: Invalid Button ID %s\n", idStr.c_str());
+            sendJobAccepted(request, _executor.submitButton(buttonId));
+            return;
         }
+        message = "Invalid Button ID received";
+        DEBUG_PRINTF("WebServerManager: Invalid Button ID %s\n", id->value().c_str());
     } else {
-        message = "Missing 'id' parameter"; error = true;
+        message = "Missing 'id' parameter";
         DEBUG_PRINTLN("WebServerManager: Missing 'id' parameter in button request");
     }
-    finalResponse = error ? message : (message + "\n" + actionDetails);
-    request->send(error ? 400 : 200, "text/plain", finalResponse);
+    request->send(400, "text/plain", message);
+}
+
+// /tune?freq=<Hz>: select the precomputed network for a frequency, or solve it
+void WebServerManager::handleTuneRequest(AsyncWebServerRequest *request) {
+    const char* message;
+    const AsyncWebParameter* freq = request->getParam("freq");
+    if (freq != nullptr) {
+        long freqHz = freq->value().toInt();
+        if (freqHz > 0 && _gaptuner.canTune()) {
+            sendJobAccepted(request, _executor.submitTune((uint32_t)freqHz));
+            return;
+        }
+        if (freqHz > 0) {
+            request->send(503, "text/plain", "No tune table or antenna sweep loaded");
+            return;
+        }
+        message = "Invalid frequency";
+    } else {
+        message = "Missing 'freq' parameter";
+        DEBUG_PRINTLN("WebServerManager: Missing 'freq' parameter in tune request");
+    }
+    request->send(400, "text/plain", message);
+}
+
+void WebServerManager::sendJobAccepted(AsyncWebServerRequest *request, uint32_t jobId) {
+    if (jobId == 0) {
+        request->send(503, "text/plain", "Relay queue full, try again");
+        return;
+    }
+    char buffer[48];
+    const int n = snprintf(buffer, sizeof(buffer), "{\"id\":%u,\"state\":\"queued\"}", (unsigned)jobId);
+    sendJson(request, 202, buffer, size_t(n));
+}
+
+// /job?id=<id>: {"id":..,"state":"queued|running|done|failed|superseded","message":..,"details":..}
+void WebServerManager::handleJobRequest(AsyncWebServerRequest *request) {
+    RelayJobStatus status;
+    const AsyncWebParameter* id = request->getParam("id");
+    if (id == nullptr || !_executor.status((uint32_t)id->value().toInt(), status)) {
+        request->send(404, "text/plain", "Unknown job");
+        return;
+    }
+    char json[ApiV1::REPLY_SIZE];
+    sendJson(request, 200, json, ApiV1::formatJob(status, json, sizeof(json)));
+}
+
+// Query parameters for ApiV1, read in place
+static const char* apiParam(void* context, const char* name) {
+    const AsyncWebParameter* p = static_cast<AsyncWebServerRequest*>(context)->getParam(name);
+    return p != nullptr ? p->value().c_str() : nullptr;
+}
+
+// /api/v1/<endpoint>: written into a stack buffer by ApiV1, then copied once
+// into the response
+void WebServerManager::handleApiRequest(AsyncWebServerRequest *request) {
+    char reply[ApiV1::REPLY_SIZE];
+    size_t length = 0;
+    const int status = _api.handle(request->url().c_str(), apiParam, request, reply, sizeof(reply), length);
+    sendJson(request, status, reply, length);
+}
+
+void WebServerManager::sendJson(AsyncWebServerRequest *request, int status, const char* json, size_t length) {
+    AsyncResponseStream* response = request->beginResponseStream("application/json", length > 0 ? length : 1);
+    response->setCode(status);
+    response->write(reinterpret_cast<const uint8_t*>(json), length);
+    request->send(response);
 }
 
 void WebServerManager::handleWiFiStatusRequest(AsyncWebServerRequest *request) {
@@ -63,6 +214,253 @@ void WebServerManager::handleWiFiStatusRequest(AsyncWebServerRequest *request) {
     }
 }
 
+// Prometheus text format, streamed in chunks straight from the counters
+void WebServerManager::handleMetricsRequest(AsyncWebServerRequest *request) {
+    _metrics.sampleSystem();
+    _metrics.wifiRssi.set(_networkMgr.isConnected() ? WiFi.RSSI() : 0);
+    _metrics.wifiReconnects.set(_networkMgr.reconnectCount());
+    _metrics.eventClients.set(int32_t(_events.count()));
+    MetricsCursor cursor;
+    request->send(request->beginChunkedResponse("text/plain; version=0.0.4",
+        [this, cursor](uint8_t *buffer, size_t maxLen, size_t) mutable -> size_t {
+            return _metrics.registry().render(reinterpret_cast<char*>(buffer), maxLen, cursor);
+        }));
+}
+
+// /rig[?link=off|rigctld|civ&host=..&port=..&baud=..&civ=<addr>&poll=<ms>]:
+// CAT follow mode. Any parameter changes the settings (kept in NVS); the
+// reply is always the current settings and status.
+void WebServerManager::handleRigRequest(AsyncWebServerRequest *request) {
+    RigConfig config = _rig.config();
+    bool changed = false;
+    if (request->hasParam("link")) {
+        const String link = request->getParam("link")->value();
+        if (link == "rigctld") config.link = RigLink::Rigctld;
+        else if (link == "civ") config.link = RigLink::Civ;
+        else if (link == "off") config.link = RigLink::Off;
+        else {
+            request->send(400, "text/plain", "link must be off, rigctld or civ");
+            return;
+        }
+        changed = true;
+    }
+    if (request->hasParam("host")) {
+        const String host = request->getParam("host")->value();
+        for (size_t i = 0; i < host.length(); i++) {
+            const char c = host[i];
+            if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != ':') {
+                request->send(400, "text/plain", "Invalid host name");
+                return;
+            }
+        }
+        strlcpy(config.host, host.c_str(), sizeof(config.host));
+        changed = true;
+    }
+    if (request->hasParam("port")) {
+        config.port = (uint16_t)request->getParam("port")->value().toInt();
+        changed = true;
+    }
+    if (request->hasParam("baud")) {
+        config.baud = (uint32_t)request->getParam("baud")->value().toInt();
+        changed = true;
+    }
+    if (request->hasParam("civ")) {
+        config.civAddress = (uint8_t)strtoul(request->getParam("civ")->value().c_str(), nullptr, 0);
+        changed = true;
+    }
+    if (request->hasParam("poll")) {
+        config.pollMs = (uint16_t)request->getParam("poll")->value().toInt();
+        changed = true;
+    }
+    if (changed) {
+        if (config.port == 0 || config.baud == 0 || config.pollMs < 10) {
+            request->send(400, "text/plain", "Invalid port, baud or poll interval");
+            return;
+        }
+        _rig.configure(config);
+        if (!_rig.saveConfig()) {
+            DEBUG_PRINTLN("WebServerManager: Could not save the rig settings");
+        }
+    }
+    const RigStatus status = _rig.status();
+    char buffer[320];
+    snprintf(buffer, sizeof(buffer),
+             "{\"link\":\"%s\",\"host\":\"%s\",\"port\":%u,\"baud\":%u,\"civ\":%u,\"poll\":%u,"
+             "\"connected\":%s,\"freq\":%u,\"ptt\":%s,\"tuned\":%u,\"retunes\":%u,\"linkErrors\":%u}",
+             RigFollower::linkName(config.link), config.host, (unsigned)config.port, (unsigned)config.baud,
+             (unsigned)config.civAddress, (unsigned)config.pollMs, status.connected ? "true" : "false",
+             (unsigned)status.freqHz, status.ptt ? "true" : "false", (unsigned)status.tunedHz,
+             (unsigned)status.retunes, (unsigned)status.linkErrors);
+    request->send(200, "application/json", buffer);
+}
+
+// Power-state timeouts in seconds (dormant=0: never), sleep=light|deep, and
+// the time and estimated energy spent in each state
+void WebServerManager::handlePowerRequest(AsyncWebServerRequest *request) {
+    PowerConfig config = _power.config();
+    bool changed = false;
+    if (request->hasParam("idle")) {
+        config.idleAfterMs = (uint32_t)request->getParam("idle")->value().toInt() * 1000;
+        changed = true;
+    }
+    if (request->hasParam("dormant")) {
+        config.dormantAfterMs = (uint32_t)request->getParam("dormant")->value().toInt() * 1000;
+        changed = true;
+    }
+    if (request->hasParam("wake")) {
+        config.wakeEveryMs = (uint32_t)request->getParam("wake")->value().toInt() * 1000;
+        changed = true;
+    }
+    if (request->hasParam("sleep")) {
+        const String mode = request->getParam("sleep")->value();
+        if (mode == "light") config.sleepMode = SleepMode::Light;
+        else if (mode == "deep") config.sleepMode = SleepMode::Deep;
+        else {
+            request->send(400, "text/plain", "sleep must be light or deep");
+            return;
+        }
+        changed = true;
+    }
+    if (changed) {
+        if (config.idleAfterMs < 5000 || (config.wakeEveryMs != 0 && config.wakeEveryMs < 60000)) {
+            request->send(400, "text/plain", "idle must be at least 5 s and wake 0 or at least 60 s");
+            return;
+        }
+        _power.configure(config);
+        if (!_power.saveConfig()) {
+            DEBUG_PRINTLN("WebServerManager: Could not save the power settings");
+        }
+    }
+    const PowerTotals totals = _power.totals();
+    char buffer[384];
+    int n = snprintf(buffer, sizeof(buffer), "{\"state\":\"%s\",\"idle\":%u,\"dormant\":%u,\"wake\":%u,\"sleep\":\"%s\"",
+                     PowerPolicy::stateName(_power.state()), (unsigned)(config.idleAfterMs / 1000),
+                     (unsigned)(config.dormantAfterMs / 1000), (unsigned)(config.wakeEveryMs / 1000),
+                     PowerPolicy::sleepModeName(config.sleepMode));
+    for (size_t i = 0; i < size_t(PowerState::Count) && n > 0 && size_t(n) < sizeof(buffer); i++) {
+        n += snprintf(buffer + n, sizeof(buffer) - n, ",\"%s\":{\"seconds\":%.1f,\"joules\":%.3f,\"entries\":%u}",
+                      PowerPolicy::stateName(PowerState(i)), double(totals.ms[i]) * 1e-3, totals.mj[i] * 1e-3,
+                      (unsigned)totals.entries[i]);
+    }
+    if (n > 0 && size_t(n) < sizeof(buffer) - 1) {
+        buffer[n++] = '}';
+        buffer[n] = '\0';
+    }
+    request->send(200, "application/json", buffer);
+}
+
+// run=1 starts a VNA calibration run: link=tcp|serial, host, port, baud,
+// start/stop in Hz, points, ifbw, gaps=one|both, verify=0|1|<Hz>. Without
+// run the progress of the last run; each sweep is stored raw in "vnacal".
+// z=<sweep> (antenna_long, ...) streams a sweep of the last complete run
+// error-corrected, as impedance in the docs/Longz format.
+void WebServerManager::handleCalRequest(AsyncWebServerRequest *request) {
+    if (request->hasParam("z")) {
+        sendCorrectedSweep(request, request->getParam("z")->value());
+        return;
+    }
+    if (request->hasParam("run")) {
+        VnaConfig config = _vna.config();
+        if (request->hasParam("link")) {
+            const String link = request->getParam("link")->value();
+            if (link == "tcp") config.link = VnaLink::Tcp;
+            else if (link == "serial") config.link = VnaLink::Serial;
+            else {
+                request->send(400, "text/plain", "link must be tcp or serial");
+                return;
+            }
+        }
+        if (request->hasParam("host")) {
+            const String host = request->getParam("host")->value();
+            for (size_t i = 0; i < host.length(); i++) {
+                const char c = host[i];
+                if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != ':') {
+                    request->send(400, "text/plain", "Invalid host name");
+                    return;
+                }
+            }
+            strlcpy(config.host, host.c_str(), sizeof(config.host));
+        }
+        if (request->hasParam("port")) config.port = (uint16_t)request->getParam("port")->value().toInt();
+        if (request->hasParam("baud")) config.baud = (uint32_t)request->getParam("baud")->value().toInt();
+        if (request->hasParam("start")) config.startHz = (uint32_t)request->getParam("start")->value().toInt();
+        if (request->hasParam("stop")) config.stopHz = (uint32_t)request->getParam("stop")->value().toInt();
+        if (request->hasParam("points")) config.points = (uint16_t)request->getParam("points")->value().toInt();
+        if (request->hasParam("ifbw")) config.ifbwHz = (uint32_t)request->getParam("ifbw")->value().toInt();
+        if (request->hasParam("gaps")) config.bothGaps = request->getParam("gaps")->value() == "both";
+        if (request->hasParam("verify")) {
+            const uint32_t verify = (uint32_t)request->getParam("verify")->value().toInt();
+            config.verify = verify != 0;
+            config.verifyHz = verify > 1 ? verify : 0;
+        }
+        if (!_vna.start(config)) {
+            request->send(_vna.running() ? 409 : 400, "text/plain",
+                          _vna.running() ? "A calibration run is in progress" : "Invalid host, range or points");
+            return;
+        }
+    }
+    const CalStatus status = _vna.status();
+    char buffer[1024];
+    int n = snprintf(buffer, sizeof(buffer),
+                     "{\"state\":\"%s\",\"step\":\"%s\",\"run\":\"%08x\",\"ms\":%u,\"vna\":\"%s\",\"error\":\"%s\","
+                     "\"corrected\":\"%08x\",\"sweeps\":[",
+                     VnaSequencer::stateName(status.state), CalStoreView::sweepName(status.step),
+                     (unsigned)status.runId, (unsigned)status.totalMs, status.vna, status.error,
+                     (unsigned)_cal.runId());
+    for (size_t i = 0; i < size_t(CalSweep::Count) && n > 0 && size_t(n) < sizeof(buffer); i++) {
+        const CalStepStatus& s = status.steps[i];
+        n += snprintf(buffer + n, sizeof(buffer) - n,
+                      "%s{\"sweep\":\"%s\",\"done\":%s,\"points\":%u,\"relay_ms\":%u,\"sweep_ms\":%u}",
+                      i == 0 ? "" : ",", CalStoreView::sweepName(CalSweep(i)), s.done ? "true" : "false",
+                      (unsigned)s.points, (unsigned)s.relayMs, (unsigned)s.sweepMs);
+    }
+    if (n > 0 && size_t(n) < sizeof(buffer) - 2) {
+        buffer[n++] = ']';
+        buffer[n++] = '}';
+        buffer[n] = '\0';
+    }
+    request->send(200, "application/json", buffer);
+}
+
+// Corrected a few points at a time as the connection takes them; the reply
+// ends early if a new run replaces this one meanwhile
+void WebServerManager::sendCorrectedSweep(AsyncWebServerRequest *request, const String& name) {
+    CalSweep sweep = CalSweep::Count;
+    for (size_t i = 0; i < size_t(CalSweep::Count); i++) {
+        if (name == CalStoreView::sweepName(CalSweep(i))) sweep = CalSweep(i);
+    }
+    const uint32_t runId = _cal.runId();
+    if (sweep == CalSweep::Count || runId == 0 || _cal.points(sweep) == 0) {
+        request->send(404, "text/plain", "No corrected sweep of that name");
+        return;
+    }
+    request->send(request->beginChunkedResponse("text/plain",
+        [this, sweep, runId, next = size_t(0), header = true](uint8_t *buffer, size_t maxLen, size_t) mutable -> size_t {
+            static constexpr size_t BATCH = 16;
+            static constexpr size_t LINE = 48; // "29999999 -1234567 1234567\n" with margin
+            char *out = reinterpret_cast<char*>(buffer);
+            size_t used = 0;
+            if (header) {
+                const int n = snprintf(out, maxLen, "%% GAPTuner VNA run %08x, %s, OSL corrected\n",
+                                       (unsigned)runId, CalStoreView::sweepName(sweep));
+                if (n < 0 || size_t(n) >= maxLen) return 0;
+                used = size_t(n);
+                header = false;
+            }
+            float freqHz[BATCH], re[BATCH], im[BATCH];
+            while (maxLen - used >= LINE) {
+                const size_t want = (maxLen - used) / LINE < BATCH ? (maxLen - used) / LINE : BATCH;
+                const size_t got = _cal.read(sweep, runId, next, want, freqHz, re, im);
+                if (got == 0) break;
+                for (size_t i = 0; i < got; i++) {
+                    used += snprintf(out + used, maxLen - used, "%.0f %.7g %.7g\n", freqHz[i], re[i], im[i]);
+                }
+                next += got;
+            }
+            return used;
+        }));
+}
+
 void WebServerManager::handleNotFoundRequest(AsyncWebServerRequest *request) {
     request->send(404, "text/plain", "Not found");
 }
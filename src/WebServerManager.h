@@ -3,32 +3,81 @@
 
 #include <Arduino.h> // For String
 #include <ESPAsyncWebServer.h>
+#include "ApiV1.h"
+#include "TunerMetrics.h" // For HttpRoute
+#include "TunerState.h"
+#include "WebAssets.h"
 
 // Forward declarations for classes used by reference/pointer
+class CalCorrector;
 class GAPTuner;
 class NetworkMgr;
-
-// Extern declaration for HTML string defined in main.cpp
-extern const char index_html[];
+class PowerManager;
+class RelayExecutor;
+class RigFollower;
+class VnaSequencer;
 
 class WebServerManager {
 public:
     static constexpr const char* WIFI_STATUS_ONLINE = "online";
     static constexpr const char* WIFI_STATUS_OFFLINE = "offline";
 
-    WebServerManager(AsyncWebServer& srv, GAPTuner& tuner, NetworkMgr& netMgr);
+    static constexpr uint32_t LINK_CHECK_MS = 2000;  // WiFi link and RSSI sampled for /events
+    static constexpr uint32_t HEARTBEAT_MS  = 15000; // keeps idle /events connections verifiably alive
+    static constexpr uint32_t EVENTS_RETRY_MS = 2000; // browser reconnect delay after a dropped /events
+
+    WebServerManager(AsyncWebServer& srv, GAPTuner& tuner, RelayExecutor& executor, NetworkMgr& netMgr,
+                     TunerMetrics& metrics, TunerState& state, RigFollower& rig, PowerManager& power,
+                     VnaSequencer& vna, CalCorrector& cal);
     void setupRoutes();
     void begin();
+    // Called from loop(): link status changes and the /events heartbeat
+    void service(uint32_t nowMs);
+
+    // Sends an embedded UI file, or 304 if the browser's copy is current
+    static void sendAsset(AsyncWebServerRequest *request, const WebAsset& asset);
 
 private:
     AsyncWebServer& _server;
     GAPTuner&       _gaptuner;
+    RelayExecutor&  _executor;
     NetworkMgr&     _networkMgr;
+    TunerMetrics&   _metrics;
+    TunerState&     _state;
+    RigFollower&    _rig;
+    PowerManager&   _power;
+    VnaSequencer&   _vna;
+    CalCorrector&   _cal;
+    ApiV1           _api;
+    AsyncEventSource _events;
+    uint32_t        _lastLinkCheckMs;
+    uint32_t        _lastHeartbeatMs;
+
+    typedef void (WebServerManager::*Handler)(AsyncWebServerRequest *request);
+    // Registers a GET handler and records its latency under route; every
+    // request but a /metrics scrape counts as activity for PowerManager
+    void route(const char* uri, HttpRoute route, Handler handler);
+    // Same for an embedded UI file at its own path
+    void route(const WebAsset& asset, HttpRoute route);
 
-    void handleRootRequest(AsyncWebServerRequest *request);
     void handleButtonRequest(AsyncWebServerRequest *request);
+    void handleTuneRequest(AsyncWebServerRequest *request);
+    void handleJobRequest(AsyncWebServerRequest *request);
+    void sendJobAccepted(AsyncWebServerRequest *request, uint32_t jobId);
+    void handleApiRequest(AsyncWebServerRequest *request);
+    // One JSON reply from a buffer, without an intermediate String
+    void sendJson(AsyncWebServerRequest *request, int status, const char* json, size_t length);
     void handleWiFiStatusRequest(AsyncWebServerRequest *request);
+    void handleMetricsRequest(AsyncWebServerRequest *request);
+    void handleRigRequest(AsyncWebServerRequest *request);
+    void handlePowerRequest(AsyncWebServerRequest *request);
+    void handleCalRequest(AsyncWebServerRequest *request);
+    void sendCorrectedSweep(AsyncWebServerRequest *request, const String& name);
     void handleNotFoundRequest(AsyncWebServerRequest *request);
+
+    // /events: TunerState pushed as "state" events with the version as id
+    static void onStateChange(void* context, uint32_t version);
+    void handleEventsConnect(AsyncEventSourceClient *client);
 };
 
 #endif // WEBSERVER_MANAGER_H
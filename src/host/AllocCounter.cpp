@@ -0,0 +1,73 @@
+#include "AllocCounter.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+namespace {
+
+thread_local AllocStats s_thread = {0, 0, 0, 0};
+std::atomic<uint64_t> s_allocations(0), s_frees(0), s_allocated(0);
+std::atomic<int64_t> s_bytes(0);
+
+void* counted(size_t size)
+{
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    // The usable size, so that a free subtracts exactly what was added
+    const int64_t bytes = int64_t(malloc_usable_size(p));
+    s_thread.allocations++;
+    s_thread.bytes += bytes;
+    s_thread.allocated += uint64_t(bytes);
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocated.fetch_add(uint64_t(bytes), std::memory_order_relaxed);
+    s_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+}
+
+void release(void* p)
+{
+    if (p == nullptr) {
+        return;
+    }
+    const int64_t bytes = int64_t(malloc_usable_size(p));
+    s_thread.frees++;
+    s_thread.bytes -= bytes;
+    s_frees.fetch_add(1, std::memory_order_relaxed);
+    s_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    free(p);
+}
+
+void* countedOrThrow(size_t size)
+{
+    void* p = counted(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+} // namespace
+
+AllocStats threadAllocs()
+{
+    return s_thread;
+}
+
+AllocStats processAllocs()
+{
+    return AllocStats{s_allocations.load(), s_frees.load(), s_bytes.load(), s_allocated.load()};
+}
+
+void* operator new(size_t size) { return countedOrThrow(size); }
+void* operator new[](size_t size) { return countedOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted(size); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
@@ -0,0 +1,30 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Counts operator new / delete in the host program (AllocCounter.cpp
+// replaces the global operators). Heap use of the firmware code built for
+// the host goes through new, so a path that allocates shows up here; plain
+// malloc does not.
+struct AllocStats {
+    uint64_t allocations;
+    uint64_t frees;
+    int64_t  bytes;      // live: allocated minus freed
+    uint64_t allocated;  // bytes, in total
+};
+
+// This thread only: the request path under test, whatever the others do
+AllocStats threadAllocs();
+// The whole process
+AllocStats processAllocs();
+
+// Difference of two readings
+inline AllocStats allocsSince(const AllocStats& before, const AllocStats& now)
+{
+    return AllocStats{now.allocations - before.allocations, now.frees - before.frees, now.bytes - before.bytes,
+                      now.allocated - before.allocated};
+}
+
+#endif // ALLOC_COUNTER_H
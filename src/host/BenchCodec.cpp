@@ -0,0 +1,231 @@
+// bench-codec: the error-bounded sweep codec on the sample sweeps. Reports
+// compression against raw floats (8 bytes a point) with the error achieved,
+// and the cost of decoding one bin and whole sweeps.
+//
+//   program bench-codec [--block 32] [--points 1001] [--repeat 200000] [--seed 1]
+//
+// Data: the impedance sweeps of docs/Longz and docs/Shortz at several SWR
+// and ohm limits, and S11 / S21 of tuner networks (TunerDesign, ideal L
+// network) over 1.5-30 MHz as a personality block holds them, within |S|
+// limits only (an S11 of a mismatched network is near 1, where SWR is not a
+// useful limit). Checks every
+// point against its tolerance and the limits it came from, that one-bin
+// decodes match block decodes, and that bad input is refused.
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "Personality.h"
+#include "SweepCodec.h"
+#include "SweepFile.h"
+#include "TunerDesign.h"
+
+namespace {
+
+struct Series {
+    std::string        name;
+    std::vector<float> re, im;
+    bool               impedance;
+};
+
+struct Limits {
+    float maxOhms; // or maxS for reflection data
+    float maxSwr;
+};
+
+double swrOf(double gamma)
+{
+    return (1.0 + gamma) / (1.0 - gamma);
+}
+
+double gammaOfZ(double re, double im, double z0)
+{
+    return hypot(re - z0, im) / hypot(re + z0, im);
+}
+
+// Ideal L network of a tune state, capacitor on the antenna side
+AbcdMatrix networkAbcd(const TunerModel& model, uint16_t lMask, uint16_t cMask, float hz)
+{
+    std::vector<Cplx> z(model.numInductorStates()), y(model.numCapacitorStates());
+    model.seriesImpedances(hz, z.data());
+    model.shuntAdmittances(hz, y.data());
+    const AbcdMatrix series = {Cplx{1, 0}, z[lMask], Cplx{0, 0}, Cplx{1, 0}};
+    const AbcdMatrix shunt = {Cplx{1, 0}, Cplx{0, 0}, y[cMask], Cplx{1, 0}};
+    return cascadeAbcd(series, shunt);
+}
+
+} // namespace
+
+int cmdBenchCodec(int argc, char** argv)
+{
+    const uint16_t blockSize = uint16_t(argNumber(argc, argv, "--block", SweepEncoder::DEFAULT_BLOCK));
+    const size_t points = size_t(argNumber(argc, argv, "--points", 1001));
+    const int repeat = int(argNumber(argc, argv, "--repeat", 200000));
+    std::mt19937 rng(unsigned(argNumber(argc, argv, "--seed", 1)));
+    if (blockSize < 2 || points < 2) {
+        printf("--block and --points must be at least 2\n");
+        return 1;
+    }
+
+    std::vector<Series> series;
+    const char* const files[] = {"docs/Longz", "docs/Shortz"};
+    for (const char* file : files) {
+        SweepData data;
+        if (!loadSweepFile(file, data)) {
+            printf("cannot read %s\n", file);
+            return 1;
+        }
+        series.push_back(Series{file + 5, data.re, data.im, true});
+    }
+    const TunerModel model = TunerDesign::model();
+    const uint16_t lTop = uint16_t(model.numInductorStates() - 1), cTop = uint16_t(model.numCapacitorStates() - 1);
+    const struct { uint16_t l, c; } states[] = {{0, 0}, {1, 3}, {uint16_t(lTop / 3), uint16_t(cTop / 2)}, {lTop, cTop}};
+    for (const auto& state : states) {
+        Series s11{"", std::vector<float>(points), std::vector<float>(points), false};
+        Series s21 = s11;
+        for (size_t i = 0; i < points; i++) {
+            Cplx s[4];
+            abcdToS(networkAbcd(model, state.l, state.c, float(1.5e6 + 28.5e6 * double(i) / double(points - 1))),
+                    model.z0(), s);
+            s11.re[i] = s[size_t(SParam::S11)].re;
+            s11.im[i] = s[size_t(SParam::S11)].im;
+            s21.re[i] = s[size_t(SParam::S21)].re;
+            s21.im[i] = s[size_t(SParam::S21)].im;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "L%u C%u S11", (unsigned)state.l, (unsigned)state.c);
+        s11.name = name;
+        snprintf(name, sizeof(name), "L%u C%u S21", (unsigned)state.l, (unsigned)state.c);
+        s21.name = name;
+        series.push_back(s11);
+        series.push_back(s21);
+    }
+
+    const Limits zLimits[] = {{0.0f, 0.001f}, {0.0f, 0.01f}, {0.0f, 0.05f}, {0.5f, 0.0f}, {0.1f, 0.01f}};
+    const Limits sLimits[] = {{1e-5f, 0.0f}, {1e-4f, 0.0f}, {1e-3f, 0.0f}};
+    const float z0 = 50.0f;
+
+    size_t failures = 0;
+    printf("block %u\n%-14s %8s %8s %7s %7s %10s %10s\n", (unsigned)blockSize, "series", "ohm/|S|", "SWR", "bytes",
+           "ratio", "max |err|", "max dSWR");
+    std::vector<uint8_t> buffer;
+    std::vector<float> tol, re, im;
+    for (const Series& s : series) {
+        const size_t n = s.re.size();
+        const Limits* limits = s.impedance ? zLimits : sLimits;
+        const size_t numLimits = s.impedance ? sizeof(zLimits) / sizeof(zLimits[0]) : sizeof(sLimits) / sizeof(sLimits[0]);
+        tol.resize(n);
+        re.resize(n);
+        im.resize(n);
+        for (size_t k = 0; k < numLimits; k++) {
+            const Limits& lim = limits[k];
+            if (s.impedance) {
+                impedanceTolerance(s.re.data(), s.im.data(), n, lim.maxOhms, lim.maxSwr, z0, tol.data());
+            } else {
+                reflectionTolerance(s.re.data(), s.im.data(), n, lim.maxOhms, lim.maxSwr, tol.data());
+            }
+            buffer.assign(SweepEncoder::maxEncodedSize(n, blockSize), 0);
+            const size_t bytes = SweepEncoder::encode(s.re.data(), s.im.data(), tol.data(), n, buffer.data(),
+                                                      buffer.size(), blockSize);
+            SweepCodecView view;
+            if (bytes == 0 || !view.attach(buffer.data(), bytes) || view.size() != n || view.encodedSize() != bytes) {
+                printf("%-14s FAIL: not encoded\n", s.name.c_str());
+                failures++;
+                continue;
+            }
+            view.decode(0, n, re.data(), im.data());
+            double maxErr = 0.0, maxSwrErr = 0.0;
+            bool bounded = true, same = true;
+            for (size_t i = 0; i < n; i++) {
+                const double err = hypot(double(re[i]) - s.re[i], double(im[i]) - s.im[i]);
+                maxErr = fmax(maxErr, err);
+                bounded = bounded && err <= tol[i];
+                const double g0 = s.impedance ? gammaOfZ(s.re[i], s.im[i], z0) : hypot(s.re[i], s.im[i]);
+                const double g1 = s.impedance ? gammaOfZ(re[i], im[i], z0) : hypot(re[i], im[i]);
+                const double dSwr = g0 < 1.0 && g1 < 1.0 ? fabs(swrOf(g1) - swrOf(g0)) : 0.0;
+                maxSwrErr = fmax(maxSwrErr, dSwr);
+                if (lim.maxSwr > 0.0f) bounded = bounded && dSwr <= lim.maxSwr * 1.0001;
+                if (lim.maxOhms > 0.0f) bounded = bounded && err <= lim.maxOhms;
+                const Cplx one = view.at(i);
+                same = same && one.re == re[i] && one.im == im[i];
+            }
+            // Ranges that start and end inside blocks
+            for (int r = 0; r < 50 && same; r++) {
+                const size_t first = rng() % n, count = 1 + rng() % (n - first);
+                std::vector<float> partRe(count), partIm(count);
+                view.decode(first, count, partRe.data(), partIm.data());
+                for (size_t i = 0; i < count; i++) {
+                    same = same && partRe[i] == re[first + i] && partIm[i] == im[first + i];
+                }
+            }
+            char swr[16] = "-", dSwr[16] = "-";
+            if (s.impedance) {
+                snprintf(swr, sizeof(swr), "%g", double(lim.maxSwr));
+                snprintf(dSwr, sizeof(dSwr), "%.3g", maxSwrErr);
+            }
+            printf("%-14s %8g %8s %7zu %6.1fx %10.3g %10s%s%s\n", s.name.c_str(), double(lim.maxOhms), swr, bytes,
+                   double(8 * n) / double(bytes), maxErr, dSwr,
+                   bounded ? "" : "  FAIL: over the limit", same ? "" : "  FAIL: bin decode differs");
+            if (!bounded || !same) failures++;
+        }
+    }
+
+    // Refusals
+    {
+        const Series& s = series[0];
+        const size_t n = s.re.size();
+        impedanceTolerance(s.re.data(), s.im.data(), n, 0.0f, 0.01f, z0, tol.data());
+        buffer.assign(SweepEncoder::maxEncodedSize(n, blockSize), 0);
+        const bool small = SweepEncoder::encode(s.re.data(), s.im.data(), tol.data(), n, buffer.data(),
+                                                buffer.size() - 1, blockSize) != 0;
+        std::vector<float> zero(tol);
+        zero[n / 2] = 0.0f;
+        const bool zeroTol =
+            SweepEncoder::encode(s.re.data(), s.im.data(), zero.data(), n, buffer.data(), buffer.size(), blockSize) != 0;
+        const size_t bytes =
+            SweepEncoder::encode(s.re.data(), s.im.data(), tol.data(), n, buffer.data(), buffer.size(), blockSize);
+        SweepCodecView view;
+        const bool truncated = view.attach(buffer.data(), bytes - 1);
+        buffer[0] ^= 1;
+        const bool badMagic = view.attach(buffer.data(), bytes);
+        printf("refused: buffer too small %s, zero tolerance %s, truncated %s, bad magic %s\n", small ? "NO" : "yes",
+               zeroTol ? "NO" : "yes", truncated ? "NO" : "yes", badMagic ? "NO" : "yes");
+        if (small || zeroTol || truncated || badMagic || view.size() != 0) failures++;
+    }
+
+    // One bin at random, and whole sweeps
+    {
+        const Series& s = series[0];
+        const size_t n = s.re.size();
+        impedanceTolerance(s.re.data(), s.im.data(), n, 0.0f, 0.01f, z0, tol.data());
+        buffer.assign(SweepEncoder::maxEncodedSize(n, blockSize), 0);
+        SweepCodecView view;
+        view.attach(buffer.data(), SweepEncoder::encode(s.re.data(), s.im.data(), tol.data(), n, buffer.data(),
+                                                        buffer.size(), blockSize));
+        std::vector<uint32_t> bins(4096);
+        for (uint32_t& b : bins) b = uint32_t(rng() % n);
+        float sink = 0.0f;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) sink += view.at(bins[size_t(r) & 4095]).re;
+        auto t1 = std::chrono::steady_clock::now();
+        const int sweeps = repeat / 1000 + 1;
+        for (int r = 0; r < sweeps; r++) {
+            view.decode(0, n, re.data(), im.data());
+            sink += re[size_t(r) % n];
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        printf("%s: one bin %.0f ns, whole sweep %.1f us (%.0f Mpoint/s)%s\n", s.name.c_str(),
+               std::chrono::duration<double, std::nano>(t1 - t0).count() / repeat,
+               std::chrono::duration<double, std::micro>(t2 - t1).count() / sweeps,
+               double(n) * sweeps / std::chrono::duration<double, std::micro>(t2 - t1).count(),
+               sink == 12345.0f ? " " : "");
+    }
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// bench-executor: checks the lock-free job queue and RelayExecutor on
+// simulated relays with real-time pulse delays.
+//
+//   program bench-executor [--producers 4] [--items 200000]
+//
+// Queue: several producer threads push numbered items into a BoundedQueue
+// while one consumer drains it; every item must arrive exactly once.
+// Executor: a burst of button presses is submitted while a 90 ms antenna
+// sequence runs. Each submit must return at once, the queued duplicates in a
+// relay group must be superseded by the latest one, and the relays must end
+// in the state of the last request of each group.
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "SimRelayHal.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double usSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+static bool benchQueue(int producers, uint32_t items)
+{
+    BoundedQueue<uint32_t, 64> queue;
+    std::vector<uint8_t> seen(size_t(producers) * items, 0);
+    std::atomic<int> running(producers);
+    const Clock::time_point t0 = Clock::now();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (uint32_t i = 0; i < items; i++) {
+                const uint32_t v = uint32_t(p) * items + i;
+                while (!queue.push(v)) std::this_thread::yield();
+            }
+            running.fetch_sub(1);
+        });
+    }
+    size_t received = 0, duplicates = 0;
+    uint32_t v;
+    while (running.load() > 0 || received < seen.size()) {
+        if (queue.pop(v)) {
+            if (seen[v]++) duplicates++;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread& t : threads) t.join();
+    const double us = usSince(t0);
+
+    size_t missing = 0;
+    for (uint8_t s : seen) missing += s == 0;
+    printf("queue: %d producers x %u items, %.1f M items/s, %zu missing, %zu duplicated\n",
+           producers, items, seen.size() / us, missing, duplicates);
+    return missing == 0 && duplicates == 0 && !queue.pop(v);
+}
+
+static bool benchExecutor()
+{
+    SimRelayHal hal;
+    RelayController relays(hal);
+    GAPTuner tuner(relays);
+    relays.initializePins();
+    tuner.applyDefaultState();
+    hal.setRealTime(true);
+    RelayExecutor executor(tuner);
+    executor.begin();
+
+    using B = GAPTuner::ButtonID;
+    const B burst[] = {
+        B::ANTENNA_LONG,                             // starts running at once
+        B::ANTENNA_SHORT, B::TUNING_1, B::ANTENNA_LONG,
+        B::CAL_OPEN, B::TUNING_2, B::ANTENNA_SHORT,  // latest antenna / tuning request
+        B::CAL_LOAD
+    };
+    std::vector<uint32_t> ids;
+    double worstSubmitUs = 0.0;
+    const Clock::time_point t0 = Clock::now();
+    for (B b : burst) {
+        const Clock::time_point t = Clock::now();
+        ids.push_back(executor.submitButton(int(b)));
+        const double us = usSince(t);
+        if (us > worstSubmitUs) worstSubmitUs = us;
+        if (b == B::ANTENNA_LONG && ids.size() == 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10)); // let it start
+        }
+    }
+    while (!executor.idle()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const double totalMs = usSince(t0) * 1e-3;
+    executor.end();
+
+    bool ok = true;
+    size_t superseded = 0;
+    printf("executor: worst submit %.1f us, burst finished after %.0f ms\n", worstSubmitUs, totalMs);
+    for (size_t i = 0; i < ids.size(); i++) {
+        RelayJobStatus status;
+        if (ids[i] == 0 || !executor.status(ids[i], status)) {
+            printf("  job for %d: no status\n", int(burst[i]));
+            ok = false;
+            continue;
+        }
+        printf("  job %2u button %d: %s\n", (unsigned)status.id, int(burst[i]), RelayExecutor::stateName(status.state));
+        superseded += status.state == RelayJobState::Superseded;
+        // The last request of each group must have run
+        bool last = true;
+        for (size_t j = i + 1; j < ids.size(); j++) {
+            last = last && RelayExecutor::groupOf(int(burst[j])) != RelayExecutor::groupOf(int(burst[i]));
+        }
+        if (last && status.state != RelayJobState::Done) {
+            printf("  FAIL: latest request of its group did not run\n");
+            ok = false;
+        }
+    }
+    hal.settle();
+    if (hal.contact(RelayId::K8) || hal.contact(RelayId::LK99) || !hal.contact(RelayId::K3)) {
+        printf("  FAIL: relays not in the state of the last requests\n");
+        ok = false;
+    }
+    // Submitting must not wait for a sequence (90 ms)
+    if (worstSubmitUs > 10000.0 || superseded == 0) {
+        printf("  FAIL: %s\n", superseded == 0 ? "nothing coalesced" : "submit blocked");
+        ok = false;
+    }
+    return ok;
+}
+
+int cmdBenchExecutor(int argc, char** argv)
+{
+    const int producers = int(argNumber(argc, argv, "--producers", 4));
+    const uint32_t items = uint32_t(argNumber(argc, argv, "--items", 200000));
+    bool ok = benchQueue(producers, items);
+    ok = benchExecutor() && ok;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// bench-kernels: checks every complex kernel path built into this binary
+// against a double-precision reference and reports its throughput.
+//
+//   program bench-kernels [--n 4099] [--repeat 2000] [--seed 1]
+//
+// Fails if any result is outside the tolerances stated in CplxKernels.h.
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <complex>
+#include <random>
+#include <vector>
+#include "CplxKernels.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+
+typedef std::complex<double> cd;
+
+struct SoA {
+    std::vector<float> re, im;
+    explicit SoA(size_t n) : re(n), im(n) {}
+    CplxIn in() const { return CplxIn{re.data(), im.data()}; }
+    CplxOut out() { return CplxOut{re.data(), im.data()}; }
+    cd at(size_t i) const { return cd(re[i], im[i]); }
+};
+
+struct Abcd {
+    SoA a, b, c, d;
+    explicit Abcd(size_t n) : a(n), b(n), c(n), d(n) {}
+    AbcdIn in() const { return AbcdIn{a.in(), b.in(), c.in(), d.in()}; }
+    AbcdOut out() { return AbcdOut{a.out(), b.out(), c.out(), d.out()}; }
+};
+
+// Relative error of got against want, scaled by the size of the terms
+static double relError(cd got, cd want, double scale)
+{
+    return std::abs(got - want) / (scale > 0.0 ? scale : 1.0);
+}
+
+static double swrOf(double gamma2)
+{
+    const double g = sqrt(gamma2);
+    return (1.0 + g) / (1.0 - g);
+}
+
+int cmdBenchKernels(int argc, char** argv)
+{
+    const size_t n = size_t(argNumber(argc, argv, "--n", 4099)); // odd to exercise the tails
+    const int repeat = int(argNumber(argc, argv, "--repeat", 2000));
+    std::mt19937 rng(unsigned(argNumber(argc, argv, "--seed", 1)));
+    // Magnitudes over several decades, as in normalised L/C tables
+    std::uniform_real_distribution<float> mant(-1.0f, 1.0f), expo(-3.0f, 3.0f);
+    auto fill = [&](SoA& v) {
+        for (size_t i = 0; i < n; i++) {
+            const float s = powf(10.0f, expo(rng));
+            v.re[i] = mant(rng) * s;
+            v.im[i] = mant(rng) * s;
+        }
+    };
+
+    SoA x(n), y(n), out(n);
+    fill(x); fill(y);
+    Abcd m1(n), m2(n), mo(n);
+    for (SoA* v : {&m1.a, &m1.b, &m1.c, &m1.d, &m2.a, &m2.b, &m2.c, &m2.d}) fill(*v);
+    // Antenna-like loads with SWR 1..20 against 50 ohm
+    const float z0 = 50.0f;
+    SoA z(n);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t i = 0; i < n; i++) {
+        const double gmax = (20.0 - 1.0) / (20.0 + 1.0);
+        const cd g = std::polar(gmax * sqrt(unit(rng)), 2.0 * M_PI * unit(rng));
+        const cd zi = double(z0) * (1.0 + g) / (1.0 - g);
+        z.re[i] = float(zi.real());
+        z.im[i] = float(zi.imag());
+    }
+    std::vector<float> scalarOut(n);
+
+    printf("%zu elements, tolerance %.1g relative, %.1g SWR\n", n, CPLX_KERNEL_REL_TOL, CPLX_KERNEL_SWR_TOL);
+    printf("%-8s %10s %10s %10s %10s %10s   (M elements/s)\n", "path", "mul", "div", "abs2", "gamma2", "cascade");
+    bool ok = true;
+    for (size_t p = 0; p < NUM_KERNEL_PATHS; p++) {
+        const CplxKernels* k = cplxKernels(KernelPath(p));
+        if (k == nullptr) {
+            continue;
+        }
+        double err[5] = {0, 0, 0, 0, 0};
+
+        k->mul(x.in(), y.in(), out.out(), n);
+        for (size_t i = 0; i < n; i++) err[0] = fmax(err[0], relError(out.at(i), x.at(i) * y.at(i), std::abs(x.at(i)) * std::abs(y.at(i))));
+        k->div(x.in(), y.in(), out.out(), n);
+        for (size_t i = 0; i < n; i++) err[1] = fmax(err[1], relError(out.at(i), x.at(i) / y.at(i), std::abs(x.at(i)) / std::abs(y.at(i))));
+        k->abs2(x.in(), out.re.data(), n);
+        for (size_t i = 0; i < n; i++) err[2] = fmax(err[2], relError(out.re[i], std::norm(x.at(i)), std::norm(x.at(i))));
+        k->gamma2(z.in(), z0, out.re.data(), n);
+        for (size_t i = 0; i < n; i++) {
+            const cd zi = z.at(i);
+            err[3] = fmax(err[3], fabs(swrOf(out.re[i]) - swrOf(std::norm((zi - double(z0)) / (zi + double(z0))))));
+        }
+        k->cascade(m1.in(), m2.in(), mo.out(), n);
+        for (size_t i = 0; i < n; i++) {
+            const cd a1 = m1.a.at(i), b1 = m1.b.at(i), c1 = m1.c.at(i), d1 = m1.d.at(i);
+            const cd a2 = m2.a.at(i), b2 = m2.b.at(i), c2 = m2.c.at(i), d2 = m2.d.at(i);
+            err[4] = fmax(err[4], relError(mo.a.at(i), a1 * a2 + b1 * c2, std::abs(a1) * std::abs(a2) + std::abs(b1) * std::abs(c2)));
+            err[4] = fmax(err[4], relError(mo.b.at(i), a1 * b2 + b1 * d2, std::abs(a1) * std::abs(b2) + std::abs(b1) * std::abs(d2)));
+            err[4] = fmax(err[4], relError(mo.c.at(i), c1 * a2 + d1 * c2, std::abs(c1) * std::abs(a2) + std::abs(d1) * std::abs(c2)));
+            err[4] = fmax(err[4], relError(mo.d.at(i), c1 * b2 + d1 * d2, std::abs(c1) * std::abs(b2) + std::abs(d1) * std::abs(d2)));
+        }
+
+        // Aliased output (out = x) must give the same values
+        SoA alias = x;
+        k->mul(alias.in(), y.in(), alias.out(), n);
+        k->mul(x.in(), y.in(), out.out(), n);
+        const bool aliasOk = alias.re == out.re && alias.im == out.im;
+
+        double rate[5];
+        for (int kernel = 0; kernel < 5; kernel++) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeat; r++) {
+                switch (kernel) {
+                case 0: k->mul(x.in(), y.in(), out.out(), n); break;
+                case 1: k->div(x.in(), y.in(), out.out(), n); break;
+                case 2: k->abs2(x.in(), out.re.data(), n); break;
+                case 3: k->gamma2(z.in(), z0, out.re.data(), n); break;
+                case 4: k->cascade(m1.in(), m2.in(), mo.out(), n); break;
+                }
+            }
+            const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            rate[kernel] = double(n) * repeat / secs * 1e-6;
+        }
+
+        const bool pass = aliasOk && err[0] <= CPLX_KERNEL_REL_TOL && err[1] <= CPLX_KERNEL_REL_TOL &&
+                          err[2] <= CPLX_KERNEL_REL_TOL && err[3] <= CPLX_KERNEL_SWR_TOL && err[4] <= CPLX_KERNEL_REL_TOL;
+        printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f\n", k->name, rate[0], rate[1], rate[2], rate[3], rate[4]);
+        printf("%-8s %10.2g %10.2g %10.2g %10.2g %10.2g   max error%s: %s\n", "", err[0], err[1], err[2], err[3], err[4],
+               aliasOk ? "" : ", ALIASING BROKEN", pass ? "ok" : "FAIL");
+        ok = ok && pass;
+    }
+    printf("best path: %s\n%s\n", cplxKernelsBest().name, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// bench-metrics: cost of recording a metric and of rendering /metrics, and
+// checks on the exposition text.
+//
+//   program bench-metrics [--events 10000000] [--threads 4] [--chunk 256] [--print]
+//
+// Recording: histogram observations and counter increments from one thread
+// (ns per event) and from several threads at once (no event may be lost).
+// Rendering: TunerMetrics is filled by relay jobs on simulated relays,
+// then rendered in --chunk byte pieces as the chunked HTTP response does.
+// The result must equal a single-buffer render, every sample line must be
+// "name{labels} value", and histogram buckets must be cumulative with the
+// +Inf bucket equal to _count. --print shows the text.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "Metrics.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "SimRelayHal.h"
+#include "TunerMetrics.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double nsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+static bool benchRecording(uint32_t events, int threads)
+{
+    static const uint32_t bounds[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000};
+    MetricHistogram histogram(bounds, sizeof(bounds) / sizeof(bounds[0]));
+    MetricCounter counter;
+
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < events; i++) {
+        histogram.observe((i * 2654435761u) >> 14); // spread over all buckets
+    }
+    const double observeNs = nsSince(t0) / events;
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < events; i++) {
+        counter.add();
+    }
+    const double addNs = nsSince(t0) / events;
+    printf("record: histogram observe %.1f ns, counter add %.1f ns (one thread)\n", observeNs, addNs);
+
+    MetricHistogram shared(bounds, sizeof(bounds) / sizeof(bounds[0]));
+    std::vector<std::thread> pool;
+    t0 = Clock::now();
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&shared, events, t] {
+            for (uint32_t i = 0; i < events; i++) shared.observe((i + uint32_t(t)) & 0x3FFFF);
+        });
+    }
+    for (std::thread& t : pool) t.join();
+    const double contendedNs = nsSince(t0) / events;
+    uint64_t total = 0;
+    for (size_t i = 0; i <= shared.bounds(); i++) total += shared.bucket(i);
+    printf("record: %d threads on one histogram %.1f ns per event per thread, %llu of %llu events counted\n",
+           threads, contendedNs, (unsigned long long)total, (unsigned long long)events * threads);
+    return total == uint64_t(events) * threads && counter.value() == events && observeNs < 1000.0;
+}
+
+static std::string renderAll(const MetricsRegistry& registry, size_t chunk, size_t& chunks)
+{
+    std::vector<char> buffer(chunk);
+    std::string text;
+    MetricsCursor cursor;
+    chunks = 0;
+    for (;;) {
+        const size_t n = registry.render(buffer.data(), buffer.size(), cursor);
+        if (n == 0) break;
+        text.append(buffer.data(), n);
+        chunks++;
+    }
+    return text;
+}
+
+// Sample lines are "name value" or "name{labels} value"; histograms are
+// cumulative and end with +Inf == _count
+static bool checkExposition(const std::string& text, size_t& samples)
+{
+    bool ok = true;
+    samples = 0;
+    double lastBucket = -1.0, infBucket = -1.0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t end = text.find('\n', pos);
+        if (end == std::string::npos) {
+            printf("  unterminated last line\n");
+            return false;
+        }
+        const std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (line.compare(0, 7, "# HELP ") == 0 || line.compare(0, 7, "# TYPE ") == 0) {
+            continue;
+        }
+        const size_t space = line.rfind(' ');
+        const size_t brace = line.find('{');
+        char* valueEnd = nullptr;
+        const double value = space == std::string::npos ? 0.0 : strtod(line.c_str() + space + 1, &valueEnd);
+        const bool nameOk = space != std::string::npos && space > 0 &&
+                            (brace == std::string::npos || (brace < space && line[space - 1] == '}'));
+        if (!nameOk || valueEnd == nullptr || *valueEnd != '\0') {
+            printf("  malformed line: %s\n", line.c_str());
+            ok = false;
+            continue;
+        }
+        samples++;
+        const std::string name = line.substr(0, brace == std::string::npos ? space : brace);
+        if (name.size() > 7 && name.compare(name.size() - 7, 7, "_bucket") == 0) {
+            if (value < lastBucket) {
+                printf("  bucket not cumulative: %s\n", line.c_str());
+                ok = false;
+            }
+            lastBucket = value;
+            if (line.find("le=\"+Inf\"") != std::string::npos) infBucket = value;
+        } else if (name.size() > 6 && name.compare(name.size() - 6, 6, "_count") == 0) {
+            if (value != infBucket) {
+                printf("  _count %g differs from the +Inf bucket %g: %s\n", value, infBucket, line.c_str());
+                ok = false;
+            }
+            lastBucket = -1.0;
+            infBucket = -1.0;
+        }
+    }
+    return ok;
+}
+
+int cmdBenchMetrics(int argc, char** argv)
+{
+    const uint32_t events = uint32_t(argNumber(argc, argv, "--events", 10000000));
+    const int threads = int(argNumber(argc, argv, "--threads", 4));
+    const size_t chunk = size_t(argNumber(argc, argv, "--chunk", 256));
+    bool ok = benchRecording(events, threads);
+
+    TunerMetrics metrics;
+    SimRelayHal hal;
+    RelayController relays(hal);
+    GAPTuner tuner(relays);
+    relays.attachMetrics(&metrics);
+    relays.initializePins();
+    tuner.applyDefaultState();
+    RelayExecutor executor(tuner);
+    executor.attachMetrics(&metrics);
+    executor.begin();
+    for (int round = 0; round < 3; round++) {
+        for (int id = 1; id <= GAPTuner::NUM_ACTIONS; id++) {
+            executor.submitButton(id);
+            while (!executor.idle()) std::this_thread::yield();
+        }
+    }
+    executor.submitTune(7100000); // no tune table: counted as failed
+    while (!executor.idle()) std::this_thread::yield();
+    executor.end();
+    for (size_t r = 0; r < size_t(HttpRoute::Count); r++) {
+        metrics.httpLatency[r].observe(uint32_t(150 * (r + 1)));
+    }
+    metrics.sampleSystem();
+
+    size_t chunks = 0, singleChunks = 0;
+    const Clock::time_point t0 = Clock::now();
+    const std::string text = renderAll(metrics.registry(), chunk, chunks);
+    const double renderUs = nsSince(t0) * 1e-3;
+    const std::string single = renderAll(metrics.registry(), 1 << 20, singleChunks);
+    size_t samples = 0;
+    const bool formatOk = checkExposition(text, samples);
+    printf("render: %zu series, %zu samples, %zu bytes in %zu chunks of %zu, %.0f us\n",
+           metrics.registry().count(), samples, text.size(), chunks, chunk, renderUs);
+    if (text != single) {
+        printf("  FAIL: chunked render differs from a single-buffer render\n");
+        ok = false;
+    }
+    ok = formatOk && ok;
+    if (metrics.relayActuations[size_t(RelayId::K8)].value() == 0 || metrics.relayPlan.sumUs() == 0 ||
+        metrics.qsyButton.sumUs() == 0 || metrics.jobsFailed.value() != 1) {
+        printf("  FAIL: relay sequences were not recorded\n");
+        ok = false;
+    }
+    if (argFlag(argc, argv, "--print")) {
+        fputs(text.c_str(), stdout);
+    }
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+// bench-osl: the Open/Short/Load error correction against a double-precision
+// reference, on synthetic standards read through a known error box, and its
+// throughput per kernel path.
+//
+//   program bench-osl [--points 1001] [--repeat 2000]
+//
+// The raw sweeps are what the software VNA of sim-cal reads (VnaErrorModel:
+// directivity, source match, a lossy cable) for the standards as built, the
+// antennas of docs/Longz and docs/Shortz and a few loads from 5 to 500 ohm,
+// rounded to float as they are stored. Checks:
+//   terms      e00, e11 and delta solved from the standards against the model
+//   reference  corrected reflection against a straightforward double
+//              implementation (3x3 solve per point) on the same raw data,
+//              and against the true reflection
+//   store      solving from a vnacal partition written through CalSlotWriter;
+//              standards of different runs are refused
+//   refusals   standards on different grids, too many points, an open that
+//              is also used as the short
+// Fails outside OSL_GAMMA_TOL.
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <complex>
+#include <vector>
+#include "CalStore.h"
+#include "CplxKernels.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "MemoryFlash.h"
+#include "OslCorrection.h"
+#include "SweepFile.h"
+#include "VnaSim.h"
+
+namespace {
+
+typedef std::complex<double> cd;
+
+// Float storage of raw data and table, against |gamma| <= 1
+const double OSL_GAMMA_TOL = 1e-5;
+
+struct Sweep {
+    std::vector<float> freq, re, im;
+    explicit Sweep(size_t n = 0) : freq(n), re(n), im(n) {}
+    CalTrace trace() const { return CalTrace(freq.data(), re.data(), im.data(), freq.size()); }
+    CplxIn in() const { return CplxIn{re.data(), im.data()}; }
+    cd at(size_t i) const { return cd(re[i], im[i]); }
+};
+
+struct Dut {
+    const char*      name;
+    std::vector<cd>  gamma; // true reflection per point
+};
+
+// What the VNA reads for a DUT, as stored
+Sweep measure(const std::vector<double>& hz, const std::vector<cd>& gamma, const VnaErrorModel& errors)
+{
+    Sweep s(hz.size());
+    for (size_t i = 0; i < hz.size(); i++) {
+        const cd m = errors.measured(hz[i], gamma[i]);
+        s.freq[i] = float(hz[i]);
+        s.re[i] = float(m.real());
+        s.im[i] = float(m.imag());
+    }
+    return s;
+}
+
+// Reference: the three standard equations e00 + G m e11 - G delta = m solved
+// as a 3x3 system per point, Gaussian elimination with partial pivoting
+void referenceTerms(const cd g[3], const cd m[3], cd& e00, cd& e11, cd& delta)
+{
+    cd a[3][4];
+    for (int r = 0; r < 3; r++) {
+        a[r][0] = 1.0;
+        a[r][1] = g[r] * m[r];
+        a[r][2] = -g[r];
+        a[r][3] = m[r];
+    }
+    for (int c = 0; c < 3; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < 3; r++) {
+            if (std::abs(a[r][c]) > std::abs(a[pivot][c])) pivot = r;
+        }
+        for (int k = 0; k < 4; k++) std::swap(a[c][k], a[pivot][k]);
+        for (int r = c + 1; r < 3; r++) {
+            const cd f = a[r][c] / a[c][c];
+            for (int k = c; k < 4; k++) a[r][k] -= f * a[c][k];
+        }
+    }
+    cd x[3];
+    for (int r = 2; r >= 0; r--) {
+        cd s = a[r][3];
+        for (int k = r + 1; k < 3; k++) s -= a[r][k] * x[k];
+        x[r] = s / a[r][r];
+    }
+    e00 = x[0];
+    e11 = x[1];
+    delta = x[2];
+}
+
+// Writes one sweep into its slot as the VNA's trace reply would arrive
+bool storeSweep(MemoryFlash& flash, CalSweep sweep, uint32_t runId, const Sweep& s)
+{
+    CalSlotWriter writer;
+    if (!writer.begin(&flash, sweep)) return false;
+    char item[80];
+    for (size_t i = 0; i < s.freq.size(); i++) {
+        const int n = snprintf(item, sizeof(item), "%s[%.0f,%.9g,%.9g]", i == 0 ? "" : ",", double(s.freq[i]),
+                               double(s.re[i]), double(s.im[i]));
+        if (!writer.write(item, size_t(n))) return false;
+    }
+    if (!writer.write("\n", 1) || !writer.done()) return false;
+    CalSlotHeader header = {};
+    header.runId = runId;
+    header.sweep = uint8_t(sweep);
+    return writer.finish(header);
+}
+
+} // namespace
+
+int cmdBenchOsl(int argc, char** argv)
+{
+    const size_t points = size_t(argNumber(argc, argv, "--points", 1001));
+    const int repeat = int(argNumber(argc, argv, "--repeat", 2000));
+    if (points < 2 || points > CAL_SLOT_MAX_POINTS) {
+        printf("--points must be 2..%u\n", (unsigned)CAL_SLOT_MAX_POINTS);
+        return 1;
+    }
+    SweepData antenna[2];
+    if (!loadSweepFile("docs/Longz", antenna[0]) || !loadSweepFile("docs/Shortz", antenna[1])) {
+        printf("cannot read docs/Longz and docs/Shortz\n");
+        return 1;
+    }
+
+    const VnaStandards standards;
+    const VnaErrorModel errors;
+    CalKit kit;
+    kit.openFarads = float(standards.openFarads);
+    kit.shortHenries = float(standards.shortHenries);
+    kit.loadOhms = float(standards.loadOhms);
+    kit.loadHenries = float(standards.loadHenries);
+    kit.z0 = float(standards.z0);
+
+    std::vector<double> hz(points);
+    for (size_t i = 0; i < points; i++) hz[i] = nearbyint(1.5e6 + (30e6 - 1.5e6) * double(i) / double(points - 1));
+    std::vector<cd> open(points), shortCircuit(points), load(points);
+    for (size_t i = 0; i < points; i++) {
+        open[i] = standards.open(hz[i]);
+        shortCircuit[i] = standards.shortCircuit(hz[i]);
+        load[i] = standards.load(hz[i]);
+    }
+    const Sweep rawOpen = measure(hz, open, errors), rawShort = measure(hz, shortCircuit, errors),
+                rawLoad = measure(hz, load, errors);
+
+    std::vector<Dut> duts;
+    const char* const antennaNames[] = {"antenna long", "antenna short"};
+    for (size_t a = 0; a < 2; a++) {
+        const ImpedanceSweep sweep = antenna[a].view();
+        Dut dut{antennaNames[a], std::vector<cd>(points)};
+        for (size_t i = 0; i < points; i++) {
+            Cplx z{50.0f, 0.0f};
+            sweep.impedanceAt(float(fmin(fmax(hz[i], sweep.minFreq()), sweep.maxFreq())), z);
+            dut.gamma[i] = standards.gamma(cd(z.re, z.im));
+        }
+        duts.push_back(dut);
+    }
+    const struct { const char* name; cd z; } loads[] = {
+        {"5 ohm", cd(5, 0)}, {"500 ohm", cd(500, 0)}, {"50+j200", cd(50, 200)}, {"10-j100", cd(10, -100)},
+    };
+    for (const auto& l : loads) duts.push_back(Dut{l.name, std::vector<cd>(points, standards.gamma(l.z))});
+
+    size_t failures = 0;
+    std::vector<float> table(OslCorrection::TABLE_FLOATS * points);
+    OslCorrection osl;
+    osl.setTable(table.data(), points);
+    if (!osl.solve(rawOpen.trace(), rawShort.trace(), rawLoad.trace(), kit)) {
+        printf("FAIL: standards not solved\n");
+        return 1;
+    }
+
+    // Error terms against the model and the reference solve
+    double termsModel = 0.0, termsRef = 0.0;
+    std::vector<cd> refE00(points), refE11(points), refDelta(points);
+    for (size_t i = 0; i < points; i++) {
+        const cd g[3] = {cd(kit.open(hz[i]).re, kit.open(hz[i]).im),
+                         cd(kit.shortCircuit(hz[i]).re, kit.shortCircuit(hz[i]).im),
+                         cd(kit.load(hz[i]).re, kit.load(hz[i]).im)};
+        const cd m[3] = {rawOpen.at(i), rawShort.at(i), rawLoad.at(i)};
+        referenceTerms(g, m, refE00[i], refE11[i], refDelta[i]);
+        cd e00, e11, e10e01;
+        errors.terms(hz[i], e00, e11, e10e01);
+        Cplx o00, o11, oDelta;
+        osl.terms(i, o00, o11, oDelta);
+        const cd got[3] = {cd(o00.re, o00.im), cd(o11.re, o11.im), cd(oDelta.re, oDelta.im)};
+        const cd model[3] = {e00, e11, e00 * e11 - e10e01};
+        const cd ref[3] = {refE00[i], refE11[i], refDelta[i]};
+        for (int k = 0; k < 3; k++) {
+            termsModel = fmax(termsModel, std::abs(got[k] - model[k]));
+            termsRef = fmax(termsRef, std::abs(got[k] - ref[k]));
+        }
+    }
+    printf("%zu points, 1.5-30 MHz; error terms off by %.2g from the model, %.2g from the reference\n", points,
+           termsModel, termsRef);
+    if (!(termsModel < OSL_GAMMA_TOL) || !(termsRef < OSL_GAMMA_TOL)) {
+        printf("  FAIL: error terms\n");
+        failures++;
+    }
+
+    printf("%-14s %12s %12s %12s\n", "dut", "vs reference", "vs truth", "max |Z err|");
+    for (const Dut& dut : duts) {
+        const Sweep raw = measure(hz, dut.gamma, errors);
+        Sweep gamma(points), z(points);
+        osl.correctGamma(0, raw.in(), CplxOut{gamma.re.data(), gamma.im.data()}, points);
+        osl.correct(0, raw.in(), CplxOut{z.re.data(), z.im.data()}, points);
+        double vsRef = 0.0, vsTruth = 0.0, zErr = 0.0;
+        for (size_t i = 0; i < points; i++) {
+            const cd m = raw.at(i);
+            const cd ref = (m - refE00[i]) / (m * refE11[i] - refDelta[i]);
+            vsRef = fmax(vsRef, std::abs(gamma.at(i) - ref));
+            vsTruth = fmax(vsTruth, std::abs(gamma.at(i) - dut.gamma[i]));
+            const cd zTrue = standards.z0 * (1.0 + dut.gamma[i]) / (1.0 - dut.gamma[i]);
+            zErr = fmax(zErr, std::abs(z.at(i) - zTrue) / std::abs(zTrue));
+        }
+        printf("%-14s %12.2g %12.2g %11.2g%%\n", dut.name, vsRef, vsTruth, zErr * 100.0);
+        if (!(vsRef < OSL_GAMMA_TOL) || !(vsTruth < OSL_GAMMA_TOL) || !(zErr < 1e-3)) {
+            printf("  FAIL: %s\n", dut.name);
+            failures++;
+        }
+        // In place, raw buffer reused for the result
+        Sweep inPlace = raw;
+        osl.correct(0, inPlace.in(), CplxOut{inPlace.re.data(), inPlace.im.data()}, points);
+        if (inPlace.re != z.re || inPlace.im != z.im) {
+            printf("  FAIL: %s corrected in place differs\n", dut.name);
+            failures++;
+        }
+    }
+
+    // The standards of a run from the vnacal partition
+    {
+        MemoryFlash flash(CAL_STORE_SIZE);
+        bool stored = storeSweep(flash, CalSweep::Open, 7, rawOpen) && storeSweep(flash, CalSweep::Short, 7, rawShort) &&
+                      storeSweep(flash, CalSweep::Load, 7, rawLoad);
+        CalStoreView view;
+        OslCorrection fromStore;
+        std::vector<float> storeTable(OslCorrection::TABLE_FLOATS * points);
+        fromStore.setTable(storeTable.data(), points);
+        const bool solved = stored && view.attach(flash.bytes.data(), flash.bytes.size()) &&
+                            fromStore.solve(view, kit) && fromStore.runId() == 7 && storeTable == table;
+        stored = storeSweep(flash, CalSweep::Load, 8, rawLoad);
+        const bool mixed = stored && fromStore.solve(view, kit);
+        printf("store: %s, standards of two runs %s\n", solved ? "solved, same table" : "FAIL",
+               mixed ? "FAIL: accepted" : "refused");
+        if (!solved || mixed || fromStore.size() != 0) failures++;
+    }
+
+    // Refusals
+    {
+        Sweep shifted = rawLoad;
+        shifted.freq[points / 2] += 1.0f;
+        std::vector<float> small(OslCorrection::TABLE_FLOATS * (points - 1));
+        OslCorrection smallOsl;
+        smallOsl.setTable(small.data(), points - 1);
+        const bool grid = osl.solve(rawOpen.trace(), rawShort.trace(), shifted.trace(), kit);
+        const bool degenerate = osl.solve(rawOpen.trace(), rawOpen.trace(), rawLoad.trace(), kit);
+        const bool tooBig = smallOsl.solve(rawOpen.trace(), rawShort.trace(), rawLoad.trace(), kit);
+        printf("refused: different grids %s, open as short %s, table too small %s\n", grid ? "NO" : "yes",
+               degenerate ? "NO" : "yes", tooBig ? "NO" : "yes");
+        if (grid || degenerate || tooBig || osl.size() != 0) failures++;
+        osl.solve(rawOpen.trace(), rawShort.trace(), rawLoad.trace(), kit);
+    }
+
+    // Throughput: solving once, then correcting a whole sweep to impedance
+    const Sweep raw = measure(hz, duts[0].gamma, errors);
+    Sweep z(points);
+    printf("%-8s %14s %16s\n", "path", "solve (us)", "correct (us)");
+    for (size_t p = 0; p < NUM_KERNEL_PATHS; p++) {
+        const CplxKernels* kernels = cplxKernels(KernelPath(p));
+        if (kernels == nullptr) continue;
+        osl.setKernels(*kernels);
+        auto t0 = std::chrono::steady_clock::now();
+        const int solves = repeat / 20 + 1;
+        for (int r = 0; r < solves; r++) osl.solve(rawOpen.trace(), rawShort.trace(), rawLoad.trace(), kit);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) osl.correct(0, raw.in(), CplxOut{z.re.data(), z.im.data()}, points);
+        auto t2 = std::chrono::steady_clock::now();
+        printf("%-8s %14.1f %16.2f\n", kernels->name,
+               std::chrono::duration<double, std::micro>(t1 - t0).count() / solves,
+               std::chrono::duration<double, std::micro>(t2 - t1).count() / repeat);
+    }
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
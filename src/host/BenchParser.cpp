@@ -0,0 +1,284 @@
+// bench-parser: SweepParser throughput and correctness on sweep files.
+//
+//   program bench-parser [--sweep docs/Longz] [--repeat 200] [--max-chunk 1460] [--seed 1]
+//
+// Each file is parsed whole and in random-sized chunks into a small sample
+// buffer, checked against a line-at-a-time sscanf reference, stored through a
+// SweepSlotWriter into an in-memory slot and read back. Touchstone copies of
+// the sweep (S, Y and Z in RI/MA/DB with kHz/MHz/GHz units, and a 2-port
+// file with wrapped records) are generated and parsed back.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "BlockUpload.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "MemoryFlash.h"
+#include "SweepFile.h"
+#include "SweepParser.h"
+#include "SweepStore.h"
+
+static bool readFile(const char* path, std::string& out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+// The fgets/sscanf loader this parser replaced, kept as the reference
+static void parseReference(const std::string& text, SweepData& out)
+{
+    out = SweepData();
+    size_t pos = 0;
+    char line[256];
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) end = text.size();
+        const size_t len = std::min(end - pos, sizeof(line) - 1);
+        memcpy(line, text.data() + pos, len);
+        line[len] = '\0';
+        pos = end + 1;
+        char* comment = strchr(line, '%');
+        if (comment) *comment = '\0';
+        float freq, re, im;
+        if (sscanf(line, "%f %f %f", &freq, &re, &im) == 3) {
+            out.freqHz.push_back(freq);
+            out.re.push_back(re);
+            out.im.push_back(im);
+        }
+    }
+}
+
+// Parses text in chunks of 1..maxChunk bytes (maxChunk 0: one chunk) into a
+// deliberately small sample buffer, collecting everything into out
+static bool parseChunked(SweepParser& parser, const std::string& text, size_t maxChunk, unsigned& seed,
+                         SweepData& out, std::vector<float>* re2 = nullptr)
+{
+    static constexpr size_t BATCH = 64;
+    const size_t params = re2 ? 4 : 1;
+    float freq[BATCH], re[BATCH * 4], im[BATCH * 4]; // room for 2-port records
+    parser.reset();
+    parser.setSampleBuffer(freq, re, im, BATCH);
+    out = SweepData();
+    auto drain = [&]() {
+        for (size_t i = 0; i < parser.sampleCount(); i++) {
+            out.freqHz.push_back(freq[i]);
+            out.re.push_back(re[i * params]);
+            out.im.push_back(im[i * params]);
+            if (re2) re2->push_back(re[i * params + 1]); // S21 real part
+        }
+        parser.clearSamples();
+    };
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t len = text.size() - pos;
+        if (maxChunk) {
+            seed = seed * 1103515245u + 12345u;
+            len = std::min(len, size_t(1 + (seed >> 8) % maxChunk));
+        }
+        const size_t end = pos + len;
+        while (pos < end) {
+            pos += parser.feed(text.data() + pos, end - pos);
+            if (parser.full()) {
+                drain();
+            } else if (parser.status() != SweepParser::Status::Ok) {
+                return false;
+            }
+        }
+    }
+    parser.finish();
+    drain();
+    return parser.status() == SweepParser::Status::Ok;
+}
+
+static float maxRelError(const SweepData& a, const SweepData& b)
+{
+    if (a.freqHz.size() != b.freqHz.size()) return INFINITY;
+    float worst = 0.0f;
+    for (size_t i = 0; i < a.freqHz.size(); i++) {
+        const float scale = hypotf(b.re[i], b.im[i]) + 1e-3f;
+        worst = fmaxf(worst, fabsf(a.freqHz[i] - b.freqHz[i]) / b.freqHz[i]);
+        worst = fmaxf(worst, hypotf(a.re[i] - b.re[i], a.im[i] - b.im[i]) / scale);
+    }
+    return worst;
+}
+
+struct TouchstoneCase {
+    const char* unit;
+    double      scale;
+    char        param;  // 'S', 'Y', 'Z'
+    const char* format; // "RI", "MA", "DB"
+};
+
+// Writes a 1-port Touchstone rendering of an impedance sweep
+static std::string toTouchstone(const SweepData& z, const TouchstoneCase& tc, double z0)
+{
+    std::string text = "! generated by bench-parser\n";
+    char line[160];
+    snprintf(line, sizeof(line), "# %s %c %s R %g\n", tc.unit, tc.param, tc.format, z0);
+    text += line;
+    for (size_t i = 0; i < z.freqHz.size(); i++) {
+        double a = z.re[i], b = z.im[i];
+        if (tc.param == 'S') {
+            // S = (Z - z0) / (Z + z0)
+            const double nr = a - z0, dr = a + z0, d = dr * dr + b * b;
+            const double sr = (nr * dr + b * b) / d, si = (b * dr - nr * b) / d;
+            a = sr; b = si;
+        } else if (tc.param == 'Y') {
+            const double d = a * a + b * b; // normalised: y = z0 / Z
+            a = z0 * a / d; b = -z0 * b / d;
+        } else {
+            a /= z0; b /= z0;
+        }
+        double x = a, y = b;
+        if (strcmp(tc.format, "RI") != 0) {
+            const double mag = hypot(a, b);
+            x = strcmp(tc.format, "DB") == 0 ? 20.0 * log10(mag) : mag;
+            y = atan2(b, a) * 180.0 / M_PI;
+        }
+        snprintf(line, sizeof(line), "%.9g\t%.9g %.9g\n", z.freqHz[i] / tc.scale, x, y);
+        text += line;
+    }
+    return text;
+}
+
+static bool checkFile(const char* path, int repeat, size_t maxChunk, unsigned seed)
+{
+    std::string text;
+    if (!readFile(path, text)) {
+        return false;
+    }
+    bool ok = true;
+    SweepData reference, parsed;
+    parseReference(text, reference);
+
+    SweepParser parser;
+    static SweepParser::Annotation ann[SWEEP_SLOT_MAX_ANNOTATIONS];
+    parser.setAnnotationBuffer(ann, SWEEP_SLOT_MAX_ANNOTATIONS);
+    if (!parseChunked(parser, text, 0, seed, parsed) || maxRelError(parsed, reference) != 0.0f) {
+        printf("  FAIL: whole-file parse differs from the reference\n");
+        ok = false;
+    }
+    const size_t lines = parser.lineCount();
+    printf("%s: %zu bytes, %zu lines, %zu samples, %zu annotations\n", path, text.size(), lines,
+           parsed.freqHz.size(), parser.annotationCount());
+    for (size_t i = 0; i < parser.annotationCount() && i < 3; i++) {
+        printf("  annotation %.4f MHz: %s L=%.3g uH C=%.4g pF\n", ann[i].freqHz * 1e-6,
+               ann[i].capFirst ? "C,L" : "L,C", ann[i].henries * 1e6, ann[i].farads * 1e12);
+    }
+
+    for (int r = 0; r < 20; r++) {
+        if (!parseChunked(parser, text, maxChunk, seed, parsed) || maxRelError(parsed, reference) != 0.0f) {
+            printf("  FAIL: chunked parse (max %zu bytes) differs from the reference\n", maxChunk);
+            ok = false;
+            break;
+        }
+    }
+
+    // Throughput: whole-buffer parse vs. the sscanf reference
+    float freq[256], re[256], im[256];
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        parser.reset();
+        parser.setSampleBuffer(freq, re, im, 256);
+        size_t pos = 0;
+        while (pos < text.size() && (parser.status() == SweepParser::Status::Ok || parser.full())) {
+            pos += parser.feed(text.data() + pos, text.size() - pos);
+            parser.clearSamples();
+        }
+        parser.finish();
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        parseReference(text, reference);
+    }
+    const double refSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  parser    %7.1f MB/s %6.2f M lines/s\n", text.size() * repeat / secs * 1e-6, lines * repeat / secs * 1e-6);
+    printf("  reference %7.1f MB/s %6.2f M lines/s\n", text.size() * repeat / refSecs * 1e-6, lines * repeat / refSecs * 1e-6);
+
+    // Store into the second slot of an in-memory sweeps partition in upload-sized
+    // blocks and read it back
+    static MemoryFlash flash(SWEEP_SLOT_SIZE * NUM_GAP_LENGTHS);
+    static SweepSlotWriter writer;
+    flash.base = uint32_t(GapLength::Short) * SWEEP_SLOT_SIZE;
+    bool stored = writer.begin(&flash);
+    for (size_t pos = 0; stored && pos < text.size(); pos += BLOCK_UPLOAD_SIZE) {
+        stored = writer.write(text.data() + pos, std::min(text.size() - pos, size_t(BLOCK_UPLOAD_SIZE)));
+    }
+    stored = stored && writer.finish();
+    SweepStoreView view;
+    const ImpedanceSweep slot = view.attach(flash.bytes.data(), flash.bytes.size()) ? view.sweep(GapLength::Short) : ImpedanceSweep();
+    bool same = stored && slot.size() == reference.freqHz.size() &&
+                view.annotationCount(GapLength::Short) == parser.annotationCount() &&
+                view.sweep(GapLength::Long).size() == 0;
+    for (size_t i = 0; same && i < slot.size(); i++) {
+        same = slot.freqAt(i) == reference.freqHz[i] && slot.zAt(i).re == reference.re[i] && slot.zAt(i).im == reference.im[i];
+    }
+    printf("  slot store: %s, %u points\n", same ? "ok" : "FAIL", unsigned(slot.size()));
+    ok = ok && same;
+
+    // Touchstone renderings of the same sweep
+    static const TouchstoneCase cases[] = {
+        {"Hz",  1.0, 'Z', "RI"}, {"kHz", 1e3, 'S', "MA"}, {"MHz", 1e6, 'S', "DB"},
+        {"GHz", 1e9, 'S', "RI"}, {"MHz", 1e6, 'Y', "MA"}, {"MHz", 1e6, 'Z', "DB"},
+    };
+    for (const TouchstoneCase& tc : cases) {
+        const std::string s1p = toTouchstone(reference, tc, 50.0);
+        SweepParser ts;
+        ts.setConvertToImpedance(true);
+        const bool parsedOk = parseChunked(ts, s1p, maxChunk, seed, parsed);
+        const float err = parsedOk ? maxRelError(parsed, reference) : INFINITY;
+        // S near |S| = 1 amplifies float rounding when converted back to Z
+        const bool pass = err < 2e-3f;
+        printf("  s1p %-3s %c %s: %s (max rel error %.2g)\n", tc.unit, tc.param, tc.format, pass ? "ok" : "FAIL", err);
+        ok = ok && pass;
+    }
+
+    // 2-port: S11 S21 on the first line, S12 S22 wrapped onto the next
+    std::string s2p = "# MHz S RI R 50\n";
+    char line[200];
+    for (size_t i = 0; i < reference.freqHz.size(); i++) {
+        snprintf(line, sizeof(line), "%.9g %.9g %.9g %g 0\n %g 0 %.9g %.9g ! wrapped\n", reference.freqHz[i] * 1e-6,
+                 reference.re[i], reference.im[i], double(i), double(i), reference.re[i], reference.im[i]);
+        s2p += line;
+    }
+    SweepParser twoPort(2);
+    std::vector<float> s21;
+    const bool twoOk = parseChunked(twoPort, s2p, maxChunk, seed, parsed, &s21);
+    bool twoPass = twoOk && maxRelError(parsed, reference) < 1e-6f;
+    for (size_t i = 0; twoPass && i < s21.size(); i++) twoPass = s21[i] == float(i);
+    printf("  s2p wrapped records: %s\n", twoPass ? "ok" : "FAIL");
+    return ok && twoPass;
+}
+
+int cmdBenchParser(int argc, char** argv)
+{
+    const int repeat = int(argNumber(argc, argv, "--repeat", 200));
+    const size_t maxChunk = size_t(argNumber(argc, argv, "--max-chunk", 1460));
+    const unsigned seed = unsigned(argNumber(argc, argv, "--seed", 1));
+    const char* sweep = argString(argc, argv, "--sweep", nullptr);
+
+    bool ok = true;
+    if (sweep) {
+        ok = checkFile(sweep, repeat, maxChunk, seed);
+    } else {
+        ok = checkFile("docs/Longz", repeat, maxChunk, seed) && ok;
+        ok = checkFile("docs/Shortz", repeat, maxChunk, seed) && ok;
+    }
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// bench-solver: runs the exhaustive match solver at every point of a sweep
+// file and reports combinations/second, then checks that branch and bound
+// finds the same states and reports how many it evaluates.
+//
+//   program bench-solver [--sweep docs/Longz] [--repeat 5] [--lbits 8] [--lsb-uh 0.3]
+//                        [--cbits 8] [--lsb-pf 5] [--ql 150] [--qc 500] [--swr-target 1.5]
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "HostModel.h"
+#include "MatchSolver.h"
+#include "SweepFile.h"
+
+int cmdBenchSolver(int argc, char** argv)
+{
+    const char* path = argString(argc, argv, "--sweep", "docs/Longz");
+    const int repeat = int(argNumber(argc, argv, "--repeat", 5));
+    // Defaults to 8+8 bank bits rather than TunerDesign to show how the search scales
+    const TunerModel model = modelFromArgs(argc, argv,
+        TunerModel::binaryWeighted(8, 0.3e-6f, 150.0f, 8, 5e-12f, 500.0f));
+
+    SweepData data;
+    if (!loadSweepFile(path, data)) {
+        return 1;
+    }
+    const ImpedanceSweep sweep = data.view();
+    MatchSolver solver(model);
+
+    printf("sweep %s: %zu points, %.3f-%.3f MHz\n", path, sweep.size(),
+           sweep.minFreq() * 1e-6, sweep.maxFreq() * 1e-6);
+    printf("banks: %u L bits, %u C bits -> %zu combinations per solve\n",
+           model.inductorBits(), model.capacitorBits(),
+           2 * model.numInductorStates() * model.numCapacitorStates());
+
+    // Exhaustive reference
+    std::vector<MatchResult> reference(sweep.size());
+    uint64_t combos = 0;
+    size_t solves = 0;
+    float worstSwr = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < sweep.size(); i++) {
+            const MatchResult res = solver.solve(sweep.freqAt(i), sweep.zAt(i));
+            reference[i] = res;
+            combos += res.evaluated;
+            solves++;
+            if (res.swr > worstSwr) worstSwr = res.swr;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("exhaustive: %zu solves in %.3f s: %.1f us/solve, %.1f M combinations/s, worst SWR %.2f\n",
+           solves, secs, secs * 1e6 / double(solves), double(combos) / secs * 1e-6, worstSwr);
+
+    // Branch and bound must find the same state at every point
+    solver.setSearchMode(SearchMode::BranchAndBound);
+    size_t mismatches = 0;
+    uint64_t evaluated = 0, pruned = 0;
+    uint32_t worstEvaluated = 0;
+    solves = 0;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < sweep.size(); i++) {
+            const MatchResult res = solver.solve(sweep.freqAt(i), sweep.zAt(i));
+            evaluated += res.evaluated;
+            pruned += res.pruned;
+            if (res.evaluated > worstEvaluated) worstEvaluated = res.evaluated;
+            solves++;
+            if (r == 0 && res.state != reference[i].state) {
+                if (mismatches++ < 5) {
+                    printf("  MISMATCH at %.4f MHz: gamma2 %.9g vs exhaustive %.9g\n",
+                           sweep.freqAt(i) * 1e-6, res.gamma2, reference[i].gamma2);
+                }
+            }
+        }
+    }
+    const double bnbSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("branch and bound: %.1f us/solve (%.1fx), %.1f states evaluated (worst %u), %.1f subtrees pruned per solve, %zu mismatches\n",
+           bnbSecs * 1e6 / double(solves), secs / bnbSecs, double(evaluated) / double(solves), worstEvaluated,
+           double(pruned) / double(solves), mismatches);
+
+    const float swrTarget = float(argNumber(argc, argv, "--swr-target", 0));
+    if (swrTarget > 1.0f) {
+        solver.setSwrTarget(swrTarget);
+        size_t met = 0, reachable = 0;
+        evaluated = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < sweep.size(); i++) {
+            const MatchResult res = solver.solve(sweep.freqAt(i), sweep.zAt(i));
+            evaluated += res.evaluated;
+            if (reference[i].swr <= swrTarget) reachable++;
+            if (res.swr <= swrTarget) met++;
+        }
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("SWR target %.2f: met at %zu of %zu reachable points, %.1f us/solve, %.1f states evaluated\n",
+               swrTarget, met, reachable, secs * 1e6 / double(sweep.size()), double(evaluated) / double(sweep.size()));
+        solver.setSwrTarget(0.0f);
+    }
+
+    // A few spot frequencies for comparison with the hand-computed annotations in the sweep files
+    const float spots[] = {3.525e6f, 7.1e6f, 14.1e6f, 21.1e6f, 28.4e6f};
+    for (float f : spots) {
+        MatchResult res;
+        if (!solver.solve(sweep, f, res)) continue;
+        printf("  %7.3f MHz: %s  L=%6.2f uH  C=%7.1f pF  SWR %.2f\n", f * 1e-6,
+               res.state.topology == Topology::LC ? "L,C" : "C,L",
+               model.inductanceOf(res.state.lMask) * 1e6, model.capacitanceOf(res.state.cMask) * 1e12, res.swr);
+    }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+// check-arena: the dataset arena allocator as the firmware uses it, with the
+// host build's guard and leak tracking (ARENA_CHECKS).
+//
+//   program check-arena [--bytes 1048576] [--repeat 1000000]
+//
+// Checks:
+//   alignment  default (cache line) and requested alignments, all inside
+//              the region
+//   exhaustion a full arena refuses and counts the allocation, and keeps
+//              working after a reset
+//   rewind     marks, ArenaScope and reset free in bulk; the high-water
+//              mark stays; released memory is poisoned
+//   carve      a child budget resets without touching its parent's data
+//   overrun    a write past an allocation is found by check() and when the
+//              allocation is released
+//   leaks      allocations that outlive their scope are listed by tag; a
+//              table rebuilt the way CalCorrector does holds steady
+// and reports allocation cost against malloc/free.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "OslCorrection.h"
+
+namespace {
+
+size_t s_failures = 0;
+
+void expect(bool ok, const char* what)
+{
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) s_failures++;
+}
+
+bool inside(const Arena& arena, const void* p, size_t bytes)
+{
+    const uint8_t* base = static_cast<const uint8_t*>(arena.base());
+    const uint8_t* q = static_cast<const uint8_t*>(p);
+    return q >= base && q + bytes <= base + arena.capacity();
+}
+
+bool allBytes(const void* p, size_t n, uint8_t value)
+{
+    const uint8_t* q = static_cast<const uint8_t*>(p);
+    for (size_t i = 0; i < n; i++) {
+        if (q[i] != value) return false;
+    }
+    return true;
+}
+
+void collectTag(const char* tag, size_t bytes, void* ctx)
+{
+    char item[64];
+    snprintf(item, sizeof(item), "%s%s:%zu", static_cast<std::string*>(ctx)->empty() ? "" : " ", tag, bytes);
+    *static_cast<std::string*>(ctx) += item;
+}
+
+std::string liveTags(const Arena& arena)
+{
+    std::string tags;
+    arena.forEachLive(collectTag, &tags);
+    return tags;
+}
+
+} // namespace
+
+int cmdCheckArena(int argc, char** argv)
+{
+    const size_t bytes = size_t(argNumber(argc, argv, "--bytes", 1024 * 1024));
+    const int repeat = int(argNumber(argc, argv, "--repeat", 1000000));
+    if (!ARENA_CHECKS) {
+        printf("built without ARENA_CHECKS\n");
+        return 1;
+    }
+    // Deliberately misaligned, as a heap block need not be
+    std::vector<uint8_t> region(bytes + 64);
+    Arena arena;
+    arena.begin("datasets", region.data() + 3, bytes);
+    printf("arena of %zu bytes at +3, guard %zu bytes\n", arena.capacity(), Arena::GUARD);
+
+    printf("alignment\n");
+    {
+        bool aligned = true, within = true;
+        const size_t aligns[] = {Arena::DEFAULT_ALIGN, 1, 4, 8, 64, 4096};
+        for (size_t i = 0; i < 60; i++) {
+            const size_t align = aligns[i % 6], n = 1 + (i * 37) % 500;
+            void* p = arena.allocate(n, align, "align");
+            aligned = aligned && p != nullptr && (reinterpret_cast<uintptr_t>(p) & (align - 1)) == 0;
+            within = within && inside(arena, p, n);
+        }
+        float* table = arena.allocateArray<float>(1001, "floats");
+        expect(aligned && (reinterpret_cast<uintptr_t>(table) & 31) == 0, "every pointer on its alignment");
+        expect(within && inside(arena, table, 1001 * sizeof(float)), "every allocation inside the region");
+        expect(arena.allocate(16, 3) == nullptr && arena.failures() == 1, "alignment not a power of two refused");
+        expect(arena.allocations() == 61 && arena.check(), "61 live, guards intact");
+        arena.reset();
+        expect(arena.used() == 0 && arena.allocations() == 0 && liveTags(arena).empty(), "reset frees everything");
+    }
+
+    printf("exhaustion\n");
+    {
+        const uint32_t failuresBefore = arena.failures();
+        size_t count = 0;
+        while (arena.allocate(4000, Arena::DEFAULT_ALIGN, "fill") != nullptr) count++;
+        expect(count > 0 && arena.used() <= arena.capacity(), "fills up within its capacity");
+        expect(arena.allocate(4000) == nullptr && arena.failures() == failuresBefore + 2, "refuses and counts, no fallback");
+        expect(arena.allocateArray<float>(SIZE_MAX / 2) == nullptr, "oversized array refused");
+        expect(arena.allocate(arena.available() + 1) == nullptr, "one byte too many refused");
+        const size_t highWater = arena.highWater();
+        arena.reset();
+        expect(arena.allocate(4000) != nullptr && arena.highWater() == highWater, "usable again after reset, high water kept");
+        arena.reset();
+    }
+
+    printf("rewind\n");
+    {
+        arena.allocate(100, Arena::DEFAULT_ALIGN, "kept");
+        const ArenaMark mark = arena.mark();
+        uint8_t* scratch = static_cast<uint8_t*>(arena.allocate(5000, Arena::DEFAULT_ALIGN, "scratch"));
+        memset(scratch, 0x42, 5000);
+        arena.rewind(mark);
+        expect(arena.used() == mark.used && arena.allocations() == 1, "rewind to a mark");
+        expect(allBytes(scratch, 5000, Arena::POISON_BYTE), "released memory poisoned");
+        {
+            ArenaScope scope(arena);
+            arena.allocate(2000, Arena::DEFAULT_ALIGN, "scoped");
+            arena.allocate(3000, Arena::DEFAULT_ALIGN, "scoped");
+        }
+        expect(arena.used() == mark.used && liveTags(arena) == "kept:100", "ArenaScope rewinds on exit");
+        arena.rewind(ArenaMark{arena.used() + 1, 1});
+        expect(arena.used() == mark.used, "a mark past the end is ignored");
+        arena.reset();
+    }
+
+    printf("carve\n");
+    {
+        uint8_t* before = static_cast<uint8_t*>(arena.allocate(256, Arena::DEFAULT_ALIGN, "parent"));
+        memset(before, 0x11, 256);
+        Arena child;
+        expect(arena.carve(child, "cal", 64 * 1024) && inside(arena, child.base(), 64 * 1024), "child inside the parent");
+        uint8_t* after = static_cast<uint8_t*>(arena.allocate(256, Arena::DEFAULT_ALIGN, "parent"));
+        memset(after, 0x22, 256);
+        for (int i = 0; i < 10; i++) {
+            child.reset();
+            memset(child.allocate(child.available() - Arena::GUARD, 1, "table"), 0x33, child.capacity() - Arena::GUARD);
+        }
+        expect(allBytes(before, 256, 0x11) && allBytes(after, 256, 0x22) && arena.check() && child.check(),
+               "child filled and reset, parent untouched");
+        const uint32_t parentFailures = arena.failures();
+        expect(child.allocate(1) == nullptr && child.failures() == 1 && arena.failures() == parentFailures,
+               "child full on its own budget");
+        Arena tooBig;
+        expect(!arena.carve(tooBig, "big", arena.capacity()) && tooBig.capacity() == 0, "carve larger than left refused");
+        arena.reset();
+    }
+
+    printf("overrun\n");
+    {
+        const uint32_t overruns = arena.overruns();
+        uint8_t* p = static_cast<uint8_t*>(arena.allocate(100, Arena::DEFAULT_ALIGN, "victim"));
+        arena.allocate(100, Arena::DEFAULT_ALIGN, "next");
+        expect(arena.check(), "clean before");
+        p[100] = 0; // one past the end
+        expect(!arena.check() && arena.overruns() > overruns, "check() finds a write one past the end");
+        const uint32_t found = arena.overruns();
+        arena.reset();
+        expect(arena.overruns() == found + 1, "found again when released");
+        float* table = arena.allocateArray<float>(64, "table");
+        table[64] = 1.0f;
+        expect(!arena.check(), "float written past an array");
+        arena.reset();
+    }
+
+    printf("leaks\n");
+    {
+        // A request that keeps scratch past its scope
+        arena.allocate(512, Arena::DEFAULT_ALIGN, "table");
+        {
+            ArenaScope scope(arena);
+            arena.allocate(128, Arena::DEFAULT_ALIGN, "scratch");
+        }
+        arena.allocate(64, Arena::DEFAULT_ALIGN, "forgotten");
+        expect(liveTags(arena) == "table:512 forgotten:64", "live allocations listed by tag");
+        arena.reset();
+
+        // CalCorrector::rebuild(): reset, then the table for the run
+        Arena cal;
+        arena.carve(cal, "cal", OslCorrection::TABLE_FLOATS * 4096 * sizeof(float) + Arena::DEFAULT_ALIGN + Arena::GUARD);
+        bool steady = true;
+        for (size_t run = 0; run < 1000; run++) {
+            const size_t points = 101 + (run * 997) % 3996;
+            cal.reset();
+            float* table = cal.allocateArray<float>(OslCorrection::TABLE_FLOATS * points, "osl table");
+            steady = steady && table != nullptr && cal.allocations() == 1 && cal.check();
+        }
+        expect(steady && cal.failures() == 0 && cal.highWater() <= cal.capacity(),
+               "1000 rebuilds of 101..4096 points, one live table");
+        cal.reset();
+        expect(cal.allocateArray<float>(OslCorrection::TABLE_FLOATS * 4200, "osl table") == nullptr &&
+                   cal.failures() == 1,
+               "a 4200-point run refused");
+        arena.reset();
+    }
+
+    // Cost of a scratch allocation
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        uintptr_t sink = 0;
+        for (int r = 0; r < repeat; r++) {
+            ArenaScope scope(arena);
+            sink += reinterpret_cast<uintptr_t>(arena.allocate(size_t(64 + (r & 1023)), Arena::DEFAULT_ALIGN, "bench"));
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) {
+            void* p = malloc(size_t(64 + (r & 1023)));
+            sink += reinterpret_cast<uintptr_t>(p);
+            free(p);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        printf("allocate + rewind %.1f ns (with checks), malloc + free %.1f ns%s\n",
+               std::chrono::duration<double, std::nano>(t1 - t0).count() / repeat,
+               std::chrono::duration<double, std::nano>(t2 - t1).count() / repeat, sink == 1 ? " " : "");
+    }
+
+    printf("\n%s\n", s_failures == 0 ? "PASS" : "FAIL");
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+// check-relay-masks: checks the GPIO set/clear masks GAPTuner builds from its
+// relay action tables at compile time against the tables themselves.
+//
+//   program check-relay-masks [--verbose]
+//
+// For every table each pin must be in the set or clear mask of its GPIO bank
+// (word pin / 32, bit pin % 32; word 2 is the LC bank shift register) as its
+// level says, and no other bit may be
+// present. The table is also written to SimRelayHal both pin by pin and as
+// the mask, and the resulting relay coil states must agree.
+
+#include <stdio.h>
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "RelayController.h"
+#include "SimRelayHal.h"
+
+static bool checkTable(const GAPTuner::ActionTable& t, bool verbose)
+{
+    uint32_t set[3] = {0, 0, 0}, clear[3] = {0, 0, 0};
+    bool ok = true;
+    for (size_t i = 0; i < t.count; i++) {
+        const unsigned pin = t.actions[i].pin;
+        for (size_t j = 0; j < i; j++) {
+            if (t.actions[j].pin == pin) {
+                printf("  %s: pin %u listed twice\n", t.name, pin);
+                ok = false;
+            }
+        }
+        (t.actions[i].value ? set : clear)[pin / 32] |= 1u << (pin % 32);
+    }
+    for (size_t w = 0; w < 3; w++) {
+        if (set[w] != t.mask.set[w] || clear[w] != t.mask.clear[w]) {
+            printf("  %s: bank %zu expected set %08X clear %08X, compiled set %08X clear %08X\n", t.name, w,
+                   set[w], clear[w], t.mask.set[w], t.mask.clear[w]);
+            ok = false;
+        }
+    }
+
+    // Same coil states whether written pin by pin or as one mask
+    SimRelayHal byPin, byMask;
+    for (size_t i = 0; i < t.count; i++) {
+        byPin.digitalWrite(t.actions[i].pin, t.actions[i].value);
+    }
+    byMask.writeMask(t.mask);
+    byPin.settle();
+    byMask.settle();
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        if (byPin.contact(RelayId(r)) != byMask.contact(RelayId(r))) {
+            printf("  %s: %s differs when written as a mask\n", t.name, SimRelayHal::relayName(RelayId(r)));
+            ok = false;
+        }
+    }
+
+    size_t registerWrites = 0;
+    for (size_t w = 0; w < 2; w++) {
+        registerWrites += (t.mask.set[w] != 0) + (t.mask.clear[w] != 0);
+    }
+    const bool shifted = (t.mask.set[2] | t.mask.clear[2]) != 0;
+    if (verbose || !ok) {
+        printf("%-18s %2zu pins -> %zu register writes%s  set %04X %08X %08X  clear %04X %08X %08X  %s\n", t.name,
+               t.count, registerWrites, shifted ? " + shift" : "", t.mask.set[2], t.mask.set[1], t.mask.set[0],
+               t.mask.clear[2], t.mask.clear[1], t.mask.clear[0], ok ? "ok" : "FAIL");
+    }
+    return ok;
+}
+
+int cmdCheckRelayMasks(int argc, char** argv)
+{
+    const bool verbose = argFlag(argc, argv, "--verbose");
+    size_t count = 0;
+    const GAPTuner::ActionTable* tables = GAPTuner::actionTables(count);
+    size_t failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        failures += !checkTable(tables[i], verbose);
+    }
+    printf("%zu relay action tables, %zu with wrong masks\n", count, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// check-state-push: the versioned tuner state behind /events, driven by relay
+// jobs on simulated relays.
+//
+//   program check-state-push [--clients 4] [--idle-s 3600] [--print]
+//
+// Every change must push one event with a strictly higher version; an idle
+// tuner must push nothing; a job that was superseded before it ran must not
+// appear; the pushed relays must match the relay controller's shadow
+// register. A reconnecting client gets nothing if its Last-Event-ID is
+// current and exactly the current state otherwise. The longest message,
+// escaped throughout, must fit TunerState::JSON_MAX. Finally the traffic of
+// --clients browsers idling for --idle-s seconds is compared with the old
+// 5 s /wifi-status polling. --print shows the pushed events.
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "SimRelayHal.h"
+#include "TunerState.h"
+
+namespace {
+
+struct PushedEvent {
+    uint32_t    version;
+    std::string json;
+};
+
+// Stands in for WebServerManager::onStateChange
+struct EventLog {
+    const TunerState*        state = nullptr;
+    std::mutex               lock;
+    std::vector<PushedEvent> events;
+
+    static void onChange(void* context, uint32_t)
+    {
+        EventLog* self = static_cast<EventLog*>(context);
+        char json[TunerState::JSON_MAX];
+        uint32_t version = 0;
+        if (self->state->format(json, sizeof(json), version) == 0) {
+            strcpy(json, "<did not fit>");
+        }
+        std::lock_guard<std::mutex> lock(self->lock);
+        self->events.push_back(PushedEvent{version, json});
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        return events.size();
+    }
+};
+
+void waitIdle(const RelayExecutor& executor)
+{
+    while (!executor.idle()) std::this_thread::yield();
+}
+
+bool checkRelays(const TunerState& state, const RelayController& relays)
+{
+    TunerState::Snapshot s;
+    state.snapshot(s);
+    for (size_t i = 0; i < size_t(RelayId::Count); i++) {
+        const int8_t v = relays.state(RelayId(i));
+        if (s.relays[i] != (v < 0 ? '?' : char('0' + v))) {
+            printf("  FAIL: pushed relay %zu is '%c', controller has %d\n", i, s.relays[i], int(v));
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int cmdCheckStatePush(int argc, char** argv)
+{
+    const int clients = int(argNumber(argc, argv, "--clients", 4));
+    const double idleS = argNumber(argc, argv, "--idle-s", 3600);
+    bool ok = true;
+
+    SimRelayHal hal;
+    RelayController relays(hal);
+    GAPTuner tuner(relays);
+    TunerState state;
+    EventLog log;
+    log.state = &state;
+    state.onChange(&EventLog::onChange, &log);
+    relays.initializePins();
+    tuner.applyDefaultState();
+    state.relaysChanged(tuner);
+    RelayExecutor executor(tuner);
+    executor.attachState(&state);
+    executor.begin();
+
+    // One job at a time: a start and a result event each
+    using B = GAPTuner::ButtonID;
+    const B sequence[] = {B::ANTENNA_LONG, B::TUNING_1, B::ANTENNA_SHORT, B::CAL_OPEN, B::TUNING_2};
+    for (B b : sequence) {
+        const size_t before = log.size();
+        executor.submitButton(int(b));
+        waitIdle(executor);
+        TunerState::Snapshot s;
+        state.snapshot(s);
+        const bool gapOk = b == B::ANTENNA_LONG ? s.gapKnown && s.gap == GapLength::Long
+                         : b == B::ANTENNA_SHORT ? s.gapKnown && s.gap == GapLength::Short : true;
+        const bool buttonOk = RelayExecutor::groupOf(int(b)) == RelayGroup::AntennaLength || s.button == uint8_t(b);
+        if (log.size() - before != 2 || s.jobState != RelayJobState::Done || !gapOk || !buttonOk) {
+            printf("  FAIL: button %d pushed %zu events, job %s, gap %s, button %u\n", int(b), log.size() - before,
+                   RelayExecutor::stateName(s.jobState), gapOk ? "ok" : "wrong", (unsigned)s.button);
+            ok = false;
+        }
+        ok = checkRelays(state, relays) && ok;
+    }
+    executor.submitTune(7100000); // no tune table: a failed job is pushed too
+    waitIdle(executor);
+    TunerState::Snapshot failed;
+    state.snapshot(failed);
+    if (failed.jobState != RelayJobState::Failed || failed.message[0] == '\0') {
+        printf("  FAIL: failed tune job not pushed\n");
+        ok = false;
+    }
+
+    // Queued jobs replaced before they ran push nothing
+    hal.setRealTime(true);
+    const size_t beforeBurst = log.size();
+    executor.submitButton(int(B::ANTENNA_LONG));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    executor.submitButton(int(B::ANTENNA_SHORT));
+    executor.submitButton(int(B::ANTENNA_LONG));
+    waitIdle(executor);
+    hal.setRealTime(false);
+    if (log.size() - beforeBurst != 4) {
+        printf("  FAIL: burst of 3 with 1 superseded pushed %zu events, expected 4\n", log.size() - beforeBurst);
+        ok = false;
+    }
+    executor.end();
+
+    // Idle: nothing changes, nothing is pushed; small RSSI moves are ignored
+    state.linkChanged(true, -60);
+    const size_t beforeIdle = log.size();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    state.linkChanged(true, -60 + TunerState::RSSI_STEP_DB - 1);
+    state.linkChanged(true, -60 - (TunerState::RSSI_STEP_DB - 1));
+    const size_t idleEvents = log.size() - beforeIdle;
+    state.linkChanged(true, -60 - TunerState::RSSI_STEP_DB);
+    if (idleEvents != 0 || log.size() != beforeIdle + 1) {
+        printf("  FAIL: idle pushed %zu events, RSSI step pushed %zu\n", idleEvents, log.size() - beforeIdle - idleEvents);
+        ok = false;
+    }
+
+    // The longest message, all of it escaped, with the numbers at full width
+    // must still fit the buffers WebServerManager sends from
+    char worstMessage[sizeof(TunerState::Snapshot::message)];
+    memset(worstMessage, '"', sizeof(worstMessage) - 1);
+    worstMessage[sizeof(worstMessage) - 1] = '\0';
+    state.jobFinished(0xFFFFFFFFu, false, worstMessage, tuner, 0, 0xFFFFFFFFu);
+    state.linkChanged(false, -127);
+    char worst[TunerState::JSON_MAX];
+    uint32_t worstVersion = 0;
+    const size_t worstBytes = state.format(worst, sizeof(worst), worstVersion);
+    if (worstBytes == 0 || worstBytes >= TunerState::JSON_MAX) {
+        printf("  FAIL: worst-case state does not fit %zu bytes\n", TunerState::JSON_MAX);
+        ok = false;
+    }
+
+    size_t maxBytes = 0;
+    for (size_t i = 0; i < log.events.size(); i++) {
+        const PushedEvent& e = log.events[i];
+        maxBytes = e.json.size() > maxBytes ? e.json.size() : maxBytes;
+        if (i > 0 && e.version <= log.events[i - 1].version) {
+            printf("  FAIL: version %u after %u\n", (unsigned)e.version, (unsigned)log.events[i - 1].version);
+            ok = false;
+        }
+        if (argFlag(argc, argv, "--print")) {
+            printf("  id %u: %s\n", (unsigned)e.version, e.json.c_str());
+        }
+    }
+
+    // Reconnects: Last-Event-ID current -> nothing, stale or new -> the state
+    char json[TunerState::JSON_MAX], current[TunerState::JSON_MAX];
+    uint32_t version = 0, currentVersion = 0;
+    state.format(current, sizeof(current), currentVersion);
+    const size_t upToDate = state.resync(currentVersion, json, sizeof(json), version);
+    const size_t stale = state.resync(log.events.front().version, json, sizeof(json), version);
+    const bool staleOk = stale > 0 && strcmp(json, current) == 0 && version == currentVersion;
+    const size_t fresh = state.resync(0, json, sizeof(json), version);
+    if (upToDate != 0 || !staleOk || fresh == 0) {
+        printf("  FAIL: resync sent %zu bytes when current, %zu when stale (%s), %zu when new\n",
+               upToDate, stale, staleOk ? "matches" : "differs", fresh);
+        ok = false;
+    }
+
+    printf("push: %zu events for %zu jobs, largest %zu bytes (worst case %zu of %zu), final version %u\n",
+           log.events.size(), size_t(sizeof(sequence) / sizeof(sequence[0])) + 4, maxBytes, worstBytes,
+           TunerState::JSON_MAX, (unsigned)currentVersion);
+    // Polling: one /wifi-status request per client every 5 s. Push: one
+    // heartbeat per client every 15 s, and state events only on change.
+    const double polls = clients * idleS / 5.0;
+    const double heartbeats = clients * idleS / 15.0;
+    printf("idle %d clients for %.0f s: %.0f polled requests before, 0 requests and %.0f heartbeat events now\n",
+           clients, idleS, polls, heartbeats);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+// check-web-assets: the embedded web UI (WebAssetData.h, generated from web/
+// by tools/embed_web.py) and the ETag matching behind its 304 responses.
+//
+//   program check-web-assets
+//
+// Every asset must be gzip data with a unique quoted ETag; the stylesheet and
+// script must carry a content hash in their path and be cached as immutable,
+// the page and the service worker revalidated. If-None-Match is checked with
+// lists, weak tags and "*". Prints the bytes a first visit and a repeat visit
+// to the control page put on the wire.
+
+#include <stdio.h>
+#include <string.h>
+#include "HostCommands.h"
+#include "WebAssetData.h"
+#include "WebAssets.h"
+
+// Status line and headers as WebServerManager::sendAsset sends them
+static size_t headerBytes(const WebAsset& asset, bool notModified)
+{
+    char head[512];
+    const int n = notModified
+        ? snprintf(head, sizeof(head), "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: %s\r\n\r\n",
+                   asset.etag, asset.cacheControl)
+        : snprintf(head, sizeof(head),
+                   "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\nContent-Encoding: gzip\r\n"
+                   "ETag: %s\r\nCache-Control: %s\r\n\r\n",
+                   asset.contentType, (unsigned)asset.gzipSize, asset.etag, asset.cacheControl);
+    return n > 0 ? size_t(n) : 0;
+}
+
+static bool checkAsset(const WebAsset& a, const WebAsset* others, size_t count)
+{
+    bool ok = true;
+    const bool immutable = strstr(a.cacheControl, "immutable") != nullptr;
+    // "/app.<hash>.css": a dot-separated hash between name and extension
+    const char* dot = strchr(a.path, '.');
+    const bool hashed = dot != nullptr && strchr(dot + 1, '.') != nullptr;
+    const size_t etagLen = strlen(a.etag);
+    printf("  %-22s %-24s %5u bytes gzip, ETag %s, %s\n", a.path, a.contentType, (unsigned)a.gzipSize, a.etag,
+           a.cacheControl);
+    if (a.gzipSize < 18 || a.gzip[0] != 0x1f || a.gzip[1] != 0x8b || a.gzip[2] != 8) {
+        printf("  FAIL: %s is not gzip data\n", a.path);
+        ok = false;
+    }
+    if (etagLen < 3 || a.etag[0] != '"' || a.etag[etagLen - 1] != '"') {
+        printf("  FAIL: %s ETag is not a quoted string\n", a.path);
+        ok = false;
+    }
+    if (immutable != hashed) {
+        printf("  FAIL: %s is %s but its path %s a content hash\n", a.path, immutable ? "immutable" : "revalidated",
+               hashed ? "has" : "lacks");
+        ok = false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (&others[i] != &a && (strcmp(others[i].etag, a.etag) == 0 || strcmp(others[i].path, a.path) == 0)) {
+            printf("  FAIL: %s shares its ETag or path with %s\n", a.path, others[i].path);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool checkEtagMatching()
+{
+    struct Case {
+        const char* ifNoneMatch;
+        bool        match;
+    };
+    static const Case cases[] = {
+        {"\"abc\"", true},
+        {"W/\"abc\"", true},
+        {"\"x\", \"abc\"", true},
+        {"\"x\",W/\"abc\"", true},
+        {"*", true},
+        {"\"abcd\"", false},
+        {"\"ab\"", false},
+        {"abc", false},
+        {"", false},
+        {"\"x\", \"y\"", false},
+        {"\"abc", false},
+    };
+    bool ok = true;
+    for (const Case& c : cases) {
+        if (webEtagMatches(c.ifNoneMatch, "\"abc\"") != c.match) {
+            printf("  FAIL: If-None-Match %s %s \"abc\"\n", c.ifNoneMatch, c.match ? "should match" : "should not match");
+            ok = false;
+        }
+    }
+    if (webEtagMatches(nullptr, "\"abc\"")) {
+        printf("  FAIL: a missing If-None-Match matched\n");
+        ok = false;
+    }
+    printf("etag: %zu If-None-Match cases\n", sizeof(cases) / sizeof(cases[0]));
+    return ok;
+}
+
+int cmdCheckWebAssets(int, char**)
+{
+    const size_t count = sizeof(g_webUiAssets) / sizeof(g_webUiAssets[0]);
+    bool ok = true;
+    printf("control UI:\n");
+    for (size_t i = 0; i < count; i++) {
+        ok = checkAsset(g_webUiAssets[i], g_webUiAssets, count) && ok;
+    }
+    printf("configuration AP:\n");
+    ok = checkAsset(g_webConfigPage, &g_webConfigPage, 1) && ok;
+    if (strcmp(g_webUiAssets[0].path, "/") != 0) {
+        printf("  FAIL: the page is not the first asset\n");
+        ok = false;
+    }
+    ok = checkEtagMatching() && ok;
+
+    // First visit: page, stylesheet and script (the service worker loads
+    // later, in the background). Repeat visit: the page revalidates with a
+    // 304, the immutable files come from the browser cache.
+    size_t first = 0, repeat = 0;
+    for (size_t i = 0; i < count; i++) {
+        const WebAsset& a = g_webUiAssets[i];
+        if (strcmp(a.path, "/sw.js") == 0) continue;
+        first += headerBytes(a, false) + a.gzipSize;
+        if (strstr(a.cacheControl, "immutable") == nullptr) repeat += headerBytes(a, true);
+    }
+    printf("wire: first visit %zu bytes, repeat visit %zu bytes (responses with headers)\n", first, repeat);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,310 @@
+// gen-personality: writes a binary personality synthesised from the lumped
+// TunerModel (until measured data is available), then maps it back and
+// checks that the solver gets the same answers from it as from the model.
+//
+//   program gen-personality [--out personality.bin] [--start 1.5e6] [--stop 30e6]
+//                           [--points 1000] [--network] [--stages] [--measured 8]
+//                           [--stray-pf 0] [--contact-nh 0] [--km1-nh 0] [--tol 0.01]
+//                           [model options]
+//
+// --network also stores every complete network state, which makes the file
+// exponentially larger but must not change the cold-start time.
+// --stages stores each inductor stage and capacitor branch in both relay
+// positions instead of every bank state: 2 (L bits + C bits) sweeps rather
+// than 2^L + 2^C. --measured adds that many complete network states, spread
+// over all of them, as the few measured directly; the file is then validated
+// by composing those states from the stages (fails beyond --tol in |S|).
+// The stages and measured states can carry parasitics: stray capacitance
+// across each stage, relay contact inductance in every stage and branch,
+// and the KM1 contact, which no stage measurement includes.
+// Flash with:  esptool.py write_flash 0xdf0000 personality.bin
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <vector>
+#include "Crc32.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "HostModel.h"
+#include "MappedRegion.h"
+#include "MatchSolver.h"
+#include "Personality.h"
+#include "TunerDesign.h"
+
+typedef std::complex<double> cd;
+
+struct Abcd {
+    cd a, b, c, d;
+};
+
+static Abcd cascade(const Abcd& x, const Abcd& y)
+{
+    return Abcd{x.a * y.a + x.b * y.c, x.a * y.b + x.b * y.d, x.c * y.a + x.d * y.c, x.c * y.b + x.d * y.d};
+}
+
+// S11, S21, S12, S22 of a 2-port given as ABCD
+static void abcdToS(const Abcd& m, double z0, cd s[4])
+{
+    const cd den = m.a + m.b / z0 + m.c * z0 + m.d;
+    s[0] = (m.a + m.b / z0 - m.c * z0 - m.d) / den;
+    s[1] = 2.0 / den;
+    s[2] = 2.0 * (m.a * m.d - m.b * m.c) / den;
+    s[3] = (-m.a + m.b / z0 - m.c * z0 + m.d) / den;
+}
+
+static size_t alignUp(size_t n)
+{
+    return (n + PERSONALITY_ALIGN - 1) / PERSONALITY_ALIGN * PERSONALITY_ALIGN;
+}
+
+struct BlockSpec {
+    BlockKind kind;
+    uint32_t  state;
+};
+
+static bool operator<(const BlockSpec& x, const BlockSpec& y)
+{
+    return x.kind != y.kind ? x.kind < y.kind : x.state < y.state;
+}
+
+// Parasitics of the hardware that the lumped model leaves out
+struct Parasitics {
+    double strayFarads = 0.0;   // across each inductor stage, to ground, split half at each end
+    double contactHenries = 0.0; // KM relay contact, in series with every stage and branch
+    double km1Henries = 0.0;    // KM1 contact to the capacitor bank, outside every stage measurement
+
+    bool any() const { return strayFarads > 0.0 || contactHenries > 0.0 || km1Henries > 0.0; }
+};
+
+static Abcd seriesAbcd(cd z) { return Abcd{1.0, z, 0.0, 1.0}; }
+static Abcd shuntAbcd(cd y) { return Abcd{1.0, 0.0, y, 1.0}; }
+
+// Inductor stage n with its relay set (inductor in the chain) or bypassed
+static Abcd stageAbcd(const TunerModel& model, const Parasitics& p, size_t n, bool set, double hz)
+{
+    const double w = 2.0 * M_PI * hz;
+    cd z(0.0, w * p.contactHenries);
+    if (set) {
+        const double x = w * model.inductor(uint8_t(n)).value;
+        z += cd(x / model.inductor(uint8_t(n)).q, x); // ESR = X/Q as in TunerModel
+    }
+    const Abcd half = shuntAbcd(cd(0.0, w * p.strayFarads / 2.0));
+    return cascade(half, cascade(seriesAbcd(z), half));
+}
+
+// Capacitor branch n to ground: the capacitor with its relay closed, the
+// relay's off capacitance (taken as the stray) when open
+static cd branchAdmittance(const TunerModel& model, const Parasitics& p, size_t n, bool set, double hz)
+{
+    const double w = 2.0 * M_PI * hz;
+    const double b = w * (set ? model.capacitor(uint8_t(n)).value : p.strayFarads);
+    if (b == 0.0) return 0.0;
+    const cd y(set ? b / model.capacitor(uint8_t(n)).q : 0.0, b);
+    return 1.0 / (1.0 / y + cd(0.0, w * p.contactHenries));
+}
+
+// Complete network as it would measure, built element by element
+static Abcd networkAbcd(const TunerModel& model, const Parasitics& p, uint32_t state, double hz)
+{
+    const uint32_t lMask = state & 0xFFF, cMask = (state >> 12) & 0xFFF;
+    Abcd chain = seriesAbcd(0.0);
+    for (size_t n = 0; n < model.inductorBits(); n++) chain = cascade(chain, stageAbcd(model, p, n, (lMask >> n) & 1, hz));
+    cd y = 0.0;
+    for (size_t n = 0; n < model.capacitorBits(); n++) y += branchAdmittance(model, p, n, (cMask >> n) & 1, hz);
+    if (y != 0.0 && p.km1Henries > 0.0) y = 1.0 / (1.0 / y + cd(0.0, 2.0 * M_PI * hz * p.km1Henries));
+    // "C, L" has the capacitor on the antenna side, i.e. after the inductor seen from the radio
+    return (state >> 24) & 1 ? cascade(chain, shuntAbcd(y)) : cascade(shuntAbcd(y), chain);
+}
+
+// ABCD of one block at one frequency; port 1 faces the radio
+static Abcd blockAbcd(const BlockSpec& spec, const TunerModel& model, const Parasitics& p, double hz,
+                      const Cplx* zL, const Cplx* yC)
+{
+    switch (spec.kind) {
+    case BlockKind::InductorBank:
+        return seriesAbcd(cd(zL[spec.state].re, zL[spec.state].im));
+    case BlockKind::CapacitorBank:
+        return shuntAbcd(cd(yC[spec.state].re, yC[spec.state].im));
+    case BlockKind::InductorStage:
+        return stageAbcd(model, p, spec.state >> 1, spec.state & 1, hz);
+    case BlockKind::CapacitorBranch:
+        return shuntAbcd(branchAdmittance(model, p, spec.state >> 1, spec.state & 1, hz));
+    default:
+        return networkAbcd(model, p, spec.state, hz);
+    }
+}
+
+static bool writePersonality(const char* path, const TunerModel& model, const Parasitics& parasitics,
+                             const std::vector<float>& freqs, bool withNetwork, bool stages, size_t measured)
+{
+    std::vector<BlockSpec> specs;
+    if (stages) {
+        for (uint8_t n = 0; n < model.inductorBits(); n++) {
+            specs.push_back({BlockKind::InductorStage, packStageState(n, false)});
+            specs.push_back({BlockKind::InductorStage, packStageState(n, true)});
+        }
+        for (uint8_t n = 0; n < model.capacitorBits(); n++) {
+            specs.push_back({BlockKind::CapacitorBranch, packStageState(n, false)});
+            specs.push_back({BlockKind::CapacitorBranch, packStageState(n, true)});
+        }
+    } else {
+        for (uint32_t s = 0; s < model.numInductorStates(); s++) specs.push_back({BlockKind::InductorBank, s});
+        for (uint32_t s = 0; s < model.numCapacitorStates(); s++) specs.push_back({BlockKind::CapacitorBank, s});
+    }
+    const size_t numNetworks = 2 * model.numCapacitorStates() * model.numInductorStates();
+    // Every state, or `measured` of them spread evenly, stepping L and C too
+    std::vector<bool> chosen(numNetworks, withNetwork);
+    for (size_t k = 0; k < measured && k < numNetworks; k++) {
+        chosen[(k * numNetworks / measured + k * 5) % numNetworks] = true;
+    }
+    for (size_t i = 0; i < numNetworks; i++) {
+        if (!chosen[i]) continue;
+        const uint32_t l = uint32_t(i % model.numInductorStates());
+        const uint32_t c = uint32_t(i / model.numInductorStates() % model.numCapacitorStates());
+        const bool t = i / model.numInductorStates() / model.numCapacitorStates() != 0;
+        specs.push_back({BlockKind::Network, packNetworkState(uint16_t(l), uint16_t(c), t)});
+    }
+    std::sort(specs.begin(), specs.end());
+
+    PersonalityHeader h = {};
+    h.magic = PERSONALITY_MAGIC;
+    h.version = PERSONALITY_VERSION;
+    h.headerSize = sizeof(PersonalityHeader);
+    h.numFreqs = uint32_t(freqs.size());
+    h.numBlocks = uint32_t(specs.size());
+    h.numParams = 4;
+    h.z0 = model.z0();
+    h.freqOffset = uint32_t(alignUp(sizeof(PersonalityHeader)));
+    h.blockOffset = uint32_t(alignUp(h.freqOffset + freqs.size() * sizeof(float)));
+    h.stride = uint32_t(alignUp(freqs.size() * sizeof(float)));
+    const size_t dataStart = alignUp(h.blockOffset + specs.size() * sizeof(PersonalityBlock));
+    const size_t blockBytes = size_t(h.stride) * 2 * h.numParams;
+    h.totalSize = uint32_t(dataStart + specs.size() * blockBytes);
+
+    std::vector<uint8_t> file(h.totalSize, 0);
+    memcpy(&file[h.freqOffset], freqs.data(), freqs.size() * sizeof(float));
+    PersonalityBlock* blocks = reinterpret_cast<PersonalityBlock*>(&file[h.blockOffset]);
+    for (size_t i = 0; i < specs.size(); i++) {
+        blocks[i] = PersonalityBlock{uint16_t(specs[i].kind), 0, specs[i].state, uint32_t(dataStart + i * blockBytes)};
+    }
+
+    std::vector<Cplx> zL(model.numInductorStates()), yC(model.numCapacitorStates());
+    for (size_t fi = 0; fi < freqs.size(); fi++) {
+        model.seriesImpedances(freqs[fi], zL.data());
+        model.shuntAdmittances(freqs[fi], yC.data());
+        for (size_t i = 0; i < specs.size(); i++) {
+            cd s[4];
+            abcdToS(blockAbcd(specs[i], model, parasitics, freqs[fi], zL.data(), yC.data()), model.z0(), s);
+            for (size_t p = 0; p < 4; p++) {
+                float* re = reinterpret_cast<float*>(&file[blocks[i].dataOffset + h.stride * (2 * p)]);
+                float* im = reinterpret_cast<float*>(&file[blocks[i].dataOffset + h.stride * (2 * p + 1)]);
+                re[fi] = float(s[p].real());
+                im[fi] = float(s[p].imag());
+            }
+        }
+    }
+    h.crc32 = crc32(&file[h.headerSize], h.totalSize - h.headerSize);
+    memcpy(&file[0], &h, sizeof(h));
+
+    FILE* f = fopen(path, "wb");
+    if (!f || fwrite(file.data(), 1, file.size(), f) != file.size()) {
+        fprintf(stderr, "cannot write %s\n", path);
+        if (f) fclose(f);
+        return false;
+    }
+    fclose(f);
+    printf("wrote %s: %zu blocks x %zu points, %.1f KB\n", path, specs.size(), freqs.size(), file.size() / 1024.0);
+    // One 2-port sweep per block; the alternatives for the same banks
+    printf("2-port sweeps: %zu per stage and branch, %zu per bank state, %zu per network state\n",
+           size_t(2 * (model.inductorBits() + model.capacitorBits())),
+           model.numInductorStates() + model.numCapacitorStates(), numNetworks);
+    return true;
+}
+
+// Maps the file back, reports cold-start cost and compares solver answers
+// (for data without parasitics) and composed against measured networks
+static bool checkPersonality(const char* path, const TunerModel& model, bool parasitics, float tol)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    MappedRegion region;
+    PersonalityView view;
+    if (!region.mapFile(path) || !view.attach(region.data(), region.size())) {
+        fprintf(stderr, "%s: failed to map or validate\n", path);
+        return false;
+    }
+    const double attachUs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1e6;
+    printf("map + attach: %.1f us (%zu bytes mapped, view is %zu bytes)\n", attachUs, region.size(), sizeof(view));
+    if (!view.verifyCrc()) {
+        fprintf(stderr, "%s: CRC mismatch\n", path);
+        return false;
+    }
+
+    if (view.numInductorStages() != 0) {
+        NetworkValidation v;
+        if (view.validateNetworks(v)) {
+            printf("composed vs measured: %zu network states, worst |dS| %.2g (S%s at %.3f MHz, L %u C %u %s)\n",
+                   v.states, v.maxError, v.worstParam == SParam::S11 ? "11" : v.worstParam == SParam::S21 ? "21" :
+                   v.worstParam == SParam::S12 ? "12" : "22", v.worstFreqHz * 1e-6, (unsigned)(v.worstState & 0xFFF),
+                   (unsigned)((v.worstState >> 12) & 0xFFF), (v.worstState >> 24) & 1 ? "C, L" : "L, C");
+            if (!(v.maxError <= tol)) {
+                fprintf(stderr, "%s: composed states differ from the measured ones by more than %g\n", path, tol);
+                return false;
+            }
+        }
+    }
+    if (parasitics) {
+        printf("solver vs model: skipped, the data has parasitics the model does not\n");
+        return true;
+    }
+
+    MatchSolver fromModel(model), fromFile(model);
+    std::vector<Cplx> zL(model.numInductorStates()), yC(model.numCapacitorStates());
+    size_t mismatches = 0, checked = 0;
+    for (size_t fi = 0; fi < view.numFreqs(); fi += 37) {
+        const float f = view.freqs()[fi];
+        if (!view.seriesImpedances(fi, zL.data(), zL.size()) || !view.shuntAdmittances(fi, yC.data(), yC.size())) {
+            fprintf(stderr, "%s: bank blocks missing\n", path);
+            return false;
+        }
+        fromFile.prepareTables(zL.data(), yC.data());
+        // A moderately mismatched antenna that the network can match
+        const Cplx zAnt{20.0f, -400.0f * 3.5e6f / f};
+        const MatchResult a = fromModel.solve(f, zAnt);
+        const MatchResult b = fromFile.solvePrepared(zAnt);
+        checked++;
+        if (a.state != b.state && fabsf(a.swr - b.swr) > 1e-3f) mismatches++;
+    }
+    printf("solver from personality vs model: %zu/%zu frequencies agree\n", checked - mismatches, checked);
+    return mismatches == 0;
+}
+
+int cmdGenPersonality(int argc, char** argv)
+{
+    const char* outPath = argString(argc, argv, "--out", "personality.bin");
+    const double start = argNumber(argc, argv, "--start", 1.5e6);
+    const double stop = argNumber(argc, argv, "--stop", 30e6);
+    const size_t points = size_t(argNumber(argc, argv, "--points", 1000));
+    if (points < 2 || stop <= start) {
+        fprintf(stderr, "invalid frequency grid\n");
+        return 1;
+    }
+    const TunerModel model = modelFromArgs(argc, argv, TunerDesign::model());
+    std::vector<float> freqs(points);
+    for (size_t i = 0; i < points; i++) {
+        freqs[i] = float(start + (stop - start) * double(i) / double(points - 1));
+    }
+    Parasitics parasitics;
+    parasitics.strayFarads = argNumber(argc, argv, "--stray-pf", 0) * 1e-12;
+    parasitics.contactHenries = argNumber(argc, argv, "--contact-nh", 0) * 1e-9;
+    parasitics.km1Henries = argNumber(argc, argv, "--km1-nh", 0) * 1e-9;
+    const bool stages = argFlag(argc, argv, "--stages");
+    if (!writePersonality(outPath, model, parasitics, freqs, argFlag(argc, argv, "--network"), stages,
+                          size_t(argNumber(argc, argv, "--measured", 0)))) {
+        return 1;
+    }
+    return checkPersonality(outPath, model, parasitics.any(), float(argNumber(argc, argv, "--tol", 0.01))) ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+// gen-table: solves every frequency of a band plan for both gap lengths and
+// writes the binary tune table for the "tunetab" flash partition.
+//
+//   program gen-table [--long docs/Longz] [--short docs/Shortz] [--out tunetable.bin]
+//                     [--start 1.5e6] [--stop 30e6] [--step 28000] [model options]
+//
+// Model options (--lbits, --lsb-uh, ...) default to TunerDesign. Flash the
+// result with:  esptool.py write_flash 0xd70000 tunetable.bin
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "Crc32.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "HostModel.h"
+#include "MappedRegion.h"
+#include "MatchSolver.h"
+#include "SweepFile.h"
+#include "TuneTable.h"
+#include "TunerDesign.h"
+
+static bool solveSection(const char* path, MatchSolver& solver, uint32_t start, uint32_t stop,
+                         uint32_t step, std::vector<TuneTableEntry>& out)
+{
+    SweepData data;
+    if (!loadSweepFile(path, data)) {
+        return false;
+    }
+    const ImpedanceSweep sweep = data.view();
+    size_t under2 = 0;
+    float worst = 0.0f;
+    for (uint32_t f = start; f <= stop; f += step) {
+        MatchResult res;
+        if (!solver.solve(sweep, float(f), res)) {
+            continue; // outside the swept range
+        }
+        out.push_back(TuneTableEntry::make(f, res.state, res.swr));
+        if (res.swr < 2.0f) under2++;
+        if (res.swr > worst) worst = res.swr;
+    }
+    printf("  %s: %zu entries, %zu with SWR < 2, worst SWR %.2f\n", path, out.size(), under2, worst);
+    return !out.empty();
+}
+
+// Maps the written file back and checks that every entry is found again
+static bool checkTable(const char* path)
+{
+    MappedRegion region;
+    TuneTableView table;
+    if (!region.mapFile(path) || !table.attach(region.data(), region.size()) || !table.verifyCrc()) {
+        fprintf(stderr, "%s: table failed to map or validate\n", path);
+        return false;
+    }
+    size_t lookups = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        const GapLength gap = GapLength(g);
+        const TuneTableEntry* e = table.entries(gap);
+        for (size_t i = 0; i < table.count(gap); i++, lookups++) {
+            // Slightly off-grid request must still land on the nearest entry
+            if (table.find(gap, e[i].freqHz + table.header().stepHz / 4) != &e[i]) {
+                fprintf(stderr, "%s: lookup mismatch at %u Hz\n", path, e[i].freqHz);
+                return false;
+            }
+        }
+    }
+    const double ns = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9;
+    printf("check: %zu lookups OK, %.0f ns/lookup\n", lookups, lookups ? ns / double(lookups) : 0.0);
+    return true;
+}
+
+int cmdGenTable(int argc, char** argv)
+{
+    const char* outPath = argString(argc, argv, "--out", "tunetable.bin");
+    const uint32_t start = uint32_t(argNumber(argc, argv, "--start", 1.5e6));
+    const uint32_t stop = uint32_t(argNumber(argc, argv, "--stop", 30e6));
+    const uint32_t step = uint32_t(argNumber(argc, argv, "--step", 28000));
+    if (step == 0 || stop < start) {
+        fprintf(stderr, "invalid band plan\n");
+        return 1;
+    }
+    const TunerModel model = modelFromArgs(argc, argv, TunerDesign::model());
+    MatchSolver solver(model);
+    printf("banks: %u L bits, %u C bits; %.3f-%.3f MHz step %u Hz\n", model.inductorBits(),
+           model.capacitorBits(), start * 1e-6, stop * 1e-6, step);
+
+    std::vector<TuneTableEntry> sections[NUM_GAP_LENGTHS];
+    if (!solveSection(argString(argc, argv, "--long", "docs/Longz"), solver, start, stop, step,
+                      sections[size_t(GapLength::Long)]) ||
+        !solveSection(argString(argc, argv, "--short", "docs/Shortz"), solver, start, stop, step,
+                      sections[size_t(GapLength::Short)])) {
+        return 1;
+    }
+
+    TuneTableHeader header = {};
+    header.magic = TUNE_TABLE_MAGIC;
+    header.version = TUNE_TABLE_VERSION;
+    header.headerSize = sizeof(TuneTableHeader);
+    header.lBits = model.inductorBits();
+    header.cBits = model.capacitorBits();
+    header.stepHz = step;
+    std::vector<uint8_t> payload;
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        header.offset[g] = uint32_t(sizeof(TuneTableHeader) + payload.size());
+        header.count[g] = uint32_t(sections[g].size());
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(sections[g].data());
+        payload.insert(payload.end(), bytes, bytes + sections[g].size() * sizeof(TuneTableEntry));
+    }
+    header.crc32 = crc32(payload.data(), payload.size());
+
+    FILE* f = fopen(outPath, "wb");
+    if (!f || fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(payload.data(), 1, payload.size(), f) != payload.size()) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        if (f) fclose(f);
+        return 1;
+    }
+    fclose(f);
+    printf("wrote %s: %zu bytes\n", outPath, sizeof(header) + payload.size());
+    return checkTable(outPath) ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#ifndef HOST_ARGS_H
+#define HOST_ARGS_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Tiny "--name value" option lookup for the host tools
+
+inline const char* argString(int argc, char** argv, const char* name, const char* fallback)
+{
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+inline double argNumber(int argc, char** argv, const char* name, double fallback)
+{
+    const char* s = argString(argc, argv, name, nullptr);
+    return s ? atof(s) : fallback;
+}
+
+inline bool argFlag(int argc, char** argv, const char* name)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+#endif // HOST_ARGS_H
@@ -0,0 +1,52 @@
+// The board-only classes WebServerManager is wired to, as the host tools
+// see them: NetworkMgr always connected, PowerManager keeping its settings
+// in memory. Only what WebServerManager calls is defined; NetworkMgr.cpp and
+// PowerManager.cpp themselves are not in the native build.
+
+#include "driver/gpio.h" // For WIFI_RESET_BUTTON_PIN
+#include "NetworkMgr.h"
+#include "PowerManager.h"
+
+NetworkMgr::NetworkMgr(const char* confHostname) :
+    _hostname(confHostname), _wifiResetButtonPin(WIFI_RESET_BUTTON_PIN), _gotIp(1), _reconnects(0),
+    _leaseBorrowed(false), _events(nullptr), _connecting(false), _fastAttempt(false), _fastConnected(false),
+    _connectStartUs(0), _connectUs(0), _cache(), _staticIp(), _nvsHandle(0), _configWebServer(80)
+{
+}
+
+bool NetworkMgr::isConnected()
+{
+    return WiFi.status() == WL_CONNECTED;
+}
+
+PowerManager::PowerManager(NetworkMgr& net, RelayExecutor& executor, GAPTuner& tuner, RelayController& relays,
+                           RigFollower& rig, TunerMetrics& metrics) :
+    _net(net), _executor(executor), _tuner(tuner), _relays(relays), _rig(rig), _metrics(metrics),
+    _configChanged(false), _totals(), _activity(false), _state(uint8_t(PowerState::Active)), _policy(PowerConfig(), 0),
+    _resuming(false), _wakeUs(0)
+{
+}
+
+void PowerManager::configure(const PowerConfig& config)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _config = config;
+    _configChanged = true;
+}
+
+PowerConfig PowerManager::config() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _config;
+}
+
+PowerTotals PowerManager::totals() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _totals;
+}
+
+bool PowerManager::saveConfig() const
+{
+    return true;
+}
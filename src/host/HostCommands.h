@@ -0,0 +1,37 @@
+#ifndef HOST_COMMANDS_H
+#define HOST_COMMANDS_H
+
+// Host-side command line tools (benchmarks, generators, simulators), built by
+// the `native` PlatformIO environment:
+//   pio run -e native && .pio/build/native/program <command> [options]
+// Each command lives in its own file in src/host and is listed in HostMain.cpp.
+
+struct HostCommand {
+    const char* name;
+    const char* summary;
+    int (*run)(int argc, char** argv); // argv[0] is the command name
+};
+
+int cmdBenchSolver(int argc, char** argv);
+int cmdBenchParser(int argc, char** argv);
+int cmdBenchKernels(int argc, char** argv);
+int cmdSimRelays(int argc, char** argv);
+int cmdBenchExecutor(int argc, char** argv);
+int cmdCheckRelayMasks(int argc, char** argv);
+int cmdBenchMetrics(int argc, char** argv);
+int cmdCheckStatePush(int argc, char** argv);
+int cmdCheckWebAssets(int argc, char** argv);
+int cmdSimFollow(int argc, char** argv);
+int cmdRigctldSim(int argc, char** argv);
+int cmdSimCal(int argc, char** argv);
+int cmdBenchOsl(int argc, char** argv);
+int cmdSimPower(int argc, char** argv);
+int cmdGenTable(int argc, char** argv);
+int cmdGenPersonality(int argc, char** argv);
+int cmdBenchCodec(int argc, char** argv);
+int cmdCheckArena(int argc, char** argv);
+int cmdSoakApi(int argc, char** argv);
+int cmdLoadWeb(int argc, char** argv);
+int cmdUpload(int argc, char** argv);
+
+#endif // HOST_COMMANDS_H
@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <string.h>
+#include "HostCommands.h"
+
+static const HostCommand s_commands[] = {
+    {"bench-solver", "exhaustive match solver throughput on a sweep file", cmdBenchSolver},
+    {"bench-parser", "sweep text parser throughput and round-trip checks", cmdBenchParser},
+    {"bench-kernels", "complex kernel paths against double precision", cmdBenchKernels},
+    {"sim-relays",   "QSY timing of the firmware relay sequences on simulated relays", cmdSimRelays},
+    {"bench-executor", "lock-free relay job queue and executor on simulated relays", cmdBenchExecutor},
+    {"check-relay-masks", "compile-time GPIO masks of the relay action tables", cmdCheckRelayMasks},
+    {"bench-metrics", "metric recording cost and /metrics exposition checks", cmdBenchMetrics},
+    {"check-state-push", "versioned tuner state pushed on /events, driven by relay jobs", cmdCheckStatePush},
+    {"check-web-assets", "embedded gzip UI files, their ETags and cache headers", cmdCheckWebAssets},
+    {"sim-follow",   "rig CAT follow mode against a simulated rig over rigctld and CI-V", cmdSimFollow},
+    {"rigctld-sim",  "simulated rig behind a rigctld server, driven from stdin", cmdRigctldSim},
+    {"sim-cal",      "VNA calibration sequence against a software VNA over TCP and serial", cmdSimCal},
+    {"bench-osl",    "Open/Short/Load error correction against a reference, and its throughput", cmdBenchOsl},
+    {"sim-power",    "power states after a tune on a simulated clock, time and energy per state", cmdSimPower},
+    {"gen-table",    "band-plan tune table for the tunetab partition", cmdGenTable},
+    {"gen-personality", "binary personality (SoA S-parameters) from the tuner model", cmdGenPersonality},
+    {"bench-codec",  "error-bounded sweep codec: compression against error, decode cost", cmdBenchCodec},
+    {"check-arena",  "dataset arena allocator: exhaustion, bulk reset, overrun and leak checks", cmdCheckArena},
+    {"soak-api",     "/api/v1 replies from fixed buffers: 100k mixed requests, heap allocations", cmdSoakApi},
+    {"load-web",     "WebServerManager handlers under concurrent load: throughput, latency, allocations", cmdLoadWeb},
+    {"upload",       "resumable block upload to the tuner (or --loopback)", cmdUpload},
+};
+
+static void printUsage(const char* prog)
+{
+    printf("usage: %s <command> [options]\n\ncommands:\n", prog);
+    for (const HostCommand& cmd : s_commands) {
+        printf("  %-16s %s\n", cmd.name, cmd.summary);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    for (const HostCommand& cmd : s_commands) {
+        if (strcmp(argv[1], cmd.name) == 0) {
+            return cmd.run(argc - 1, argv + 1);
+        }
+    }
+    fprintf(stderr, "unknown command '%s'\n", argv[1]);
+    printUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,21 @@
+#ifndef HOST_MODEL_H
+#define HOST_MODEL_H
+
+#include "HostArgs.h"
+#include "TunerModel.h"
+
+// Tuner model for the host tools: binary-weighted banks taken from `fallback`,
+// with --lbits/--lsb-uh/--ql and --cbits/--lsb-pf/--qc overriding its values
+inline TunerModel modelFromArgs(int argc, char** argv, const TunerModel& fallback)
+{
+    return TunerModel::binaryWeighted(
+        uint8_t(argNumber(argc, argv, "--lbits", fallback.inductorBits())),
+        float(argNumber(argc, argv, "--lsb-uh", fallback.inductor(0).value * 1e6) * 1e-6),
+        float(argNumber(argc, argv, "--ql", fallback.inductor(0).q)),
+        uint8_t(argNumber(argc, argv, "--cbits", fallback.capacitorBits())),
+        float(argNumber(argc, argv, "--lsb-pf", fallback.capacitor(0).value * 1e12) * 1e-12),
+        float(argNumber(argc, argv, "--qc", fallback.capacitor(0).q)),
+        fallback.z0());
+}
+
+#endif // HOST_MODEL_H
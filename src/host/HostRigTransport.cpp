@@ -0,0 +1,72 @@
+#include "HostRigTransport.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int connectTcp(const char* host, uint16_t port)
+{
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    addrinfo hints = {};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host, service, &hints, &res) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) {
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool HostRigTransport::open(const RigConfig& config)
+{
+    close();
+    _fd = _opener ? _opener(config) : connectTcp(config.host, config.port);
+    return _fd >= 0;
+}
+
+void HostRigTransport::close()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+bool HostRigTransport::write(const uint8_t* data, size_t len)
+{
+    while (_fd >= 0 && len > 0) {
+        const ssize_t n = send(_fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= size_t(n);
+    }
+    return _fd >= 0;
+}
+
+int HostRigTransport::read(uint8_t* out, size_t size, uint32_t timeoutMs)
+{
+    if (_fd < 0) return -1;
+    pollfd p = {_fd, POLLIN, 0};
+    const int ready = poll(&p, 1, int(timeoutMs));
+    if (ready <= 0) {
+        return ready == 0 ? 0 : -1;
+    }
+    const ssize_t n = recv(_fd, out, size, 0);
+    return n > 0 ? int(n) : -1; // 0: closed by the peer
+}
@@ -0,0 +1,27 @@
+#ifndef HOST_RIG_TRANSPORT_H
+#define HOST_RIG_TRANSPORT_H
+
+#include <functional>
+#include "RigTransport.h"
+
+// RigTransport over a socket for the host tools: a TCP connection to
+// config.host:config.port (rigctld), or, with an opener, whatever descriptor
+// it returns (RigSim's CI-V bus end, a serial port).
+class HostRigTransport : public RigTransport {
+public:
+    typedef std::function<int(const RigConfig&)> Opener; // descriptor or -1
+
+    explicit HostRigTransport(Opener opener = nullptr) : _opener(opener), _fd(-1) {}
+    ~HostRigTransport() override { close(); }
+
+    bool open(const RigConfig& config) override;
+    void close() override;
+    bool write(const uint8_t* data, size_t len) override;
+    int read(uint8_t* out, size_t size, uint32_t timeoutMs) override;
+
+private:
+    Opener _opener;
+    int    _fd;
+};
+
+#endif // HOST_RIG_TRANSPORT_H
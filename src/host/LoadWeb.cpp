@@ -0,0 +1,482 @@
+// load-web: WebServerManager's handlers under load, through the in-process
+// ESPAsyncWebServer mock (compat/ESPAsyncWebServer.h).
+//
+//   program load-web [--clients 4] [--seconds 5] [--think-ms 0] [--press-ms 100]
+//                    [--seed 1] [--mix root:1,reload:2,wifi:6,button:2,api:2,missing:1]
+//                    [--out FILE] [--check FILE] [--slack 3]
+//
+// Each client sends one request at a time and waits for the whole response,
+// then after --think-ms picks the next route from the mix at random. One
+// server thread runs the handlers in turn, as the AsyncTCP task does, so
+// with more clients requests queue: latency grows while throughput stays
+// that of one handler at a time. /button jobs run on the RelayExecutor over
+// simulated relays with their real pulse times. A person waits for the
+// relays before pressing again, so each client presses a button at most once
+// every --press-ms; a button picked before then is replaced by another route.
+// The mix's button share is therefore an upper bound, and the requests that
+// do go out mostly find room in the relay queue (0 sends every pick, which
+// measures the 503 path instead).
+//
+// Routes: root (/, the gzip page), reload (/ with its current ETag, a 304),
+// wifi (/wifi-status), button (/button?id=1..8), api (/api/v1/state) and
+// missing (/favicon.ico, a 404).
+//
+// Per route: requests, how many got the expected status (ok) and how many a
+// 503 for a full relay queue (busy), throughput, latency from sending the request to the
+// last body byte (p50, p99, p99.9), time in the handler alone, and heap
+// allocations and bytes per request on the server thread. Every status must
+// be the expected one and the server thread must end with no net heap use.
+//
+// --out writes the table as a baseline; docs/load_baseline.txt is the one
+// checked in (program load-web --out docs/load_baseline.txt). --check
+// compares with a baseline: allocations per request and the busy share must
+// not rise, and p99 latency and throughput must stay within --slack times
+// the baseline, which absorbs the difference between machines.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AllocCounter.h"
+#include "CalCorrector.h"
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "HostRigTransport.h"
+#include "MemoryFlash.h"
+#include "NetworkMgr.h"
+#include "PowerManager.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "RigFollower.h"
+#include "SimRelayHal.h"
+#include "TunerMetrics.h"
+#include "TunerState.h"
+#include "VnaSequencer.h"
+#include "WebAssetData.h"
+#include "WebServerManager.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Route { ROOT, RELOAD, WIFI, BUTTON, API, MISSING, NUM_ROUTES };
+
+struct RouteInfo {
+    const char* name;
+    const char* target;
+    int         status;    // expected
+    int         busy;      // also fine: the relay queue full
+};
+
+const RouteInfo ROUTES[NUM_ROUTES] = {
+    {"root",    "/",             200, 0},
+    {"reload",  "/",             304, 0},
+    {"wifi",    "/wifi-status",  200, 0},
+    {"button",  "/button?id=",   202, 503},
+    {"api",     "/api/v1/state", 200, 0},
+    {"missing", "/favicon.ico",  404, 0},
+};
+
+const char* const DEFAULT_MIX = "root:1,reload:2,wifi:6,button:2,api:2,missing:1";
+
+struct Row {
+    char   route[16];
+    size_t requests, ok, busy;
+    double perSecond, p50Us, p99Us, p999Us, handlerUs, allocs, bytes;
+};
+
+// Server thread totals, one per route
+struct ServerStats {
+    size_t   requests;
+    size_t   ok;         // the expected status
+    size_t   busy;       // 503 from a full relay queue
+    size_t   wrongStatus;
+    double   handlerUs;
+    uint64_t allocations;
+    uint64_t allocated;
+    int64_t  netBytes;
+    uint64_t bodyBytes;
+};
+
+// One outstanding request per client
+struct Slot {
+    AsyncWebServerRequest*  request = nullptr;
+    Route                   route = ROOT;
+    bool                    done = false;
+    std::mutex              lock;
+    std::condition_variable cv;
+};
+
+// Clients waiting for the server thread, oldest first
+class Pending {
+public:
+    explicit Pending(size_t clients) : _ring(clients), _head(0), _count(0), _stop(false) {}
+
+    void push(size_t client)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _ring[(_head + _count++) % _ring.size()] = client;
+        _cv.notify_one();
+    }
+    // false once stopped and empty
+    bool pop(size_t& client)
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        _cv.wait(lock, [this] { return _count > 0 || _stop; });
+        if (_count == 0) return false;
+        client = _ring[_head];
+        _head = (_head + 1) % _ring.size();
+        _count--;
+        return true;
+    }
+    void stop()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _stop = true;
+        _cv.notify_one();
+    }
+
+private:
+    std::vector<size_t>     _ring;
+    size_t                  _head, _count;
+    bool                    _stop;
+    std::mutex              _lock;
+    std::condition_variable _cv;
+};
+
+bool parseMix(const char* text, unsigned weights[NUM_ROUTES])
+{
+    std::fill(weights, weights + NUM_ROUTES, 0u);
+    std::string mix(text);
+    size_t pos = 0;
+    while (pos < mix.size()) {
+        size_t end = mix.find(',', pos);
+        if (end == std::string::npos) end = mix.size();
+        const std::string item = mix.substr(pos, end - pos);
+        const size_t colon = item.find(':');
+        size_t r = 0;
+        while (r < NUM_ROUTES && item.compare(0, colon, ROUTES[r].name) != 0) r++;
+        if (colon == std::string::npos || r == NUM_ROUTES) {
+            return false;
+        }
+        weights[r] = unsigned(atoi(item.c_str() + colon + 1));
+        pos = end + 1;
+    }
+    unsigned total = 0;
+    for (size_t r = 0; r < NUM_ROUTES; r++) total += weights[r];
+    return total > 0;
+}
+
+double percentile(std::vector<float>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    const size_t i = std::min(sorted.size() - 1, size_t(p * double(sorted.size())));
+    return sorted[i];
+}
+
+void printRow(FILE* f, const Row& r)
+{
+    fprintf(f, "%-8s %9zu %9zu %7zu %9.0f %8.1f %8.1f %9.1f %10.2f %10.2f %9.0f\n", r.route, r.requests, r.ok, r.busy,
+            r.perSecond, r.p50Us, r.p99Us, r.p999Us, r.handlerUs, r.allocs, r.bytes);
+}
+
+void printTable(FILE* f, const std::vector<Row>& rows)
+{
+    fprintf(f, "%-8s %9s %9s %7s %9s %8s %8s %9s %10s %10s %9s\n", "route", "requests", "ok", "busy", "req/s",
+            "p50 us", "p99 us", "p99.9 us", "handler us", "allocs/req", "bytes/req");
+    for (const Row& r : rows) printRow(f, r);
+}
+
+bool loadBaseline(const char* path, std::vector<Row>& rows)
+{
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        Row r;
+        if (line[0] == '#' || strncmp(line, "route", 5) == 0) continue;
+        if (sscanf(line, "%15s %zu %zu %zu %lf %lf %lf %lf %lf %lf %lf", r.route, &r.requests, &r.ok, &r.busy,
+                   &r.perSecond, &r.p50Us, &r.p99Us, &r.p999Us, &r.handlerUs, &r.allocs, &r.bytes) == 11) {
+            rows.push_back(r);
+        }
+    }
+    fclose(f);
+    return !rows.empty();
+}
+
+// Regressions against the baseline, printed; the number found
+size_t compare(const std::vector<Row>& base, const std::vector<Row>& now, double slack)
+{
+    size_t regressions = 0;
+    for (const Row& b : base) {
+        const Row* n = nullptr;
+        for (const Row& r : now) {
+            if (strcmp(r.route, b.route) == 0) n = &r;
+        }
+        if (n == nullptr || n->requests == 0) continue; // not in this mix
+        if (n->allocs > b.allocs + 0.05) {
+            printf("  REGRESSION %s: %.2f allocations a request, baseline %.2f\n", b.route, n->allocs, b.allocs);
+            regressions++;
+        }
+        // Work refused rather than done: a slower relay task or a smaller queue
+        const double busyShare = double(n->busy) / double(n->requests);
+        const double baseBusyShare = b.requests ? double(b.busy) / double(b.requests) : 0.0;
+        if (busyShare > baseBusyShare + 0.05) {
+            printf("  REGRESSION %s: %.1f%% refused busy, baseline %.1f%%\n", b.route, busyShare * 100,
+                   baseBusyShare * 100);
+            regressions++;
+        }
+        if (n->p99Us > b.p99Us * slack) {
+            printf("  REGRESSION %s: p99 %.1f us, baseline %.1f us\n", b.route, n->p99Us, b.p99Us);
+            regressions++;
+        }
+        if (strcmp(b.route, "all") == 0 && n->perSecond * slack < b.perSecond) {
+            printf("  REGRESSION: %.0f requests/s, baseline %.0f\n", n->perSecond, b.perSecond);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+} // namespace
+
+int cmdLoadWeb(int argc, char** argv)
+{
+    const size_t clients = size_t(argNumber(argc, argv, "--clients", 4));
+    const double seconds = argNumber(argc, argv, "--seconds", 5);
+    const int thinkMs = int(argNumber(argc, argv, "--think-ms", 0));
+    const int pressMs = int(argNumber(argc, argv, "--press-ms", 100));
+    const unsigned seed = unsigned(argNumber(argc, argv, "--seed", 1));
+    const char* mixText = argString(argc, argv, "--mix", DEFAULT_MIX);
+    const char* outPath = argString(argc, argv, "--out", nullptr);
+    const char* checkPath = argString(argc, argv, "--check", nullptr);
+    const double slack = argNumber(argc, argv, "--slack", 3);
+    unsigned weights[NUM_ROUTES];
+    if (clients == 0 || seconds <= 0 || !parseMix(mixText, weights)) {
+        printf("--clients and --seconds must be positive, --mix route:weight,... of");
+        for (const RouteInfo& r : ROUTES) printf(" %s", r.name);
+        printf("\n");
+        return 1;
+    }
+
+    // The firmware's objects as main.cpp wires them, on simulated relays
+    SimRelayHal hal;
+    RelayController relays(hal);
+    GAPTuner tuner(relays);
+    TunerMetrics metrics;
+    TunerState state;
+    relays.initializePins();
+    tuner.applyDefaultState();
+    state.relaysChanged(tuner);
+    hal.setRealTime(true);
+    RelayExecutor executor(tuner);
+    executor.attachMetrics(&metrics);
+    executor.attachState(&state);
+    executor.begin();
+    HostRigTransport rigTcp, rigSerial, vnaTcp, vnaSerial;
+    RigFollower rig(executor, tuner, relays, rigTcp, rigSerial);
+    MemoryFlash calFlash(CAL_STORE_SIZE);
+    VnaSequencer vna(executor, tuner, relays, state, vnaTcp, vnaSerial, calFlash);
+    CalCorrector cal;
+    NetworkMgr network("gaptuner");
+    PowerManager power(network, executor, tuner, relays, rig, metrics);
+    AsyncWebServer server(80);
+    WebServerManager web(server, tuner, executor, network, metrics, state, rig, power, vna, cal);
+    web.setupRoutes();
+
+    // Requests are built up front and sent again and again, so that the
+    // server thread allocates only what the handlers do
+    std::vector<std::vector<std::unique_ptr<AsyncWebServerRequest>>> requests(clients);
+    for (size_t c = 0; c < clients; c++) {
+        for (size_t r = 0; r < NUM_ROUTES; r++) {
+            const size_t variants = r == BUTTON ? size_t(GAPTuner::NUM_ACTIONS) : 1;
+            for (size_t v = 0; v < variants; v++) {
+                std::string target = ROUTES[r].target;
+                if (r == BUTTON) target += std::to_string(v + 1);
+                requests[c].emplace_back(new AsyncWebServerRequest(target.c_str()));
+                if (r == RELOAD) requests[c].back()->addHeader("If-None-Match", g_webUiAssets[0].etag);
+            }
+        }
+    }
+    const auto requestFor = [&](size_t c, Route r, size_t n) {
+        const size_t index = r <= BUTTON ? size_t(r) : size_t(r) + GAPTuner::NUM_ACTIONS - 1;
+        return requests[c][r == BUTTON ? index + n % GAPTuner::NUM_ACTIONS : index].get();
+    };
+
+    std::vector<Slot> slots(clients);
+    Pending pending(clients);
+    ServerStats stats[NUM_ROUTES] = {};
+    int64_t serverNetBytes = 0;
+
+    // The AsyncTCP task: one request at a time
+    std::thread serverThread([&] {
+        static uint8_t window[1460]; // one TCP segment
+        size_t c;
+        const AllocStats start = threadAllocs();
+        while (pending.pop(c)) {
+            Slot& slot = slots[c];
+            ServerStats& s = stats[slot.route];
+            const AllocStats a0 = threadAllocs();
+            const Clock::time_point t0 = Clock::now();
+            server.dispatch(slot.request);
+            const int status = slot.request->response() ? slot.request->response()->code() : 0;
+            s.bodyBytes += slot.request->transmit(window, sizeof(window));
+            s.handlerUs += std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+            const AllocStats a = allocsSince(a0, threadAllocs());
+            s.requests++;
+            s.allocations += a.allocations;
+            s.allocated += a.allocated;
+            s.netBytes += a.bytes;
+            const RouteInfo& info = ROUTES[slot.route];
+            s.ok += status == info.status;
+            s.busy += info.busy != 0 && status == info.busy;
+            s.wrongStatus += status != info.status && (info.busy == 0 || status != info.busy);
+            {
+                std::lock_guard<std::mutex> lock(slot.lock);
+                slot.done = true;
+            }
+            slot.cv.notify_one();
+        }
+        serverNetBytes = allocsSince(start, threadAllocs()).bytes;
+    });
+
+    // The phones
+    std::vector<std::vector<float>> latencyUs[NUM_ROUTES];
+    for (auto& perClient : latencyUs) perClient.resize(clients);
+    const Clock::time_point begin = Clock::now();
+    const Clock::time_point deadline = begin + std::chrono::microseconds(int64_t(seconds * 1e6));
+    std::vector<std::thread> clientThreads;
+    for (size_t c = 0; c < clients; c++) {
+        clientThreads.emplace_back([&, c] {
+            std::mt19937 rng(seed * 1000u + unsigned(c));
+            unsigned total = 0;
+            for (unsigned w : weights) total += w;
+            Slot& slot = slots[c];
+            Clock::time_point nextPress = Clock::now();
+            for (size_t n = 0; Clock::now() < deadline; n++) {
+                unsigned pick = rng() % total;
+                size_t r = 0;
+                while (pick >= weights[r]) pick -= weights[r++];
+                if (r == BUTTON && pressMs > 0) {
+                    if (Clock::now() < nextPress) {
+                        // Not yet: another route, drawn from the rest of the mix
+                        if (total == weights[BUTTON]) {
+                            std::this_thread::sleep_until(std::min(nextPress, deadline));
+                            continue;
+                        }
+                        pick = rng() % (total - weights[BUTTON]);
+                        r = 0;
+                        while (r == BUTTON || pick >= weights[r]) {
+                            if (r != BUTTON) pick -= weights[r];
+                            r++;
+                        }
+                    } else {
+                        nextPress = Clock::now() + std::chrono::milliseconds(pressMs);
+                    }
+                }
+                slot.route = Route(r);
+                slot.request = requestFor(c, Route(r), n);
+                slot.done = false;
+                const Clock::time_point t0 = Clock::now();
+                pending.push(c);
+                {
+                    std::unique_lock<std::mutex> lock(slot.lock);
+                    slot.cv.wait(lock, [&slot] { return slot.done; });
+                }
+                latencyUs[r][c].push_back(float(std::chrono::duration<double, std::micro>(Clock::now() - t0).count()));
+                if (thinkMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+            }
+        });
+    }
+    for (std::thread& t : clientThreads) t.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    pending.stop();
+    serverThread.join();
+    executor.end();
+
+    std::vector<Row> rows;
+    std::vector<float> all;
+    ServerStats total = {};
+    size_t failures = 0;
+    for (size_t r = 0; r <= NUM_ROUTES; r++) {
+        std::vector<float> merged;
+        const ServerStats& s = r < NUM_ROUTES ? stats[r] : total;
+        if (r < NUM_ROUTES) {
+            for (const auto& perClient : latencyUs[r]) merged.insert(merged.end(), perClient.begin(), perClient.end());
+            all.insert(all.end(), merged.begin(), merged.end());
+            total.requests += s.requests;
+            total.ok += s.ok;
+            total.busy += s.busy;
+            total.handlerUs += s.handlerUs;
+            total.allocations += s.allocations;
+            total.allocated += s.allocated;
+            if (s.wrongStatus > 0) {
+                printf("  FAIL: %s answered %zu requests with an unexpected status\n", ROUTES[r].name, s.wrongStatus);
+                failures++;
+            }
+        } else {
+            merged = all;
+        }
+        if (s.requests == 0) continue;
+        std::sort(merged.begin(), merged.end());
+        Row row;
+        snprintf(row.route, sizeof(row.route), "%s", r < NUM_ROUTES ? ROUTES[r].name : "all");
+        row.requests = s.requests;
+        row.ok = s.ok;
+        row.busy = s.busy;
+        row.perSecond = double(s.requests) / elapsed;
+        row.p50Us = percentile(merged, 0.50);
+        row.p99Us = percentile(merged, 0.99);
+        row.p999Us = percentile(merged, 0.999);
+        row.handlerUs = s.handlerUs / double(s.requests);
+        row.allocs = double(s.allocations) / double(s.requests);
+        row.bytes = double(s.allocated) / double(s.requests);
+        rows.push_back(row);
+    }
+
+    printf("%zu clients for %.1f s, think %d ms, press %d ms, mix %s, seed %u\n", clients, elapsed, thinkMs, pressMs,
+           mixText, seed);
+    printTable(stdout, rows);
+    printf("server thread heap %lld bytes net\n", (long long)serverNetBytes);
+    if (serverNetBytes != 0) {
+        printf("  FAIL: the handlers left heap allocated\n");
+        failures++;
+    }
+
+    if (outPath != nullptr) {
+        FILE* f = fopen(outPath, "w");
+        if (f == nullptr) {
+            printf("cannot write %s\n", outPath);
+            return 1;
+        }
+        fprintf(f, "# program load-web --clients %zu --seconds %g --think-ms %d --press-ms %d --mix %s --seed %u\n",
+                clients, seconds, thinkMs, pressMs, mixText, seed);
+        fprintf(f, "# ok: the expected status (202 for button); busy: 503, the relay queue full;\n");
+        fprintf(f, "# latency: request sent to last body byte; handler: dispatch and body only;\n");
+        fprintf(f, "# allocs and bytes: heap use per request on the server thread\n");
+        printTable(f, rows);
+        fclose(f);
+        printf("wrote %s\n", outPath);
+    }
+    if (checkPath != nullptr) {
+        std::vector<Row> base;
+        if (!loadBaseline(checkPath, base)) {
+            printf("cannot read %s\n", checkPath);
+            return 1;
+        }
+        const size_t regressions = compare(base, rows, slack);
+        printf("against %s (slack %gx): %zu regressions\n", checkPath, slack, regressions);
+        failures += regressions;
+    }
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#ifndef MEMORY_FLASH_H
+#define MEMORY_FLASH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "SweepStore.h" // For SweepFlash, SWEEP_SECTOR_SIZE
+
+// In-memory partition with NOR flash semantics for the host tools: erase
+// sets 0xFF (whole sectors only), writes only clear bits. Offsets are
+// relative to base.
+class MemoryFlash : public SweepFlash {
+public:
+    explicit MemoryFlash(size_t size) : bytes(size, 0xFF), base(0) {}
+    bool flashErase(uint32_t offset, uint32_t len) override
+    {
+        if (offset % SWEEP_SECTOR_SIZE || base + offset + len > bytes.size()) return false;
+        memset(&bytes[base + offset], 0xFF, len);
+        return true;
+    }
+    bool flashWrite(uint32_t offset, const void* data, uint32_t len) override
+    {
+        if (base + offset + len > bytes.size()) return false;
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        for (uint32_t i = 0; i < len; i++) bytes[base + offset + i] &= src[i];
+        return true;
+    }
+    std::vector<uint8_t> bytes;
+    uint32_t base;
+};
+
+#endif // MEMORY_FLASH_H
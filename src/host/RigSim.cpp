@@ -0,0 +1,256 @@
+#include "RigSim.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include "RigProtocol.h"
+
+// hamlib error codes
+static const int RIG_EINVAL  = -1;
+static const int RIG_ENIMPL  = -4;
+static const int RIG_ENAVAIL = -11;
+
+RigSim::RigSim(uint32_t freqHz, const RigSimOptions& options) :
+    _options(options), _freqHz(freqHz), _ptt(false), _requests(0), _stopping(false), _listenFd(-1), _civFd(-1)
+{
+}
+
+RigSim::~RigSim()
+{
+    stop();
+}
+
+uint16_t RigSim::startRigctld(uint16_t port)
+{
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenFd < 0) {
+        return 0;
+    }
+    const int one = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if (bind(_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(_listenFd, 4) != 0 ||
+        getsockname(_listenFd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        close(_listenFd);
+        _listenFd = -1;
+        return 0;
+    }
+    _acceptThread = std::thread([this] { acceptLoop(); });
+    return ntohs(addr.sin_port);
+}
+
+int RigSim::openCiv()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_civFd >= 0) shutdown(_civFd, SHUT_RDWR);
+        _civFd = fds[0];
+    }
+    addClient(fds[0]);
+    std::lock_guard<std::mutex> lock(_lock);
+    _threads.emplace_back([this, fd = fds[0]] { serveCiv(fd); });
+    return fds[1];
+}
+
+void RigSim::dropClients()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    for (int fd : _clients) shutdown(fd, SHUT_RDWR);
+}
+
+void RigSim::stop()
+{
+    _stopping = true;
+    if (_acceptThread.joinable()) _acceptThread.join();
+    if (_listenFd >= 0) {
+        close(_listenFd);
+        _listenFd = -1;
+    }
+    dropClients();
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        threads.swap(_threads);
+    }
+    for (std::thread& t : threads) t.join();
+}
+
+void RigSim::setFrequency(uint32_t hz)
+{
+    _freqHz = hz;
+    if (!_options.transceive) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_civFd >= 0) {
+        uint8_t frame[CIV_MAX_FRAME];
+        const size_t n = civFrequencyFrame(CIV_BROADCAST, _options.civAddress, CIV_CMD_FREQ_TX, hz, frame, sizeof(frame));
+        send(_civFd, frame, n, MSG_NOSIGNAL);
+    }
+}
+
+void RigSim::setPtt(bool ptt)
+{
+    _ptt = ptt;
+}
+
+void RigSim::addClient(int fd)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.push_back(fd);
+}
+
+void RigSim::acceptLoop()
+{
+    while (!_stopping) {
+        pollfd p = {_listenFd, POLLIN, 0};
+        if (poll(&p, 1, 20) <= 0) continue;
+        const int fd = accept(_listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        addClient(fd);
+        std::lock_guard<std::mutex> lock(_lock);
+        _threads.emplace_back([this, fd] { serveRigctld(fd); });
+    }
+}
+
+// One thread per connection, as rigctld itself does
+void RigSim::serveRigctld(int fd)
+{
+    std::string pending;
+    char buf[256];
+    bool quit = false;
+    ssize_t n;
+    while (!quit && (n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        pending.append(buf, size_t(n));
+        size_t nl;
+        while (!quit && (nl = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, nl);
+            pending.erase(0, nl + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            const std::string reply = rigctldReply(line, quit);
+            if (!reply.empty() && send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0) quit = true;
+        }
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), fd), _clients.end());
+    close(fd);
+}
+
+std::string RigSim::rigctldReply(const std::string& line, bool& quit)
+{
+    char reply[48];
+    const size_t space = line.find(' ');
+    std::string cmd = line.substr(0, space);
+    const char* arg = space == std::string::npos ? "" : line.c_str() + space + 1;
+    if (cmd == "\\get_freq") cmd = "f";
+    else if (cmd == "\\set_freq") cmd = "F";
+    else if (cmd == "\\get_ptt") cmd = "t";
+    else if (cmd == "\\set_ptt") cmd = "T";
+    _requests++;
+    int code = 0;
+    if (cmd == "f") {
+        snprintf(reply, sizeof(reply), "%u\n", (unsigned)_freqHz.load());
+        return reply;
+    } else if (cmd == "t") {
+        if (!_options.pttSupported) {
+            code = RIG_ENAVAIL;
+        } else {
+            return _ptt ? "1\n" : "0\n";
+        }
+    } else if (cmd == "F") {
+        const double hz = atof(arg);
+        if (hz < 1.0) code = RIG_EINVAL;
+        else setFrequency(uint32_t(hz + 0.5));
+    } else if (cmd == "T") {
+        if (*arg != '0' && *arg != '1') code = RIG_EINVAL;
+        else setPtt(*arg == '1');
+    } else if (cmd == "q" || cmd == "Q") {
+        quit = true;
+        return std::string();
+    } else if (cmd.empty()) {
+        return std::string();
+    } else {
+        code = RIG_ENIMPL;
+    }
+    snprintf(reply, sizeof(reply), "RPRT %d\n", code);
+    return reply;
+}
+
+void RigSim::serveCiv(int fd)
+{
+    uint8_t frame[CIV_MAX_FRAME];
+    size_t len = 0;
+    uint8_t buf[64];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        sendCiv(fd, buf, size_t(n)); // the bus echoes everything
+        for (ssize_t i = 0; i < n; i++) {
+            const uint8_t b = buf[i];
+            if (b == CIV_PREAMBLE) {
+                if (len >= 2 && frame[len - 1] != CIV_PREAMBLE) len = 0;
+                if (len < 2) frame[len++] = b;
+            } else if (len < 2) {
+                len = 0;
+            } else if (b == CIV_END) {
+                civFrame(fd, frame, len);
+                len = 0;
+            } else if (len < sizeof(frame)) {
+                frame[len++] = b;
+            } else {
+                len = 0;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), fd), _clients.end());
+    if (_civFd == fd) _civFd = -1;
+    close(fd);
+}
+
+// frame: FE FE to from cmd data... (without FD)
+void RigSim::civFrame(int fd, const uint8_t* frame, size_t len)
+{
+    const uint8_t rig = _options.civAddress;
+    if (len < 5 || (frame[2] != rig && frame[2] != CIV_BROADCAST) || frame[3] == rig) {
+        return;
+    }
+    _requests++;
+    const uint8_t from = frame[3], cmd = frame[4];
+    uint8_t reply[CIV_MAX_FRAME];
+    size_t n = 0;
+    if (cmd == CIV_CMD_READ_FREQ && len == 5) {
+        n = civFrequencyFrame(from, rig, CIV_CMD_READ_FREQ, _freqHz, reply, sizeof(reply));
+    } else if (cmd == CIV_CMD_PTT && len == 6 && frame[5] == 0x00 && _options.pttSupported) {
+        n = civPttFrame(from, rig, _ptt, reply, sizeof(reply));
+    } else {
+        uint32_t hz = 0;
+        const bool set = cmd == CIV_CMD_SET_FREQ && len == 10 && civDecodeFrequency(frame + 5, hz);
+        const uint8_t ack[] = {CIV_PREAMBLE, CIV_PREAMBLE, from, rig, set ? CIV_OK : CIV_NG, CIV_END};
+        memcpy(reply, ack, sizeof(ack));
+        n = sizeof(ack);
+        if (set) _freqHz = hz;
+    }
+    sendCiv(fd, reply, n);
+}
+
+void RigSim::sendCiv(int fd, const uint8_t* data, size_t len)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    send(fd, data, len, MSG_NOSIGNAL);
+}
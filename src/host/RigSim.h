@@ -0,0 +1,70 @@
+#ifndef RIG_SIM_H
+#define RIG_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct RigSimOptions {
+    uint8_t civAddress   = 0x94; // IC-7300 default
+    bool    transceive   = true; // CI-V: broadcast VFO changes
+    bool    pttSupported = true; // false: PTT reads fail (RPRT -11, NG)
+};
+
+// Simulated transceiver for the host tools, reachable the two ways the
+// tuner follows a rig:
+//   rigctld  TCP server speaking the default rigctld protocol: f, F <hz>,
+//            t, T <0|1>, q (and their \get_freq style long names), errors
+//            as "RPRT <code>"
+//   CI-V     one end of a socketpair standing in for the single-wire bus:
+//            every byte the controller sends is echoed, read frequency (03),
+//            set frequency (05) and PTT (1C 00) are answered, and with
+//            transceive on every VFO change is broadcast (cmd 00)
+// The VFO and PTT are set by the test (or by rigctld clients).
+class RigSim {
+public:
+    explicit RigSim(uint32_t freqHz, const RigSimOptions& options = RigSimOptions());
+    ~RigSim();
+
+    // Listens on 127.0.0.1:port (0: any free port); the bound port, 0 on error
+    uint16_t startRigctld(uint16_t port);
+    // Controller end of a new CI-V bus (the previous one is disconnected), -1 on error
+    int openCiv();
+    // Disconnects every client, as a rig restart would
+    void dropClients();
+    void stop();
+
+    void setFrequency(uint32_t hz);
+    void setPtt(bool ptt);
+    uint32_t frequency() const { return _freqHz; }
+    bool ptt() const { return _ptt; }
+    // Requests answered so far (rigctld lines, CI-V frames to the rig)
+    uint32_t requests() const { return _requests; }
+
+private:
+    void acceptLoop();
+    void serveRigctld(int fd);
+    void serveCiv(int fd);
+    std::string rigctldReply(const std::string& line, bool& quit);
+    void civFrame(int fd, const uint8_t* frame, size_t len);
+    void sendCiv(int fd, const uint8_t* data, size_t len);
+    void addClient(int fd);
+
+    RigSimOptions         _options;
+    std::atomic<uint32_t> _freqHz;
+    std::atomic<bool>     _ptt;
+    std::atomic<uint32_t> _requests;
+    std::atomic<bool>     _stopping;
+    int                   _listenFd;
+    std::thread           _acceptThread;
+    std::mutex            _lock;    // _clients, _civFd, _threads, CI-V writes
+    std::vector<int>      _clients;
+    int                   _civFd;   // simulator end of the CI-V bus, or -1
+    std::vector<std::thread> _threads;
+};
+
+#endif // RIG_SIM_H
@@ -0,0 +1,49 @@
+// rigctld-sim: a simulated rig behind a rigctld TCP server, for trying the
+// tuner's follow mode without a radio.
+//
+//   program rigctld-sim [--port 4532] [--freq 14074000] [--no-ptt]
+//
+// Point the tuner's /rig settings at this host and port. Lines on stdin
+// drive the rig: "F <hz>" sets the VFO, "T 1" / "T 0" keys and unkeys,
+// "drop" disconnects the clients, "q" quits. --no-ptt answers PTT reads
+// with RPRT -11, as rigs without PTT status do.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "RigProtocol.h"
+#include "RigSim.h"
+
+int cmdRigctldSim(int argc, char** argv)
+{
+    RigSimOptions options;
+    options.pttSupported = !argFlag(argc, argv, "--no-ptt");
+    RigSim rig(uint32_t(argNumber(argc, argv, "--freq", 14074000)), options);
+    const uint16_t port = rig.startRigctld(uint16_t(argNumber(argc, argv, "--port", RIGCTLD_PORT)));
+    if (port == 0) {
+        fprintf(stderr, "cannot listen on the rigctld port\n");
+        return 1;
+    }
+    printf("rigctld simulator on 127.0.0.1:%u, VFO %u Hz\n", (unsigned)port, (unsigned)rig.frequency());
+    char line[64];
+    while (fgets(line, sizeof(line), stdin) != nullptr) {
+        if (line[0] == 'F' && line[1] == ' ') {
+            rig.setFrequency(uint32_t(atof(line + 2) + 0.5));
+        } else if (line[0] == 'T' && line[1] == ' ') {
+            rig.setPtt(line[2] == '1');
+        } else if (strncmp(line, "drop", 4) == 0) {
+            rig.dropClients();
+        } else if (line[0] == 'q') {
+            break;
+        } else {
+            printf("F <hz> | T 0|1 | drop | q\n");
+            continue;
+        }
+        printf("VFO %u Hz, PTT %s, %u requests answered\n", (unsigned)rig.frequency(), rig.ptt() ? "on" : "off",
+               (unsigned)rig.requests());
+    }
+    rig.stop();
+    return 0;
+}
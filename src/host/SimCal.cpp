@@ -0,0 +1,312 @@
+// sim-cal: automated VNA characterisation end to end. VnaSequencer drives a
+// software VNA (VnaSim) over SCPI, by TCP and over a serial link, through
+// Open, Short, Load, the antenna with K4 energised at both gap lengths and
+// a verify sweep through the matching network, on simulated relays in real
+// time.
+//
+//   program sim-cal [--link tcp|serial|both] [--points 1001] [--us-per-point 20] [--limit-s 5] [--verbose]
+//
+// The VNA sees the relays: K1-K3 select the standards (an open with fringe
+// capacitance, a short and a load with some inductance), K4 the antenna from
+// docs/Longz or docs/Shortz by the gap relays, otherwise the antenna through
+// the LC network as the KM relays are latched. Its readings go through a
+// known error box (directivity, source match, a lossy cable). Per link:
+//   run        every sweep is in its slot of an in-memory vnacal partition
+//              with the run's id and matches what the VNA read (float
+//              rounding only); no relay moved while the VNA swept, and the
+//              relays are back as found afterwards
+//   interlock  a button pressed during a (slowed) sweep fails on the RF
+//              interlock instead of switching; the run still completes
+//   timing     relay and sweep time per step; the whole characterisation
+//              must take less than --limit-s
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <thread>
+#include <vector>
+#include "CalStore.h"
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "HostRigTransport.h"
+#include "MatchSolver.h"
+#include "MemoryFlash.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "SimRelayHal.h"
+#include "SweepFile.h"
+#include "TunerDesign.h"
+#include "TunerState.h"
+#include "VnaSequencer.h"
+#include "VnaSim.h"
+
+namespace {
+
+typedef std::complex<double> cd;
+
+// Tuning found before the run, through the network with "C, L"
+const TuneState PRIOR_STATE{0x5, 0x3, Topology::CL};
+
+enum class Path : uint8_t { Open, Short, Load, Antenna, Network, None };
+
+// What the VNA port is connected to, from the relay contacts
+struct Plant {
+    VnaStandards standards;
+    SweepData    antenna[NUM_GAP_LENGTHS];
+    TunerModel   model = TunerDesign::model();
+
+    cd antennaZ(GapLength gap, double hz) const
+    {
+        const ImpedanceSweep sweep = antenna[size_t(gap)].view();
+        const float f = float(fmin(fmax(hz, sweep.minFreq()), sweep.maxFreq()));
+        Cplx z{50.0f, 0.0f};
+        sweep.impedanceAt(f, z);
+        return cd(z.re, z.im);
+    }
+
+    cd reflection(Path path, GapLength gap, const TuneState& state, double hz) const
+    {
+        switch (path) {
+        case Path::Open:    return standards.open(hz);
+        case Path::Short:   return standards.shortCircuit(hz);
+        case Path::Load:    return standards.load(hz);
+        case Path::Antenna: return standards.gamma(antennaZ(gap, hz));
+        default:            break;
+        }
+        Cplx zL[1u << TunerDesign::L_BITS];
+        Cplx yC[1u << TunerDesign::C_BITS];
+        model.seriesImpedances(float(hz), zL);
+        model.shuntAdmittances(float(hz), yC);
+        const cd za = antennaZ(gap, hz);
+        const Cplx z = MatchSolver::inputImpedance(Cplx{float(za.real()), float(za.imag())}, zL[state.lMask],
+                                                   yC[state.cMask], state.topology);
+        return standards.gamma(cd(z.re, z.im));
+    }
+};
+
+struct Bench {
+    SimRelayHal     hal;
+    RelayController relays;
+    GAPTuner        tuner;
+    RelayExecutor   executor;
+    TunerState      state;
+
+    Bench() : relays(hal), tuner(relays), executor(tuner)
+    {
+        relays.initializePins();
+        tuner.applyDefaultState();
+        hal.setRealTime(true);
+        executor.attachState(&state);
+        executor.begin();
+    }
+    ~Bench() { executor.end(); }
+
+    RelayJobState wait(uint32_t id)
+    {
+        RelayJobStatus s;
+        for (int i = 0; i < 5000 && executor.status(id, s); i++) {
+            if (s.state != RelayJobState::Queued && s.state != RelayJobState::Running) return s.state;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return RelayJobState::Unknown;
+    }
+
+    // One bit per relay contact
+    uint64_t contacts() const
+    {
+        uint64_t bits = 0;
+        for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+            if (hal.contact(RelayId(r))) bits |= uint64_t(1) << r;
+        }
+        return bits;
+    }
+
+    Path path() const
+    {
+        const bool k1 = hal.contact(RelayId::K1), k2 = hal.contact(RelayId::K2), k3 = hal.contact(RelayId::K3);
+        if (k1 && !k3) return k2 ? Path::Short : Path::Open;
+        if (k3 && !k1 && !k2) return Path::Load;
+        if (k1 || k2 || k3) return Path::None;
+        return hal.contact(RelayId::K4) ? Path::Antenna : Path::Network;
+    }
+
+    bool gapKnown() const { return hal.contact(RelayId::K8) == hal.contact(RelayId::K9); }
+    GapLength gap() const { return hal.contact(RelayId::K8) ? GapLength::Long : GapLength::Short; }
+
+    TuneState tuneState() const
+    {
+        static const RelayId l[] = {RelayId::KML1, RelayId::KML2, RelayId::KML3, RelayId::KML4};
+        static const RelayId c[] = {RelayId::KMC1, RelayId::KMC2, RelayId::KMC3, RelayId::KMC4};
+        TuneState s{0, 0, hal.contact(RelayId::LK99) ? Topology::CL : Topology::LC};
+        for (size_t i = 0; i < TunerDesign::L_BITS; i++) s.lMask |= hal.contact(l[i]) ? 1u << i : 0;
+        for (size_t i = 0; i < TunerDesign::C_BITS; i++) s.cMask |= hal.contact(c[i]) ? 1u << i : 0;
+        return s;
+    }
+
+    // The tuner as a user left it: antenna long, tuned through the network
+    bool prepare()
+    {
+        RelayTarget target;
+        for (size_t i = 0; i < TunerDesign::L_BITS; i++) {
+            RelayController::setTarget(target, RelayId(size_t(RelayId::KML1) + i), PRIOR_STATE.lMask & (1u << i));
+        }
+        for (size_t i = 0; i < TunerDesign::C_BITS; i++) {
+            RelayController::setTarget(target, RelayId(size_t(RelayId::KMC1) + i), PRIOR_STATE.cMask & (1u << i));
+        }
+        return relays.applyTarget(target) &&
+               wait(executor.submitButton(int(GAPTuner::ButtonID::ANTENNA_LONG))) == RelayJobState::Done &&
+               wait(executor.submitButton(int(GAPTuner::ButtonID::TUNING_1))) == RelayJobState::Done;
+    }
+};
+
+struct LinkResult {
+    size_t   failures = 0;
+    CalStatus status;
+};
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); r.failures++; } } while (0)
+
+// Stored sweep against what the VNA read for the slot's path
+double worstError(const CalTrace& trace, const VnaSim& sim, const Plant& plant, Path path, GapLength gap)
+{
+    double worst = 0.0;
+    for (size_t i = 0; i < trace.size(); i++) {
+        const double hz = sim.frequency(i);
+        const cd want = sim.options().errors.measured(hz, plant.reflection(path, gap, PRIOR_STATE, hz));
+        const cd got(trace.gammaAt(i).re, trace.gammaAt(i).im);
+        worst = fmax(worst, std::abs(got - want));
+        if (trace.freqAt(i) != float(nearbyint(hz))) worst = INFINITY;
+    }
+    return worst;
+}
+
+LinkResult runLink(VnaLink link, const Plant& plant, uint16_t points, double usPerPoint, bool interlock)
+{
+    LinkResult r;
+    Bench bench;
+    CHECK(bench.prepare(), "could not set up the tuning found before the run");
+    const uint64_t found = bench.contacts();
+
+    VnaSimOptions options;
+    options.usPerPoint = usPerPoint;
+    VnaSim sim(
+        [&](double hz, cd& gamma) {
+            const Path path = bench.path();
+            if (path == Path::None || !bench.gapKnown()) return false;
+            gamma = plant.reflection(path, bench.gap(), bench.tuneState(), hz);
+            return true;
+        },
+        [&] { return bench.contacts(); }, options);
+    HostRigTransport tcp;
+    HostRigTransport serial([&](const RigConfig&) { return sim.openSerial(); });
+    MemoryFlash flash(CAL_STORE_SIZE);
+    VnaSequencer sequencer(bench.executor, bench.tuner, bench.relays, bench.state, tcp, serial, flash);
+
+    VnaConfig config;
+    config.link = link;
+    if (link == VnaLink::Tcp) {
+        snprintf(config.host, sizeof(config.host), "127.0.0.1");
+        config.port = sim.startTcp(0);
+        CHECK(config.port != 0, "VNA simulator not listening");
+    }
+    config.points = points;
+    config.bothGaps = true;
+    config.verify = true;
+
+    // A user presses a button while the VNA sweeps
+    std::atomic<bool> done(false);
+    RelayJobState pressed = RelayJobState::Unknown;
+    std::thread user;
+    if (interlock) {
+        user = std::thread([&] {
+            while (!done && !sim.rfOn()) std::this_thread::sleep_for(std::chrono::microseconds(200));
+            if (!done) pressed = bench.wait(bench.executor.submitButton(int(GAPTuner::ButtonID::ANTENNA_SHORT)));
+        });
+    }
+    CHECK(sequencer.start(config), "run not started");
+    CHECK(!sequencer.start(config), "second run started while the first is running");
+    sequencer.wait();
+    done = true;
+    if (user.joinable()) user.join();
+    r.status = sequencer.status();
+
+    CHECK(r.status.state == CalRunState::Done, "run %s: %s", VnaSequencer::stateName(r.status.state), r.status.error);
+    CHECK(sim.movedDuringSweep() == 0, "%u relay moves while the VNA swept", (unsigned)sim.movedDuringSweep());
+    CHECK(sim.invalidPoints() == 0, "%u points swept between relay states", (unsigned)sim.invalidPoints());
+    CHECK(sim.errors() == 0, "%u SCPI commands not understood", (unsigned)sim.errors());
+    CHECK(!bench.relays.rfApplied(), "RF interlock left set");
+    CHECK(bench.contacts() == found && bench.tuner.gapLength() == GapLength::Long, "relays not restored as found");
+    if (interlock) {
+        CHECK(pressed == RelayJobState::Failed, "button during a sweep: %s, not refused",
+              RelayExecutor::stateName(pressed));
+    }
+
+    CalStoreView view;
+    CHECK(view.attach(flash.bytes.data(), flash.bytes.size()), "store not attached");
+    static const Path paths[] = {Path::Open, Path::Short, Path::Load, Path::Antenna, Path::Antenna, Path::Network};
+    static const GapLength gaps[] = {GapLength::Long, GapLength::Long, GapLength::Long, GapLength::Long,
+                                     GapLength::Short, GapLength::Long};
+    for (size_t s = 0; s < size_t(CalSweep::Count); s++) {
+        const CalSweep sweep = CalSweep(s);
+        const CalSlotHeader* h = view.header(sweep);
+        const CalTrace trace = view.trace(sweep);
+        CHECK(h != nullptr && h->runId == r.status.runId && h->gap == uint8_t(gaps[s]) && trace.size() == points,
+              "%s slot missing or not from this run", CalStoreView::sweepName(sweep));
+        if (trace.size() == points) {
+            const double worst = worstError(trace, sim, plant, paths[s], gaps[s]);
+            CHECK(worst < 1e-6, "%s sweep off by %.3g", CalStoreView::sweepName(sweep), worst);
+        }
+    }
+    return r;
+}
+
+} // namespace
+
+int cmdSimCal(int argc, char** argv)
+{
+    const char* linkArg = argString(argc, argv, "--link", "both");
+    const uint16_t points = uint16_t(argNumber(argc, argv, "--points", 1001));
+    const double usPerPoint = argNumber(argc, argv, "--us-per-point", 20);
+    const double limitS = argNumber(argc, argv, "--limit-s", 5);
+    Serial.enabled = argFlag(argc, argv, "--verbose");
+
+    Plant plant;
+    if (!loadSweepFile("docs/Longz", plant.antenna[size_t(GapLength::Long)]) ||
+        !loadSweepFile("docs/Shortz", plant.antenna[size_t(GapLength::Short)])) {
+        printf("cannot read docs/Longz and docs/Shortz\n");
+        return 1;
+    }
+
+    size_t failures = 0;
+    const VnaLink links[] = {VnaLink::Tcp, VnaLink::Serial};
+    const char* const names[] = {"tcp", "serial"};
+    for (size_t l = 0; l < 2; l++) {
+        if (strcmp(linkArg, "both") != 0 && strcmp(linkArg, names[l]) != 0) continue;
+        printf("\n%s, %u points, %.0f us per point:\n", names[l], (unsigned)points, usPerPoint);
+        const LinkResult r = runLink(links[l], plant, points, usPerPoint, false);
+        failures += r.failures;
+        for (size_t s = 0; s < size_t(CalSweep::Count); s++) {
+            const CalStepStatus& step = r.status.steps[s];
+            printf("  %-14s relays %4u ms, sweep + store %5u ms, %u points\n", CalStoreView::sweepName(CalSweep(s)),
+                   (unsigned)step.relayMs, (unsigned)step.sweepMs, (unsigned)step.points);
+        }
+        printf("  total %.2f s (VNA \"%s\")\n", r.status.totalMs * 1e-3, r.status.vna);
+        if (r.status.totalMs > limitS * 1000) {
+            printf("  FAIL: characterisation over the %.0f s limit\n", limitS);
+            failures++;
+        }
+    }
+
+    // Sweeps slow enough to press a button during one
+    printf("\ninterlock, button pressed during a sweep:\n");
+    const LinkResult r = runLink(VnaLink::Tcp, plant, 201, 1000, true);
+    printf("  %s\n", r.failures == 0 ? "refused, run completed" : "FAIL");
+    failures += r.failures;
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
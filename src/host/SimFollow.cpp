@@ -0,0 +1,359 @@
+// sim-follow: CAT follow mode end to end. RigFollower polls a simulated rig
+// (RigSim) over rigctld and over CI-V and retunes a GAPTuner whose relay
+// jobs run on simulated relays in real time.
+//
+//   program sim-follow [--link rigctld|civ|both] [--jumps 20] [--poll-ms 50] [--limit-ms 250] [--verbose]
+//
+// The tune table is synthetic: one entry every 25 kHz from 1.8 to 30 MHz,
+// neighbouring entries a single bank relay apart (Gray code), so every
+// entry is its own segment with edges halfway between entries. Per link:
+//   jumps       band changes between FT8 frequencies; each must retune at
+//               once, and the time from the VFO change until the relays
+//               have settled is reported (the limit applies to the worst)
+//   knob        the VFO swept through several segments faster than the
+//               debounce: no retune while it moves, one when it stops
+//   hysteresis  the VFO parked just across a segment edge: no retune
+//   ptt         a QSY while the rig transmits (and a button press) must not
+//               move a single relay; the retune follows the PTT release
+//   reconnect   the rig drops the link; the follower reconnects and retunes
+// The protocol decoders are checked first on canned replies and frames.
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "HostRigTransport.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "RigFollower.h"
+#include "RigSim.h"
+#include "SimRelayHal.h"
+#include "TuneTable.h"
+#include "TunerDesign.h"
+#include "TunerMetrics.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t TABLE_START_HZ = 1800000;
+constexpr uint32_t TABLE_STOP_HZ  = 30000000;
+constexpr uint32_t TABLE_STEP_HZ  = 25000;
+
+TuneState stateOfEntry(uint32_t index)
+{
+    const uint32_t g = index ^ (index >> 1);
+    return TuneState{uint16_t(g & 0xF), uint16_t(g >> 4 & 0xF), (g >> 8 & 1) ? Topology::CL : Topology::LC};
+}
+
+std::vector<uint32_t> buildTable()
+{
+    const size_t count = (TABLE_STOP_HZ - TABLE_START_HZ) / TABLE_STEP_HZ + 1;
+    std::vector<uint32_t> words((sizeof(TuneTableHeader) + NUM_GAP_LENGTHS * count * sizeof(TuneTableEntry)) / 4);
+    TuneTableHeader* h = reinterpret_cast<TuneTableHeader*>(words.data());
+    h->magic = TUNE_TABLE_MAGIC;
+    h->version = TUNE_TABLE_VERSION;
+    h->headerSize = sizeof(TuneTableHeader);
+    h->lBits = TunerDesign::L_BITS;
+    h->cBits = TunerDesign::C_BITS;
+    h->stepHz = TABLE_STEP_HZ;
+    TuneTableEntry* e = reinterpret_cast<TuneTableEntry*>(reinterpret_cast<uint8_t*>(words.data()) + sizeof(TuneTableHeader));
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        h->offset[g] = uint32_t(sizeof(TuneTableHeader) + g * count * sizeof(TuneTableEntry));
+        h->count[g] = uint32_t(count);
+        for (size_t i = 0; i < count; i++) {
+            *e++ = TuneTableEntry::make(TABLE_START_HZ + uint32_t(i) * TABLE_STEP_HZ, stateOfEntry(uint32_t(i)), 1.3f);
+        }
+    }
+    return words;
+}
+
+TuneState stateFor(uint32_t freqHz)
+{
+    return stateOfEntry((freqHz - TABLE_START_HZ + TABLE_STEP_HZ / 2) / TABLE_STEP_HZ);
+}
+
+bool relaysAt(const SimRelayHal& hal, const TuneState& s)
+{
+    static const RelayId l[] = {RelayId::KML1, RelayId::KML2, RelayId::KML3, RelayId::KML4};
+    static const RelayId c[] = {RelayId::KMC1, RelayId::KMC2, RelayId::KMC3, RelayId::KMC4};
+    for (size_t i = 0; i < TunerDesign::L_BITS; i++) {
+        if (hal.contact(l[i]) != bool(s.lMask & (1u << i))) return false;
+    }
+    for (size_t i = 0; i < TunerDesign::C_BITS; i++) {
+        if (hal.contact(c[i]) != bool(s.cMask & (1u << i))) return false;
+    }
+    return hal.contact(RelayId::LK99) == (s.topology == Topology::CL);
+}
+
+void sleepMs(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+double msSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+struct Bench {
+    SimRelayHal     hal;
+    RelayController relays;
+    GAPTuner        tuner;
+    RelayExecutor   executor;
+    TunerMetrics    metrics;
+    TuneTableView   view;
+    std::vector<uint32_t> table;
+
+    Bench() : relays(hal), tuner(relays), executor(tuner)
+    {
+        table = buildTable();
+        view.attach(reinterpret_cast<const uint8_t*>(table.data()), table.size() * 4);
+        relays.initializePins();
+        tuner.applyDefaultState();
+        tuner.attachTuneTable(&view);
+        hal.setRealTime(true);
+        executor.attachMetrics(&metrics);
+        executor.begin();
+    }
+    ~Bench() { executor.end(); }
+};
+
+// Waits until the follower has retuned past `retunes` and the relays sit at
+// freqHz's state; the time waited in ms, or a negative value on timeout
+double waitRetune(Bench& bench, const RigFollower& follower, uint32_t retunes, uint32_t freqHz, uint32_t timeoutMs)
+{
+    const Clock::time_point t0 = Clock::now();
+    const TuneState want = stateFor(freqHz);
+    while (msSince(t0) < timeoutMs) {
+        if (follower.status().retunes > retunes && bench.executor.idle() && relaysAt(bench.hal, want)) {
+            return msSince(t0);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return -1.0;
+}
+
+size_t writes(const SimRelayHal& hal)
+{
+    size_t n = 0;
+    for (const SimEvent& e : hal.events()) n += e.kind == SimEvent::Write;
+    return n;
+}
+
+struct LinkResult {
+    std::vector<double> jumpMs;
+    double pttReleaseMs = 0;
+    double reconnectMs = 0;
+    size_t failures = 0;
+};
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); r.failures++; } } while (0)
+
+LinkResult runLink(RigLink link, int jumps, uint16_t pollMs)
+{
+    LinkResult r;
+    Bench bench;
+    RigSim rig(14074000);
+    HostRigTransport tcp;
+    HostRigTransport serial([&rig](const RigConfig&) { return rig.openCiv(); });
+    RigFollower follower(bench.executor, bench.tuner, bench.relays, tcp, serial);
+
+    RigConfig config;
+    config.link = link;
+    config.pollMs = pollMs;
+    if (link == RigLink::Rigctld) {
+        const uint16_t port = rig.startRigctld(0);
+        if (port == 0) {
+            printf("  FAIL: cannot listen on 127.0.0.1\n");
+            r.failures++;
+            return r;
+        }
+        strcpy(config.host, "127.0.0.1");
+        config.port = port;
+    } else {
+        config.civAddress = 0x94;
+    }
+    const FollowConfig& policy = config.follow;
+    const uint32_t settleMs = policy.debounceMs + 3u * pollMs + 300u; // generous upper bound for one retune
+
+    // Connect: the first poll retunes to wherever the rig is
+    follower.configure(config);
+    follower.begin();
+    CHECK(waitRetune(bench, follower, 0, 14074000, 2000) >= 0, "no retune after connecting");
+
+    // Band jumps
+    static const uint32_t ft8[] = {3573000, 7074000, 10136000, 14074000, 18100000, 21074000, 24915000, 28074000};
+    uint32_t at = 14074000;
+    for (int i = 0; i < jumps; i++) {
+        uint32_t to = ft8[(i * 3 + 1) % 8];
+        if (to == at) to = ft8[(i * 3 + 2) % 8];
+        const uint32_t before = follower.status().retunes;
+        rig.setFrequency(to);
+        const double ms = waitRetune(bench, follower, before, to, settleMs);
+        CHECK(ms >= 0, "jump %u -> %u Hz did not retune", (unsigned)at, (unsigned)to);
+        if (ms >= 0) r.jumpMs.push_back(ms);
+        at = to;
+        sleepMs(pollMs); // let the follower see the VFO at rest
+    }
+
+    // Knob: 5 kHz every 20 ms, 100 ms per 25 kHz segment, under the debounce
+    {
+        rig.setFrequency(14074000);
+        waitRetune(bench, follower, follower.status().retunes, 14074000, settleMs);
+        const uint32_t before = follower.status().retunes;
+        uint32_t f = 14074000;
+        for (int i = 0; i < 40; i++) {
+            f += 5000;
+            rig.setFrequency(f);
+            sleepMs(20);
+        }
+        const uint32_t whileSpinning = follower.status().retunes - before;
+        CHECK(whileSpinning == 0, "%u retunes while the knob was turning", (unsigned)whileSpinning);
+        CHECK(waitRetune(bench, follower, before + whileSpinning, f, settleMs) >= 0, "no retune after the knob stopped");
+        sleepMs(policy.debounceMs + 2 * pollMs);
+        CHECK(follower.status().retunes == before + whileSpinning + 1, "%u retunes for one knob turn",
+              (unsigned)(follower.status().retunes - before));
+    }
+
+    // Hysteresis: tuned to an entry, VFO 1 kHz across the segment edge
+    {
+        const uint32_t entry = 14075000;
+        rig.setFrequency(entry);
+        waitRetune(bench, follower, follower.status().retunes, entry, settleMs);
+        const uint32_t before = follower.status().retunes;
+        const uint32_t edge = entry + TABLE_STEP_HZ / 2;
+        rig.setFrequency(edge + policy.hysteresisHz / 2);
+        sleepMs(policy.debounceMs + 4 * pollMs);
+        CHECK(follower.status().retunes == before, "retuned within the hysteresis");
+        rig.setFrequency(edge + policy.hysteresisHz + 1000);
+        CHECK(waitRetune(bench, follower, before, edge + policy.hysteresisHz + 1000, settleMs) >= 0,
+              "no retune past the hysteresis");
+    }
+
+    // PTT: nothing moves while transmitting, the retune follows the release
+    {
+        rig.setPtt(true);
+        sleepMs(3 * pollMs);
+        CHECK(bench.relays.rfApplied(), "PTT not passed to the relay controller");
+        const uint32_t before = follower.status().retunes;
+        const size_t writesBefore = writes(bench.hal);
+        rig.setFrequency(21074000);
+        const uint32_t button = bench.executor.submitButton(int(GAPTuner::ButtonID::TUNING_1));
+        sleepMs(policy.debounceMs + 6 * pollMs);
+        RelayJobStatus job;
+        CHECK(bench.executor.status(button, job) && job.state == RelayJobState::Failed, "button job ran during PTT");
+        CHECK(follower.status().retunes == before, "retuned during PTT");
+        CHECK(writes(bench.hal) == writesBefore, "%zu relay writes during PTT", writes(bench.hal) - writesBefore);
+        rig.setPtt(false);
+        r.pttReleaseMs = waitRetune(bench, follower, before, 21074000, settleMs);
+        CHECK(r.pttReleaseMs >= 0, "no retune after PTT release");
+        CHECK(!bench.relays.rfApplied(), "interlock still set after PTT release");
+    }
+
+    // Reconnect: PTT is on when the link drops; the interlock must not stick
+    {
+        rig.setPtt(true);
+        sleepMs(3 * pollMs);
+        const uint32_t before = follower.status().retunes;
+        rig.dropClients();
+        rig.setPtt(false);
+        rig.setFrequency(7074000);
+        r.reconnectMs = waitRetune(bench, follower, before, 7074000, RigFollower::RECONNECT_MS + settleMs + 1000);
+        CHECK(r.reconnectMs >= 0, "no retune after the link came back");
+        CHECK(follower.status().linkErrors > 0, "dropped link not counted");
+    }
+
+    follower.end();
+    rig.stop();
+    CHECK(bench.hal.faults() == 0, "%zu relay timing faults", bench.hal.faults());
+    const MetricHistogram& qsy = bench.metrics.qsyFollow;
+    uint32_t count = 0;
+    for (size_t i = 0; i <= qsy.bounds(); i++) count += qsy.bucket(i);
+    printf("  %u follow jobs, VFO left its segment -> settled mean %.1f ms (qsy_duration{kind=\"follow\"}, incl. debounce)\n",
+           (unsigned)count, count ? qsy.sumUs() * 1e-3 / count : 0.0);
+    return r;
+}
+
+bool checkDecoders()
+{
+    bool ok = true;
+    uint32_t hz = 0;
+    bool ptt = true;
+    ok &= rigctldParseFrequency("14074000", hz) && hz == 14074000;
+    ok &= rigctldParseFrequency("7074000.000000\r", hz) && hz == 7074000;
+    ok &= !rigctldParseFrequency("RPRT -11", hz) && !rigctldParseFrequency("", hz);
+    ok &= rigctldParsePtt("0", ptt) && !ptt && rigctldParsePtt("1", ptt) && ptt && !rigctldParsePtt("RPRT -11", ptt);
+
+    // Echo of our request, noise, the reply, a transceive broadcast, a PTT
+    // reply, a frame for another controller and a collision
+    uint8_t stream[96];
+    size_t n = civReadFrequency(0x94, stream, sizeof(stream));
+    stream[n++] = 0x55;
+    n += civFrequencyFrame(CIV_CONTROLLER, 0x94, CIV_CMD_READ_FREQ, 14074000, stream + n, sizeof(stream) - n);
+    n += civFrequencyFrame(CIV_BROADCAST, 0x94, CIV_CMD_FREQ_TX, 1234567890, stream + n, sizeof(stream) - n);
+    n += civPttFrame(CIV_CONTROLLER, 0x94, true, stream + n, sizeof(stream) - n);
+    n += civFrequencyFrame(0xE1, 0x94, CIV_CMD_READ_FREQ, 3573000, stream + n, sizeof(stream) - n);
+    const uint8_t cut[] = {CIV_PREAMBLE, CIV_PREAMBLE, CIV_CONTROLLER, 0x94, CIV_CMD_READ_FREQ, 0x00};
+    memcpy(stream + n, cut, sizeof(cut));
+    n += sizeof(cut);
+    n += civFrequencyFrame(CIV_CONTROLLER, 0x94, CIV_CMD_READ_FREQ, 28074000, stream + n, sizeof(stream) - n);
+    CivDecoder decoder(0x94);
+    std::vector<CivEvent> events;
+    for (size_t i = 0; i < n; i++) {
+        CivEvent e;
+        if (decoder.feed(stream[i], e)) events.push_back(e);
+    }
+    ok &= events.size() == 4;
+    ok &= events.size() > 0 && events[0].kind == CivEvent::Frequency && events[0].freqHz == 14074000;
+    ok &= events.size() > 1 && events[1].kind == CivEvent::Frequency && events[1].freqHz == 1234567890;
+    ok &= events.size() > 2 && events[2].kind == CivEvent::Ptt && events[2].ptt;
+    ok &= events.size() > 3 && events[3].kind == CivEvent::Frequency && events[3].freqHz == 28074000;
+    return ok;
+}
+
+double percentile(std::vector<double> v, double p)
+{
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, size_t(p * (v.size() - 1) + 0.5))];
+}
+
+} // namespace
+
+int cmdSimFollow(int argc, char** argv)
+{
+    const char* linkArg = argString(argc, argv, "--link", "both");
+    const int jumps = int(argNumber(argc, argv, "--jumps", 20));
+    const uint16_t pollMs = uint16_t(argNumber(argc, argv, "--poll-ms", 50));
+    const double limitMs = argNumber(argc, argv, "--limit-ms", 250);
+    Serial.enabled = argFlag(argc, argv, "--verbose");
+
+    size_t failures = 0;
+    const bool decodersOk = checkDecoders();
+    printf("rigctld parser and CI-V decoder: %s\n", decodersOk ? "ok" : "FAIL");
+    failures += decodersOk ? 0 : 1;
+
+    const RigLink links[] = {RigLink::Rigctld, RigLink::Civ};
+    for (RigLink link : links) {
+        if (strcmp(linkArg, "both") != 0 && strcmp(linkArg, RigFollower::linkName(link)) != 0) continue;
+        printf("\n%s, poll every %u ms:\n", RigFollower::linkName(link), (unsigned)pollMs);
+        const LinkResult r = runLink(link, jumps, pollMs);
+        const double worst = percentile(r.jumpMs, 1.0);
+        printf("  band jump, VFO change -> relays settled: median %.1f ms, p90 %.1f ms, worst %.1f ms (%zu jumps)\n",
+               percentile(r.jumpMs, 0.5), percentile(r.jumpMs, 0.9), worst, r.jumpMs.size());
+        printf("  PTT release -> relays settled %.1f ms, link drop -> retuned %.1f ms\n", r.pttReleaseMs, r.reconnectMs);
+        failures += r.failures;
+        if (worst > limitMs) {
+            printf("  FAIL: worst band jump over the %.0f ms limit\n", limitMs);
+            failures++;
+        }
+    }
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+// sim-power: the post-tune power states (PowerPolicy) on a simulated clock,
+// and the relay state restored after a deep sleep.
+//
+//   program sim-power [--hours 24] [--idle-s 60] [--dormant-s 600] [--wake-s 0]
+//                     [--sleep light|deep] [--sessions 6] [--verbose]
+//
+// Checked, each with the policy stepped every 100 ms as loop() does:
+//   timeouts    ACTIVE -> TUNED-IDLE after idle-s, -> DORMANT dormant-s later
+//   activity    a request in TUNED-IDLE or DORMANT is ACTIVE at the next step
+//   holds       a relay job keeps ACTIVE; a rigctld link keeps the tuner out
+//               of DORMANT; an energised monostable relay forces light sleep
+//   restore     relays tuned, the latched positions saved as for a deep sleep
+//               and restored on a fresh controller: repeating the tune pulses
+//               no latching coil (without the restore every one is pulsed)
+// Then a day of operating (--sessions bursts of QSYs, each started by the
+// wake pin if the tuner is DORMANT) is run and the time and estimated
+// energy in each state reported against staying ACTIVE throughout.
+
+#include <stdio.h>
+#include <string.h>
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "PowerPolicy.h"
+#include "RelayController.h"
+#include "SimRelayHal.h"
+
+namespace {
+
+constexpr uint32_t STEP_MS = 100; // loop() cadence
+
+struct SimClock {
+    PowerPolicy& policy;
+    uint32_t     nowMs;
+    bool         verbose;
+
+    // Steps the policy until untilMs with hold; returns the last state
+    PowerState run(uint32_t untilMs, const PowerHold& hold = PowerHold())
+    {
+        PowerState state = policy.state();
+        while (nowMs < untilMs) {
+            nowMs += STEP_MS;
+            const PowerState next = policy.update(nowMs, hold);
+            if (next != state && verbose) {
+                printf("  %9.1f s  %s -> %s\n", nowMs * 1e-3, PowerPolicy::stateName(state), PowerPolicy::stateName(next));
+            }
+            state = next;
+        }
+        return state;
+    }
+};
+
+bool expect(bool ok, const char* what)
+{
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+bool checkTransitions(const PowerConfig& config, bool verbose)
+{
+    printf("timeouts, activity and holds:\n");
+    bool ok = true;
+    PowerPolicy policy(config, 0);
+    SimClock clock{policy, 0, verbose};
+    const uint32_t idle = config.idleAfterMs, dormant = config.dormantAfterMs;
+
+    ok &= expect(clock.run(idle - STEP_MS) == PowerState::Active, "ACTIVE until the idle timeout");
+    ok &= expect(clock.run(idle) == PowerState::TunedIdle, "TUNED-IDLE at the idle timeout");
+    ok &= expect(clock.run(idle + dormant - STEP_MS) == PowerState::TunedIdle, "TUNED-IDLE until the dormant timeout");
+    ok &= expect(clock.run(idle + dormant) == PowerState::Dormant, "DORMANT at the dormant timeout");
+    ok &= expect(policy.nextChangeMs(clock.nowMs) == 0, "DORMANT is left by a wake only");
+
+    policy.activity(clock.nowMs + 10);
+    ok &= expect(clock.run(clock.nowMs + STEP_MS) == PowerState::Active, "wake: ACTIVE at the next step");
+    clock.run(clock.nowMs + idle);
+    policy.activity(clock.nowMs + 10);
+    ok &= expect(clock.run(clock.nowMs + STEP_MS) == PowerState::Active, "request in TUNED-IDLE: ACTIVE at the next step");
+
+    PowerHold busy;
+    busy.busy = true;
+    ok &= expect(clock.run(clock.nowMs + 2 * idle, busy) == PowerState::Active, "relay job running: stays ACTIVE");
+    const uint32_t released = clock.nowMs;
+    ok &= expect(clock.run(released + idle - STEP_MS) == PowerState::Active, "idle timeout counts from the job's end");
+
+    PowerHold rigctld;
+    rigctld.networkNeeded = true;
+    ok &= expect(clock.run(clock.nowMs + idle + 2 * dormant, rigctld) == PowerState::TunedIdle,
+                 "rigctld link: TUNED-IDLE, never DORMANT");
+
+    PowerHold coil;
+    coil.lightSleepOnly = true;
+    PowerConfig deep = config;
+    deep.sleepMode = SleepMode::Deep;
+    policy.configure(deep);
+    ok &= expect(clock.run(clock.nowMs + dormant, coil) == PowerState::Dormant && policy.sleepMode() == SleepMode::Light,
+                 "monostable relay energised: light sleep, not deep");
+    policy.activity(clock.nowMs);
+    clock.run(clock.nowMs + idle + dormant + STEP_MS);
+    ok &= expect(policy.state() == PowerState::Dormant && policy.sleepMode() == SleepMode::Deep,
+                 "relays at rest: the configured deep sleep");
+
+    const PowerTotals& t = policy.totals();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size_t(PowerState::Count); i++) sum += t.ms[i];
+    ok &= expect(sum == clock.nowMs, "state times add up to the elapsed time");
+    return ok;
+}
+
+// Latching coil writes in the HAL log
+size_t latchingWrites(const SimRelayHal& hal)
+{
+    size_t n = 0;
+    for (const SimEvent& e : hal.events()) {
+        if (e.kind == SimEvent::Write && e.value != 0 && RelayController::profiles()[size_t(e.relay)].kind != RelayKind::Monostable) {
+            n++;
+        }
+    }
+    return n;
+}
+
+struct Bench {
+    SimRelayHal     hal;
+    RelayController relays;
+    GAPTuner        tuner;
+    Bench() : relays(hal), tuner(relays)
+    {
+        relays.initializePins();
+        tuner.applyDefaultState();
+    }
+    // Gap short plus some LC bank relays
+    bool tune()
+    {
+        char message[96];
+        if (!tuner.processButtonAction(int(GAPTuner::ButtonID::ANTENNA_SHORT), message, sizeof(message))) return false;
+        RelayTarget target;
+        RelayController::setTarget(target, RelayId::KML1, true);
+        RelayController::setTarget(target, RelayId::KML3, true);
+        RelayController::setTarget(target, RelayId::KMC2, true);
+        RelayController::setTarget(target, RelayId::LK99, true);
+        return relays.applyTarget(target);
+    }
+};
+
+bool checkRestore()
+{
+    printf("relay state through a deep sleep:\n");
+    Bench before;
+    if (!before.tune()) {
+        printf("  could not tune the simulated relays\n");
+        return false;
+    }
+    // What PowerManager keeps in RTC memory
+    const RelayTarget saved = before.relays.state();
+    const GapLength gap = before.tuner.gapLength();
+
+    Bench woken;
+    woken.tuner.restoreLatched(saved, gap);
+    bool ok = expect(woken.tuner.gapLength() == GapLength::Short && woken.relays.state(RelayId::K8) >= 0,
+                     "gap length and gap relays known after the wake");
+    woken.hal.clearEvents();
+    const uint64_t t0 = woken.hal.nowUs();
+    ok &= expect(woken.tune() && latchingWrites(woken.hal) == 0, "same tune after the restore: no latching pulse");
+    const uint64_t restoredEnd = woken.hal.settle();
+    const uint64_t restoredUs = restoredEnd > t0 ? restoredEnd - t0 : 0;
+
+    Bench cold;
+    cold.hal.clearEvents();
+    const uint64_t t1 = cold.hal.nowUs();
+    ok &= expect(cold.tune() && latchingWrites(cold.hal) > 0, "same tune without it: latching relays pulsed");
+    const uint64_t coldEnd = cold.hal.settle();
+    const uint64_t coldUs = coldEnd > t1 ? coldEnd - t1 : 0;
+    printf("  tune repeated after the wake: relays settled in %.1f ms with the restore, %.1f ms without\n",
+           restoredUs * 1e-3, coldUs * 1e-3);
+    return ok;
+}
+
+void report(const PowerPolicy& policy, uint32_t elapsedMs)
+{
+    const PowerTotals& t = policy.totals();
+    const PowerConfig& c = policy.config();
+    double total = 0.0;
+    printf("\n  %-11s %10s %7s %8s %11s %9s\n", "state", "time [s]", "share", "entries", "energy [J]", "avg [mW]");
+    for (size_t i = 0; i < size_t(PowerState::Count); i++) {
+        total += t.mj[i];
+        printf("  %-11s %10.1f %6.1f%% %8u %11.2f %9.2f\n", PowerPolicy::stateName(PowerState(i)), t.ms[i] * 1e-3,
+               100.0 * double(t.ms[i]) / elapsedMs, (unsigned)t.entries[i], t.mj[i] * 1e-3,
+               t.ms[i] != 0 ? t.mj[i] / double(t.ms[i]) * 1e3 : 0.0);
+    }
+    const double alwaysOn = double(elapsedMs) * c.activeMw * 1e-3;
+    printf("  %-11s %10.1f %7s %8s %11.2f %9.2f\n", "total", elapsedMs * 1e-3, "", "", total * 1e-3, total / elapsedMs * 1e3);
+    printf("  always ACTIVE would use %.2f J: %.1f%% saved\n", alwaysOn * 1e-3, 100.0 * (1.0 - total / alwaysOn));
+}
+
+// Sessions spread over the day, each a QSY every 20 s for 5 minutes; a
+// session that finds the tuner DORMANT starts with the wake pin
+void runDay(const PowerConfig& config, double hours, int sessions, bool verbose)
+{
+    printf("\n%.1f h, %d operating sessions, sleep %s, idle %u s, dormant %u s, wake %u s:\n", hours, sessions,
+           PowerPolicy::sleepModeName(config.sleepMode), (unsigned)(config.idleAfterMs / 1000),
+           (unsigned)(config.dormantAfterMs / 1000), (unsigned)(config.wakeEveryMs / 1000));
+    PowerPolicy policy(config, 0);
+    SimClock clock{policy, 0, verbose};
+    const uint32_t dayMs = uint32_t(hours * 3600e3);
+    const uint32_t spacingMs = sessions > 0 ? dayMs / uint32_t(sessions) : dayMs;
+    uint32_t wakes = 0;
+    uint32_t nextTimerMs = 0;
+    for (int s = 0; s < sessions; s++) {
+        const uint32_t startMs = uint32_t(s) * spacingMs;
+        for (uint32_t qsy = startMs; qsy < startMs + 300000 && qsy < dayMs; qsy += 20000) {
+            while (clock.nowMs < qsy) {
+                // Timer wakes while DORMANT
+                if (config.wakeEveryMs != 0 && policy.state() == PowerState::Dormant) {
+                    if (nextTimerMs == 0) nextTimerMs = clock.nowMs + config.wakeEveryMs;
+                    if (clock.nowMs >= nextTimerMs) {
+                        policy.activity(clock.nowMs);
+                        nextTimerMs = 0;
+                    }
+                }
+                clock.run(clock.nowMs + STEP_MS);
+            }
+            if (policy.state() == PowerState::Dormant) wakes++;
+            policy.activity(clock.nowMs);
+            PowerHold busy;
+            busy.busy = true;
+            clock.run(clock.nowMs + 200, busy); // the relay job
+        }
+    }
+    while (clock.nowMs < dayMs) {
+        clock.run(clock.nowMs + STEP_MS);
+    }
+    report(policy, clock.nowMs);
+    printf("  %u sessions began with a wake from DORMANT\n", (unsigned)wakes);
+}
+
+} // namespace
+
+int cmdSimPower(int argc, char** argv)
+{
+    PowerConfig config;
+    config.idleAfterMs = uint32_t(argNumber(argc, argv, "--idle-s", config.idleAfterMs / 1000) * 1000);
+    config.dormantAfterMs = uint32_t(argNumber(argc, argv, "--dormant-s", config.dormantAfterMs / 1000) * 1000);
+    config.wakeEveryMs = uint32_t(argNumber(argc, argv, "--wake-s", 0) * 1000);
+    config.sleepMode = strcmp(argString(argc, argv, "--sleep", "light"), "deep") == 0 ? SleepMode::Deep : SleepMode::Light;
+    const bool verbose = argFlag(argc, argv, "--verbose");
+    if (config.idleAfterMs < STEP_MS || config.dormantAfterMs < STEP_MS) {
+        fprintf(stderr, "--idle-s and --dormant-s must be at least 0.1\n");
+        return 1;
+    }
+
+    bool ok = checkTransitions(config, verbose);
+    ok &= checkRestore();
+    runDay(config, argNumber(argc, argv, "--hours", 24), int(argNumber(argc, argv, "--sessions", 6)), verbose);
+    printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
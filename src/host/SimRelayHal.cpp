@@ -0,0 +1,251 @@
+#include "SimRelayHal.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+enum class CoilKind : uint8_t { Mono, Set, Reset };
+
+struct CoilLine {
+    pin_t       pin;
+    RelayId    relay;
+    CoilKind    kind;
+};
+
+// GPIO wiring, as in RelayController.h
+static const CoilLine s_lines[] = {
+    {RELAY_K1, RelayId::K1, CoilKind::Mono}, {RELAY_K2, RelayId::K2, CoilKind::Mono},
+    {RELAY_K3, RelayId::K3, CoilKind::Mono}, {RELAY_K4, RelayId::K4, CoilKind::Mono},
+    {RELAY_K5, RelayId::K5, CoilKind::Mono}, {RELAY_K6, RelayId::K6, CoilKind::Mono},
+    {RELAY_K7, RelayId::K7, CoilKind::Mono},
+    {RELAY_LK99_SET, RelayId::LK99, CoilKind::Set}, {RELAY_LK99_RESET, RelayId::LK99, CoilKind::Reset},
+    {RELAY_KML1_SET, RelayId::KML1, CoilKind::Set}, {RELAY_KML1_RESET, RelayId::KML1, CoilKind::Reset},
+    {RELAY_KML2_SET, RelayId::KML2, CoilKind::Set}, {RELAY_KML2_RESET, RelayId::KML2, CoilKind::Reset},
+    {RELAY_KML3_SET, RelayId::KML3, CoilKind::Set}, {RELAY_KML3_RESET, RelayId::KML3, CoilKind::Reset},
+    {RELAY_KML4_SET, RelayId::KML4, CoilKind::Set}, {RELAY_KML4_RESET, RelayId::KML4, CoilKind::Reset},
+    {RELAY_KMC1_SET, RelayId::KMC1, CoilKind::Set}, {RELAY_KMC1_RESET, RelayId::KMC1, CoilKind::Reset},
+    {RELAY_KMC2_SET, RelayId::KMC2, CoilKind::Set}, {RELAY_KMC2_RESET, RelayId::KMC2, CoilKind::Reset},
+    {RELAY_KMC3_SET, RelayId::KMC3, CoilKind::Set}, {RELAY_KMC3_RESET, RelayId::KMC3, CoilKind::Reset},
+    {RELAY_KMC4_SET, RelayId::KMC4, CoilKind::Set}, {RELAY_KMC4_RESET, RelayId::KMC4, CoilKind::Reset},
+};
+
+static const CoilLine* findLine(uint8_t pin)
+{
+    for (const CoilLine& line : s_lines) {
+        if (line.pin == pin) return &line;
+    }
+    return nullptr;
+}
+
+SimRelayHal::SimRelayHal(const SimRelayTiming& timing) :
+    _timing(timing), _realTime(false), _nowUs(0), _seq(0), _lastContactUs(0), _faults(0)
+{
+    memset(_relays, 0, sizeof(_relays));
+}
+
+void SimRelayHal::pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)mode;
+    if (findLine(pin) == nullptr) {
+        fault(RelayId::Count, "pinMode on a pin with no relay");
+    }
+}
+
+void SimRelayHal::setDriveCapability(uint8_t pin, uint8_t level)
+{
+    (void)level;
+    if (findLine(pin) == nullptr) {
+        fault(RelayId::Count, "drive capability on a pin with no relay");
+    }
+}
+
+void SimRelayHal::digitalWrite(uint8_t pin, uint8_t value)
+{
+    const CoilLine* line = findLine(pin);
+    if (line == nullptr) {
+        fault(RelayId::Count, "write to a pin with no relay");
+        return;
+    }
+    const bool on = value != LOW;
+    const Relay& r = _relays[size_t(line->relay)];
+    const bool was = line->kind == CoilKind::Mono ? r.coil : line->kind == CoilKind::Set ? r.setCoil : r.resetCoil;
+    if (on == was) {
+        return;
+    }
+    log(SimEvent::Write, line->relay, on, RelayController::getRelayName(line->pin));
+    if (line->kind == CoilKind::Mono) {
+        monostableCoil(line->relay, on);
+    } else {
+        latchingCoil(line->relay, line->kind == CoilKind::Set, on);
+    }
+}
+
+void SimRelayHal::delayMs(uint32_t ms)
+{
+    if (_realTime) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+    advanceTo(_nowUs + uint64_t(ms) * 1000);
+}
+
+uint64_t SimRelayHal::settle()
+{
+    while (!_pending.empty()) {
+        uint64_t last = 0;
+        for (const Pending& p : _pending) {
+            if (p.timeUs > last) last = p.timeUs;
+        }
+        advanceTo(last > _nowUs ? last : _nowUs);
+    }
+    return _lastContactUs;
+}
+
+void SimRelayHal::advanceTo(uint64_t timeUs)
+{
+    for (;;) {
+        size_t next = _pending.size();
+        for (size_t i = 0; i < _pending.size(); i++) {
+            const Pending& p = _pending[i];
+            if (p.timeUs > timeUs) continue;
+            if (next == _pending.size() || p.timeUs < _pending[next].timeUs ||
+                (p.timeUs == _pending[next].timeUs && p.seq < _pending[next].seq)) {
+                next = i;
+            }
+        }
+        if (next == _pending.size()) break;
+        const Pending p = _pending[next];
+        _pending.erase(_pending.begin() + next);
+        if (p.timeUs > _nowUs) _nowUs = p.timeUs;
+        applyContact(p.relay, p.value);
+    }
+    _nowUs = timeUs;
+}
+
+void SimRelayHal::schedule(RelayId relay, uint64_t timeUs, bool value)
+{
+    _pending.push_back(Pending{timeUs, _seq++, relay, value});
+}
+
+void SimRelayHal::cancel(RelayId relay)
+{
+    for (size_t i = 0; i < _pending.size();) {
+        if (_pending[i].relay == relay) {
+            _pending.erase(_pending.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void SimRelayHal::monostableCoil(RelayId relay, bool on)
+{
+    Relay& r = _relays[size_t(relay)];
+    r.coil = on;
+    r.coilSinceUs = _nowUs;
+    cancel(relay);
+    if (on && !r.contact) {
+        schedule(relay, _nowUs + _timing.operateUs, true);
+    } else if (!on && r.contact) {
+        schedule(relay, _nowUs + _timing.releaseUs, false);
+    } else if (!on) {
+        fault(relay, "coil released before the contact was made");
+    }
+}
+
+void SimRelayHal::latchingCoil(RelayId relay, bool set, bool on)
+{
+    Relay& r = _relays[size_t(relay)];
+    bool& coil = set ? r.setCoil : r.resetCoil;
+    coil = on;
+    if (on) {
+        if (r.setCoil && r.resetCoil) {
+            fault(relay, "SET and RESET coils energised together");
+        }
+        r.coilSinceUs = _nowUs;
+        cancel(relay);
+        schedule(relay, _nowUs + _timing.latchOperateUs, set);
+        return;
+    }
+    if (_nowUs - r.coilSinceUs < _timing.latchOperateUs) {
+        cancel(relay);
+        fault(relay, "latching pulse too short to transfer");
+    } else if (_nowUs - r.coilSinceUs < _timing.latchPulseUs) {
+        fault(relay, "latching pulse below the rated minimum");
+    }
+}
+
+// K8/K9 coils, in series with the K5 and K6 contacts, polarity from K7
+void SimRelayHal::gapDrive()
+{
+    const bool on = _relays[size_t(RelayId::K5)].contact && _relays[size_t(RelayId::K6)].contact;
+    const Relay& k7 = _relays[size_t(RelayId::K7)];
+    for (RelayId gap : {RelayId::K8, RelayId::K9}) {
+        Relay& r = _relays[size_t(gap)];
+        if (r.coil == on) continue;
+        r.coil = on;
+        if (on) {
+            if (_nowUs - k7.contactSinceUs < _timing.polarityGuardUs && k7.contactSinceUs != 0) {
+                fault(gap, "gap coil energised while K7 was still settling");
+            }
+            r.coilSinceUs = _nowUs;
+            cancel(gap);
+            schedule(gap, _nowUs + _timing.latchOperateUs, k7.contact);
+            continue;
+        }
+        r.pulseEndUs = _nowUs;
+        if (_nowUs - r.coilSinceUs < _timing.latchOperateUs) {
+            cancel(gap);
+            fault(gap, "gap pulse too short to transfer");
+        } else if (_nowUs - r.coilSinceUs < _timing.latchPulseUs) {
+            fault(gap, "gap pulse below the rated minimum");
+        }
+    }
+}
+
+void SimRelayHal::applyContact(RelayId relay, bool value)
+{
+    Relay& r = _relays[size_t(relay)];
+    if (relay == RelayId::K8 || relay == RelayId::K9) {
+        // The armature moves with whatever polarity K7 applies right now
+        value = _relays[size_t(RelayId::K7)].contact;
+    }
+    if (r.contact == value) {
+        return;
+    }
+    r.contact = value;
+    r.contactSinceUs = _nowUs;
+    _lastContactUs = _nowUs;
+    log(SimEvent::Contact, relay, value, nullptr);
+
+    if (relay == RelayId::K5 || relay == RelayId::K6) {
+        gapDrive();
+    } else if (relay == RelayId::K7) {
+        for (RelayId gap : {RelayId::K8, RelayId::K9}) {
+            const Relay& g = _relays[size_t(gap)];
+            if (g.coil) {
+                fault(gap, "K7 changed polarity while the gap coil was energised");
+            } else if (g.pulseEndUs != 0 && _nowUs - g.pulseEndUs < _timing.polarityGuardUs) {
+                fault(gap, "K7 changed polarity as the gap coil was released");
+            }
+        }
+    }
+}
+
+void SimRelayHal::log(SimEvent::Kind kind, RelayId relay, uint8_t value, const char* detail)
+{
+    _events.push_back(SimEvent{_nowUs, kind, relay, value, detail});
+}
+
+void SimRelayHal::fault(RelayId relay, const char* detail)
+{
+    _faults++;
+    log(SimEvent::Fault, relay, 0, detail);
+}
+
+const char* SimRelayHal::relayName(RelayId relay)
+{
+    static const char* const names[] = {
+        "K1", "K2", "K3", "K4", "K5", "K6", "K7", "K8", "K9", "LK99",
+        "KML1", "KML2", "KML3", "KML4", "KMC1", "KMC2", "KMC3", "KMC4"
+    };
+    return relay < RelayId::Count ? names[size_t(relay)] : "-";
+}
@@ -0,0 +1,111 @@
+#ifndef SIM_RELAY_HAL_H
+#define SIM_RELAY_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "RelayController.h" // For RelayId
+#include "RelayHal.h"
+
+// Simulated relay hardware behind RelayHal for the host build.
+//
+// Time is virtual: delayMs() advances the clock, everything else takes no
+// time. With setRealTime(true) delayMs() also sleeps the calling thread, for
+// exercising code that runs the sequences on another thread. Each relay has
+// a coil and a contact that follows the coil after the timings below:
+//   K1..K7     monostable, contact made operateUs after the coil is energised
+//              and released releaseUs after it is de-energised
+//   LK99, KMx  latching, separate SET/RESET coils; the contact transfers
+//              latchOperateUs into a pulse and pulses shorter than
+//              latchPulseUs are reported as faults
+//   K8, K9     gap relays, bipolar latching. Their coils only see the drive
+//              while both the K5 and the K6 contact are closed, with the
+//              polarity set by the K7 contact; K7 closed latches them closed
+//              (GapLength::Long).
+// Anything the hardware would not tolerate (both coils of a latching relay
+// energised, a too-short pulse, K7 moving while a gap coil is energised or
+// within polarityGuardUs of it) is logged as a fault.
+
+struct SimRelayTiming {
+    uint32_t operateUs       = 6000;  // signal relay pull-in
+    uint32_t releaseUs       = 3000;  // signal relay drop-out
+    uint32_t latchOperateUs  = 4000;  // latching relay transfer time
+    uint32_t latchPulseUs    = 10000; // rated minimum latching pulse
+    uint32_t polarityGuardUs = 1000;  // K7 settled before and after a gap pulse
+};
+
+struct SimEvent {
+    enum Kind : uint8_t { Write, Contact, Fault };
+    uint64_t    timeUs;
+    Kind        kind;
+    RelayId    relay;
+    uint8_t     value;  // Write: pin level, Contact: closed / SET
+    const char* detail; // Write: coil name, Fault: description
+};
+
+class SimRelayHal : public RelayHal {
+public:
+    explicit SimRelayHal(const SimRelayTiming& timing = SimRelayTiming());
+
+    void pinMode(uint8_t pin, uint8_t mode) override;
+    void digitalWrite(uint8_t pin, uint8_t value) override;
+    void setDriveCapability(uint8_t pin, uint8_t level) override;
+    void delayMs(uint32_t ms) override;
+    uint32_t micros() override { return uint32_t(_nowUs); }
+
+    void setRealTime(bool on) { _realTime = on; }
+    uint64_t nowUs() const { return _nowUs; }
+    // Runs the clock until no contact is still moving; returns the time of
+    // the last contact change so far (0 if none)
+    uint64_t settle();
+
+    // true: contact closed (latching relays: SET)
+    bool contact(RelayId relay) const { return _relays[size_t(relay)].contact; }
+    const std::vector<SimEvent>& events() const { return _events; }
+    size_t faults() const { return _faults; }
+    uint64_t lastContactUs() const { return _lastContactUs; }
+    void clearEvents() { _events.clear(); _faults = 0; }
+    // Room for n events, so that logging does not allocate until then
+    void reserveEvents(size_t n) { _events.reserve(n); }
+
+    static const char* relayName(RelayId relay);
+
+private:
+    struct Relay {
+        bool     contact;
+        bool     coil;       // monostable coil, or the gap coil fed by K5/K6
+        bool     setCoil;    // latching coils
+        bool     resetCoil;
+        uint64_t coilSinceUs;
+        uint64_t contactSinceUs;
+        uint64_t pulseEndUs; // gap relays: end of the last coil pulse
+    };
+    struct Pending {
+        uint64_t timeUs;
+        uint64_t seq; // keeps events at the same time in scheduling order
+        RelayId relay;
+        bool     value;
+    };
+
+    void advanceTo(uint64_t timeUs);
+    void schedule(RelayId relay, uint64_t timeUs, bool value);
+    void cancel(RelayId relay);
+    void applyContact(RelayId relay, bool value);
+    void monostableCoil(RelayId relay, bool on);
+    void latchingCoil(RelayId relay, bool set, bool on);
+    void gapDrive();
+    void log(SimEvent::Kind kind, RelayId relay, uint8_t value, const char* detail);
+    void fault(RelayId relay, const char* detail);
+
+    SimRelayTiming        _timing;
+    bool                  _realTime;
+    uint64_t              _nowUs;
+    uint64_t              _seq;
+    uint64_t              _lastContactUs;
+    size_t                _faults;
+    Relay                 _relays[size_t(RelayId::Count)];
+    std::vector<Pending>  _pending;
+    std::vector<SimEvent> _events;
+};
+
+#endif // SIM_RELAY_HAL_H
@@ -0,0 +1,342 @@
+// sim-relays: runs the firmware relay sequences (GAPTuner and RelayController,
+// built unchanged for the host) against SimRelayHal and reports the QSY time
+// of each: from the start of the request until the last contact has settled.
+//
+//   program sim-relays [--limit-ms 120] [--strict] [--log] [--plans] [--verbose]
+//                      [--operate-ms 6] [--release-ms 3] [--latch-ms 10]
+//                      [--budget-ma 400] [--sweep docs/Longz]
+//
+// --plans prints the relay plan (RelayScheduler) of each sequence, and
+// --budget-ma overrides the coil current budget it is planned for.
+//
+// Every ButtonID is run from every ButtonID (64 sequences) and a band-plan
+// QSY is run between every pair of entries of a small built-in tune table.
+// Then, with no table but --sweep stored in the sweeps partition, QSYs across
+// the HF bands are solved by GAPTuner itself; the relays must match what
+// MatchSolver finds for the nominal TunerDesign, and the solve time (host
+// CPU) is reported.
+// Fails if a sequence ends in the wrong relay state, RelayController's shadow
+// register disagrees with the simulated contacts or a sequence takes longer
+// than --limit-ms; with --strict, relay timing faults fail it too. "saved"
+// counts the actuations skipped because the relay was already in position.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "MemoryFlash.h"
+#include "RelayController.h"
+#include "SimRelayHal.h"
+
+struct SimBench {
+    SimRelayHal     hal;
+    RelayController relays;
+    GAPTuner        tuner;
+
+    SimBench(const SimRelayTiming& timing, uint16_t budgetMa) : hal(timing), relays(hal), tuner(relays) {
+        relays.scheduler().setBudget(budgetMa);
+        relays.initializePins();
+        tuner.applyDefaultState();
+        hal.settle();
+    }
+};
+
+struct SequenceResult {
+    uint64_t callUs;   // time spent inside the firmware call
+    uint64_t settleUs; // until the last contact change
+    size_t   faults;
+    size_t   saved;    // actuations skipped by the shadow register
+};
+
+static const char* buttonName(int id)
+{
+    static const char* const names[] = {
+        "ANTENNA_SHORT", "ANTENNA_LONG", "TUNING_NONE", "TUNING_1",
+        "TUNING_2", "CAL_OPEN", "CAL_SHORT", "CAL_LOAD"
+    };
+    return id >= 1 && id <= GAPTuner::NUM_ACTIONS ? names[id - 1] : "?";
+}
+
+static void printEvents(const SimRelayHal& hal, uint64_t t0)
+{
+    for (const SimEvent& e : hal.events()) {
+        const double ms = double(e.timeUs - t0) * 1e-3;
+        switch (e.kind) {
+        case SimEvent::Write:
+            printf("    %8.3f ms  write   %-18s %s\n", ms, e.detail, e.value ? "HIGH" : "LOW");
+            break;
+        case SimEvent::Contact:
+            printf("    %8.3f ms  contact %-18s %s\n", ms, SimRelayHal::relayName(e.relay),
+                   e.value ? "closed/set" : "open/reset");
+            break;
+        case SimEvent::Fault:
+            printf("    %8.3f ms  FAULT   %-18s %s\n", ms, SimRelayHal::relayName(e.relay), e.detail);
+            break;
+        }
+    }
+}
+
+template<typename Fn>
+static SequenceResult runSequence(SimBench& bench, bool log, Fn&& fn)
+{
+    bench.hal.clearEvents();
+    const uint64_t t0 = bench.hal.nowUs();
+    fn();
+    SequenceResult r;
+    r.callUs = bench.hal.nowUs() - t0;
+    const uint64_t last = bench.hal.settle();
+    r.settleUs = last > t0 && last - t0 > r.callUs ? last - t0 : r.callUs;
+    r.faults = bench.hal.faults();
+    r.saved = bench.relays.lastSaved();
+    if (log) printEvents(bench.hal, t0);
+    return r;
+}
+
+static void printPlan(const SimBench& bench, const char* name)
+{
+    char details[1024];
+    bench.tuner.describeLastAction(details, sizeof(details));
+    printf("  plan for %s:\n%s\n", name, details);
+}
+
+// Relay state a button must leave behind, given the state before it
+static bool checkButton(const SimRelayHal& hal, int id, bool gapBefore, bool lk99Before, const char** why)
+{
+    const bool k8 = hal.contact(RelayId::K8), k9 = hal.contact(RelayId::K9);
+    const bool lk99 = hal.contact(RelayId::LK99);
+    bool gapWant = gapBefore, lk99Want = lk99Before;
+    if (id == int(GAPTuner::ButtonID::ANTENNA_SHORT)) gapWant = false;
+    if (id == int(GAPTuner::ButtonID::ANTENNA_LONG)) gapWant = true;
+    if (id == int(GAPTuner::ButtonID::TUNING_1)) lk99Want = true;
+    if (id == int(GAPTuner::ButtonID::TUNING_2)) lk99Want = false;
+    if (k8 != k9) { *why = "gap relays K8/K9 disagree"; return false; }
+    if (k8 != gapWant) { *why = "gap relays in the wrong state"; return false; }
+    if (lk99 != lk99Want) { *why = "LK99 in the wrong state"; return false; }
+    if (hal.contact(RelayId::K5) || hal.contact(RelayId::K6) || hal.contact(RelayId::K7)) {
+        *why = "gap drive relays K5/K6/K7 left energised";
+        return false;
+    }
+    return true;
+}
+
+static bool checkTuneState(const SimRelayHal& hal, const TuneState& s, const char** why)
+{
+    static const RelayId l[] = {RelayId::KML1, RelayId::KML2, RelayId::KML3, RelayId::KML4};
+    static const RelayId c[] = {RelayId::KMC1, RelayId::KMC2, RelayId::KMC3, RelayId::KMC4};
+    for (size_t i = 0; i < TunerDesign::L_BITS; i++) {
+        if (hal.contact(l[i]) != bool(s.lMask & (1u << i))) { *why = "inductor bank relay"; return false; }
+    }
+    for (size_t i = 0; i < TunerDesign::C_BITS; i++) {
+        if (hal.contact(c[i]) != bool(s.cMask & (1u << i))) { *why = "capacitor bank relay"; return false; }
+    }
+    if (hal.contact(RelayId::LK99) != (s.topology == Topology::CL)) { *why = "KM1 topology relay"; return false; }
+    return true;
+}
+
+// The shadow register in RelayController must agree with the contacts
+// wherever it claims to know the state
+static bool checkShadow(const SimBench& bench, const char** why)
+{
+    for (size_t r = 0; r < size_t(RelayId::Count); r++) {
+        const int8_t known = bench.relays.state(RelayId(r));
+        if (known >= 0 && bool(known) != bench.hal.contact(RelayId(r))) {
+            *why = "shadow register disagrees with the relays";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Small table covering both topologies, all-set / all-reset bank states and
+// a band hop that changes a single bank bit (5.5 <-> 8.5 MHz)
+static std::vector<uint32_t> buildTable(std::vector<TuneTableEntry>& entries)
+{
+    const TuneState states[] = {
+        {0x0, 0x0, Topology::LC}, {0xF, 0xF, Topology::CL}, {0x5, 0xA, Topology::LC},
+        {0xA, 0x5, Topology::CL}, {0x3, 0xC, Topology::CL}, {0x5, 0xB, Topology::LC}
+    };
+    entries.clear();
+    for (size_t i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+        entries.push_back(TuneTableEntry::make(3500000 + uint32_t(i) * 1000000, states[i], 1.5f));
+    }
+    std::vector<uint32_t> words((sizeof(TuneTableHeader) + 2 * entries.size() * sizeof(TuneTableEntry)) / 4);
+    TuneTableHeader* h = reinterpret_cast<TuneTableHeader*>(words.data());
+    h->magic = TUNE_TABLE_MAGIC;
+    h->version = TUNE_TABLE_VERSION;
+    h->headerSize = sizeof(TuneTableHeader);
+    h->lBits = TunerDesign::L_BITS;
+    h->cBits = TunerDesign::C_BITS;
+    h->stepHz = 100000;
+    uint8_t* p = reinterpret_cast<uint8_t*>(words.data()) + sizeof(TuneTableHeader);
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        h->offset[g] = uint32_t(sizeof(TuneTableHeader) + g * entries.size() * sizeof(TuneTableEntry));
+        h->count[g] = uint32_t(entries.size());
+        memcpy(p + g * entries.size() * sizeof(TuneTableEntry), entries.data(), entries.size() * sizeof(TuneTableEntry));
+    }
+    return words;
+}
+
+// The sweep file parsed into the Long slot of an in-memory sweeps partition
+static bool storeSweep(const char* path, MemoryFlash& flash, SweepStoreView& view)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+    fclose(f);
+    static SweepSlotWriter writer;
+    flash.base = uint32_t(GapLength::Long) * SWEEP_SLOT_SIZE;
+    return writer.begin(&flash) && writer.write(text.data(), text.size()) && writer.finish() &&
+           view.attach(flash.bytes.data(), flash.bytes.size());
+}
+
+int cmdSimRelays(int argc, char** argv)
+{
+    SimRelayTiming timing;
+    timing.operateUs = uint32_t(argNumber(argc, argv, "--operate-ms", timing.operateUs * 1e-3) * 1000);
+    timing.releaseUs = uint32_t(argNumber(argc, argv, "--release-ms", timing.releaseUs * 1e-3) * 1000);
+    timing.latchPulseUs = uint32_t(argNumber(argc, argv, "--latch-ms", timing.latchPulseUs * 1e-3) * 1000);
+    const double limitMs = argNumber(argc, argv, "--limit-ms", 120);
+    const bool strict = argFlag(argc, argv, "--strict");
+    const bool log = argFlag(argc, argv, "--log");
+    const bool plans = argFlag(argc, argv, "--plans");
+    const uint16_t budgetMa = uint16_t(argNumber(argc, argv, "--budget-ma", RELAY_COIL_BUDGET_MA));
+    Serial.enabled = argFlag(argc, argv, "--verbose");
+
+    size_t failures = 0, faults = 0, saved = 0;
+    double worstMs = 0.0;
+
+    printf("ButtonID sequences (each from every ButtonID), QSY time in ms:\n");
+    printf("%-14s %8s %8s %8s %7s %7s\n", "to", "call", "min", "max", "faults", "saved");
+    for (int to = 1; to <= GAPTuner::NUM_ACTIONS; to++) {
+        SequenceResult worst = {0, 0, 0, 0};
+        uint64_t best = UINT64_MAX;
+        size_t toFaults = 0, toSaved = 0;
+        for (int from = 1; from <= GAPTuner::NUM_ACTIONS; from++) {
+            SimBench bench(timing, budgetMa);
+            char message[96];
+            bench.tuner.processButtonAction(from, message, sizeof(message));
+            bench.hal.settle();
+            const bool gapBefore = bench.hal.contact(RelayId::K8);
+            const bool lk99Before = bench.hal.contact(RelayId::LK99);
+            if (log) printf("  %s -> %s\n", buttonName(from), buttonName(to));
+            const SequenceResult r = runSequence(bench, log, [&] { bench.tuner.processButtonAction(to, message, sizeof(message)); });
+            if (plans && from == 1) printPlan(bench, buttonName(to));
+            const char* why = nullptr;
+            if (!checkButton(bench.hal, to, gapBefore, lk99Before, &why) || !checkShadow(bench, &why)) {
+                printf("FAIL %s -> %s: %s\n", buttonName(from), buttonName(to), why);
+                failures++;
+            }
+            if (r.settleUs > worst.settleUs) worst = r;
+            if (r.settleUs < best) best = r.settleUs;
+            toFaults += r.faults;
+            toSaved += r.saved;
+        }
+        printf("%-14s %8.1f %8.1f %8.1f %7zu %7zu\n", buttonName(to), worst.callUs * 1e-3, best * 1e-3,
+               worst.settleUs * 1e-3, toFaults, toSaved);
+        if (worst.settleUs * 1e-3 > worstMs) worstMs = worst.settleUs * 1e-3;
+        faults += toFaults;
+        saved += toSaved;
+    }
+
+    std::vector<TuneTableEntry> entries;
+    const std::vector<uint32_t> table = buildTable(entries);
+    TuneTableView view;
+    view.attach(reinterpret_cast<const uint8_t*>(table.data()), table.size() * 4);
+    printf("\ntune table QSYs (%zu x %zu entries), QSY time in ms:\n", entries.size(), entries.size());
+    printf("%-14s %8s %8s %8s %7s %7s\n", "to", "call", "min", "max", "faults", "saved");
+    for (const TuneTableEntry& to : entries) {
+        SequenceResult worst = {0, 0, 0, 0};
+        uint64_t best = UINT64_MAX;
+        size_t toFaults = 0, toSaved = 0;
+        for (const TuneTableEntry& from : entries) {
+            SimBench bench(timing, budgetMa);
+            bench.tuner.attachTuneTable(&view);
+            char message[96];
+            bench.tuner.tuneToFrequency(from.freqHz, message, sizeof(message));
+            bench.hal.settle();
+            if (log) printf("  %u Hz -> %u Hz\n", from.freqHz, to.freqHz);
+            const SequenceResult r = runSequence(bench, log, [&] { bench.tuner.tuneToFrequency(to.freqHz, message, sizeof(message)); });
+            if (plans && &from == &entries[0]) {
+                char name[24];
+                snprintf(name, sizeof(name), "%u Hz", to.freqHz);
+                printPlan(bench, name);
+            }
+            const char* why = nullptr;
+            if (!checkTuneState(bench.hal, to.state(), &why) || !checkShadow(bench, &why)) {
+                printf("FAIL %u Hz -> %u Hz: %s\n", from.freqHz, to.freqHz, why);
+                failures++;
+            }
+            if (r.settleUs > worst.settleUs) worst = r;
+            if (r.settleUs < best) best = r.settleUs;
+            toFaults += r.faults;
+            toSaved += r.saved;
+        }
+        printf("%-11.3f MHz %8.1f %8.1f %8.1f %7zu %7zu\n", to.freqHz * 1e-6, worst.callUs * 1e-3, best * 1e-3,
+               worst.settleUs * 1e-3, toFaults, toSaved);
+        if (worst.settleUs * 1e-3 > worstMs) worstMs = worst.settleUs * 1e-3;
+        faults += toFaults;
+        saved += toSaved;
+    }
+
+    // No table: GAPTuner solves each QSY from the stored sweep
+    static MemoryFlash flash(SWEEP_SLOT_SIZE * NUM_GAP_LENGTHS);
+    SweepStoreView sweeps;
+    if (!storeSweep(argString(argc, argv, "--sweep", "docs/Longz"), flash, sweeps)) {
+        return 1;
+    }
+    const TunerModel model = TunerDesign::model();
+    MatchSolver reference(model);
+    const uint32_t qsys[] = {1840000, 3573000, 5357000, 7074000, 10136000, 14074000, 18100000, 21074000,
+                             24915000, 28074000};
+    printf("\nsolved QSYs without a tune table (from the previous one), QSY time in ms:\n");
+    printf("%-14s %8s %8s %8s %7s %7s\n", "to", "call", "solve us", "settle", "faults", "saved");
+    uint32_t worstSolveUs = 0;
+    SimBench solving(timing, budgetMa);
+    solving.tuner.attachSolverData(&sweeps, nullptr);
+    for (uint32_t freqHz : qsys) {
+        char message[96];
+        bool tuned = false;
+        const SequenceResult r = runSequence(solving, log, [&] { tuned = solving.tuner.tuneToFrequency(freqHz, message, sizeof(message)); });
+        MatchResult expected;
+        const char* why = nullptr;
+        if (!reference.solve(sweeps.sweep(GapLength::Long), float(freqHz), expected)) {
+            why = "outside the sweep";
+        } else if (!tuned) {
+            why = message;
+        } else {
+            checkTuneState(solving.hal, expected.state, &why);
+            if (why == nullptr) checkShadow(solving, &why);
+        }
+        if (why != nullptr) {
+            printf("FAIL %u Hz: %s\n", freqHz, why);
+            failures++;
+        }
+        printf("%-11.3f MHz %8.1f %8u %8.1f %7zu %7zu\n", freqHz * 1e-6, r.callUs * 1e-3,
+               (unsigned)solving.tuner.lastSolveUs(), r.settleUs * 1e-3, r.faults, r.saved);
+        if (r.settleUs * 1e-3 > worstMs) worstMs = r.settleUs * 1e-3;
+        if (solving.tuner.lastSolveUs() > worstSolveUs) worstSolveUs = solving.tuner.lastSolveUs();
+        faults += r.faults;
+        saved += r.saved;
+    }
+    printf("worst solve %u us on this host (%zu combinations)\n", (unsigned)worstSolveUs,
+           2 * model.numInductorStates() * model.numCapacitorStates());
+
+    printf("\nworst QSY %.1f ms (limit %.0f ms), %zu wrong end states, %zu timing faults%s, %zu actuations saved\n",
+           worstMs, limitMs, failures, faults, faults && !log ? " (--log shows them)" : "", saved);
+    if (worstMs > limitMs) {
+        printf("FAIL: QSY time over the limit\n");
+        failures++;
+    }
+    if (strict && faults > 0) {
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// soak-api: /api/v1 and /job answered by ApiV1 as WebServerManager calls it,
+// for a long run of mixed requests, counting heap allocations.
+//
+//   program soak-api [--requests 100000] [--print]
+//
+// The mix: state, wifi, job (known and unknown ids), button and tune jobs
+// that run on the RelayExecutor over simulated relays (tune table in
+// memory), bad and missing parameters and unknown endpoints. Every reply
+// must be one complete JSON object with the expected status. After a
+// warm-up, the requests must not allocate at all and the whole process (the
+// relay jobs included) must end with no net heap movement. --print shows
+// one reply of each kind.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "AllocCounter.h"
+#include "ApiV1.h"
+#include "GAPTuner.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "RelayController.h"
+#include "RelayExecutor.h"
+#include "SimRelayHal.h"
+#include "TuneTable.h"
+#include "TunerDesign.h"
+#include "TunerState.h"
+
+namespace {
+
+// Query parameters of one request, as AsyncWebServerRequest::getParam gives them
+struct Query {
+    const char* name[2];
+    const char* value[2];
+
+    static const char* lookup(void* context, const char* name)
+    {
+        const Query* q = static_cast<const Query*>(context);
+        for (size_t i = 0; i < 2; i++) {
+            if (q->name[i] != nullptr && strcmp(q->name[i], name) == 0) return q->value[i];
+        }
+        return nullptr;
+    }
+};
+
+struct Request {
+    const char* kind;
+    const char* path;
+    const char* param;
+    const char* value;
+    int         status;  // expected; 0: 202 or 503 (queue full), -1: 200 or 404
+};
+
+// Small band-plan table from 1.8 to 30 MHz, enough for tune jobs
+std::vector<uint32_t> buildTable()
+{
+    const uint32_t start = 1800000, step = 100000, count = 283;
+    std::vector<uint32_t> words((sizeof(TuneTableHeader) + NUM_GAP_LENGTHS * count * sizeof(TuneTableEntry)) / 4);
+    TuneTableHeader* h = reinterpret_cast<TuneTableHeader*>(words.data());
+    h->magic = TUNE_TABLE_MAGIC;
+    h->version = TUNE_TABLE_VERSION;
+    h->headerSize = sizeof(TuneTableHeader);
+    h->lBits = TunerDesign::L_BITS;
+    h->cBits = TunerDesign::C_BITS;
+    h->stepHz = step;
+    TuneTableEntry* e = reinterpret_cast<TuneTableEntry*>(reinterpret_cast<uint8_t*>(words.data()) + sizeof(TuneTableHeader));
+    for (size_t g = 0; g < NUM_GAP_LENGTHS; g++) {
+        h->offset[g] = uint32_t(sizeof(TuneTableHeader) + g * count * sizeof(TuneTableEntry));
+        h->count[g] = count;
+        for (uint32_t i = 0; i < count; i++) {
+            *e++ = TuneTableEntry::make(start + i * step, TuneState{uint16_t(i & 0xF), uint16_t(i >> 4 & 0xF),
+                                                                    (i & 1) ? Topology::CL : Topology::LC}, 1.2f);
+        }
+    }
+    return words;
+}
+
+// One object, nothing after it, and as long as reported
+bool wellFormed(const char* json, size_t length)
+{
+    return length > 1 && strlen(json) == length && json[0] == '{' && json[length - 1] == '}';
+}
+
+} // namespace
+
+int cmdSoakApi(int argc, char** argv)
+{
+    const size_t requests = size_t(argNumber(argc, argv, "--requests", 100000));
+    const bool print = argFlag(argc, argv, "--print");
+
+    SimRelayHal hal;
+    hal.reserveEvents(1 << 17);
+    RelayController relays(hal);
+    GAPTuner tuner(relays);
+    TunerState state;
+    relays.initializePins();
+    tuner.applyDefaultState();
+    state.relaysChanged(tuner);
+    state.linkChanged(true, -61);
+    const std::vector<uint32_t> table = buildTable();
+    TuneTableView view;
+    view.attach(reinterpret_cast<const uint8_t*>(table.data()), table.size() * 4);
+    tuner.attachTuneTable(&view);
+    RelayExecutor executor(tuner);
+    executor.attachState(&state);
+    executor.begin();
+    ApiV1 api(tuner, executor, state);
+
+    char button[4], freq[12], job[12];
+    const Request mix[] = {
+        {"state",          "/api/v1/state",  nullptr, nullptr, 200},
+        {"wifi",           "/api/v1/wifi",   nullptr, nullptr, 200},
+        {"button",         "/api/v1/button", "id",    button,  0},
+        {"job",            "/api/v1/job",    "id",    job,     200},
+        {"tune",           "/api/v1/tune",   "freq",  freq,    0},
+        {"state",          "state",          nullptr, nullptr, 200},
+        {"bad button",     "/api/v1/button", "id",    "9",     400},
+        {"missing freq",   "/api/v1/tune",   nullptr, nullptr, 400},
+        {"bad freq",       "/api/v1/tune",   "freq",  "7.1e6", 400},
+        {"unknown job",    "/api/v1/job",    "id",    "0",     404},
+        {"unknown",        "/api/v1/reboot", nullptr, nullptr, 404},
+    };
+    const size_t kinds = sizeof(mix) / sizeof(mix[0]);
+    const size_t window = 1000, warmup = 10 * window;
+
+    char reply[ApiV1::REPLY_SIZE];
+    size_t failures = 0, accepted = 0, queueFull = 0, maxLength = 0;
+    uint32_t lastJob = 0, previousJob = 0;
+    std::vector<bool> printed(kinds, false);
+    AllocStats thread0 = {}, process0 = {};
+    double requestUs = 0.0;
+    for (size_t n = 0; n < warmup + requests; n++) {
+        if (n % window == 0) {
+            // The simulated relays log every coil write: empty the log when
+            // the jobs are done, so that it stays within its reserve
+            while (!executor.idle()) std::this_thread::yield();
+            hal.clearEvents();
+        }
+        if (n == warmup) {
+            thread0 = threadAllocs();
+            process0 = processAllocs();
+        }
+        const Request& r = mix[n % kinds];
+        snprintf(button, sizeof(button), "%u", unsigned(1 + (n / kinds) % GAPTuner::NUM_ACTIONS));
+        snprintf(freq, sizeof(freq), "%u", unsigned(1800000 + (n * 7919) % 28200000));
+        snprintf(job, sizeof(job), "%u", unsigned(lastJob));
+        Query query = {{r.param, nullptr}, {r.value, nullptr}};
+
+        size_t length = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        const int status = api.handle(r.path, &Query::lookup, &query, reply, sizeof(reply), length);
+        if (n >= warmup) {
+            requestUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        }
+
+        // The job of the button request just before is known; an older one
+        // may be overwritten, as a refused request takes an id too
+        const int expected = strcmp(r.kind, "job") == 0 && previousJob == 0 ? -1 : r.status;
+        previousJob = 0;
+        const bool statusOk = expected == 0    ? status == 202 || status == 503
+                            : expected == -1 ? status == 200 || status == 404
+                                             : status == expected;
+        if (status == 202) {
+            accepted++;
+            lastJob = previousJob = uint32_t(strtoul(strchr(reply, ':') + 1, nullptr, 10));
+        }
+        queueFull += status == 503;
+        maxLength = length > maxLength ? length : maxLength;
+        if (!statusOk || !wellFormed(reply, length)) {
+            if (failures++ < 5) {
+                printf("  FAIL: %s %s -> %d (expected %d): %s\n", r.kind, r.path, status, expected, reply);
+            }
+        }
+        if (print && !printed[n % kinds]) {
+            printed[n % kinds] = true;
+            printf("  %-13s %d %s\n", r.kind, status, reply);
+        }
+    }
+    while (!executor.idle()) std::this_thread::yield();
+    hal.clearEvents();
+    const AllocStats onThread = allocsSince(thread0, threadAllocs());
+    const AllocStats inProcess = allocsSince(process0, processAllocs());
+    executor.end();
+
+    printf("%zu requests, %.2f us each; %zu jobs accepted, %zu refused with the queue full; largest reply %zu bytes\n",
+           requests, requestUs / double(requests), accepted, queueFull, maxLength);
+    printf("request thread: %llu allocations, %llu frees, %lld bytes net\n", (unsigned long long)onThread.allocations,
+           (unsigned long long)onThread.frees, (long long)onThread.bytes);
+    printf("whole process:  %llu allocations, %llu frees, %lld bytes net\n", (unsigned long long)inProcess.allocations,
+           (unsigned long long)inProcess.frees, (long long)inProcess.bytes);
+    const bool ok = failures == 0 && accepted > 0 && onThread.allocations == 0 && onThread.frees == 0 &&
+                    inProcess.bytes == 0;
+    printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#include "SweepFile.h"
+#include <stdio.h>
+#include "SweepParser.h"
+
+bool loadSweepFile(const char* path, SweepData& out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open sweep file %s\n", path);
+        return false;
+    }
+    out = SweepData();
+
+    static constexpr size_t CHUNK = 4096, BATCH = 256;
+    char chunk[CHUNK];
+    float freq[BATCH], re[BATCH], im[BATCH];
+    SweepParser parser;
+    parser.setSampleBuffer(freq, re, im, BATCH);
+    parser.setConvertToImpedance(true);
+
+    auto drain = [&]() {
+        for (size_t i = 0; i < parser.sampleCount(); i++) {
+            out.freqHz.push_back(freq[i]);
+            out.re.push_back(re[i]);
+            out.im.push_back(im[i]);
+        }
+        parser.clearSamples();
+    };
+
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        size_t used = 0;
+        while (used < n) {
+            used += parser.feed(chunk + used, n - used);
+            if (parser.full()) {
+                drain();
+            } else if (parser.status() != SweepParser::Status::Ok) {
+                break;
+            }
+        }
+    }
+    fclose(f);
+    parser.finish();
+    if (parser.status() != SweepParser::Status::Ok) {
+        fprintf(stderr, "%s: parse error near line %zu\n", path, parser.lineCount() + 1);
+        return false;
+    }
+    drain();
+    return !out.freqHz.empty();
+}
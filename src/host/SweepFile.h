@@ -0,0 +1,19 @@
+#ifndef SWEEP_FILE_H
+#define SWEEP_FILE_H
+
+#include <vector>
+#include "ImpedanceSweep.h"
+
+// Antenna sweep loaded from a docs/Longz style or .s1p text file on the host
+struct SweepData {
+    std::vector<float> freqHz;
+    std::vector<float> re;
+    std::vector<float> im;
+
+    ImpedanceSweep view() const { return ImpedanceSweep(freqHz.data(), re.data(), im.data(), freqHz.size()); }
+};
+
+// Reads a Longz style or 1-port Touchstone file as impedance (see SweepParser)
+bool loadSweepFile(const char* path, SweepData& out);
+
+#endif // SWEEP_FILE_H
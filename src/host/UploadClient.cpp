@@ -0,0 +1,285 @@
+// upload: sends a file to the tuner's /upload route as BlockUpload frames,
+// resuming from the committed offset after a dropped connection.
+//
+//   program upload --file personality.bin --target personality [--host gaptuner.local] [--port 80]
+//   program upload --file personality.bin --loopback [--erase-ms 30]
+//
+// --loopback runs the same frame stream through an in-process BlockReceiver
+// and UploadWriter into a FlashImageSink over simulated flash, with random
+// segment sizes, a sender that waits while the writer is congested and a
+// connection drop part way. It checks that the dropped upload left the
+// header erased, that the image reads back byte for byte, and reports the
+// longest feed() call, the time the body handler holds the TCP task.
+
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BlockUpload.h"
+#include "FlashImageSink.h"
+#include "HostArgs.h"
+#include "HostCommands.h"
+#include "MemoryFlash.h"
+#include "UploadWriter.h"
+
+static bool readFile(const char* path, std::vector<uint8_t>& out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return !out.empty();
+}
+
+// Frame stream for the image from `offset` (a block boundary) to the end
+static std::vector<uint8_t> buildFrames(const std::vector<uint8_t>& image, uint32_t offset)
+{
+    std::vector<uint8_t> body;
+    for (uint32_t pos = offset; pos < image.size(); pos += BLOCK_UPLOAD_SIZE) {
+        const uint32_t len = uint32_t(std::min<size_t>(BLOCK_UPLOAD_SIZE, image.size() - pos));
+        const BlockFrameHeader h = BlockReceiver::frameHeader(pos, &image[pos], len);
+        const uint8_t* hb = reinterpret_cast<const uint8_t*>(&h);
+        body.insert(body.end(), hb, hb + sizeof(h));
+        body.insert(body.end(), image.begin() + pos, image.begin() + pos + len);
+    }
+    return body;
+}
+
+// --- HTTP over a plain socket ---
+
+static int connectTo(const char* host, const char* port)
+{
+    addrinfo hints = {};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static bool sendAll(int fd, const void* data, size_t len)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n; len -= size_t(n);
+    }
+    return true;
+}
+
+// Returns the HTTP status code, response body in `reply`; -1 on a network error
+static int httpRequest(const char* host, const char* port, const std::string& head,
+                       const std::vector<uint8_t>* body, std::string& reply)
+{
+    const int fd = connectTo(host, port);
+    if (fd < 0) return -1;
+    bool ok = sendAll(fd, head.data(), head.size());
+    if (ok && body) ok = sendAll(fd, body->data(), body->size());
+    reply.clear();
+    char buf[1024];
+    ssize_t n;
+    while (ok && (n = recv(fd, buf, sizeof(buf), 0)) > 0) reply.append(buf, size_t(n));
+    close(fd);
+    int code = -1;
+    if (!ok || sscanf(reply.c_str(), "HTTP/1.%*d %d", &code) != 1) return -1;
+    const size_t bodyStart = reply.find("\r\n\r\n");
+    reply = bodyStart == std::string::npos ? std::string() : reply.substr(bodyStart + 4);
+    return code;
+}
+
+static long jsonNumber(const std::string& json, const char* key)
+{
+    const std::string k = std::string("\"") + key + "\":";
+    const size_t p = json.find(k);
+    return p == std::string::npos ? -1 : atol(json.c_str() + p + k.size());
+}
+
+// After a 202: the last blocks are still being written to flash
+static int waitWritten(const char* host, const char* port, const char* target)
+{
+    char head[256];
+    snprintf(head, sizeof(head), "GET /upload-status?target=%s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n",
+             target, host);
+    for (int attempt = 0; attempt < 50; attempt++) {
+        std::string reply;
+        if (httpRequest(host, port, head, nullptr, reply) == 200 && reply.find("\"writing\"") == std::string::npos) {
+            printf("%s\n", reply.c_str());
+            return reply.find("\"complete\"") != std::string::npos ? 0 : 1;
+        }
+        usleep(100000);
+    }
+    fprintf(stderr, "upload not written\n");
+    return 1;
+}
+
+static int uploadHttp(const std::vector<uint8_t>& image, const char* host, const char* port, const char* target)
+{
+    uint32_t offset = 0;
+    for (int attempt = 0; attempt < 10; attempt++) {
+        const std::vector<uint8_t> body = buildFrames(image, offset);
+        char head[512];
+        snprintf(head, sizeof(head),
+                 "POST /upload?target=%s&total=%zu&offset=%u HTTP/1.1\r\nHost: %s\r\n"
+                 "Content-Type: application/octet-stream\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                 target, image.size(), offset, host, body.size());
+        std::string reply;
+        const int code = httpRequest(host, port, head, &body, reply);
+        printf("POST from %u: HTTP %d %s\n", offset, code, reply.c_str());
+        if (code == 200 && jsonNumber(reply, "committed") == long(image.size())) {
+            return 0;
+        }
+        if (code == 202 && jsonNumber(reply, "committed") == long(image.size())) {
+            return waitWritten(host, port, target);
+        }
+        if (code == 409) {
+            sleep(1); // the previous upload is still going to flash
+        }
+        // Ask where to resume; the committed offset survives a dropped connection
+        snprintf(head, sizeof(head), "GET /upload-status?target=%s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n",
+                 target, host);
+        if (httpRequest(host, port, head, nullptr, reply) != 200 || jsonNumber(reply, "committed") < 0) {
+            sleep(1);
+            continue;
+        }
+        offset = uint32_t(jsonNumber(reply, "committed")) / BLOCK_UPLOAD_SIZE * BLOCK_UPLOAD_SIZE;
+    }
+    fprintf(stderr, "upload did not complete\n");
+    return 1;
+}
+
+// --- In-process loopback ---
+
+// MemoryFlash that takes as long as the ESP32-S3's flash to erase a sector
+class SlowFlash : public MemoryFlash {
+public:
+    SlowFlash(size_t size, int eraseMs) : MemoryFlash(size), _eraseMs(eraseMs) {}
+    bool flashErase(uint32_t offset, uint32_t len) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(_eraseMs * int(len / SWEEP_SECTOR_SIZE)));
+        return MemoryFlash::flashErase(offset, len);
+    }
+
+private:
+    int _eraseMs;
+};
+
+// Feeds body bytes in TCP-sized segments as UploadManager does, stopping while
+// the writer is congested as a sender would with the receive window shut.
+// Returns the longest feed() call in microseconds.
+static double feedBody(BlockReceiver& receiver, UploadWriter& writer, std::atomic<bool>& windowShut,
+                       const std::vector<uint8_t>& body, size_t end, std::mt19937& rng)
+{
+    double longestUs = 0.0;
+    for (size_t pos = 0; pos < end;) {
+        while (windowShut.load()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        const size_t n = std::min<size_t>(1 + rng() % 1460, end - pos);
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool ok = receiver.feed(&body[pos], n);
+        longestUs = std::max(longestUs, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        if (!ok) break;
+        if (writer.congested()) windowShut.store(true);
+        pos += n;
+    }
+    return longestUs;
+}
+
+static void waitIdle(const UploadWriter& writer)
+{
+    while (!writer.idle()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+static int uploadLoopback(const std::vector<uint8_t>& image, int eraseMs)
+{
+    std::mt19937 rng(1234);
+    SlowFlash flash((image.size() + BLOCK_UPLOAD_SIZE - 1) / BLOCK_UPLOAD_SIZE * BLOCK_UPLOAD_SIZE, eraseMs);
+    static FlashImageSink sink;     // as on the device: static instances, no heap
+    static BlockReceiver receiver;
+    static UploadWriter writer;
+    std::atomic<bool> windowShut(false);
+    std::atomic<int> done(0), finished(0);
+    sink.attach(&flash, flash.bytes.size());
+    writer.setSink(&sink);
+    writer.onDone([&](bool ok) { done++; finished += ok ? 1 : 0; });
+    writer.onDrained([&]() { windowShut.store(false); });
+    writer.start();
+    receiver.begin(&writer, uint32_t(image.size()));
+
+    // First connection drops part way through; the writer ends what it has
+    std::vector<uint8_t> body = buildFrames(image, 0);
+    const size_t dropAt = body.size() / 2 + 777;
+    double longestUs = feedBody(receiver, writer, windowShut, body, dropAt, rng);
+    writer.end();
+    waitIdle(writer);
+    const bool headerErased = flash.bytes[0] == 0xFF && flash.bytes[3] == 0xFF;
+    const uint32_t resumeAt = receiver.committed() / BLOCK_UPLOAD_SIZE * BLOCK_UPLOAD_SIZE;
+    printf("dropped after %zu body bytes, committed %u, resuming at %u; header %s\n", dropAt, receiver.committed(),
+           resumeAt, headerErased ? "erased" : "STILL THERE");
+
+    // Second connection: resend from one block earlier to exercise duplicate skipping
+    const uint32_t resendFrom = resumeAt >= BLOCK_UPLOAD_SIZE ? resumeAt - uint32_t(BLOCK_UPLOAD_SIZE) : 0;
+    if (!receiver.resume(resendFrom)) {
+        fprintf(stderr, "resume refused\n");
+        return 1;
+    }
+    body = buildFrames(image, resendFrom);
+    longestUs = std::max(longestUs, feedBody(receiver, writer, windowShut, body, body.size(), rng));
+    waitIdle(writer);
+    writer.stop();
+
+    const bool ok = receiver.status() == UploadStatus::Complete && !writer.failed() && flash.bytes == image &&
+                    headerErased && done.load() == 2 && finished.load() == 1;
+    printf("status %s, %d done callbacks (%d finished), image %s\n", uploadStatusName(receiver.status()), done.load(),
+           finished.load(), flash.bytes == image ? "identical" : "DIFFERENT");
+    printf("longest feed() %.0f us with %d ms sector erases; receiver %zu + writer %zu bytes\n", longestUs, eraseMs,
+           sizeof(BlockReceiver), sizeof(UploadWriter));
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int cmdUpload(int argc, char** argv)
+{
+    const char* path = argString(argc, argv, "--file", "");
+    if (path[0] == '\0') {
+        fprintf(stderr, "usage: upload --file <image> --target personality [--host gaptuner.local] [--port 80]\n"
+                        "       upload --file <image> --loopback [--erase-ms 30]\n");
+        return 1;
+    }
+    std::vector<uint8_t> image;
+    if (!readFile(path, image)) {
+        return 1;
+    }
+    if (argFlag(argc, argv, "--loopback")) {
+        // Image padded to whole sectors, as it would read back from a partition
+        image.resize((image.size() + BLOCK_UPLOAD_SIZE - 1) / BLOCK_UPLOAD_SIZE * BLOCK_UPLOAD_SIZE, 0xFF);
+        return uploadLoopback(image, int(argNumber(argc, argv, "--erase-ms", 30)));
+    }
+    return uploadHttp(image, argString(argc, argv, "--host", "gaptuner.local"),
+                      argString(argc, argv, "--port", "80"), argString(argc, argv, "--target", "personality"));
+}
@@ -0,0 +1,291 @@
+#include "VnaSim.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+typedef std::complex<double> cd;
+
+static const double TWO_PI = 6.283185307179586;
+
+cd VnaStandards::open(double hz) const
+{
+    return gamma(1.0 / cd(0.0, TWO_PI * hz * openFarads));
+}
+
+cd VnaStandards::shortCircuit(double hz) const
+{
+    return gamma(cd(0.0, TWO_PI * hz * shortHenries));
+}
+
+cd VnaStandards::load(double hz) const
+{
+    return gamma(cd(loadOhms, TWO_PI * hz * loadHenries));
+}
+
+void VnaErrorModel::terms(double hz, cd& e00, cd& e11, cd& e10e01) const
+{
+    e00 = std::polar(directivity, 0.3 + TWO_PI * hz * 0.2e-9);
+    e11 = std::polar(sourceMatch, -1.0 - TWO_PI * hz * 0.5e-9);
+    const double lossDb = cableLossDb * sqrt(hz / 10e6);
+    e10e01 = std::polar(pow(10.0, -2.0 * lossDb / 20.0), -TWO_PI * hz * 2.0 * cableDelayS);
+}
+
+cd VnaErrorModel::measured(double hz, cd gamma) const
+{
+    cd e00, e11, e10e01;
+    terms(hz, e00, e11, e10e01);
+    return e00 + e10e01 * gamma / (1.0 - e11 * gamma);
+}
+
+VnaSim::VnaSim(Dut dut, DutState state, const VnaSimOptions& options) :
+    _dut(dut), _dutState(state), _options(options), _stopping(false), _listenFd(-1), _serialFd(-1),
+    _startHz(1e6), _stopHz(30e6), _points(201), _single(false), _sweeping(false), _complete(false), _stateAtRun(0),
+    _sweeps(0), _moved(0), _invalid(0), _errors(0)
+{
+}
+
+VnaSim::~VnaSim()
+{
+    stop();
+}
+
+uint16_t VnaSim::startTcp(uint16_t port)
+{
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenFd < 0) {
+        return 0;
+    }
+    const int one = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if (bind(_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(_listenFd, 4) != 0 ||
+        getsockname(_listenFd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        close(_listenFd);
+        _listenFd = -1;
+        return 0;
+    }
+    _acceptThread = std::thread([this] { acceptLoop(); });
+    return ntohs(addr.sin_port);
+}
+
+int VnaSim::openSerial()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_serialFd >= 0) shutdown(_serialFd, SHUT_RDWR);
+        _serialFd = fds[0];
+    }
+    addClient(fds[0]);
+    std::lock_guard<std::mutex> lock(_lock);
+    _threads.emplace_back([this, fd = fds[0]] { serve(fd); });
+    return fds[1];
+}
+
+void VnaSim::stop()
+{
+    _stopping = true;
+    if (_acceptThread.joinable()) _acceptThread.join();
+    if (_listenFd >= 0) {
+        close(_listenFd);
+        _listenFd = -1;
+    }
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        for (int fd : _clients) shutdown(fd, SHUT_RDWR);
+        threads.swap(_threads);
+    }
+    for (std::thread& t : threads) t.join();
+}
+
+void VnaSim::addClient(int fd)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.push_back(fd);
+}
+
+void VnaSim::acceptLoop()
+{
+    while (!_stopping) {
+        pollfd p = {_listenFd, POLLIN, 0};
+        if (poll(&p, 1, 20) <= 0) continue;
+        const int fd = accept(_listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        addClient(fd);
+        std::lock_guard<std::mutex> lock(_lock);
+        _threads.emplace_back([this, fd] { serve(fd); });
+    }
+}
+
+void VnaSim::serve(int fd)
+{
+    std::string pending;
+    char buf[256];
+    ssize_t n;
+    bool ok = true;
+    while (ok && (n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        pending.append(buf, size_t(n));
+        size_t nl;
+        while (ok && (nl = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, nl);
+            pending.erase(0, nl + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            const std::string text = reply(line);
+            if (!text.empty() && send(fd, text.data(), text.size(), MSG_NOSIGNAL) < 0) ok = false;
+        }
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), fd), _clients.end());
+    if (_serialFd == fd) _serialFd = -1;
+    close(fd);
+}
+
+double VnaSim::frequency(size_t i) const
+{
+    return _points < 2 ? _startHz : _startHz + (_stopHz - _startHz) * double(i) / double(_points - 1);
+}
+
+bool VnaSim::rfOn()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    advance();
+    return _sweeping;
+}
+
+void VnaSim::advance()
+{
+    if (!_sweeping || std::chrono::steady_clock::now() < _sweepEnd) {
+        return;
+    }
+    if (_dutState() != _stateAtRun) {
+        _moved++;
+    }
+    _complete = true;
+    _sweeps++;
+    if (_single) {
+        _sweeping = false;
+        return;
+    }
+    // Free running: the next sweep starts at once
+    _stateAtRun = _dutState();
+    _sweepEnd = std::chrono::steady_clock::now() +
+                std::chrono::microseconds(int64_t(_points * _options.usPerPoint));
+}
+
+// "ACQuisition" matches ACQ and ACQUISITION, in any case
+static bool nodeMatches(const std::string& node, const char* pattern)
+{
+    std::string shortForm, longForm;
+    for (const char* p = pattern; *p; p++) {
+        if (isupper((unsigned char)*p) || isdigit((unsigned char)*p) || *p == '*') shortForm += *p;
+        longForm += char(toupper((unsigned char)*p));
+    }
+    std::string upper;
+    for (char c : node) upper += char(toupper((unsigned char)c));
+    return upper == shortForm || upper == longForm;
+}
+
+static bool headerMatches(const std::string& header, const char* pattern)
+{
+    size_t h = header.empty() || header[0] != ':' ? 0 : 1;
+    const char* p = pattern;
+    for (;;) {
+        const size_t hEnd = std::min(header.find(':', h), header.size());
+        const char* pEnd = strchr(p, ':');
+        const std::string pNode = pEnd ? std::string(p, pEnd) : std::string(p);
+        if (!nodeMatches(header.substr(h, hEnd - h), pNode.c_str())) return false;
+        if (pEnd == nullptr || hEnd == header.size()) return pEnd == nullptr && hEnd == header.size();
+        h = hEnd + 1;
+        p = pEnd + 1;
+    }
+}
+
+std::string VnaSim::reply(const std::string& line)
+{
+    const size_t space = line.find(' ');
+    std::string header = line.substr(0, space);
+    const std::string arg = space == std::string::npos ? "" : line.substr(space + 1);
+    const bool query = !header.empty() && header.back() == '?';
+    if (query) header.pop_back();
+    const double value = atof(arg.c_str());
+
+    std::lock_guard<std::mutex> lock(_lock);
+    advance();
+    if (header.empty()) {
+        return std::string();
+    }
+    if (query) {
+        if (headerMatches(header, "*IDN")) return std::string(_options.idn) + "\n";
+        if (headerMatches(header, "*OPC")) return "1\n";
+        if (headerMatches(header, "VNA:ACQuisition:FINished")) return _sweeping ? "FALSE\n" : "TRUE\n";
+        if (headerMatches(header, "VNA:ACQuisition:POINTS")) return std::to_string(_points) + "\n";
+        if (headerMatches(header, "VNA:TRACe:DATA") && nodeMatches(arg, "S11") && _complete) return trace();
+        _errors++;
+        return "ERROR\n";
+    }
+    if (headerMatches(header, "VNA:FREQuency:START") && value > 0) {
+        _startHz = value;
+    } else if (headerMatches(header, "VNA:FREQuency:STOP") && value > 0) {
+        _stopHz = value;
+    } else if (headerMatches(header, "VNA:ACQuisition:POINTS") && value >= 2) {
+        _points = uint32_t(value);
+    } else if (headerMatches(header, "VNA:ACQuisition:IFBW") && value > 0) {
+        // No noise to average here
+    } else if (headerMatches(header, "VNA:ACQuisition:SINGLE")) {
+        _single = nodeMatches(arg, "TRUE");
+    } else if (headerMatches(header, "VNA:ACQuisition:STOP")) {
+        _sweeping = false;
+    } else if (headerMatches(header, "VNA:ACQuisition:RUN")) {
+        // The DUT is read at the start; advance() checks it has not changed
+        _data.resize(_points);
+        for (uint32_t i = 0; i < _points; i++) {
+            cd gamma;
+            if (!_dut(frequency(i), gamma)) {
+                gamma = 0.5;
+                _invalid++;
+            }
+            _data[i] = _options.errors.measured(frequency(i), gamma);
+        }
+        _stateAtRun = _dutState();
+        _sweeping = true;
+        _complete = false;
+        _sweepEnd = std::chrono::steady_clock::now() +
+                    std::chrono::microseconds(int64_t(_points * _options.usPerPoint));
+    } else {
+        _errors++;
+    }
+    return std::string();
+}
+
+std::string VnaSim::trace()
+{
+    std::string out;
+    out.reserve(_data.size() * 40);
+    char item[80];
+    for (size_t i = 0; i < _data.size(); i++) {
+        const int n = snprintf(item, sizeof(item), "%s[%.0f,%.9g,%.9g]", i == 0 ? "" : ",", frequency(i),
+                               _data[i].real(), _data[i].imag());
+        out.append(item, size_t(n));
+    }
+    out += '\n';
+    return out;
+}
@@ -0,0 +1,127 @@
+#ifndef VNA_SIM_H
+#define VNA_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The tuner's calibration standards as built, referred to the reference
+// plane at K1-K3: an open with fringe capacitance, a short and a load with
+// some series inductance
+struct VnaStandards {
+    double openFarads   = 2.0e-12;
+    double shortHenries = 3.0e-9;
+    double loadOhms     = 50.0;
+    double loadHenries  = 1.5e-9;
+    double z0           = 50.0;
+
+    std::complex<double> open(double hz) const;
+    std::complex<double> shortCircuit(double hz) const;
+    std::complex<double> load(double hz) const;
+    std::complex<double> gamma(std::complex<double> z) const { return (z - z0) / (z + z0); }
+};
+
+// Error box between the VNA port and the reference plane, the classic
+// one-port three-term model: directivity e00, source match e11 and
+// reflection tracking e10e01. Here a short cable with some loss and a
+// slightly mismatched VNA bridge.
+struct VnaErrorModel {
+    double directivity = 0.02;     // |e00|
+    double sourceMatch = 0.06;     // |e11|
+    double cableDelayS = 5.0e-9;   // one way, about 1 m of coax
+    double cableLossDb = 0.1;      // one way, at 10 MHz, growing with sqrt(f)
+
+    void terms(double hz, std::complex<double>& e00, std::complex<double>& e11, std::complex<double>& e10e01) const;
+    // What the VNA reads for a reflection gamma at the reference plane
+    std::complex<double> measured(double hz, std::complex<double> gamma) const;
+};
+
+struct VnaSimOptions {
+    double        usPerPoint = 20.0;  // sweep time; 1001 points: 20 ms
+    VnaErrorModel errors;
+    const char*   idn = "GAPTuner,SoftVNA,0,1.0";
+};
+
+// Software stand-in for a LibreVNA driven over its SCPI interface, for the
+// host tools. The device under test is a callback giving the reflection at
+// the reference plane, so a test can wire it to simulated relays. Reachable
+// over TCP (LibreVNA-GUI's SCPI server) or one end of a socketpair standing
+// in for a serial link. Understands, in long or short form:
+//   *IDN?  *OPC?
+//   :VNA:FREQuency:START|STOP <Hz>     :VNA:ACQuisition:POINTS|IFBW <n>
+//   :VNA:ACQuisition:SINGLE TRUE|FALSE :VNA:ACQuisition:RUN|STOP
+//   :VNA:ACQuisition:FINished?         :VNA:TRACe:DATA? S11
+// Set commands are silent; an unknown query answers "ERROR". A single sweep
+// takes points * usPerPoint; the DUT is sampled when it starts, and if its
+// state has changed by the time the sweep ends (a relay moved with RF
+// applied) that is counted.
+class VnaSim {
+public:
+    // Reflection at the reference plane; false if no path is made (relays
+    // between states), which reads as a 0.5 reflection and is counted
+    typedef std::function<bool(double hz, std::complex<double>& gamma)> Dut;
+    // Anything that changes whenever the DUT does, e.g. the relay contacts
+    typedef std::function<uint64_t()> DutState;
+
+    VnaSim(Dut dut, DutState state, const VnaSimOptions& options = VnaSimOptions());
+    ~VnaSim();
+
+    // Listens on 127.0.0.1:port (0: any free port); the bound port, 0 on error
+    uint16_t startTcp(uint16_t port);
+    // Controller end of a new serial link (the previous one is disconnected), -1 on error
+    int openSerial();
+    void stop();
+
+    const VnaSimOptions& options() const { return _options; }
+    // Frequency of point i of the configured sweep
+    double frequency(size_t i) const;
+
+    uint32_t sweeps() const { return _sweeps; }
+    uint32_t movedDuringSweep() const { return _moved; }
+    uint32_t invalidPoints() const { return _invalid; }
+    uint32_t errors() const { return _errors; }
+    // Relay jobs are expected only between sweeps: false while RF is applied
+    bool rfOn();
+
+private:
+    void acceptLoop();
+    void serve(int fd);
+    std::string reply(const std::string& line);
+    std::string trace();
+    void advance(); // under _lock: completes a sweep whose time is up
+    void addClient(int fd);
+
+    Dut                   _dut;
+    DutState              _dutState;
+    VnaSimOptions         _options;
+    std::atomic<bool>     _stopping;
+    int                   _listenFd;
+    std::thread           _acceptThread;
+    mutable std::mutex    _lock;     // everything below
+    std::vector<int>      _clients;
+    int                   _serialFd; // simulator end of the serial link, or -1
+    std::vector<std::thread> _threads;
+
+    double                _startHz;
+    double                _stopHz;
+    uint32_t              _points;
+    bool                  _single;
+    bool                  _sweeping;
+    bool                  _complete;
+    std::chrono::steady_clock::time_point _sweepEnd;
+    uint64_t              _stateAtRun;
+    std::vector<std::complex<double>> _data;
+    std::atomic<uint32_t> _sweeps;
+    std::atomic<uint32_t> _moved;
+    std::atomic<uint32_t> _invalid;
+    std::atomic<uint32_t> _errors;
+};
+
+#endif // VNA_SIM_H
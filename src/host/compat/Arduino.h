@@ -0,0 +1,105 @@
+#ifndef HOST_COMPAT_ARDUINO_H
+#define HOST_COMPAT_ARDUINO_H
+
+// Just enough of the Arduino core for the hardware-independent firmware
+// sources (RelayController, GAPTuner) to build in the native environment.
+// GPIO and relay timing go through RelayHal, so none of them are provided
+// here; micros() and millis() are only for sources that time themselves.
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#define HIGH   0x1
+#define LOW    0x0
+#define INPUT  0x01
+#define OUTPUT 0x03
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(const char* s) { _s += s; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == s; }
+    bool operator!=(const String& s) const { return _s != s._s; }
+
+    unsigned int length() const { return unsigned(_s.size()); }
+    char operator[](unsigned int index) const { return index < _s.size() ? _s[index] : '\0'; }
+    const char* c_str() const { return _s.c_str(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool startsWith(const String& s) const { return _s.compare(0, s._s.size(), s._s) == 0; }
+    bool endsWith(const String& s) const {
+        return _s.size() >= s._s.size() && _s.compare(_s.size() - s._s.size(), s._s.size(), s._s) == 0;
+    }
+    int indexOf(const char* s) const {
+        const size_t pos = _s.find(s);
+        return pos == std::string::npos ? -1 : int(pos);
+    }
+    void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+    long toInt() const { return atol(_s.c_str()); }
+
+private:
+    std::string _s;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+
+// Firmware debug output; silent unless a host tool enables it
+class HostSerial {
+public:
+    bool enabled = false;
+
+    void print(const char* s) { if (enabled) fputs(s, stdout); }
+    void print(const String& s) { print(s.c_str()); }
+    void println(const char* s = "") { if (enabled) { fputs(s, stdout); fputc('\n', stdout); } }
+    void println(const String& s) { println(s.c_str()); }
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (!enabled) return 0;
+        va_list args;
+        va_start(args, format);
+        const int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+};
+
+inline HostSerial Serial;
+
+inline uint32_t micros()
+{
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+inline uint32_t millis()
+{
+    return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// In newlib, and in glibc only from 2.38
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char* dst, const char* src, size_t size)
+{
+    const size_t len = strlen(src);
+    if (size > 0) {
+        const size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+#endif // HOST_COMPAT_ARDUINO_H
@@ -0,0 +1,325 @@
+#ifndef HOST_COMPAT_ESP_ASYNC_WEB_SERVER_H
+#define HOST_COMPAT_ESP_ASYNC_WEB_SERVER_H
+
+// The part of ESPAsyncWebServer that WebServerManager uses, as an in-process
+// mock for the host load harness (src/host/LoadWeb.cpp). There is no
+// network: a test builds an AsyncWebServerRequest from a URL, hands it to
+// AsyncWebServer::dispatch(), which runs the handler registered for it as
+// the AsyncTCP task would, and then pulls the response body with
+// transmit().
+//
+// Responses are heap objects owned by the request, and they copy text
+// bodies and header strings and buffer streams, as the library does, so
+// the allocations counted per request approximate the firmware's. Bodies
+// given as a pointer (the embedded UI files) are sent from there.
+
+#include <Arduino.h>
+#include <string.h>
+#include <strings.h>
+#include <functional>
+#include <list>
+#include <vector>
+
+typedef enum { HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_ANY = 0b01111111 } WebRequestMethod;
+
+class AsyncWebServerRequest;
+class AsyncEventSourceClient;
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const char* name, const char* value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code, const char* contentType) : _code(code), _contentType(contentType) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int code) { _code = code; }
+    void addHeader(const char* name, const char* value) { _headers.emplace_back(name, value); }
+
+    int code() const { return _code; }
+    const String& contentType() const { return _contentType; }
+    const std::list<AsyncWebHeader>& headers() const { return _headers; }
+    // Body bytes from index on, at most maxLen; 0 at the end
+    virtual size_t fill(uint8_t* buffer, size_t maxLen, size_t index) = 0;
+
+private:
+    int                       _code;
+    String                    _contentType;
+    std::list<AsyncWebHeader> _headers;
+};
+
+// send(code, type, content): the body is copied
+class AsyncBasicResponse : public AsyncWebServerResponse {
+public:
+    AsyncBasicResponse(int code, const char* contentType, const char* content) :
+        AsyncWebServerResponse(code, contentType), _content(content) {}
+
+    size_t fill(uint8_t* buffer, size_t maxLen, size_t index) override
+    {
+        return copyOut(buffer, maxLen, index, reinterpret_cast<const uint8_t*>(_content.c_str()), _content.length());
+    }
+
+    static size_t copyOut(uint8_t* buffer, size_t maxLen, size_t index, const uint8_t* data, size_t size)
+    {
+        const size_t n = index >= size ? 0 : (size - index < maxLen ? size - index : maxLen);
+        memcpy(buffer, data + index, n);
+        return n;
+    }
+
+private:
+    String _content;
+};
+
+// beginResponse(code, type, data, len): sent from data (flash) as is
+class AsyncProgmemResponse : public AsyncWebServerResponse {
+public:
+    AsyncProgmemResponse(int code, const char* contentType, const uint8_t* content, size_t len) :
+        AsyncWebServerResponse(code, contentType), _content(content), _len(len) {}
+
+    size_t fill(uint8_t* buffer, size_t maxLen, size_t index) override
+    {
+        return AsyncBasicResponse::copyOut(buffer, maxLen, index, _content, _len);
+    }
+
+private:
+    const uint8_t* _content;
+    size_t         _len;
+};
+
+// beginResponseStream(): written into a heap buffer of bufferSize, which
+// grows if needed
+class AsyncResponseStream : public AsyncWebServerResponse {
+public:
+    AsyncResponseStream(const char* contentType, size_t bufferSize) : AsyncWebServerResponse(200, contentType)
+    {
+        _content.reserve(bufferSize);
+    }
+
+    size_t write(const uint8_t* data, size_t len)
+    {
+        _content.insert(_content.end(), data, data + len);
+        return len;
+    }
+    size_t write(uint8_t c) { return write(&c, 1); }
+
+    size_t fill(uint8_t* buffer, size_t maxLen, size_t index) override
+    {
+        return AsyncBasicResponse::copyOut(buffer, maxLen, index, _content.data(), _content.size());
+    }
+
+private:
+    std::vector<uint8_t> _content;
+};
+
+// beginChunkedResponse(): the filler is called until it returns 0
+class AsyncChunkedResponse : public AsyncWebServerResponse {
+public:
+    AsyncChunkedResponse(const char* contentType, AwsResponseFiller filler) :
+        AsyncWebServerResponse(200, contentType), _filler(filler) {}
+
+    size_t fill(uint8_t* buffer, size_t maxLen, size_t index) override { return _filler(buffer, maxLen, index); }
+
+private:
+    AwsResponseFiller _filler;
+};
+
+class AsyncWebServerRequest {
+public:
+    // target: path with an optional ?query (no %-decoding)
+    explicit AsyncWebServerRequest(const char* target) : _response(nullptr)
+    {
+        const char* query = strchr(target, '?');
+        _url = query ? String(std::string(target, size_t(query - target))) : String(target);
+        while (query != nullptr && *++query != '\0') {
+            const char* end = strchr(query, '&');
+            const std::string pair = end ? std::string(query, size_t(end - query)) : std::string(query);
+            const size_t eq = pair.find('=');
+            _params.emplace_back(String(pair.substr(0, eq)), String(eq == std::string::npos ? "" : pair.substr(eq + 1)));
+            query = end;
+        }
+    }
+    ~AsyncWebServerRequest() { delete _response; }
+    AsyncWebServerRequest(const AsyncWebServerRequest&) = delete;
+    AsyncWebServerRequest& operator=(const AsyncWebServerRequest&) = delete;
+
+    void addHeader(const char* name, const char* value) { _headers.emplace_back(name, value); }
+
+    const String& url() const { return _url; }
+    WebRequestMethod method() const { return HTTP_GET; }
+
+    bool hasParam(const char* name) const { return getParam(name) != nullptr; }
+    const AsyncWebParameter* getParam(const char* name) const
+    {
+        for (const AsyncWebParameter& p : _params) {
+            if (p.name() == name) return &p;
+        }
+        return nullptr;
+    }
+    const AsyncWebHeader* getHeader(const char* name) const
+    {
+        for (const AsyncWebHeader& h : _headers) {
+            if (strcasecmp(h.name().c_str(), name) == 0) return &h;
+        }
+        return nullptr;
+    }
+
+    AsyncWebServerResponse* beginResponse(int code, const char* contentType = "", const char* content = "")
+    {
+        return new AsyncBasicResponse(code, contentType, content);
+    }
+    AsyncWebServerResponse* beginResponse(int code, const char* contentType, const uint8_t* content, size_t len)
+    {
+        return new AsyncProgmemResponse(code, contentType, content, len);
+    }
+    AsyncResponseStream* beginResponseStream(const char* contentType, size_t bufferSize = 1460)
+    {
+        return new AsyncResponseStream(contentType, bufferSize);
+    }
+    AsyncWebServerResponse* beginChunkedResponse(const char* contentType, AwsResponseFiller filler)
+    {
+        return new AsyncChunkedResponse(contentType, filler);
+    }
+
+    void send(AsyncWebServerResponse* response)
+    {
+        delete _response;
+        _response = response;
+    }
+    void send(int code, const char* contentType = "", const char* content = "")
+    {
+        send(beginResponse(code, contentType, content));
+    }
+    void send(int code, const String& contentType, const String& content)
+    {
+        send(code, contentType.c_str(), content.c_str());
+    }
+
+    // The response the handler sent, or nullptr
+    AsyncWebServerResponse* response() const { return _response; }
+    // Pulls the whole body through buffer, as AsyncTCP would into its send
+    // window, frees the response and returns the body length; the request
+    // can then be dispatched again
+    size_t transmit(uint8_t* buffer, size_t size)
+    {
+        size_t total = 0;
+        if (_response != nullptr) {
+            for (size_t n; (n = _response->fill(buffer, size, total)) > 0;) total += n;
+        }
+        delete _response;
+        _response = nullptr;
+        return total;
+    }
+
+private:
+    String                         _url;
+    std::vector<AsyncWebParameter> _params;
+    std::vector<AsyncWebHeader>    _headers;
+    AsyncWebServerResponse*        _response;
+};
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+    AsyncCallbackWebHandler(const char* uri, WebRequestMethod method, ArRequestHandlerFunction fn) :
+        _uri(uri), _method(method), _fn(fn) {}
+
+    // The library's rules without regex: the exact path or a path below it,
+    // or any path starting with what precedes a trailing '*'
+    bool canHandle(const AsyncWebServerRequest& request) const
+    {
+        const char* url = request.url().c_str();
+        const size_t n = _uri.length();
+        if (n > 0 && _uri.c_str()[n - 1] == '*') {
+            return strncmp(url, _uri.c_str(), n - 1) == 0;
+        }
+        return strncmp(url, _uri.c_str(), n) == 0 && (url[n] == '\0' || url[n] == '/');
+    }
+    void handle(AsyncWebServerRequest* request) const { _fn(request); }
+
+private:
+    String                   _uri;
+    WebRequestMethod         _method;
+    ArRequestHandlerFunction _fn;
+};
+
+class AsyncEventSourceClient {
+public:
+    uint32_t lastId() const { return 0; }
+    void send(const char*, const char* = nullptr, uint32_t = 0, uint32_t = 0) {}
+};
+
+// /events: no clients connect to the mock
+class AsyncEventSource : public AsyncWebHandler {
+public:
+    explicit AsyncEventSource(const char* url) : _url(url) {}
+    void onConnect(std::function<void(AsyncEventSourceClient* client)> fn) { _onConnect = fn; }
+    size_t count() const { return 0; }
+    void send(const char*, const char* = nullptr, uint32_t = 0, uint32_t = 0) {}
+
+private:
+    String                                               _url;
+    std::function<void(AsyncEventSourceClient* client)> _onConnect;
+};
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) : _port(port) {}
+
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethod method, ArRequestHandlerFunction fn)
+    {
+        _handlers.emplace_back(uri, method, fn);
+        return _handlers.back();
+    }
+    void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+    void addHandler(AsyncWebHandler*) {}
+    void begin() {}
+
+    // Runs the first handler that takes the request, else the not-found one,
+    // else a bare 404, the way the library picks them
+    void dispatch(AsyncWebServerRequest* request)
+    {
+        for (const AsyncCallbackWebHandler& h : _handlers) {
+            if (h.canHandle(*request)) {
+                h.handle(request);
+                return;
+            }
+        }
+        if (_notFound) {
+            _notFound(request);
+        } else {
+            request->send(404);
+        }
+    }
+
+private:
+    uint16_t                           _port;
+    std::list<AsyncCallbackWebHandler> _handlers;
+    ArRequestHandlerFunction           _notFound;
+};
+
+#endif // HOST_COMPAT_ESP_ASYNC_WEB_SERVER_H
@@ -0,0 +1,6 @@
+#ifndef HOST_COMPAT_ESP_MDNS_H
+#define HOST_COMPAT_ESP_MDNS_H
+
+// Included by NetworkMgr.h; nothing of it is used in the host build
+
+#endif // HOST_COMPAT_ESP_MDNS_H
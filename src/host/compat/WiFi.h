@@ -0,0 +1,19 @@
+#ifndef HOST_COMPAT_WIFI_H
+#define HOST_COMPAT_WIFI_H
+
+// WiFi as the host build sees it: connected, at a fixed signal level
+// (NetworkMgr.h and WebServerManager; see compat/ESPAsyncWebServer.h)
+
+#include <stdint.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+class HostWiFi {
+public:
+    wl_status_t status() const { return WL_CONNECTED; }
+    int8_t RSSI() const { return -60; }
+};
+
+inline HostWiFi WiFi;
+
+#endif // HOST_COMPAT_WIFI_H
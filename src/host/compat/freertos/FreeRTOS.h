@@ -0,0 +1,6 @@
+#ifndef HOST_COMPAT_FREERTOS_H
+#define HOST_COMPAT_FREERTOS_H
+
+// Included by NetworkMgr.h; the host tools use std::thread instead
+
+#endif // HOST_COMPAT_FREERTOS_H
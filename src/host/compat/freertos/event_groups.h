@@ -0,0 +1,11 @@
+#ifndef HOST_COMPAT_FREERTOS_EVENT_GROUPS_H
+#define HOST_COMPAT_FREERTOS_EVENT_GROUPS_H
+
+// The event group types in NetworkMgr.h's declarations
+
+#include <stdint.h>
+
+typedef void*    EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#endif // HOST_COMPAT_FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,11 @@
+#ifndef HOST_COMPAT_NVS_H
+#define HOST_COMPAT_NVS_H
+
+// The NVS types in NetworkMgr.h's declarations; settings are not stored in
+// the host build
+
+#include <stdint.h>
+
+typedef uint32_t nvs_handle_t;
+
+#endif // HOST_COMPAT_NVS_H
@@ -0,0 +1,6 @@
+#ifndef HOST_COMPAT_NVS_FLASH_H
+#define HOST_COMPAT_NVS_FLASH_H
+
+#include "nvs.h"
+
+#endif // HOST_COMPAT_NVS_FLASH_H
@@ -17,22 +17,177 @@ const char* mDnsHostname = "gaptuner"; // Keep hostname for mDNS
 #include <ESPmDNS.h>
 
 #include "DebugUtils.h"
+#include "Esp32RelayHal.h"
 #include "RelayController.h"
 #include "GAPTuner.h"
+#include "RelayExecutor.h"
 #include "NetworkMgr.h"
 #include "WebServerManager.h"
+#include "MappedRegion.h"
+#include "TuneTable.h"
+#include "Personality.h"
+#include "SweepStore.h"
+#include "UploadManager.h"
+#include "TunerMetrics.h"
+#include "TunerState.h"
+#include "RigFollower.h"
+#include "Esp32RigTransport.h"
+#include "PowerManager.h"
+#include "CalStore.h"
+#include "Esp32CalFlash.h"
+#include "VnaSequencer.h"
+#include "CalCorrector.h"
+#include "MemoryArenas.h"
 
 // --- Global Object Instances ---
-RelayController  g_relayController;
+MemoryArenas     g_arenas;
+TunerMetrics     g_metrics;
+TunerState       g_tunerState;
+Esp32RelayHal    g_relayHal;
+RelayController  g_relayController(g_relayHal);
 GAPTuner         g_gaptuner(g_relayController);
+RelayExecutor    g_relayExecutor(g_gaptuner);
+Esp32RigctldTransport g_rigctldTransport;
+Esp32CivTransport g_civTransport;
+RigFollower      g_rigFollower(g_relayExecutor, g_gaptuner, g_relayController, g_rigctldTransport, g_civTransport);
 NetworkMgr       g_networkMgr(mDnsHostname);
+PowerManager     g_powerManager(g_networkMgr, g_relayExecutor, g_gaptuner, g_relayController, g_rigFollower, g_metrics);
+Esp32RigctldTransport g_vnaTcpTransport;   // a plain TCP / UART byte stream, as for the rig
+Esp32VnaUartTransport g_vnaSerialTransport;
+Esp32CalFlash    g_calFlash;
+VnaSequencer     g_vnaSequencer(g_relayExecutor, g_gaptuner, g_relayController, g_tunerState, g_vnaTcpTransport,
+                                g_vnaSerialTransport, g_calFlash);
+CalCorrector     g_calCorrector;
 AsyncWebServer   g_asyncServer(80);
-WebServerManager g_webServerManager(g_asyncServer, g_gaptuner, g_networkMgr);
+WebServerManager g_webServerManager(g_asyncServer, g_gaptuner, g_relayExecutor, g_networkMgr, g_metrics,
+                                     g_tunerState, g_rigFollower, g_powerManager, g_vnaSequencer,
+                                     g_calCorrector);
+MappedRegion     g_tuneTableRegion;
+TuneTableView    g_tuneTable;
+MappedRegion     g_personalityRegion;
+PersonalityView  g_personality;
+MappedRegion     g_sweepsRegion;
+SweepStoreView   g_sweeps;
+MappedRegion     g_calRegion;
+CalStoreView     g_cal;
+UploadManager    g_uploadManager(g_asyncServer);
 
+// Map the band-plan tune table in place; no copy, no parsing. A band plan is
+// some tens of KB, so its CRC is checked too before the relays follow it.
+static void mapTuneTable()
+{
+    if (g_tuneTableRegion.mapPartition("tunetab", TUNE_TABLE_SUBTYPE) &&
+        g_tuneTable.attach(g_tuneTableRegion.data(), g_tuneTableRegion.size()) && g_tuneTable.verifyCrc()) {
+        g_gaptuner.attachTuneTable(&g_tuneTable);
+    } else {
+        g_tuneTable = TuneTableView();
+        DEBUG_PRINTLN("main: No valid tune table in the tunetab partition.");
+    }
+}
+
+// Same for the personality: read in place, header check only (its upload
+// writes the header last)
+static void mapPersonality()
+{
+    if (g_personalityRegion.mapPartition("personality", PERSONALITY_SUBTYPE) &&
+        g_personality.attach(g_personalityRegion.data(), g_personalityRegion.size())) {
+        DEBUG_PRINTF("main: Personality mapped, %u blocks x %u points, %u inductor stages / %u capacitor branches.\n",
+                     (unsigned)g_personality.numBlocks(), (unsigned)g_personality.numFreqs(),
+                     (unsigned)g_personality.numInductorStages(), (unsigned)g_personality.numCapacitorBranches());
+    } else {
+        DEBUG_PRINTLN("main: No valid personality in the personality partition.");
+    }
+}
+
+// Parsed antenna sweeps, one slot per gap length
+static void mapSweeps()
+{
+    if (g_sweepsRegion.mapPartition("sweeps", SWEEP_STORE_SUBTYPE) &&
+        g_sweeps.attach(g_sweepsRegion.data(), g_sweepsRegion.size())) {
+        DEBUG_PRINTF("main: Sweeps mapped, %u long / %u short points.\n",
+                     (unsigned)g_sweeps.sweep(GapLength::Long).size(), (unsigned)g_sweeps.sweep(GapLength::Short).size());
+    } else {
+        DEBUG_PRINTLN("main: No sweeps partition.");
+    }
+}
+
+// Raw VNA sweeps of the last calibration run, and the error terms from its standards
+static void mapCal()
+{
+    if (g_calRegion.mapPartition("vnacal", CAL_STORE_SUBTYPE) && g_cal.attach(g_calRegion.data(), g_calRegion.size())) {
+        const CalSlotHeader* open = g_cal.header(CalSweep::Open);
+        DEBUG_PRINTF("main: VNA calibration mapped, run %08x.\n", open ? (unsigned)open->runId : 0u);
+        g_calCorrector.rebuild(&g_cal);
+    } else {
+        DEBUG_PRINTLN("main: No vnacal partition.");
+    }
+}
+
+// A calibration run rewrites the partition behind the mapped view
+static void onCalStoreChange(void*, bool complete)
+{
+    if (complete) {
+        mapCal();
+    } else {
+        g_calCorrector.rebuild(nullptr);
+        g_cal = CalStoreView();
+        g_calRegion.unmap();
+    }
+}
+
+// Uploads rewrite the partitions behind the mapped views: drop the mapping
+// before the first sector is erased and map what is there once the upload
+// ends. An upload writes its header last, so one that did not finish maps as
+// nothing rather than as a half-written table.
+// Tune jobs read the table, sweeps and personality, so relay jobs are held
+// off while any of them is swapped.
+static void onUploadTargetChange(UploadManager::Target target, bool done)
+{
+    g_relayExecutor.suspend();
+    switch (target) {
+    case UploadManager::Target::TuneTable:
+        if (done) {
+            mapTuneTable();
+        } else {
+            g_gaptuner.attachTuneTable(nullptr);
+            g_tuneTable = TuneTableView();
+            g_tuneTableRegion.unmap();
+        }
+        break;
+    case UploadManager::Target::Personality:
+        if (done) {
+            mapPersonality();
+        } else {
+            g_personality = PersonalityView();
+            g_personalityRegion.unmap();
+        }
+        break;
+    case UploadManager::Target::SweepLong:
+    case UploadManager::Target::SweepShort:
+        if (done) {
+            mapSweeps();
+        } else {
+            g_sweeps = SweepStoreView();
+            g_sweepsRegion.unmap();
+        }
+        break;
+    default:
+        break;
+    }
+    g_relayExecutor.resume();
+}
 
 // ==========================================================================
 // Arduino Setup and Loop
 // ==========================================================================
+// Duration of a start-up phase that began at startUs; returns now
+static uint32_t bootPhaseDone(BootPhase phase, uint32_t startUs)
+{
+    const uint32_t now = metricsMicros();
+    g_metrics.bootPhaseUs[size_t(phase)].set(int32_t(now - startUs));
+    return now;
+}
+
 void setup()
 {
     #if DEBUG > 0
@@ -40,176 +195,92 @@ void setup()
     #endif
     DEBUG_PRINTLN("\nStarting GAP Antenna Tuner Controller (v3)...");
 
-    // Check and handle WiFi reset button press
-    g_networkMgr.checkAndHandleWiFiResetButton();
+    // Dataset memory first, while PSRAM is in one piece
+    if (g_arenas.begin()) {
+        g_calCorrector.setArena(&g_arenas.cal());
+        g_metrics.watchArena(ArenaId::Datasets, &g_arenas.datasets());
+        g_metrics.watchArena(ArenaId::Cal, &g_arenas.cal());
+    }
+
+    // NVS once, for the WiFi credentials and cache and the rig settings
+    uint32_t t = metricsMicros();
+    NetworkMgr::initNvs();
+    g_networkMgr.begin();
+    t = bootPhaseDone(BootPhase::Nvs, t);
+
+    // Check and handle WiFi reset button press, unless it was pressed to
+    // wake the tuner from deep sleep
+    if (!PowerManager::wokenByButton()) {
+        g_networkMgr.checkAndHandleWiFiResetButton();
+    }
+    t = bootPhaseDone(BootPhase::ResetButton, t);
+
+    // The station associates (and gets its address) while the rest starts
+    const uint32_t wifiStartUs = t;
+    g_networkMgr.beginConnect();
 
+    g_relayController.attachMetrics(&g_metrics);
+    g_relayExecutor.attachMetrics(&g_metrics);
+    g_relayExecutor.attachState(&g_tunerState);
     g_relayController.initializePins();
     g_gaptuner.applyDefaultState();
+    // Back from deep sleep: the latching relays are where they were left
+    g_powerManager.restoreAfterSleep();
+    g_tunerState.relaysChanged(g_gaptuner);
+    if (!g_relayExecutor.begin()) {
+        DEBUG_PRINTLN("Setup: Could not start the relay task.");
+    }
+    t = bootPhaseDone(BootPhase::Relays, t);
+
+    mapTuneTable();
+    mapPersonality();
+    mapSweeps();
+    g_gaptuner.attachSolverData(&g_sweeps, &g_personality);
+    mapCal();
+    g_vnaSequencer.onStoreChange(onCalStoreChange, nullptr);
+    t = bootPhaseDone(BootPhase::Partitions, t);
 
-    // Initialize NVS flash
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        DEBUG_PRINTLN("main: NVS partition was truncated and needs to be erased.");
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+    // CAT follow mode, if set up on /rig; it waits for the network by itself
+    g_rigFollower.loadConfig();
+    g_powerManager.loadConfig();
+    if (!g_rigFollower.begin()) {
+        DEBUG_PRINTLN("Setup: Could not start the rig follower task.");
     }
-    ESP_ERROR_CHECK(ret);
-    DEBUG_PRINTLN("main: NVS flash initialized.");
+    g_webServerManager.setupRoutes();
+    g_uploadManager.onTargetChange(onUploadTargetChange);
+    g_uploadManager.setupRoutes();
+    t = bootPhaseDone(BootPhase::Rig, t);
 
-    if (g_networkMgr.connect()) {
-        g_networkMgr.setupMDNS();
-        g_webServerManager.setupRoutes();
+    const bool connected = g_networkMgr.waitConnected();
+    t = metricsMicros();
+    g_metrics.bootPhaseUs[size_t(BootPhase::WiFi)].set(int32_t(t - wifiStartUs));
+    g_metrics.wifiFastConnect.set(g_networkMgr.fastConnected() ? 1 : 0);
+    if (connected) {
         g_webServerManager.begin();
+        t = bootPhaseDone(BootPhase::Server, t);
+        g_metrics.bootReadyUs.set(int32_t(t));
+        g_networkMgr.setupMDNS(); // after the server: HTTP by IP works meanwhile
     } else {
         DEBUG_PRINTLN("Setup: WiFi connection failed. Starting configuration AP.");
-        // The NetworkMgr::connect() method should handle starting the AP if connection fails.
+        // NetworkMgr::waitConnected() has started the AP.
+    }
 
+    DEBUG_PRINTF("Setup: ready %u ms after app start%s\n", (unsigned)(t / 1000),
+                 g_networkMgr.fastConnected() ? " (fast WiFi reconnect)" : "");
+    for (size_t i = 0; i < size_t(BootPhase::Count); i++) {
+        DEBUG_PRINTF("  %-12s %5u ms\n", TunerMetrics::bootPhaseName(BootPhase(i)),
+                     (unsigned)(g_metrics.bootPhaseUs[i].value() / 1000));
     }
 }
 
 void loop()
 {
-    // Do nothing here. Application is driven through http requests to AsyncWebserver
-    // See WebServerManager::handle* which processes incoming http requests and acts on them.
+    // The application is driven through http requests to AsyncWebserver (see
+    // WebServerManager::handle*); here only the DHCP lease cache, the link
+    // status pushed on /events and the power state, which may sleep in
+    // service() while DORMANT
+    g_networkMgr.service();
+    g_webServerManager.service(millis());
+    g_powerManager.service(millis());
+    delay(100);
 }
-
-// Gap Tuner UI HTML and Javascript
-const char index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0, user-scalable=no">
-    <title>GAP Antenna Tuner</title>
-    <style>
-        :root{--icom-black:#1a1a1a;--icom-dark-grey:#2c2c2c;--icom-light-grey:#e0e0e0;--icom-blue-accent:#00aaff;--icom-shadow-dark:rgba(0,0,0,0.6);--icom-shadow-light:rgba(255,255,255,0.05);--border-radius:5px;--group-spacing:25px;--button-v-spacing:10px;--button-h-spacing:8px;--button-bg:var(--icom-button-grey);--button-text:var(--icom-light-grey);--icom-button-grey:#424242;}
-        body{font-family:-apple-system,BlinkMacSystemFont,"Segoe UI",Roboto,Helvetica,Arial,sans-serif;display:flex;justify-content:center;align-items:flex-start;min-height:100vh;background-color:var(--icom-black);margin:0;padding:20px 15px;box-sizing:border-box;-webkit-tap-highlight-color:transparent;}
-        .container{background:var(--icom-dark-grey);padding:25px 30px;border-radius:var(--border-radius);box-shadow:0 0 15px var(--icom-shadow-dark), inset 0 0 5px var(--icom-shadow-light);text-align:center;width:100%;max-width:380px;box-sizing:border-box;}
-        
-        h1{color:var(--icom-light-grey);margin-top:0;margin-bottom: 0px; font-weight:600;font-size:1.6em;}
-
-        .wifi-status-line { text-align: center; margin-bottom: 30px; height: 1.2em; }
-        #wifiStatusIndicator { display: inline-block; width: 15px; height: 15px; border-radius: 50%; margin-right: 6px; vertical-align: middle; background-color: #ffc107; transition: background-color 0.5s ease; }
-        .wifi-online { background-color: #28a745 !important; }
-        .wifi-offline { background-color: #dc3545 !important; }
-        #wifiStatusText { font-size: 1.0em; vertical-align: middle; color: var(--icom-light-grey); }
-        
-        .button-group{margin-bottom:var(--group-spacing);text-align:left;}
-        .button-group:last-child{margin-bottom:15px;}
-        .group-title{font-size:0.9em;font-weight:600;color:var(--icom-light-grey);text-transform:uppercase;letter-spacing:0.5px;margin-bottom:15px;padding-left:5px;}
-        
-        button { padding:12px 10px; font-size:0.95rem; font-weight:500; text-align:center; cursor:pointer; border: 1px solid var(--icom-black); border-radius:var(--border-radius); background-color: var(--button-bg); color:var(--button-text); transition: background-color 0.15s ease, transform 0.05s ease, box-shadow 0.15s ease; -webkit-tap-highlight-color: transparent; box-sizing:border-box; outline: none; box-shadow: inset 0 2px 5px var(--icom-shadow-light), inset 0 -2px 5px var(--icom-shadow-dark), 0 2px 4px var(--icom-shadow-dark); text-shadow: 0 1px 2px rgba(0,0,0,0.5); }
-        button:focus, button:focus-visible { background-color: var(--icom-blue-accent); color: var(--icom-black); box-shadow: inset 0 1px 3px var(--icom-shadow-dark), 0 1px 2px var(--icom-shadow-dark); }
-        button:active { background-color: var(--icom-blue-accent); transform: translateY(1px) scale(0.98); box-shadow: inset 0 1px 3px var(--icom-shadow-dark); }
-        .highlighted { background-color: var(--icom-blue-accent); color: var(--icom-black); box-shadow: inset 0 1px 3px var(--icom-shadow-dark), 0 1px 2px var(--icom-shadow-dark); }
-        
-        .button-group .button-stack button{display:block;width:100%;margin-bottom:var(--button-v-spacing);}
-        .button-group .button-stack button:last-child{margin-bottom:0;}
-        .button-group .button-row{display:flex;gap:var(--button-h-spacing);justify-content:space-between;}
-        .button-group .button-row button{flex:1;}
-        .status{margin-top:25px; font-size:0.85em; color:var(--icom-light-grey); min-height:3em; line-height:1.4; text-align:left; background-color: var(--icom-black); padding: 8px 12px; border-radius: 5px; white-space: pre-wrap;}
-    </style>
-</head>
-<body>
-    <div class="container" id="controlContainer">
-        <h1>GAP Antenna Tuner</h1>
-        <div class="wifi-status-line"> <span id="wifiStatusIndicator"></span><span id="wifiStatusText">Checking...</span> </div>
-        <div class="button-group"> <h3 class="group-title">Antenna Length</h3> <div class="button-row"> <button data-id="1">Shorter</button> <button data-id="2">Longer</button> </div> </div>
-        <div class="button-group"> <h3 class="group-title">Tuning Network</h3> <div class="button-row"> <button data-id="3">None</button> <button data-id="4">1</button> <button data-id="5">2</button> </div> </div>
-        <div class="button-group"> <h3 class="group-title">Calibration</h3> <div class="button-row"> <button data-id="6">Open</button> <button data-id="7">Short</button> <button data-id="8">Load</button> </div> </div>
-        <div class="status" id="statusMessage">Select an option above.</div>
-    </div>
-    <script>
-        document.addEventListener('DOMContentLoaded', () => {
-            const controlContainer = document.getElementById('controlContainer');
-            const statusMessage = document.getElementById('statusMessage');
-            let lastHighlightedAntennaButton = null; // To keep track of the last highlighted button in the antenna group
-            let lastHighlightedOtherButton = null;    // To keep track of the last highlighted button in the other group
-
-            // Helper function to determine button group
-            function getButtonGroup(buttonId) {
-                const id = parseInt(buttonId, 10);
-                if (id === 1 || id === 2) {
-                    return 'antenna'; // ANTENNA_SHORT, ANTENNA_LONG
-                } else if (id >= 3 && id <= 8) {
-                    return 'other'; // TUNING_NONE, TUNING_1, TUNING_2, CAL_OPEN, CAL_SHORT, CAL_LOAD
-                }
-                return 'unknown'; // Should not happen with valid button IDs
-            }
-
-            function checkWifiStatus() {
-                const wifiIndicator = document.getElementById('wifiStatusIndicator');
-                const wifiStatusText = document.getElementById('wifiStatusText');
-                if (!wifiIndicator || !wifiStatusText) { console.warn("WiFi status elements not found yet."); return; }
-                const controller = new AbortController();
-                const timeoutId = setTimeout(() => controller.abort(), 5000); // Increased timeout to 5 seconds
-                fetch('/wifi-status', { signal: controller.signal })
-                    .then(response => {
-                        clearTimeout(timeoutId);
-                        if (!response.ok) { console.warn(`WiFi status endpoint error: ${response.status}`); throw new Error(`Status request server error: ${response.status}`); }
-                        return response.text();
-                    })
-                    .then(status => {
-                        console.log("WiFi Status from ESP32:", status);
-                        if (status === "online") { wifiIndicator.className = 'wifi-online'; wifiStatusText.textContent = "Online"; }
-                        else { wifiIndicator.className = 'wifi-offline'; wifiStatusText.textContent = "Offline (Reported)"; }
-                    })
-                    .catch(error => {
-                        clearTimeout(timeoutId);
-                        console.error("Error checking WiFi status:", error.name, error.message);
-                        if (wifiIndicator) wifiIndicator.className = 'wifi-offline';
-                        if (wifiStatusText) {
-                            if (error.name === 'AbortError') { wifiStatusText.textContent = "Offline (Timeout)"; }
-                            else { wifiStatusText.textContent = "Offline (Unreachable)"; }
-                        }
-                    });
-            }
-            checkWifiStatus();
-            setInterval(checkWifiStatus, 5000);
-
-            if (controlContainer) {
-                controlContainer.addEventListener('click', event => {
-                    if (event.target.tagName === 'BUTTON' && event.target.dataset.id) {
-                        event.preventDefault();
-                        const button_id_str = event.target.dataset.id;
-                        const button_text_content = event.target.textContent;
-                        const currentButtonGroup = getButtonGroup(button_id_str);
-
-                        if (currentButtonGroup === 'antenna') {
-                            if (lastHighlightedAntennaButton && lastHighlightedAntennaButton !== event.target) {
-                                lastHighlightedAntennaButton.classList.remove('highlighted');
-                            }
-                            event.target.classList.add('highlighted');
-                            lastHighlightedAntennaButton = event.target;
-                        } else if (currentButtonGroup === 'other') {
-                            if (lastHighlightedOtherButton && lastHighlightedOtherButton !== event.target) {
-                                lastHighlightedOtherButton.classList.remove('highlighted');
-                            }
-                            event.target.classList.add('highlighted');
-                            lastHighlightedOtherButton = event.target;
-                        }
-                        // If 'unknown' group, do nothing with highlighting
-
-                        if (statusMessage) { statusMessage.textContent = `Sending: ${button_text_content}...`; }
-                        else { console.error("statusMessage element not found!"); }
-                        fetch(`/button?id=${button_id_str}`)
-                            .then(response => {
-                                if (!response.ok) return response.text().then(text_content => { throw new Error(`Server error: ${response.status} - ${text_content || "No details"}`) });
-                                return response.text();
-                            })
-                            .then(data_from_server => {
-                                console.log(`Button Action Response (Raw): ${data_from_server}`);
-                                if (statusMessage) { statusMessage.textContent = data_from_server; }
-                            })
-                            .catch(error_obj => {
-                                console.error("Error sending button command:", error_obj);
-                                if (statusMessage) { statusMessage.textContent = `Error: ${error_obj.message}`; }
-                            });
-                    }
-                });
-            } else { console.error("controlContainer element not found! Button clicks will not work."); }
-        });
-    </script>
-</body>
-</html>
-)rawliteral";
@@ -0,0 +1,180 @@
+"""Minify and gzip the web UI in web/ into a C++ header for the firmware.
+
+PlatformIO runs this before each build (extra_scripts in platformio.ini) and
+writes WebAssetData.h into the build directory; it can also be run by hand
+to see the sizes:
+
+    python3 tools/embed_web.py --out /tmp/web
+
+Each asset is served as stored, gzip-compressed, with a strong ETag (hash of
+the stored bytes). app.css and app.js get the hash in their URL and are
+cached as immutable; the page and the service worker keep fixed URLs and are
+revalidated (304 when unchanged). The minifiers only strip comments and
+whitespace; gzip does the rest.
+"""
+
+import gzip
+import hashlib
+import json
+import os
+import re
+import sys
+
+IMMUTABLE = "public, max-age=31536000, immutable"
+REVALIDATE = "no-cache"
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};,>])\s*", r"\1", text)
+    text = re.sub(r":\s+", ":", text)
+    text = re.sub(r"\s+!important", "!important", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_js(text):
+    """Drops comments and indentation; line breaks stay (no reliance on ASI
+    rules). Strings and template literals are copied as they are."""
+    out = []
+    i, n = 0, len(text)
+    while i < n:
+        c = text[i]
+        if c in "'\"`":
+            j = i + 1
+            while j < n and text[j] != c:
+                j += 2 if text[j] == "\\" else 1
+            out.append(text[i:j + 1])
+            i = j + 1
+        elif text.startswith("//", i):
+            i = text.find("\n", i)
+            i = n if i < 0 else i
+        elif text.startswith("/*", i):
+            i = text.find("*/", i) + 2
+        else:
+            out.append(c)
+            i += 1
+    lines = (line.strip() for line in "".join(out).split("\n"))
+    return "\n".join(line for line in lines if line)
+
+
+def minify_html(text):
+    def block(tag, minify):
+        def sub(m):
+            return m.group(1) + minify(m.group(2)) + m.group(3)
+        return lambda t: re.sub(r"(<%s[^>]*>)(.*?)(</%s>)" % (tag, tag), sub, t, flags=re.S)
+
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    text = block("style", minify_css)(text)
+    text = block("script", minify_js)(text)
+    # Whitespace between tags only separates inline elements; keep one space
+    text = re.sub(r">\s+<", "> <", text)
+    text = re.sub(r"\n\s*", "\n", text)
+    return text.strip()
+
+
+def read(name):
+    with open(os.path.join(WEB, name), encoding="utf-8") as f:
+        return f.read()
+
+
+def hashed_name(name, data):
+    stem, ext = os.path.splitext(name)
+    return "/%s.%s%s" % (stem, hashlib.sha256(data).hexdigest()[:10], ext)
+
+
+def build_assets():
+    """(symbol, path, content type, cache control, minified bytes) for each
+    asset, and the raw size of the sources"""
+    raw = sum(os.path.getsize(os.path.join(WEB, f)) for f in os.listdir(WEB))
+    css = minify_css(read("app.css")).encode()
+    js = minify_js(read("app.js")).encode()
+    css_path = hashed_name("app.css", css)
+    js_path = hashed_name("app.js", js)
+    page = minify_html(read("index.html").replace("{{app.css}}", css_path).replace("{{app.js}}", js_path)).encode()
+    version = hashlib.sha256(page + css + js).hexdigest()[:10]
+    sw = minify_js(read("sw.js").replace("{{version}}", version)
+                   .replace("{{assets}}", json.dumps([css_path, js_path]))).encode()
+    config = minify_html(read("config.html")).encode()
+    ui = [
+        ("index_html", "/", "text/html", REVALIDATE, page),
+        ("app_css", css_path, "text/css", IMMUTABLE, css),
+        ("app_js", js_path, "application/javascript", IMMUTABLE, js),
+        ("sw_js", "/sw.js", "application/javascript", REVALIDATE, sw),
+    ]
+    return ui, ("config_html", "/", "text/html", REVALIDATE, config), raw
+
+
+def c_array(symbol, data):
+    rows = []
+    for i in range(0, len(data), 20):
+        rows.append("    " + ",".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+    return "inline constexpr uint8_t %s[] = {\n%s\n};\n" % (symbol, "\n".join(rows))
+
+
+def generate(out_dir):
+    ui, config, raw = build_assets()
+    lines = [
+        "// Generated by tools/embed_web.py from web/ - do not edit",
+        "#ifndef WEB_ASSET_DATA_H",
+        "#define WEB_ASSET_DATA_H",
+        "",
+        '#include "WebAssets.h"',
+        "",
+    ]
+    entries = {}
+    sizes = []
+    for symbol, path, ctype, cache, data in ui + [config]:
+        gz = gzip.compress(data, 9, mtime=0)
+        etag = '"%s"' % hashlib.sha256(gz).hexdigest()[:16]
+        lines.append(c_array("s_web_" + symbol, gz))
+        entries[symbol] = '    {"%s", "%s", s_web_%s, sizeof(s_web_%s), "\\"%s\\"", "%s"},' % (
+            path, ctype, symbol, symbol, etag.strip('"'), cache)
+        sizes.append((path, len(data), len(gz)))
+    lines.append("// The control UI; the page first")
+    lines.append("inline constexpr WebAsset g_webUiAssets[] = {")
+    lines.extend(entries[a[0]] for a in ui)
+    lines.append("};")
+    lines.append("")
+    lines.append("// WiFi setup page of the configuration access point")
+    lines.append("inline constexpr WebAsset g_webConfigPage =")
+    lines.append(entries[config[0]].rstrip(",") + ";")
+    lines.append("")
+    lines.append("#endif // WEB_ASSET_DATA_H")
+    text = "\n".join(lines) + "\n"
+
+    os.makedirs(out_dir, exist_ok=True)
+    target = os.path.join(out_dir, "WebAssetData.h")
+    if not os.path.exists(target) or open(target, encoding="utf-8").read() != text:
+        with open(target, "w", encoding="utf-8") as f:
+            f.write(text)
+    return sizes, raw
+
+
+def report(sizes, raw):
+    print("web assets (web/ sources %d bytes):" % raw)
+    for path, minified, gz in sizes:
+        print("  %-24s %6d minified %6d gzip" % (path, minified, gz))
+    page_gz = sum(gz for path, _, gz in sizes[:3])
+    print("  control page load: %d bytes gzip, was %d (%.0f%% less); 304s after that"
+          % (page_gz, raw_page_bytes(), 100.0 * (1 - page_gz / raw_page_bytes())))
+
+
+def raw_page_bytes():
+    # What the single uncompressed page used to be: index.html with the
+    # stylesheet and script inline
+    return len(read("index.html").encode()) + len(read("app.css").encode()) + len(read("app.js").encode())
+
+
+if __name__ == "__main__":
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    WEB = os.path.join(ROOT, "web")
+    out = sys.argv[sys.argv.index("--out") + 1] if "--out" in sys.argv else os.path.join(ROOT, ".pio", "web")
+    report(*generate(out))
+else:
+    # PlatformIO extra script (no __file__ here)
+    Import("env")  # noqa: F821
+    WEB = os.path.join(env.subst("$PROJECT_DIR"), "web")  # noqa: F821
+    out = os.path.join(env.subst("$BUILD_DIR"), "web")  # noqa: F821
+    generate(out)
+    env.Append(CPPPATH=[out])  # noqa: F821
@@ -0,0 +1,144 @@
+document.addEventListener('DOMContentLoaded', () => {
+    const controlContainer = document.getElementById('controlContainer');
+    const statusMessage = document.getElementById('statusMessage');
+    const wifiIndicator = document.getElementById('wifiStatusIndicator');
+    const wifiStatusText = document.getElementById('wifiStatusText');
+    let stateVersion = 0;      // version of the last state pushed on /events
+    let pendingJob = null;     // job submitted from this page: {id, resolve, reject}
+    let lastMessageTime = 0;
+    let events = null;
+
+    // Helper function to determine button group
+    function getButtonGroup(buttonId) {
+        const id = parseInt(buttonId, 10);
+        if (id === 1 || id === 2) {
+            return 'antenna'; // ANTENNA_SHORT, ANTENNA_LONG
+        } else if (id >= 3 && id <= 8) {
+            return 'other'; // TUNING_NONE, TUNING_1, TUNING_2, CAL_OPEN, CAL_SHORT, CAL_LOAD
+        }
+        return 'unknown'; // Should not happen with valid button IDs
+    }
+
+    // Highlights exactly the buttons in ids within a group
+    function highlightGroup(group, ids) {
+        controlContainer.querySelectorAll('button[data-id]').forEach(button => {
+            if (getButtonGroup(button.dataset.id) === group) {
+                button.classList.toggle('highlighted', ids.includes(parseInt(button.dataset.id, 10)));
+            }
+        });
+    }
+
+    function showLink(online, text) {
+        if (!wifiIndicator || !wifiStatusText) return;
+        wifiIndicator.className = online ? 'wifi-online' : 'wifi-offline';
+        wifiStatusText.textContent = text;
+    }
+
+    // The tuner pushes its whole state on every change; one message is enough after a reconnect
+    function applyState(state) {
+        if (state.v <= stateVersion) return; // older than one already shown
+        stateVersion = state.v;
+        const job = state.job;
+        const finished = job.state === 'done' || job.state === 'failed';
+        // Keep the click's highlight until its own job has finished
+        if (!pendingJob || (job.id === pendingJob.id && finished)) {
+            highlightGroup('antenna', state.gap === 'long' ? [2] : state.gap === 'short' ? [1] : []);
+            highlightGroup('other', state.button ? [state.button] : []);
+        }
+        showLink(state.link.online, state.link.online ? `Online (${state.link.rssi} dBm)` : 'Offline (Reported)');
+        if (pendingJob && job.id === pendingJob.id && finished) {
+            const p = pendingJob;
+            pendingJob = null;
+            // Details (the relay report) are not pushed; fetch them once
+            fetch(`/job?id=${job.id}`).then(response => response.json()).then(p.resolve, p.reject);
+        } else if (!pendingJob && job.id && statusMessage && job.state !== 'unknown') {
+            statusMessage.textContent = job.state === 'running' ? 'Switching relays...' : job.message;
+        }
+    }
+
+    function connectEvents() {
+        if (!window.EventSource) { showLink(false, 'No live updates in this browser'); return; }
+        events = new EventSource('/events');
+        events.addEventListener('state', e => { lastMessageTime = Date.now(); applyState(JSON.parse(e.data)); });
+        events.addEventListener('ping', () => { lastMessageTime = Date.now(); });
+        events.onopen = () => { lastMessageTime = Date.now(); stateVersion = 0; }; // the tuner may have restarted its count
+        events.onerror = () => { showLink(false, 'Offline (Reconnecting)'); }; // EventSource retries by itself
+    }
+    connectEvents();
+    // The tuner sends a heartbeat every 15 s; a silent stream is a dead one
+    setInterval(() => {
+        if (events && events.readyState === EventSource.OPEN && Date.now() - lastMessageTime > 40000) {
+            showLink(false, 'Offline (Timeout)');
+            events.close();
+            connectEvents();
+        }
+    }, 10000);
+
+    // Relay requests are queued; the result arrives on /events, or
+    // by polling /job while the event stream is down
+    function pollJob(id) {
+        return new Promise((resolve, reject) => {
+            const poll = () => fetch(`/job?id=${id}`)
+                .then(response => {
+                    if (!response.ok) throw new Error(`Job status error: ${response.status}`);
+                    return response.json();
+                })
+                .then(job => {
+                    if (job.state === 'queued' || job.state === 'running') { setTimeout(poll, 100); }
+                    else { resolve(job); }
+                })
+                .catch(reject);
+            poll();
+        });
+    }
+
+    function waitJob(id) {
+        if (!events || events.readyState !== EventSource.OPEN) return pollJob(id);
+        if (pendingJob) pendingJob.resolve({ id: pendingJob.id, state: 'superseded' });
+        return new Promise((resolve, reject) => {
+            pendingJob = { id, resolve, reject };
+            // Superseded jobs never run, so no event reports them
+            setTimeout(() => { if (pendingJob && pendingJob.id === id) { pendingJob = null; pollJob(id).then(resolve, reject); } }, 3000);
+        });
+    }
+
+    if (controlContainer) {
+        controlContainer.addEventListener('click', event => {
+            if (event.target.tagName === 'BUTTON' && event.target.dataset.id) {
+                event.preventDefault();
+                const button_id_str = event.target.dataset.id;
+                const button_text_content = event.target.textContent;
+                const currentButtonGroup = getButtonGroup(button_id_str);
+
+                // Shown at once; the pushed state confirms or corrects it
+                if (currentButtonGroup !== 'unknown') { highlightGroup(currentButtonGroup, [parseInt(button_id_str, 10)]); }
+
+                if (statusMessage) { statusMessage.textContent = `Sending: ${button_text_content}...`; }
+                else { console.error("statusMessage element not found!"); }
+                fetch(`/button?id=${button_id_str}`)
+                    .then(response => {
+                        if (!response.ok) return response.text().then(text_content => { throw new Error(`Server error: ${response.status} - ${text_content || "No details"}`) });
+                        return response.json();
+                    })
+                    .then(job => waitJob(job.id))
+                    .then(job => {
+                        console.log(`Button Action Result: ${job.state}`, job);
+                        if (job.state === 'failed') throw new Error(job.message);
+                        const text = job.state === 'superseded' ? 'Replaced by a newer request.' : `${job.message}\n${job.details}`;
+                        if (statusMessage) { statusMessage.textContent = text; }
+                    })
+                    .catch(error_obj => {
+                        console.error("Error sending button command:", error_obj);
+                        if (statusMessage) { statusMessage.textContent = `Error: ${error_obj.message}`; }
+                    });
+            }
+        });
+    } else { console.error("controlContainer element not found! Button clicks will not work."); }
+});
+
+// Lets the page open from cache when the tuner is out of reach. Browsers
+// only allow service workers on https or localhost, so over plain
+// http://gaptuner.local this is skipped and the HTTP cache does the work.
+if ('serviceWorker' in navigator && window.isSecureContext) {
+    navigator.serviceWorker.register('/sw.js').catch(error => console.warn('Service worker not registered:', error));
+}
@@ -0,0 +1,39 @@
+// Service worker for the control page. The build (tools/embed_web.py) fills
+// in the content-hashed asset names, so a new firmware means a new cache.
+const CACHE = 'gaptuner-{{version}}';
+const PAGE = '/';
+const ASSETS = {{assets}}; // immutable, content-hashed URLs
+
+self.addEventListener('install', event => {
+    event.waitUntil(caches.open(CACHE).then(cache => cache.addAll([PAGE, ...ASSETS])).then(() => self.skipWaiting()));
+});
+
+self.addEventListener('activate', event => {
+    event.waitUntil(caches.keys()
+        .then(keys => Promise.all(keys.filter(key => key !== CACHE).map(key => caches.delete(key))))
+        .then(() => self.clients.claim()));
+});
+
+// The page: network first (it revalidates with its ETag), the cached copy
+// when the tuner does not answer within 3 s. Hashed assets: cache first.
+// Everything else (relay requests, /events, /metrics) is not touched.
+self.addEventListener('fetch', event => {
+    const url = new URL(event.request.url);
+    if (event.request.method !== 'GET' || url.origin !== self.location.origin) return;
+    if (ASSETS.includes(url.pathname)) {
+        event.respondWith(caches.match(event.request).then(cached => cached || fetch(event.request)));
+    } else if (url.pathname === PAGE) {
+        const network = fetch(event.request).then(response => {
+            if (response.ok) {
+                const copy = response.clone();
+                caches.open(CACHE).then(cache => cache.put(PAGE, copy));
+            }
+            return response;
+        });
+        const timeout = new Promise(resolve => setTimeout(resolve, 3000));
+        event.respondWith(Promise.race([network, timeout])
+            .then(response => response || caches.match(PAGE))
+            .catch(() => caches.match(PAGE))
+            .then(response => response || network));
+    }
+});